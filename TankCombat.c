@@ -15,6 +15,60 @@
         Code Key:
             Player 1 = P0
             Player 2 = P1 (AI)
+        Build Options (pass to cl65 with -D<OPTION>):
+            FRAME_BUDGET            = Record the scanlines each frame uses before waitvsync and count frames
+                                      that miss vertical blank
+            FRAME_BUDGET_SCENARIO=n = Drive player 1 from a built in joystick script (1 = both tanks firing,
+                                      2 = wall scrubbing, 3 = sitting still taking hits until game over)
+                                      and write every frame's scanlines to H:BUDGET.BIN for
+                                      tools/budgetsuite.py
+            FRAME_BUDGET_FRAMES=n   = Frames a scenario runs before its report is finished (default 3600)
+            NARROW_PLAYFIELD        = Narrow (128 color clock) playfield instead of the normal 160, for less
+                                      playfield DMA
+            PM_DOUBLE_LINE          = Double line player-missile resolution: half the PM memory and half the
+                                      sprite rows to redraw, with 4 row tank pictures
+            PM_DOUBLE_BUFFER        = Draw each frame into a second player-missile bank and flip PMBASE to it
+                                      in vertical blank, so sprites are never redrawn in front of the beam
+            BEAM_RACE               = Redraw each tank and shell as soon as the beam is below it, found from
+                                      VCOUNT, instead of all at once (not with PM_DOUBLE_BUFFER)
+            INPUT_LATENCY           = Count the frames from a joystick press to the tank visibly responding
+                                      in the inputLatency histogram
+            MEM_DEBUG               = Paint free heap and C stack memory at startup and report the stack's
+                                      high-water mark and free RAM in memReport at every game over
+            FRAME_TRACE             = Write a binary record of every frame into the frameTrace ring buffer
+                                      for tools/tracestat (turns on FRAME_BUDGET for the scanline counts)
+            FRAME_SEARCH            = Press OPTION at the winner banner to search for the game state whose
+                                      frame takes the most scanlines and keep it in frameSearch for
+                                      tools/tracestat (turns on FRAME_BUDGET)
+            TANK_HULLS              = Compile in tankHull, the solid tank outlines from tankgfx.h
+            HEADINGS_32             = 32 tank headings on true angles instead of 16, with the pictures,
+                                      steps and barrel tips from tankgfx32.h (made by tools/mksprites)
+            VARIANT=n               = Game variant from variants.h (1 = Tank, 2 = Tank-Pong, 3 = Invisible
+                                      Tank, 4 = Invisible Tank-Pong, 5 = Blitz), each its own build
+            RICOCHET                = Shells bounce off walls (up to RICOCHET_BOUNCES times) like the
+                                      original Combat's bouncing shot games
+            INVISIBLE_TANKS         = Tanks are only shown for REVEAL_FRAMES after firing and while
+                                      spinning from a hit
+            AI_VM                   = Run the AI from a bytecode script in aiprofiles.h, at most
+                                      AI_VM_BUDGET instructions a movement tick
+            AI_PROFILE=n            = AI_VM difficulty profile the game starts with (1 = easy, 2 = normal,
+                                      3 = hard), START steps through them while the game is not on
+            AI_EVASION              = The AI drives out of the path of player 1's shells, using the
+                                      threatSweep tables built at startup
+            XE_BANKS                = Use a 130XE's extended memory for the match input log, played back
+                                      with SELECT at the winner banner, and a cache of the arenas loaded
+                                      from the level disk (XEX builds only)
+            PROFILER                = Sample the program counter from a POKEY timer 4 interrupt during play
+                                      into profileHistogram, for tools/profsym.py
+            NO_OS                   = On an XL/XE, switch the OS ROM out after startup and run on the
+                                      game's own vertical blank handler, caching level disk arenas in
+                                      the RAM under the ROM
+            LEVELS                  = Play the arenas on the level disk in D2: (made by tools/mklevels), loading
+                                      the next one while the winner banner is showing, through the game's
+                                      own interrupt driven serial I/O rather than the OS's SIOV
+            SCROLL_ARENA            = Play in an arena bigger than the screen (ARENA_WIDTH x ARENA_ROWS bit
+                                      map bytes, 16 x 32 by default) that scrolls to follow the tanks, by
+                                      display list LMS addresses and fine scrolling (not with LEVELS)
     --------------------------------------------------------------------------------------------------------------------
 */
 
@@ -33,27 +87,50 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <joystick.h>
+#ifdef MEM_DEBUG
+#include <_heap.h>
+#endif
+#if defined(FRAME_SEARCH) || defined(NO_OS) || defined(XE_BANKS) || defined(LEVELS)
+#include <string.h>
+#endif
+
+//Gameplay settings of the selected VARIANT, and the rules it turns on
+#include "variants.h"
 
 /*
     ----------------------------------------------- IDENTIFIERS -------------------------------------------------------
 */
-//Defining the 16 tank rotations
-#define NORTH               0
-#define NORTH_15            1
-#define NORTH_EAST          2
-#define NORTH_60            3
-#define EAST                4
-#define EAST_15             5
-#define EAST_SOUTH          6
-#define EAST_60             7
-#define SOUTH               8
-#define SOUTH_15            9
-#define SOUTH_WEST          10
-#define SOUTH_60            11
-#define WEST                12
-#define WEST_15             13
-#define WEST_NORTH          14
-#define WEST_60             15
+//Defining the 16 named tank rotations; HEADINGS_32 puts another heading between each pair
+#ifdef HEADINGS_32
+#define HEADING_SCALE       2
+#else
+#define HEADING_SCALE       1
+#endif
+#define NORTH               (0 * HEADING_SCALE)
+#define NORTH_15            (1 * HEADING_SCALE)
+#define NORTH_EAST          (2 * HEADING_SCALE)
+#define NORTH_60            (3 * HEADING_SCALE)
+#define EAST                (4 * HEADING_SCALE)
+#define EAST_15             (5 * HEADING_SCALE)
+#define EAST_SOUTH          (6 * HEADING_SCALE)
+#define EAST_60             (7 * HEADING_SCALE)
+#define SOUTH               (8 * HEADING_SCALE)
+#define SOUTH_15            (9 * HEADING_SCALE)
+#define SOUTH_WEST          (10 * HEADING_SCALE)
+#define SOUTH_60            (11 * HEADING_SCALE)
+#define WEST                (12 * HEADING_SCALE)
+#define WEST_15             (13 * HEADING_SCALE)
+#define WEST_NORTH          (14 * HEADING_SCALE)
+#define WEST_60             (15 * HEADING_SCALE)
+#define HEADINGS            (16 * HEADING_SCALE)   //number of tank rotations, a power of 2
+#define QUARTER_TURN        (HEADINGS / 4)
+#ifdef HEADINGS_32
+//the steps in tankgfx32.h are all one pixel long
+#define SLOW_HEADING(direction) 0
+#else
+//the odd headings step (2, 1) pixels, so they only move every other tick
+#define SLOW_HEADING(direction) ((direction) & 1)
+#endif
 
 /*
     // FORWARD, BACKWARD, LEFT TURN, RIGHT TURN, FIRE
@@ -74,52 +151,546 @@
 #define M0PF                0xD000         //Missile 0 to Playfield Collision Register
 #define M1P                 0xD009         //Missile 1 to Player Collision Register
 #define M0P                 0xD008         //Missile 0 to Player Collision Register
+                                           //(M2 and M3 follow at M0PF + 2/3 and M0P + 2/3)
 
 #define HITCLR              0xD01E         //Collsion Clear Register: Poking a 1 clears ALL collision registers
+#define PORTA               0xD300         //PIA Port A: joystick 0 directions in the low nibble, 0 = pressed
+#define TRIG0               0xD010         //GTIA Joystick 0 Trigger: 0 = pressed
+#define CONSOLE_KEYS        0xD01F         //GTIA CONSOL: a console key's bit reads 0 while it is held
+#define START_KEY           0x01
+#define SELECT_KEY          0x02
+#define OPTION_KEY          0x04
+#define RTCLOK_LOW          0x14           //Real Time Clock low byte, incremented by the OS every vertical blank
+#define RTCLOK_MID          0x13           //Real Time Clock middle byte, cleared at cold boot like the rest of the clock
+#define RTCLOK_HIGH         0x12           //Real Time Clock high byte
+#define HPOSP0              0xD000         //Player 0 Horizontal Position Register (P1 follows at HPOSP0 + 1)
+#define HPOSM0              0xD004         //Missile 0 Horizontal Position Register (M1 - M3 follow at HPOSM0 + 1/2/3)
+#define DLISTL              0xD402         //ANTIC Display List Pointer (high byte follows), shadowed at SDLSTL
+#define SDLSTL              0x230          //OS display list pointer shadow, copied to DLISTL every vertical blank
+#define HSCROL              0xD404         //ANTIC Horizontal Fine Scroll, color clocks the scrolled lines move right
+#define VSCROL              0xD405         //ANTIC Vertical Fine Scroll, scanlines of the first scrolled line left out
+#define PMBASE              0xD407         //ANTIC Player-Missile Base Address Register (page), not shadowed by the OS
+#define VCOUNT              0xD40B         //ANTIC Vertical Line Counter: current scanline divided by 2
+#define SETVBV              0xE45C         //OS routine that sets a vertical blank vector: A = 7 for deferred, X/Y = high/low
+#define XITVBV              0xE462         //OS vertical blank exit, where a deferred routine ends
+#define AUDCTL              0xD208         //POKEY Audio Control: 0 for the 64 kHz clock on every channel
+#define AUDF4               0xD206         //POKEY channel 4 frequency, timer 4's divider
+#define AUDC4               0xD207         //POKEY channel 4 control, 0 for silent
+#define SKCTL               0xD20F         //POKEY Serial Port Control, the timers only run with bits 0 - 1 set
+#define IRQEN               0xD20E         //POKEY IRQ Enable, write only
+#define IRQST               0xD20E         //POKEY IRQ Status, read only: a bit reads 0 while its interrupt is pending
+#define POKMSK              0x10           //OS copy of IRQEN, the OS's IRQ handlers write it back to IRQEN
+#define TIMER4_IRQ          0x04           //IRQEN bit for POKEY timer 4, the channel the game's sounds leave alone
+#define PORTB               0xD301         //PIA Port B: memory control on XL/XE machines, joysticks 3 and 4 on the 800
+#define PCOLR0              0x2C0          //Player 0 color shadow (P1 follows at PCOLR0 + 1)
+#define COLOR1              0x2C5          //Playfield color 1 shadow, the color of the bit map walls
+#define COLOR3              0x2C7          //Playfield color 3 shadow, the color of all four missiles in fifth player mode
+#define GPRIOR              0x26F          //GTIA priority shadow, bit 4 turns on fifth player mode
+
+//missile pool definitions
+//Each tank owns MISSILES_PER_TANK shells. Shell n is drawn with hardware missile n, so tank 0 fires
+//M0 (and M2) and tank 1 fires M1 (and M3): the tank that owns a shell is always (shell & 1).
+//MISSILES_PER_TANK comes from variants.h.
+#define MISSILE_POOL_SIZE   (MISSILES_PER_TANK * 2)
+
+//ricochet definitions, wall orientations used to index reflectDirection
+#define WALL_VERTICAL       0
+#define WALL_HORIZONTAL     1
+#define WALL_CORNER         2
+#define RICOCHET_BOUNCES    4              //bounces before a shell burns out
+#define BOUNCE_GUARD_FRAMES 2              //frames a shell ignores walls after bouncing while it backs out
+
+//playfield bit map layout, used to draw the arena and look up walls under a missile
+#ifdef NARROW_PLAYFIELD
+#define DMA_PLAYFIELD       0x01           //DMACTL narrow playfield, 128 color clocks wide
+#define PLAYFIELD_LEFT      64             //horizontal position of the first bit map pixel
+#define PLAYFIELD_WIDTH     8              //bytes per bit map row, 4 pixels per byte
+#define SCORE_LINE_WIDTH    16             //characters in the score line
+#else
+#define DMA_PLAYFIELD       0x02           //DMACTL normal playfield, 160 color clocks wide
+#define PLAYFIELD_LEFT      48
+#define PLAYFIELD_WIDTH     10
+#define SCORE_LINE_WIDTH    20
+#endif
+#define PLAYFIELD_RIGHT     (PLAYFIELD_LEFT + PLAYFIELD_WIDTH * 16)   //horizontal position just past the last pixel
+#define PLAYFIELD_TOP       48             //scanline of the first bit map row
+#define PLAYFIELD_ROWS      22             //bit map rows, each 8 scanlines tall
+
+//offsets of the addresses in displayListTemplate
+#define DL_SCORE_LMS        4
+#define DL_BITMAP_LMS       7
+#define DL_JUMP             (sizeof(displayListTemplate) - 2)
+
+//Scrolling arena: the bit map is ARENA_WIDTH x ARENA_ROWS bytes and the playfield is a window onto it. Every
+//bit map line of the display list has its own LMS address, so moving the window a whole byte or row rewrites
+//those PLAYFIELD_ROWS addresses and moving it less only changes HSCROL and VSCROL, however big the arena is.
+//The last line is not vertically scrolled, which leaves a window VIEW_SCANLINES tall. The view is kept in
+//arena color clocks and scanlines, and its left edge is never at 0, so no line's LMS address is before its
+//row of the arena. Without SCROLL_ARENA the arena is the playfield.
+#ifdef SCROLL_ARENA
+#ifdef LEVELS
+#error The level disk arenas are one screen, build SCROLL_ARENA without LEVELS
+#endif
+#ifndef ARENA_WIDTH
+#define ARENA_WIDTH         16             //bytes per arena row, 256 color clocks
+#endif
+#ifndef ARENA_ROWS
+#define ARENA_ROWS          32             //arena rows, 256 scanlines
+#endif
+#define ARENA_BYTES         (ARENA_WIDTH * ARENA_ROWS)
+#if ARENA_WIDTH <= PLAYFIELD_WIDTH || ARENA_WIDTH > 32 || ARENA_ROWS <= PLAYFIELD_ROWS || ARENA_BYTES > 4096
+#error The arena has to be wider and taller than the playfield, at most 32 bytes wide and 4K in all
+#endif
+#if (defined(FRAME_TRACE) || defined(FRAME_SEARCH)) && (ARENA_WIDTH > 16 || ARENA_ROWS > 32)
+#error Frame trace and search records keep board positions in a byte, the arena can be at most 16 x 32
+#endif
+#define VIEW_SCANLINES      ((PLAYFIELD_ROWS - 1) * 8 + 1)
+#define VIEW_LEFT_MIN       1
+#define VIEW_LEFT_MAX       ((ARENA_WIDTH - PLAYFIELD_WIDTH) * 16)
+#define VIEW_TOP_MAX        (ARENA_ROWS * 8 - VIEW_SCANLINES)
+#define SCROLL_LIST_SIZE    128            //room for each display list, on a boundary so it never crosses 1K
+#define SCROLL_LIST_BYTES   (6 + PLAYFIELD_ROWS * 3 + 3)
+#define SCROLL_NONE         255            //listColumn of a display list with no arena position written yet
+#else
+#define ARENA_WIDTH         PLAYFIELD_WIDTH
+#define ARENA_ROWS          PLAYFIELD_ROWS
+#endif
+
+#define SCORE_P0_COLUMN     (SCORE_LINE_WIDTH / 4)
+#define SCORE_P1_COLUMN     (SCORE_LINE_WIDTH - 1 - SCORE_LINE_WIDTH / 4)
+#define BANNER_COLUMN       ((SCORE_LINE_WIDTH - 8) / 2)                //first column of the 8 character winner banner
+
+//fixed point positions: whole pixels in the top 12 bits, sixteenths of a pixel in the bottom 4
+#define FP_SHIFT            4
+#define FP_ONE              (1 << FP_SHIFT)
+#define TO_FP(n)            ((n) * FP_ONE)
+#define FP_INT(v)           ((v) >> FP_SHIFT)
+
+//board frame: row 0 is scanline BOARD_TOP and column 0 is horizontal position BOARD_LEFT, just inside the walls.
+//A tank's board position is the middle of its 8x8 sprite, TANK_HALF in from its top left corner.
+//With SCROLL_ARENA those are where the arena's top left corner would be with the view at 0, 0.
+#define BOARD_TOP           55
+#define BOARD_LEFT          (PLAYFIELD_LEFT + 4)
+#define TANK_HALF           4
+#define BOARD_WRAP_LEFT     2              //a spinning tank pushed past these comes out on the other side
+#define BOARD_WRAP_RIGHT    (ARENA_WIDTH * 16 - 13)
+#define BOARD_WRAP_TOP      6
+#define BOARD_WRAP_BOTTOM   (ARENA_ROWS * 8 - 20)
+
+//horizontal position and scanline of a board column and row on screen
+#ifdef SCROLL_ARENA
+#define VIEW_HORIZONTAL(column) ((column) + BOARD_LEFT - viewLeft)
+#define VIEW_SCANLINE(row)      ((row) + BOARD_TOP - viewTop)
+#else
+#define VIEW_HORIZONTAL(column) ((column) + BOARD_LEFT)
+#define VIEW_SCANLINE(row)      ((row) + BOARD_TOP)
+#endif
+
+//starting tank positions, one screen's width apart in the middle of the arena
+#define TANK_START_ROW      ((ARENA_ROWS - PLAYFIELD_ROWS) * 4 + 80)
+#define TANK0_START_COLUMN  ((ARENA_WIDTH - PLAYFIELD_WIDTH) * 8 + 9)
+#define TANK1_START_COLUMN  ((ARENA_WIDTH + PLAYFIELD_WIDTH) * 8 - 18)
+
+//colors, and the score line characters that show a score of 0 (the digits follow in order)
+#define TANK0_COLOR         70
+#define TANK1_COLOR         40
+#define SHELL_COLOR         14             //missile color in fifth player mode, for invisible tanks
+#define SCORE_P0_ZERO       208
+#define SCORE_P1_ZERO       16
+
+//player-missile memory layout
+//Vertical locations are kept in scanlines. PM_ROW turns one into a row of PM memory, and because player 1's
+//256 scanline offset halves along with everything else it lands on player 1's memory in both resolutions.
+#ifdef PM_DOUBLE_LINE
+#define DMA_PM_RESOLUTION   0x00           //DMACTL double line player-missile resolution
+#define PM_SHIFT            1
+#define PM_BANK_SIZE        1024           //size (and alignment) of the player-missile memory
+#define PM_MISSILE_OFFSET   384
+#define PM_PLAYER_OFFSET    512
+#define TANK_ROWS           4              //PM memory rows in a tank picture
+#else
+#define DMA_PM_RESOLUTION   0x10           //DMACTL single line player-missile resolution
+#define PM_SHIFT            0
+#define PM_BANK_SIZE        2048
+#define PM_MISSILE_OFFSET   768
+#define PM_PLAYER_OFFSET    1024
+#define TANK_ROWS           8
+#endif
+#define PM_ROW(scanline)    ((scanline) >> PM_SHIFT)
+#define PM_PLAYER_STRIDE    PM_ROW(256)    //bytes between player 0's and player 1's memory
+
+//Double buffering: the frame is drawn into the back bank while ANTIC shows the other one, and the deferred
+//vertical blank routine flipVBI points PMBASE at it and copies the horizontal positions from hposShadow.
+//Single buffered, the one bank is always the back bank and positions go straight to the registers.
+#ifdef PM_DOUBLE_BUFFER
+#define PM_BANKS            2
+#define POKE_HPOS(address, value)   (hposShadow[(address) - HPOSP0] = (value))
+#else
+#define PM_BANKS            1
+#define pmBack              0
+#define POKE_HPOS(address, value)   POKE(address, value)
+#endif
+
+//the deferred vertical blank routine: flipVBI goes on to scrollVBI when there are both
+#ifdef PM_DOUBLE_BUFFER
+#define DEFERRED_VBI        flipVBI
+#elif defined(SCROLL_ARENA)
+#define DEFERRED_VBI        scrollVBI
+#endif
+
+//Beam racing: commitFrame waits for the beam to pass below everything an object covers, where it was drawn
+//and where it is going, before redrawing it, so no object is ever seen half redrawn. The new picture shows
+//from the next frame, as it does double buffered. RACE_LINE is the first VCOUNT reading with the beam at or
+//below a scanline; every object is above VBI_VCOUNT, so anything can be redrawn during vertical blank.
+#ifdef BEAM_RACE
+#ifdef PM_DOUBLE_BUFFER
+#error BEAM_RACE and PM_DOUBLE_BUFFER both keep redraws away from the beam, build with one of them
+#endif
+#define RACE_OBJECTS        (2 + MISSILE_POOL_SIZE)    //the tanks, then the shells
+#define RACE_LINE(scanline) (((scanline) + 1) >> 1)
+#define RACE_BEAM()         raceBeam()
+#else
+#define RACE_BEAM()
+#endif
+
+//DMACTL: display list, player and missile DMA plus the selected resolution and playfield width
+#define SDMCTL_VALUE        (0x20 | 0x08 | 0x04 | DMA_PM_RESOLUTION | DMA_PLAYFIELD)
+
+//CPU cycles left to the 6502 each frame after ANTIC's DMA (NTSC)
+//ANTIC still fetches player-missile data every scanline in double line resolution, so PM_DOUBLE_LINE saves
+//sprite redraw work rather than DMA. The mode 7 score line fetches its character data on all 16 scanlines,
+//the mode 8 bit map fetches each row once.
+#define CYCLES_PER_FRAME        (114U * 262U)                          //262 scanlines of 114 machine cycles
+#define REFRESH_DMA_CYCLES      (9U * 262U)                            //memory refresh, every scanline
+#define PM_DMA_CYCLES           (5U * 240U)                            //missiles + 4 players, every displayed scanline
+#ifdef SCROLL_ARENA
+//an LMS address on every bit map line, and fine scrolled lines fetch the next wider playfield
+#define DLIST_DMA_CYCLES        ((unsigned int)SCROLL_LIST_BYTES)
+#define PLAYFIELD_DMA_CYCLES    (SCORE_LINE_WIDTH * 17U + (PLAYFIELD_WIDTH + 2) * PLAYFIELD_ROWS)
+#else
+#define DLIST_DMA_CYCLES        33U                                    //one cycle per display list byte
+#define PLAYFIELD_DMA_CYCLES    (SCORE_LINE_WIDTH * 17U + PLAYFIELD_WIDTH * PLAYFIELD_ROWS)
+#endif
+#define CPU_CYCLES_PER_FRAME    (CYCLES_PER_FRAME - REFRESH_DMA_CYCLES - PM_DMA_CYCLES - DLIST_DMA_CYCLES - PLAYFIELD_DMA_CYCLES)
+
+//the frame trace and the worst frame search use the scanlines each frame takes, which the frame budget code measures
+#if (defined(FRAME_TRACE) || defined(FRAME_SEARCH)) && !defined(FRAME_BUDGET)
+#define FRAME_BUDGET
+#endif
+
+#ifdef FRAME_BUDGET
+//frame budget definitions
+#define PAL                 0xD014         //GTIA TV Standard Register: reads 1 on PAL machines, 15 on NTSC
+#define VBI_VCOUNT          124            //VCOUNT at which the vertical blank interrupt (and waitvsync) fires
+#define FRAME_LOG_SIZE      128            //Number of frames kept in frameScanlines, must be a power of 2
+#endif
+
+#ifdef FRAME_BUDGET_SCENARIO
+//scenario report definitions, the layout must match tools/budgetsuite.py
+#ifndef FRAME_BUDGET
+#error FRAME_BUDGET_SCENARIO reports the frames FRAME_BUDGET measures, build it with FRAME_BUDGET
+#endif
+#ifndef FRAME_BUDGET_FRAMES
+#define FRAME_BUDGET_FRAMES 3600           //frames a scenario runs before its report is finished, unless the game ends first
+#endif
+#define BUDGET_REPORT_FILE  "H:BUDGET.BIN" //on the emulator's host device, so the suite reads it without a memory dump
+#endif
+
+#ifdef MEM_DEBUG
+//memory debug definitions
+#define MEM_SENTINEL        0xA5           //painted over free memory, any other value has been written since
+#define MEM_PAINT_MARGIN    32             //bytes left unpainted under main's frame for the paint loop's own calls
+#endif
+
+#ifdef AI_VM
+//AI bytecode definitions, the scripts and opcodes are in aiprofiles.h
+#ifndef AI_PROFILE
+#define AI_PROFILE          2
+#endif
+#define AI_VM_BUDGET        8              //most script instructions run in one movement tick
+#define AI_PROFILE_COLUMN   (SCORE_LINE_WIDTH - 1)                      //score line column showing the profile
+#define AI_PROFILE_ZERO     80             //'0' in the walls' color (COLOR1), the profile shows as 1 - AI_PROFILES
+#define AI_CLOSE_RANGE      40             //board pixels (across plus down) that count as close
+#endif
+
+#ifdef AI_EVASION
+//shell evasion definitions: the sweep tables cover SWEEP_CELLS x SWEEP_CELLS cells of SWEEP_CELL_SIZE
+//board pixels, centered on the shell, one bit per cell
+#define THREAT_FRAMES       13             //frames ahead a shell is followed: 2 pixels a frame plus TANK_HALF stays under SWEEP_REACH
+#define SWEEP_CELL_SIZE     4              //board pixels per cell, a power of 2
+#define SWEEP_CELL_SHIFT    2
+#define SWEEP_CELLS         16             //cells across, one bit each in an unsigned int
+#define SWEEP_REACH         (SWEEP_CELLS / 2 * SWEEP_CELL_SIZE)    //board pixels the tables reach out from the shell
+#endif
+
+#ifdef XE_BANKS
+//130XE extended memory definitions. PORTB bits 2-3 pick one of four 16K banks and clearing bit 4 shows it
+//to the CPU in the window at $4000-$7FFF, in place of the main memory there. The program itself runs
+//through the window, so only code in LOWCODE and data in LOWBSS (both loaded below $4000) may run or be
+//read while a bank is in, and that includes the vertical blank routines.
+#define XE_WINDOW           0x4000
+#define XE_BANK_SIZE        0x4000
+#define XE_BANK_COUNT       4
+#define XE_PORTB_BANK_BITS  0x0C
+#define XE_PORTB_CPU        0x10           //clear to show the bank to the CPU
+#define XE_PORTB_ANTIC      0x20           //clear to show the bank to ANTIC, always left set
+#define REPLAY_BANKS        3              //banks 0-2 hold the match input log
+#define REPLAY_BANK_TICKS   (XE_BANK_SIZE / 2)                 //two bytes a movement tick
+#define REPLAY_BASE_TICKS   128            //ticks logged in main memory when there is no extended memory
+#define REPLAYING           replaying
+#define LEVEL_CACHE_BANK    3              //bank 3 holds copies of the arenas read from the level disk
+#define LEVEL_CACHE_SLOTS   (XE_BANK_SIZE / (LEVEL_SECTORS * SECTOR_SIZE))
+#else
+#define REPLAYING           false          //only the extended memory build keeps a log to replay
+#endif
+
+#ifdef NO_OS
+//OS-less definitions. Clearing PORTB bit 0 on an XL/XE swaps the OS ROM for the RAM under it, NMI and IRQ
+//vectors included, so the game answers its own interrupts: a vertical blank handler that does the OS's
+//stage 1 work the game needs (the clock and the shadow registers) and nothing else, and IRQs kept off
+//but for the game's own (the profiler's timer and the level disk's serial port). The shadow registers stay
+//where the OS keeps them, so the rest of the game is unchanged. The OS comes back in only for CIO calls,
+//through osOn and osOff.
+#define PORTB_OS_ROM        0x01           //PORTB bit 0: set for the OS ROM, clear for the RAM under it
+#define NMIEN               0xD40E         //ANTIC NMI Enable: 0x40 for the vertical blank interrupt alone
+#define NMIRES              0xD40F         //ANTIC NMI Reset: any write acknowledges the interrupt
+#define NMI_VBI             0x40
+#define DMACTL              0xD400         //ANTIC DMA Control, shadowed at 0x22F
+#define CHBASE              0xD409         //ANTIC Character Base, shadowed at 0x2F4
+#define PRIOR               0xD01B         //GTIA Priority, shadowed at GPRIOR
+#define COLPM0              0xD012         //GTIA player colors, then playfield colors and background, shadowed from PCOLR0
+#define SDMCTL              0x22F
+#define CHBAS               0x2F4
+#define VVBLKD              0x224          //deferred vertical blank vector, the end of the handler jumps through it
+#define NMI_VECTOR          0xFFFA         //6502 NMI vector, in RAM once the OS ROM is out
+#define IRQ_VECTOR          0xFFFE         //6502 IRQ and BRK vector
+#define OS_RAM_PROBE        0xC000         //RAM under the OS ROM on an XL/XE, only open bus on an 800
+#define OS_RAM_HIGH         0xD800         //RAM under the floating point and OS ROM, up to the vectors
+#define OS_RAM_HIGH_END     0xFFFA
+#define OS_FONT             0xE000         //OS ROM font CHBAS points at, copied to the RAM under it by osOff
+#define OS_FONT_SIZE        1024
+#if defined(LEVELS) && !defined(XE_BANKS)
+//without extended memory, arenas read from the level disk are cached under the OS ROM instead, around the font
+#define LEVEL_CACHE_SLOTS   ((OS_RAM_HIGH_END - OS_RAM_HIGH - OS_FONT_SIZE) / (LEVEL_SECTORS * SECTOR_SIZE))
+#define LEVEL_CACHE_LOW_SLOTS ((OS_FONT - OS_RAM_HIGH) / (LEVEL_SECTORS * SECTOR_SIZE))
+#define LEVEL_CACHE_ADDRESS(n) ((unsigned char *)OS_RAM_HIGH + (n) * (LEVEL_SECTORS * SECTOR_SIZE) \
+                                + ((n) >= LEVEL_CACHE_LOW_SLOTS ? OS_FONT_SIZE : 0))
+#endif
+#endif
+
+#ifdef PROFILER
+//profiler definitions, the histogram layout must match tools/profsym.py. Timer 4 counts down the 64 kHz
+//clock, so it interrupts 64 kHz / (PROFILE_AUDF + 1) times a second, about 2000 by default. Each sample
+//adds one to the bucket of PROFILE_BUCKET bytes the interrupted program counter is in.
+#define STIMER              0xD209         //POKEY Start Timer: any write restarts the timers
+#define VTIMR4              0x214          //OS timer 4 IRQ vector, entered with A pushed
+#ifndef PROFILE_AUDF
+#define PROFILE_AUDF        31
+#endif
+#define PROFILE_START       0x2000         //program addresses the histogram covers, the rest count as outside
+#define PROFILE_END         0xC000
+#define PROFILE_BUCKET      16             //bytes a bucket
+#define PROFILE_BUCKETS     ((PROFILE_END - PROFILE_START) / PROFILE_BUCKET)
+#define PROFILE_LIMIT       0xFF00         //samples taken before the profiler stops, so no bucket can overflow
+#endif
+
+#ifdef LEVELS
+//level disk definitions, the disk layout must match tools/mklevels.c
+#ifdef NARROW_PLAYFIELD
+#error LEVELS needs the normal width playfield, level bit maps are 10 bytes a row
+#endif
+//The disk is read by the game's own serial interrupt handlers instead of the OS's SIOV, which only returns
+//once the whole sector is in: readSector sends the command frame, the POKEY serial IRQs take the drive's
+//answer a byte at a time, and pollSector picks the sector up on a later pass of the start screen loop.
+#define SEROUT              0xD20D         //POKEY Serial Output, write only
+#define SERIN               0xD20D         //POKEY Serial Input, read only
+#define SKRES               0xD20A         //POKEY Reset Serial Status: any write clears the serial error bits
+#define AUDF3               0xD204         //POKEY channel 3 frequency, the low byte of the serial baud rate
+#define AUDC3               0xD205         //POKEY channel 3 control, 0 for silent
+#define SSKCTL              0x232          //OS shadow of SKCTL
+#define PBCTL               0xD303         //PIA Port B Control: bit 3 drives the SIO command line
+#define PBCTL_COMMAND       0x34           //command line low, a command frame follows
+#define PBCTL_IDLE          0x3C           //command line high
+#define VSERIN              0x20A          //OS serial input ready IRQ vector, entered with A pushed
+#define VSEROR              0x20C          //OS serial output needed IRQ vector
+#define VSEROC              0x20E          //OS serial output complete IRQ vector
+#define SERIAL_IN_IRQ       0x20           //IRQEN and IRQST bits for the serial port
+#define SERIAL_OUT_IRQ      0x10
+#define SERIAL_DONE_IRQ     0x08           //output complete: not latched, IRQST shows it for as long as the port is idle
+#define SERIAL_IRQS         (SERIAL_IN_IRQ | SERIAL_OUT_IRQ | SERIAL_DONE_IRQ)
+#define SIO_AUDCTL          0x28           //channel 3 clocked at 1.79 MHz and joined to channel 4, as the OS sets it
+#define SIO_BAUD            0x28           //AUDF3, with AUDF4 0: 19200 baud
+#define SKCTL_SEND          0x23           //SKCTL while the command frame goes out, as the OS sets it
+#define SKCTL_RECEIVE       0x13           //SKCTL while the drive's answer comes in
+#define DISK_DEVICE         0x31           //bus ID of disk drive 1, drive n is DISK_DEVICE + n - 1
+#define DISK_READ           0x52           //'R', read sector
+#define SIO_ACK             0x41           //'A', the drive took the command frame
+#define SIO_COMPLETE        0x43           //'C', the data frame follows
+#define SIO_COMMAND_SIZE    5              //device, command, sector (2 bytes), checksum
+#define SIO_COMMAND_LINES   8              //VCOUNT lines (about a millisecond) the command line is low before the frame
+#define SIO_TIMEOUT_FRAMES  120            //frames a read may take before it is tried again
+#define SIO_RETRIES         2              //tries after the first before the level disk is given up
+#define SIO_IDLE            0              //sioState: no read under way
+#define SIO_SENDING         1              //  command frame going out
+#define SIO_WAIT_ACK        2              //  waiting for SIO_ACK
+#define SIO_WAIT_COMPLETE   3              //  waiting for SIO_COMPLETE
+#define SIO_RECEIVING       4              //  data frame coming in
+#define SIO_DONE            5              //  data frame in, not checked yet
+#define SIO_FAILED          6              //  the drive answered with something else
+#define SECTOR_SIZE         128
+#define LEVEL_DRIVE         2              //D2:, so D1: can stay the boot disk
+#define LEVEL_VERSION       1
+#define LEVEL_DIRECTORY     1              //sector holding the level directory
+#define LEVEL_FIRST_SECTOR  2              //sector the first level starts on
+#define LEVEL_SECTORS       2              //sectors per level
+#endif
+
+#ifdef INPUT_LATENCY
+//input latency definitions
+#define LATENCY_BUCKETS     16             //frames counted separately in inputLatency, the last bucket is "or more"
+#define LATENCY_WAITING     0              //latencyShows: the press is waiting for a movement tick
+#define LATENCY_TANK        1              //  the tick moved or turned the tank, wait for it to be redrawn
+#define LATENCY_SHELL       2              //  the tick fired, wait for latencyShell to be drawn
+#ifdef PM_DOUBLE_BUFFER
+#define LATENCY_FLIP_FRAMES 1              //a frame drawn into the back bank shows from the next PMBASE flip
+#else
+#define LATENCY_FLIP_FRAMES 0
+#endif
+#endif
+
+#ifdef FRAME_TRACE
+//frame trace definitions, the record layout must match tools/tracestat.c
+#define TRACE_RECORDS       64             //frames kept in the frameTrace ring buffer, at most 255
+#define TRACE_VERSION       2
+#define TRACE_NO_MOVE       0xFF           //aiMove on frames without a movement tick
+#define TRACE_NO_SHELL      0xFF           //shellRow and shellColumn of a shell not in play
+#define TRACE_HIT           0x80           //set in tankDirection while the tank is spinning from a hit
+#endif
+
+#ifdef FRAME_SEARCH
+//worst frame search definitions, the report layout must match tools/tracestat.c
+#ifdef FRAME_BUDGET_SCENARIO
+#error FRAME_SEARCH picks the input for player 1 itself, build it without FRAME_BUDGET_SCENARIO
+#endif
+#define SEARCH_VERSION      1
+#define SEARCH_SEEDS        4              //costliest frames of the game the search starts from
+#ifndef SEARCH_RANDOM_STARTS
+#define SEARCH_RANDOM_STARTS 4             //starting points made by scrambling the start of the game
+#endif
+#define SEARCH_SCRAMBLE     16             //mutations that make a random starting point
+#ifndef SEARCH_STEPS
+#define SEARCH_STEPS        48             //mutations tried from each starting point, 3 frames each
+#endif
+#define SEARCH_FIELDS       (8 + MISSILE_POOL_SIZE)                //parts of a state quietenSearchState can take out
+#define SEARCH_NO_SHELL     0xFF           //shellRow and shellColumn of a shell not in play
+#define FRAME_PATH(counter) (framePath.counter++)
+#define SOUND(voice, pitch, distortion, volume) _sound(voice, pitch, distortion, searching ? 0 : (volume))  //same cost, silent
+#else
+#define FRAME_PATH(counter)
+#define SOUND(voice, pitch, distortion, volume) _sound(voice, pitch, distortion, volume)
+#endif
 
 /*
     ----------------------------------------------- GLOBAL VARAIABLES -------------------------------------------------------
 */
-//Different tank pictures to be printed
-unsigned int tankPics[16][8] = {
-        {8,8,107,127,127,127,99,99},        //NORTH
-        {36,100,121,255,255,78,14,4},       //NORTH_15
-        {25,58,124,255,223,14,28,24},       //NORTH_EAST
-        {28,120,251,124,28,31,62,24},       //NORTH_60
-        {0,252,252,56,63,56,252,252},       //EAST
-        {24,62,31,28,124,251,120,28},       //EAST_15
-        {25,58,124,255,223,14,28,24},       //SOUTH_EAST
-        {4,14,78,255,255,121,36},           //EAST_60
-        {99,99,127,127,127,107,8,8},        //SOUTH
-        {32,112,114,255,255,158,38,36},     //SOUTH_15
-        {152,92,62,255,251,112,56,24},      //SOUTH_WEST
-        {24,124,248,56,62,223,30,56},       //SOUTH_60
-        {0,63,63,28,252,28,63,63},          //WEST
-        {56,30,223,62,56,248,124,24},       //WEST_15
-        {152,92,62,255,251,112,56,24},      //NORTH_WEST
-        {36,38,158,255,255,114,112,32}      //WEST_60
+//Player-missile memory, PM_BANKS banks on the PM_BANK_SIZE boundary PMBASE needs. It is aligned by the
+//assembler ahead of the other variables in BSS, so at most the gap up to the boundary is lost (ld65 warns
+//about the large alignment; link with -Wl --large-alignment to quiet it). enablePMGraphics loads its address.
+#define PM_STRING(value)    #value
+#define PM_EXPAND(value)    PM_STRING(value)
+asm(".pushseg");
+asm(".segment \"BSS\"");
+asm(".align " PM_EXPAND(PM_BANK_SIZE));
+asm("pmMemory: .res " PM_EXPAND(PM_BANK_SIZE * PM_BANKS));
+asm(".popseg");
+
+//Display list: 24 blank lines, the score line and the bit map, 192 scanlines in all. The LMS and JVB
+//addresses are filled in by rearrangingDisplayList once the OS has picked where screen memory and the
+//display list go, which moves with RAMTOP (BASIC, cartridges and memory size all change it).
+const unsigned char displayListTemplate[] = {
+        DL_BLK8,                        // 8 blank lines
+        DL_BLK8,
+        DL_BLK8,
+        DL_LMS(DL_CHR20x16x2),
+        0x00, 0x00,                     // Character Memory (Low Byte and High Byte), DL_SCORE_LMS
+        DL_LMS(DL_MAP40x8x4),
+        0x00, 0x00,                     // Screen memory (Low Byte and High Byte), DL_BITMAP_LMS
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_MAP40x8x4,
+        DL_JVB,                         // Jump and vertical blank
+        0x00, 0x00                      // Jump address, back to the start of the display list
 };
 
-// row, col
+//Tank pictures, collision outlines and barrel tips, generated from assets/tanks.txt by tools/mksprites
+#ifdef HEADINGS_32
+//with the steps and ricochet table for 32 headings as well
+#include "tankgfx32.h"
+#else
+#include "tankgfx.h"
+#endif
+
+#ifdef AI_VM
+//AI behavior scripts and their opcodes
+#include "aiprofiles.h"
+#endif
+
+// row, col step of one move, in fixed point
 // y, x
-short deltas[16][2] = {
-    {-1, 0},            // NORTH
-    {-2, 1},            // NORTH_15
-    {-1, 1},            // NORTH_EAST
-    {-1, 2},            // NORTH_60
-    {0, 1},             // EAST
-    {1, 2},             // EAST_15
-    {1, 1},             // EAST_SOUTH
-    {2, 1},             // EAST_60
-    {1, 0},             // SOUTH
-    {2, -1},            // SOUTH_15
-    {1, -1},            // SOUTH_WEST
-    {1, -2},            // SOUTH_60
-    {0, -1},            // WEST
-    {-1, -2},           // WEST_15
-    {-1, -1},           // WEST_NORTH
-    {-2, -1}            // WEST_60
+#ifndef HEADINGS_32
+const short deltas[16][2] = {
+    {TO_FP(-1), TO_FP(0)},          // NORTH
+    {TO_FP(-2), TO_FP(1)},          // NORTH_15
+    {TO_FP(-1), TO_FP(1)},          // NORTH_EAST
+    {TO_FP(-1), TO_FP(2)},          // NORTH_60
+    {TO_FP(0), TO_FP(1)},           // EAST
+    {TO_FP(1), TO_FP(2)},           // EAST_15
+    {TO_FP(1), TO_FP(1)},           // EAST_SOUTH
+    {TO_FP(2), TO_FP(1)},           // EAST_60
+    {TO_FP(1), TO_FP(0)},           // SOUTH
+    {TO_FP(2), TO_FP(-1)},          // SOUTH_15
+    {TO_FP(1), TO_FP(-1)},          // SOUTH_WEST
+    {TO_FP(1), TO_FP(-2)},          // SOUTH_60
+    {TO_FP(0), TO_FP(-1)},          // WEST
+    {TO_FP(-1), TO_FP(-2)},         // WEST_15
+    {TO_FP(-1), TO_FP(-1)},         // WEST_NORTH
+    {TO_FP(-2), TO_FP(-1)}          // WEST_60
+};
+#endif
+
+#if defined(RICOCHET) && !defined(HEADINGS_32)
+//direction a shell leaves a wall in, indexed by [wall orientation][direction it came in]
+//vertical walls mirror the column step, horizontal walls mirror the row step and corners send it straight back
+const unsigned char reflectDirection[3][16] = {
+    {NORTH, WEST_60, WEST_NORTH, WEST_15, WEST, SOUTH_60, SOUTH_WEST, SOUTH_15,
+     SOUTH, EAST_60, EAST_SOUTH, EAST_15, EAST, NORTH_60, NORTH_EAST, NORTH_15},    // WALL_VERTICAL
+    {SOUTH, EAST_60, EAST_SOUTH, EAST_15, EAST, NORTH_60, NORTH_EAST, NORTH_15,
+     NORTH, WEST_60, WEST_NORTH, WEST_15, WEST, SOUTH_60, SOUTH_WEST, SOUTH_15},    // WALL_HORIZONTAL
+    {SOUTH, SOUTH_15, SOUTH_WEST, SOUTH_60, WEST, WEST_15, WEST_NORTH, WEST_60,
+     NORTH, NORTH_15, NORTH_EAST, NORTH_60, EAST, EAST_15, EAST_SOUTH, EAST_60}     // WALL_CORNER
 };
+#endif
+
+//bits each missile owns in missile memory: M0 = bits 0-1, M1 = bits 2-3, M2 = bits 4-5, M3 = bits 6-7
+const unsigned char shellMask[4] = {0x02, 0x08, 0x20, 0x80};
 
 unsigned char j = 255;
 unsigned char m0SoundTracker = 0;
@@ -133,33 +704,124 @@ int bitMapAddress;
 int charMapAddress;
 int PMBaseAddress;
 int playerAddress;
-int missileAddress;
-
-//Horizontal Positions Registers
-int *horizontalRegister_P0 = (int *)0xD000;
-int *horizontalRegister_M0 = (int *)0xD004;
-int *horizontalRegister_P1 = (int *)0xD001;
-int *horizontalRegister_M1 = (int *)0xD005;
+unsigned int missileAddress[PM_BANKS];
+unsigned int tankPlayerAddress[PM_BANKS][2];   //PM memory of the player each tank is drawn with, in each bank
+#ifdef PM_DOUBLE_BUFFER
+unsigned char pmBack;                   //bank the next frame is drawn into, ANTIC shows the other one
+#ifdef XE_BANKS
+#pragma bss-name (push, "LOWBSS")       //read by flipVBI, which can interrupt an extended memory copy
+#endif
+unsigned char flipPage;                 //PMBASE page for flipVBI to show at the next vertical blank, 0 when none
+unsigned char hposShadow[8];            //HPOSP0 - HPOSP3, HPOSM0 - HPOSM3 for the back bank's frame
+#ifdef XE_BANKS
+#pragma bss-name (pop)
+#endif
+#endif
+#ifdef SCROLL_ARENA
+//The arena is shown through two display lists like the two PM banks: commitScroll writes the view into the
+//one ANTIC is not showing and the deferred vertical blank routine scrollVBI switches to it.
+unsigned char arenaMemory[ARENA_BYTES + ARENA_WIDTH];  //arena bit map, moved in so ANTIC's 4K boundaries fall at row starts
+unsigned char scrollListMemory[SCROLL_LIST_SIZE * 3];  //the display lists, at the first two SCROLL_LIST_SIZE boundaries inside it
+unsigned int scrollList[2];             //address of each display list
+unsigned char listColumn[2];            //first arena byte in the window each display list's LMS addresses are for
+unsigned char listRow[2];               //  and first arena row
+unsigned char scrollBack;               //display list commitScroll writes into, ANTIC shows the other one
+int viewLeft;                           //arena color clock at the playfield window's left edge
+int viewTop;                            //arena scanline at the playfield window's top
+#ifdef XE_BANKS
+#pragma bss-name (push, "LOWBSS")       //read by scrollVBI, which can interrupt an extended memory copy
+#endif
+unsigned char scrollPending;            //set when the shadows below hold a view for scrollVBI to show
+unsigned char hscrolShadow;
+unsigned char vscrolShadow;
+unsigned int scrollListShadow;          //display list for scrollVBI to show
+#ifdef XE_BANKS
+#pragma bss-name (pop)
+#endif
+#endif
+
+#ifdef XE_BANKS
+//Extended memory state, all below the window so it can be read while a bank is in
+#pragma bss-name (push, "LOWBSS")
+unsigned char xeBanks;                  //extended memory banks found, 0 on an 800 or a 64K XL
+unsigned char mainPortb;                //PORTB with main memory in the window
+unsigned char bankPortb[XE_BANK_COUNT]; //PORTB with each bank in the window
+unsigned char bankSelect;               //bankToRam and ramToBank: PORTB for the bank being copied
+unsigned char *bankWindow;              //  address in the window
+unsigned char *bankRam;                 //  address in main memory
+unsigned char bankLength;               //  bytes to copy, 0 for 256
+unsigned char bankSave;                 //main memory byte probeBanks borrows
+#pragma bss-name (pop)
+
+//Match input log: player 1's joystick and the AI's move for every movement tick of the current game,
+//in banks 0 - 2 (24576 ticks, over half an hour), or the first REPLAY_BASE_TICKS in main memory
+unsigned int replayTicks;
+unsigned int replayCapacity;
+unsigned char replayBase[REPLAY_BASE_TICKS * 2];
+bool replaying = false;                 //the game on screen is the last one played again from the log
+unsigned int replayPlayed;              //ticks of the log played back so far
+int replayStartRow[2];                  //where the tanks started, as a level disk arena may be gone by the replay
+int replayStartColumn[2];
+unsigned char replayStartDirection[2];
+#endif
+
+#if defined(LEVELS) && defined(LEVEL_CACHE_SLOTS)
+bool levelCached[LEVEL_CACHE_SLOTS];    //arenas with a copy in LEVEL_CACHE_BANK, or under the OS ROM
+#endif
+
+#ifdef NO_OS
+//OS-less results, read out of an emulator memory dump using the ld65 map file. The idle loops are how
+//many times a do-nothing loop ran in one frame at startup, under the OS's vertical blank and then under
+//the game's; freedCycles is the difference as a share of the CPU_CYCLES_PER_FRAME cycles a frame.
+struct {
+    unsigned int loopsWithOs;
+    unsigned int loopsWithoutOs;        //0 if the OS ROM could not be switched out (an 800)
+    unsigned int freedCycles;
+} osReport;
+bool osFree = false;                    //true once the OS ROM is out, it only comes back in for CIO calls
+unsigned char osPokmsk;                 //POKMSK for the OS's IRQs while it is out
+bool osFontCopied = false;              //the ROM font has been copied to the RAM under it, which keeps it
+#endif
+
+#ifdef PROFILER
+//Profiler results, read out of an emulator memory dump with tools/profsym.py and the ld65 map file.
+//The idle loops are counted as in osReport, without and with the timer interrupt running, and
+//overheadCycles is what the samples cost a frame.
+#ifdef XE_BANKS
+#pragma bss-name (push, "LOWBSS")       //written by profileIRQ, which can interrupt an extended memory copy
+#endif
+struct {
+    unsigned int samples;               //samples taken, the profiler stops at PROFILE_LIMIT
+    unsigned int outside;               //samples outside PROFILE_START - PROFILE_END: OS ROM, page 6
+    unsigned int loopsWithout;
+    unsigned int loopsWith;
+    unsigned int overheadCycles;
+} profileReport;
+unsigned int profileHistogram[PROFILE_BUCKETS];
+#ifdef XE_BANKS
+#pragma bss-name (pop)
+#endif
+#endif
+
+#ifdef INVISIBLE_TANKS
+const unsigned char tankColor[2] = {TANK0_COLOR, TANK1_COLOR};
+unsigned char revealTime[2];            //frames left that each tank shows for after firing
+#endif
 
 //Color-Luminance Registers
 int *colLumPM0 = (int *)0x2C0;
 int *colLumPM1 = (int *)0x2C1;
+int *colLumPM2 = (int *)0x2C2;         //missile 2 is tank 0's second shell
+int *colLumPM3 = (int *)0x2C3;         //missile 3 is tank 1's second shell
 
 //Starting direction of each Players
-unsigned int p0Direction = EAST;
-unsigned int p1Direction = WEST;
+unsigned char tankDirection[2] = {EAST, WEST};
 unsigned char p0LastMove;
 unsigned char p1LastMove;
 unsigned char p0history;
 unsigned char p1history;
 
-//Variables to track vertical and horizontal locations of players
-int p0VerticalLocation = 131;
-int p0HorizontalLocation = 57;
-int p1VerticalLocation = 387;
-int p1HorizontalLocation = 190;
-
-// variables to track the vertical and horizontal locations of the players in a new reference frame
+// variables to track the vertical and horizontal locations of the players
 /* One thing that we found out while trying to run BFS is that there is no set position system for this game
  * and that is just one of the weird things that come with the Atari. We found out that in reference
  * to player 1 the board starts at (52, 55) and ends at (196, 216). Meaning that the board has 144x161
@@ -171,37 +833,53 @@ int p1HorizontalLocation = 190;
  * the "AI tank" a lot so....
  * (9,80) =(row,col)=> (80, 9)
  * (142, 80) =(row, col)=> (80, 142). 
- * Now where ever we update the p0VerticalLocation etc etc we should update these as well.
+ * These board positions (in fixed point) are the only record of where a tank is. The horizontal position register
+ * and the rows of PM memory a tank is drawn on are worked out from them in commitTank, once a frame.
  */
+int tankRow[2] = {TO_FP(TANK_START_ROW), TO_FP(TANK_START_ROW)};
+int tankColumn[2] = {TO_FP(TANK0_START_COLUMN), TO_FP(TANK1_START_COLUMN)};
 
-int p0_r = 80;
-int p0_c = 9;
-int p1_r = 80;
-int p1_c = 142;
+//what commitTank last put on screen for each tank, so it only redraws what changed
+int tankDrawnRow[PM_BANKS][2];                      //PM memory row of the top of the sprite, -1 when not drawn
+unsigned char tankDrawnDirection[PM_BANKS][2];
+unsigned char tankDrawnHorizontal[2];
+#ifdef BEAM_RACE
+unsigned char raceLine[RACE_OBJECTS];   //VCOUNT each object waits for before it is redrawn, 0 once it has been
+#endif
 
 bool directionChosen = false;
 int desiredDirection;
-
-
-/* p0VerticalLocation = p0_r
- * p0HorizontalLocation = p0_c
- * p1VerticalLocation = p1_r
- * p1HorizontalLocation = p1_c
- */
-
-//variables for missile tracking
-int m0LastHorizontalLocation;
-int m0LastVerticalLocation;
-int m1LastHorizontalLocation;
-int m1LastVerticalLocation;
-int m0direction;
-int m1direction;
+unsigned char aiOpening = AI_OPENING;               //the arena's AI opening, counted down with k
+#ifdef AI_EVASION
+//threatSweep[d][row] has a bit set for every cell where the middle of a tank would be hit within
+//THREAT_FRAMES frames by a shell heading in direction d (the QUARTER_TURN directions from NORTH). The
+//other directions are the same sweeps turned by quarter turns, so a shell's offset is turned back to one of these.
+unsigned int threatSweep[QUARTER_TURN][SWEEP_CELLS];
+#endif
+#ifdef AI_VM
+unsigned char aiProfile = AI_PROFILE - 1;           //index in aiProfiles, START picks the next one between games
+const unsigned char *aiScript = aiProfiles[AI_PROFILE - 1];
+bool startKeyHeld = false;                          //START was down at the last look, so holding it picks once
+unsigned char aiPc;                                 //offset of the next instruction in aiScript
+unsigned char aiCounter;                            //COUNT and LOOP's counter
+unsigned char aiWait;                               //ticks of a WAIT still to sit out
+#endif
+
+//variables for missile tracking, one entry per shell in the missile pool
+int shellRow[MISSILE_POOL_SIZE];                    //board position in fixed point, like the tanks
+int shellColumn[MISSILE_POOL_SIZE];
+int shellDrawnRow[PM_BANKS][MISSILE_POOL_SIZE];     //missile memory row the shell is drawn on, -1 when not drawn
+unsigned char shellDirection[MISSILE_POOL_SIZE];
+bool shellExists[MISSILE_POOL_SIZE];
+unsigned char shellNext[2] = {0, 1};                //shell each tank recycles when all of its shells are in flight
+#ifdef RICOCHET
+unsigned char shellBounces[MISSILE_POOL_SIZE];
+unsigned char shellBounceGuard[MISSILE_POOL_SIZE];
+#endif
 
 //variables to keep track of tank firing
 bool p0Fired = false;
 bool p1Fired = false;
-bool m0exists = false;
-bool m1exists = false;
 int p0FireDelayCounter = 0;
 int p1FireDelayCounter = 0;
 bool p0FireAvailable = true;
@@ -215,42 +893,321 @@ int p1HitDir = 0;
 int hitTime[2] = {0, 0};
 
 //variables to delay tank diagonal movement
-bool p0FirstDiag = false;
-bool p1FirstDiag = false;
+bool tankFirstDiag[2] = {false, false};
 
 //scores
 //functions to turn and update tank positions
-int *characterSetP0[8] = {
-        (int*)0x0030,
-        (int*)0x0011,
-        (int*)0x0000,
-        (int*)0x0037,
-        (int*)0x0029,
-        (int*)0x002E,
-        (int*)0x0033,
-        (int*)0x0001
+//winner banners in internal character codes
+const unsigned char characterSetP0[8] = {
+        0x30,                           //P
+        0x11,                           //1
+        0x00,
+        0x37,                           //W
+        0x29,                           //I
+        0x2E,                           //N
+        0x33,                           //S
+        0x01                            //!
 };
 
-int *characterSetP1[8] = {
-        (int*)0x0030,
-        (int*)0x0012,
-        (int*)0x0000,
-        (int*)0x0037,
-        (int*)0x0029,
-        (int*)0x002E,
-        (int*)0x0033,
-        (int*)0x0001
+const unsigned char characterSetP1[8] = {
+        0x30,
+        0x12,                           //2
+        0x00,
+        0x37,
+        0x29,
+        0x2E,
+        0x33,
+        0x01
 };
 
-int p0Score = 16;
-int p1Score = 16;
+int p0Score = SCORE_P0_ZERO;
+int p1Score = SCORE_P1_ZERO;
 
 //variable to run the game, if it is false a user has won
 bool gameOn = false;
 
+//CPU cycles per frame left over by the selected DMA modes, for reading out of a memory dump
+const unsigned int cpuCyclesPerFrame = CPU_CYCLES_PER_FRAME;
+
+#ifdef FRAME_BUDGET
+//Frame budget results, read out of an emulator memory dump using the ld65 map file.
+//frameScanlines is a ring buffer of the scanlines the last FRAME_LOG_SIZE frames took from
+//waitvsync returning to waitvsync being called again. A frame that takes more than a whole
+//frame of scanlines has missed vertical blank and is counted in framesOverBudget.
+unsigned int frameScanlines[FRAME_LOG_SIZE];
+unsigned int worstFrameScanlines = 0;
+unsigned int framesMeasured = 0;
+unsigned int framesOverBudget = 0;
+unsigned char frameLogIndex = 0;
+unsigned char vcountLines = 131;        //VCOUNT lines per frame: 131 on NTSC, 156 on PAL
+unsigned char frameStartTick;
+unsigned char frameStartLine;
+unsigned char frameTicks;               //vertical blanks since beginFrameBudget, set by frameBudgetScanlines
+unsigned int bootFrames;                //frames from cold boot (power on) to the game's display list first showing
+#endif
+
+//Player 1's joystick is sampled every frame by sampleInput. Movement only happens every fifth frame, so
+//presses are latched in inputPressed until the next movement tick uses them, and a tap that is let go
+//between ticks still counts.
+unsigned char inputHeld = 0;            //joystick bits down at the last sample
+unsigned char inputPressed = 0;         //joystick bits pressed since the last movement tick
+
+#ifdef LEVELS
+//One arena on the level disk, LEVEL_SECTORS sectors long. Start positions are board pixels, as in
+//tankRow and tankColumn. aiOpening is worked out by tools/mklevels: how far the AI can drive from its
+//start before it runs into a wall.
+typedef struct {
+    unsigned char tankRow[2];
+    unsigned char tankColumn[2];
+    unsigned char tankDirection[2];
+    unsigned char color;                        //COLOR1 value for the walls
+    unsigned char aiOpening;
+    unsigned char bitMap[PLAYFIELD_ROWS * PLAYFIELD_WIDTH];
+    unsigned char spare[LEVEL_SECTORS * SECTOR_SIZE - 8 - PLAYFIELD_ROWS * PLAYFIELD_WIDTH];
+} Level;
+
+//The level being loaded for the next game. It is read a sector at a time while the game is not on,
+//so the disk is never touched during play. The first sector read is the directory, into the same buffer.
+Level level;
+unsigned char levelNumber = 0;
+unsigned char levelCount = 0;                   //0 until the directory has been read
+unsigned char levelSectorsRead = 0;             //LEVEL_SECTORS once level is loaded
+bool levelsAvailable = true;                    //false once the level disk has failed, the built in arena is used
+bool startWaiting = false;                      //fire was pressed before the arena was in, the game starts once it is
+
+//The sector read under way. The serial interrupt handlers move sioState on as the drive answers.
+#ifdef XE_BANKS
+#pragma bss-name (push, "LOWBSS")       //used by the serial IRQs, which can interrupt an extended memory copy
+#endif
+unsigned char sioState;                         //SIO_IDLE (0) until the first read
+unsigned char sioIndex;                         //next byte of the command frame to send, or of the data frame
+unsigned char sioCommand[SIO_COMMAND_SIZE];
+unsigned char sioData[SECTOR_SIZE + 1];         //the data frame, then its checksum
+#ifdef XE_BANKS
+#pragma bss-name (pop)
+#endif
+unsigned int sioSector;
+unsigned char sioStarted;                       //RTCLOK_LOW when the command frame went out
+unsigned char sioRetries;
+unsigned int osSerialVectors[3];                //the OS's VSERIN, VSEROR and VSEROC, put back after each read
+#endif
+
+#ifdef MEM_DEBUG
+//Memory report, read out of an emulator memory dump with tools/memcheck.py and the ld65 map file.
+//Addresses are filled in at startup, the high-water marks at every game over. Free memory between
+//the heap and the C stack is painted with MEM_SENTINEL, so the lowest byte that is no longer the
+//sentinel is as deep as the stack has gone.
+struct {
+    unsigned int stackTop;              //C stack at the start of main (the stack grows down from here)
+    unsigned int stackLow;              //lowest address the C stack has written
+    unsigned int stackUsed;             //stackTop - stackLow
+    unsigned int heapOrigin;            //start of the heap, just past BSS
+    unsigned int heapTop;               //highest the heap has grown to
+    unsigned int heapEnd;               //where the heap would run into the stack's reserved space
+    unsigned int freeBetween;           //never written bytes between the heap and the stack
+    unsigned int displayList;           //the OS display list, just below screen memory
+    int screenGap;                      //bytes from stackTop up to the display list, negative when they overlap
+    unsigned int pmUnused;              //bytes of pmMemory that ANTIC does not fetch
+} memReport;
+#endif
+
+#ifdef INPUT_LATENCY
+//Input latency results, read out of an emulator memory dump using the ld65 map file.
+//inputLatency[n] counts the presses that showed on screen n frames after the frame they were sampled
+//in: 0 means the tank moved, turned or fired in the very next frame drawn. Only the change the press
+//asked for counts, a move or turn for a direction and a new shell for fire.
+unsigned int inputLatency[LATENCY_BUCKETS];
+unsigned int inputsDropped = 0;         //presses the movement tick did not act on, e.g. firing while reloading
+unsigned char latencyPress = 0;         //joystick bits of the press being timed, 0 for none
+unsigned char latencyStart;             //RTCLOK_LOW in the frame it was sampled
+unsigned char latencyShows;             //LATENCY_WAITING, LATENCY_TANK or LATENCY_SHELL
+unsigned char latencyShell;             //the shell player 1 fired on the tick, for LATENCY_SHELL
+#endif
+
+#ifdef FRAME_TRACE
+//One frame of the frame trace, 36 bytes with no padding (cc65 does not pad structs).
+//Positions are whole board pixels, unsigned ints are little endian.
+typedef struct {
+    unsigned int frame;                         //frame number since the trace started, wraps at 65536
+    unsigned int scanlines;                     //scanlines the frame's logic used, as in frameScanlines
+    unsigned char tankRow[2];
+    unsigned char tankColumn[2];
+    unsigned char tankDirection[2];             //direction, plus TRACE_HIT while spinning
+    unsigned char shellRow[4];                  //TRACE_NO_SHELL when the shell is not in play
+    unsigned char shellColumn[4];
+    unsigned char shellDirection[4];
+    unsigned char input;                        //player 1 joystick bits on a movement tick, else 0
+    unsigned char aiMove;                       //AI move on a movement tick, else TRACE_NO_MOVE
+    unsigned char missilePlayfield[4];          //M0PF - M3PF before checkCollision clears them
+    unsigned char missilePlayer[4];             //M0PL - M3PL
+    unsigned char playerPlayfield[2];           //P0PF, P1PF
+} FrameRecord;
+
+//The frame trace ring buffer. The header lets tools/tracestat find it in a memory dump without
+//the map file: next is the record the coming frame is written to, and once wrapped is set the
+//oldest record is the one at next. frames wraps itself after 65536 frames, so it is not used for that.
+struct {
+    char magic[4];                              //"TKTR"
+    unsigned char version;
+    unsigned char recordSize;
+    unsigned char recordCount;
+    unsigned char next;
+    unsigned int frames;                        //frames traced so far
+    unsigned char wrapped;                      //set once every record has been written
+    FrameRecord records[TRACE_RECORDS];
+} frameTrace = {{'T', 'K', 'T', 'R'}, TRACE_VERSION, sizeof(FrameRecord), TRACE_RECORDS, 0, 0, 0};
+
+FrameRecord *traceRecord = frameTrace.records;  //record of the frame being played
+#endif
+
+#ifdef FRAME_SEARCH
+//Everything one frame of play depends on, so that a frame can be set up and played again.
+//loadSearchState and saveSearchState copy it into and out of the game's own variables.
+typedef struct {
+    int tankRow[2];
+    int tankColumn[2];
+    unsigned char tankDirection[2];
+    bool tankFirstDiag[2];
+    bool isHit[2];
+    int hitDir[2];
+    int hitTime[2];
+    int shellRow[MISSILE_POOL_SIZE];
+    int shellColumn[MISSILE_POOL_SIZE];
+    unsigned char shellDirection[MISSILE_POOL_SIZE];
+    bool shellExists[MISSILE_POOL_SIZE];
+    unsigned char shellNext[2];
+#ifdef RICOCHET
+    unsigned char shellBounces[MISSILE_POOL_SIZE];
+    unsigned char shellBounceGuard[MISSILE_POOL_SIZE];
+#endif
+    bool fireAvailable[2];
+    int fireDelayCounter[2];
+    bool fired[2];
+    unsigned char soundTracker[2];
+    unsigned char hitSound;                     //j
+    int frameDelayCounter;
+    unsigned char input;                        //player 1's joystick for the next movement tick
+    unsigned char lastMove[2];
+    unsigned char history[2];
+    int aiMoves;                                //k, the AI's opening moves driven so far
+    bool directionChosen;
+    int desiredDirection;
+#ifdef AI_VM
+    unsigned char aiProfile;
+    unsigned char aiPc;
+    unsigned char aiCounter;
+    unsigned char aiWait;
+#endif
+#ifdef INVISIBLE_TANKS
+    unsigned char revealTime[2];
+#endif
+} SearchState;
+
+//What a frame did, counted by FRAME_PATH as it is played. 12 bytes.
+typedef struct {
+    unsigned char movementTicks;                //1 if the frame was a movement tick
+    unsigned char tankSteps;                    //moveForward and moveBackward calls, four for a wall bounce
+    unsigned char spins;                        //spinTank calls
+    unsigned char shellSteps;                   //traverseMissile calls
+    unsigned char shellsFired;
+    unsigned char hits;                         //shells that hit a tank
+    unsigned char shellsRemoved;
+    unsigned char shellBounces;                 //bounceShell calls
+    unsigned char aiLines;                      //lineHitsTank calls, from attack's sweep or the script's aim
+    unsigned char threatLookups;                //inThreatSweep calls
+    unsigned char aiInstructions;               //AI script instructions run
+    unsigned char tankRedraws;                  //tanks commitTank redrew
+} FramePath;
+
+//A search state in board pixels, laid out the same whatever the build options. 28 bytes.
+typedef struct {
+    unsigned char tankRow[2];
+    unsigned char tankColumn[2];
+    unsigned char tankDirection[2];
+    unsigned char hitTime[2];                   //movement ticks of spin left, 0 when not hit
+    unsigned char hitDirection[2];              //direction of the shell that hit it
+    unsigned char shellRow[4];                  //SEARCH_NO_SHELL when the shell is not in play
+    unsigned char shellColumn[4];
+    unsigned char shellDirection[4];
+    unsigned char input;                        //player 1's joystick for the tick
+    unsigned char history[2];                   //each tank's last move, checkCollision backs it off a wall by it
+    unsigned char fireReady;                    //bit 0 player 1, bit 1 the AI
+    unsigned char ticksAway;                    //frames to the next movement tick, 0 on a tick
+    unsigned char aiOpening;                    //opening moves the C AI still has to drive
+} SearchRecord;
+
+//The worst frame search results. The header lets tools/tracestat find them in a memory dump without
+//the map file. worst is the costliest state found so far, reproducer is the same state with
+//everything taken out that did not make its frame any cheaper.
+struct {
+    char magic[4];                              //"TKWF"
+    unsigned char version;
+    unsigned char searches;                     //game overs searched at
+    unsigned int budget;                        //scanlines in a frame
+    unsigned int evaluations;                   //states played, in all searches
+    unsigned int worstScanlines;
+    unsigned int reproducerScanlines;
+    FramePath worstPath;
+    FramePath reproducerPath;
+    SearchRecord worst;
+    SearchRecord reproducer;
+} frameSearch = {{'T', 'K', 'W', 'F'}, SEARCH_VERSION};
+
+FramePath framePath;                            //what the frame being played has done
+SearchState searchStart;                        //the start of the game
+SearchState frameState;                         //the frame being played, saved before it starts
+SearchState searchSeeds[SEARCH_SEEDS];          //the game's costliest frames
+unsigned int seedScanlines[SEARCH_SEEDS];       //0 for a seed not yet kept
+SearchState searchBest;                         //the state the search has climbed to
+SearchState searchTrial;                        //a mutation of it being played
+SearchState worstState;                         //the costliest state found in all searches
+SearchState gameOverState;                      //the game over on screen, put back after a search
+bool searching = false;                         //playing search states: no sound
+#ifdef FRAME_TRACE
+FrameRecord searchTraceRecord;                  //takes the search's trace writes, so the game's trace is untouched
+#endif
+const unsigned char searchMoves[6] = {NOTHING, FORWARD, BACKWARD, LEFT_TURN, RIGHT_TURN, FIRE};
+#endif
+
+#ifdef FRAME_BUDGET_SCENARIO
+//Joystick scripts for the frame budget scenarios, pairs of {joystick input, movement ticks}.
+//The last pair repeats forever.
+const unsigned char budgetScript[][2] = {
+#if FRAME_BUDGET_SCENARIO == 1
+        {FIRE, 1},                      //start the game
+        {NOTHING, 20},
+        {FIRE, 255}                     //both tanks facing each other and firing
+#elif FRAME_BUDGET_SCENARIO == 2
+        {FIRE, 1},                      //start the game
+        {LEFT_TURN, QUARTER_TURN},      //turn from EAST to NORTH
+        {FORWARD, 255}                  //keep driving into the top wall
+#else
+        {FIRE, 1},                      //start the game
+        {NOTHING, 255}                  //sit still, take hits from the AI until it wins
+#endif
+};
+unsigned char budgetScriptIndex = 0;
+unsigned char budgetScriptTicks = 0;
+
+//The scenario report: every frame's scanlines as 16 bit words, FRAME_LOG_SIZE at a time as
+//frameScanlines fills, then budgetTrailer once the game ends or FRAME_BUDGET_FRAMES have gone by.
+FILE *budgetReport;
+struct {
+    char magic[4];                              //"TKFB"
+    unsigned char scenario;                     //FRAME_BUDGET_SCENARIO
+    unsigned char gameOver;                     //1 if the game ended before FRAME_BUDGET_FRAMES
+    unsigned int framesMeasured;
+    unsigned int framesOverBudget;
+    unsigned int worstFrameScanlines;
+    unsigned char vcountLines;                  //131 on NTSC, 156 on PAL
+} budgetTrailer = {{'T', 'K', 'F', 'B'}, FRAME_BUDGET_SCENARIO};
+#endif
+
 /*
     ----------------------------------------------- FUNCTION DECLARATIONS -------------------------------------------------------
 */
+void playFrame();
+void showWinnerBanner();
 void rearrangingDisplayList();
 void initializeScore();
 void createBitMap();
@@ -259,149 +1216,409 @@ void setUpTankDisplay();
 void spinTank(int tank);
 void movePlayers();
 void fire(int tank);
-void missileLocationHelper(unsigned int tankDirection, int pLastHorizontalLocation, int pLastVerticalLocation, int tank);
-void traverseMissile(unsigned int missileDirection, int mHorizontalLocation, int mVerticalLocation, int tank);
+void missileLocationHelper(int tank, unsigned char shell);
+void traverseMissile(unsigned char shell);
+void commitShell(unsigned char shell);
+void removeShell(unsigned char shell);
+#ifdef RICOCHET
+bool playfieldAt(int column, int row);
+void bounceShell(unsigned char shell);
+#endif
 void moveForward(int tank);
 void moveBackward(int tank);
 void checkCollision();
 void turnplayer(unsigned char turn, int player);
 void tankExplosion();
-void updateplayerDir(int player);
+void commitTank(unsigned char tank);
+void commitFrame();
+#if defined(NO_OS) || defined(PROFILER)
+unsigned int idleLoops();
+#endif
+#ifdef PROFILER
+void initProfiler();
+void startProfiler();
+void stopProfiler();
+void profileIRQ();
+#endif
+#ifdef NO_OS
+bool osOff();
+void osOn();
+void nmiHandler();
+void irqHandler();
+void vbiExit();
+#endif
+#ifdef BEAM_RACE
+void scheduleFrame();
+bool raceBeam();
+#endif
+#ifdef PM_DOUBLE_BUFFER
+void flipVBI();
+#endif
+#ifdef SCROLL_ARENA
+void followTanks();
+void commitScroll();
+void writeScrollList(unsigned char list, unsigned char column, unsigned char row);
+void scrollVBI();
+#endif
+#ifdef XE_BANKS
+void initBanks();
+void probeBanks();
+void bankToRam();
+void ramToBank();
+void bankRead(unsigned char bank, unsigned int offset, void *ram, unsigned char length);
+void bankWrite(unsigned char bank, unsigned int offset, const void *ram, unsigned char length);
+void readReplay(unsigned char *input, unsigned char *aiMove);
+void logReplay(unsigned char input, unsigned char aiMove);
+#endif
+void sampleInput();
+unsigned char readPlayerInput();
+bool lineHitsTank(int dir);
+#ifdef AI_EVASION
+void initThreatSweep();
+bool inThreatSweep(unsigned char direction, int row, int column);
+unsigned char evadeShells();
+#endif
+#ifdef AI_VM
+unsigned char runAIScript();
+bool aiCondition(unsigned char condition);
+void pickAIProfile();
+#endif
+#ifdef LEVELS
+void readSector(unsigned int sector);
+unsigned char pollSector(unsigned char *buffer);
+unsigned char sioChecksum(unsigned char *bytes, unsigned char length);
+void sioOutputIRQ();
+void sioDoneIRQ();
+void sioInputIRQ();
+void streamLevel();
+#endif
+#ifdef INPUT_LATENCY
+void actOnInputLatency(unsigned char acted);
+void endInputLatency(unsigned char shows);
+#endif
+#ifdef FRAME_BUDGET
+void beginFrameBudget();
+void endFrameBudget();
+#ifdef FRAME_BUDGET_SCENARIO
+void writeBudgetFrames(unsigned char count);
+void finishBudgetReport();
+#endif
+unsigned int frameBudgetScanlines();
+#endif
+#ifdef FRAME_SEARCH
+void beginFrameSearch();
+void keepSearchSeed(unsigned int scanlines);
+void searchWorstFrame();
+unsigned int playSearchState(const SearchState *state);
+void saveSearchState(SearchState *state);
+void loadSearchState(const SearchState *state);
+void mutateSearchState(SearchState *state);
+bool quietenSearchState(SearchState *state, unsigned char field);
+void recordSearchState(const SearchState *state, SearchRecord *record);
+int clampBoard(int position, int low, int high);
+#endif
+#ifdef MEM_DEBUG
+void paintMemory(unsigned int stackTop);
+void scanMemory();
+#endif
+#ifdef FRAME_TRACE
+void traceCollisions();
+void endFrameTrace();
+#endif
 
 /*
     ----------------------------------------------- MAIN DRIVER -------------------------------------------------------
 */
 int main() {
     int p0Input;
+    unsigned char shell;
+
+#ifdef MEM_DEBUG
+    paintMemory((unsigned int)&shell);  //main's locals are the top of the C stack
+#endif
 
-    //Loading and installing joystick driver
-    joy_load_driver(joy_stddrv);
-    joy_install(joy_static_stddrv);   
+#ifdef FRAME_BUDGET
+    if ((PEEK(PAL) & 0x0E) == 0) vcountLines = 156;    //PAL machines run 312 scanlines per frame
+#endif
 
     
     //Set Up Display Screen
     _graphics(18);                      //Set default display to graphics 3 + 16 (+16 displays mode with graphics, eliminating the text window)
+#ifdef MEM_DEBUG
+    memReport.displayList = OS.sdlstl + OS.sdlsth*256;     //before SCROLL_ARENA points it at its own lists
+#endif
     rearrangingDisplayList();           //rearranging graphics 3 display list
+#ifdef MEM_DEBUG
+    memReport.screenGap = memReport.displayList - memReport.stackTop;
+    scanMemory();
+#endif
+#ifdef FRAME_BUDGET
+    waitvsync();                        //the display list is on screen from this vertical blank on
+    bootFrames = PEEK(RTCLOK_LOW) + PEEK(RTCLOK_MID) * 256;
+#endif
+#ifdef FRAME_BUDGET_SCENARIO
+    budgetReport = fopen(BUDGET_REPORT_FILE, "wb");    //NULL without a host device, the scenario still runs
+#endif
+#ifdef NO_OS
+    //before initBanks, so the PORTB values it works out keep the OS ROM out
+    osReport.loopsWithOs = idleLoops();
+    if (osOff()) {
+        osReport.loopsWithoutOs = idleLoops();
+        osReport.freedCycles = (unsigned long)(osReport.loopsWithoutOs - osReport.loopsWithOs) * CPU_CYCLES_PER_FRAME
+                               / osReport.loopsWithoutOs;
+    }
+#endif
+#ifdef AI_EVASION
+    initThreatSweep();
+#endif
+#ifdef XE_BANKS
+    initBanks();
+#endif
+#ifdef PROFILER
+    initProfiler();
+#endif
     //First while loop to prevent program carshing in native hardware
     while (true) {
-        p0Input = joy_read(JOY_1);
+#ifdef LEVELS
+        streamLevel();                          //never waits on the disk, so the joystick is read on every pass
+#endif
+#ifdef AI_VM
+        if (!gameOn) pickAIProfile();
+#endif
+#ifdef FRAME_SEARCH
+        //only on request, the search takes the screen over for several seconds
+        if (!gameOn && seedScanlines[0] != 0 && (PEEK(CONSOLE_KEYS) & OPTION_KEY) == 0) {
+            searchWorstFrame();
+            while ((PEEK(CONSOLE_KEYS) & OPTION_KEY) == 0) waitvsync();
+        }
+#endif
+        sampleInput();
+        p0Input = readPlayerInput();
+#ifdef XE_BANKS
+        //SELECT at the winner banner plays the game again from the match log
+        replaying = !gameOn && replayTicks > 0 && (PEEK(CONSOLE_KEYS) & SELECT_KEY) == 0;
+        if (replaying) p0Input = FIRE;
+#endif
+#ifdef LEVELS
+        //a press while the arena is still coming in is kept, and the game starts on the pass that finds it in
+        if (!gameOn && !REPLAYING && (p0Input != 0x00 || startWaiting)) {
+            startWaiting = levelsAvailable && levelSectorsRead < LEVEL_SECTORS;
+            p0Input = startWaiting ? 0x00 : FIRE;
+        }
+#endif
         if (!gameOn && p0Input != 0x00) {
-            createBitMap();                     //Create bit map
+#ifdef INPUT_LATENCY
+            latencyPress = 0;                   //the press that starts the game is not timed
+#endif
+            if (!REPLAYING) createBitMap();     //Create bit map, a replay's arena is still on screen
             enablePMGraphics();                 //Enable Player Missile Graphics
             setUpTankDisplay();                 //Set up PLayer 1 and 2 Tank display
             initializeScore();
             gameOn = true;
+#ifdef PROFILER
+            startProfiler();
+#endif
+#ifdef XE_BANKS
+            if (replaying) {
+                memcpy(tankRow, replayStartRow, sizeof(tankRow));
+                memcpy(tankColumn, replayStartColumn, sizeof(tankColumn));
+                memcpy(tankDirection, replayStartDirection, sizeof(tankDirection));
+                replayPlayed = 0;
+            } else {
+                memcpy(replayStartRow, tankRow, sizeof(tankRow));
+                memcpy(replayStartColumn, tankColumn, sizeof(tankColumn));
+                memcpy(replayStartDirection, tankDirection, sizeof(tankDirection));
+                replayTicks = 0;
+            }
+#endif
+#ifdef FRAME_SEARCH
+            beginFrameSearch();
+#endif
+#ifdef FRAME_BUDGET
+            beginFrameBudget();
+#endif
+#ifdef FRAME_TRACE
+            traceRecord->aiMove = TRACE_NO_MOVE;
+#endif
         }
 
         while (gameOn) {
-            //Slows down character movement e.g. (60fps/5) = 12moves/second (it is actually slower than this for some reason)
-            if (frameDelayCounter == 5)
-            {
-                movePlayers();
-                frameDelayCounter = 0;
-
-                //if either of the players are hit, spin and move them, rather than letting them fire or move
-                if (p0IsHit && hitTime[0] > 0) spinTank(0);
-                if (p1IsHit && hitTime[1] > 0) spinTank(1);
-                
-                if(j < 12)
-                {
-                    _sound(0, j , 8, 8);
-                    j++;
-                }
+            playFrame();
+
+#ifdef FRAME_BUDGET
+            endFrameBudget();
+#endif
+#ifdef FRAME_BUDGET_SCENARIO
+            if (!gameOn || framesMeasured == FRAME_BUDGET_FRAMES) finishBudgetReport();
+#endif
+#ifdef FRAME_TRACE
+            endFrameTrace();
+#endif
+#ifdef FRAME_SEARCH
+            keepSearchSeed(frameScanlines[(frameLogIndex - 1) & (FRAME_LOG_SIZE - 1)]);
+#endif
+            waitvsync();
+#ifdef FRAME_SEARCH
+            saveSearchState(&frameState);
+#endif
+#ifdef FRAME_BUDGET
+            beginFrameBudget();
+#endif
+        }
+#ifdef XE_BANKS
+        replaying = false;                      //the log is kept, SELECT plays it again
+#endif
+    }
 
-                if(j >= 12) _sound(0, 0, 0, 0); //Turn off sound register
-            } else {
-                frameDelayCounter++;
-            }
+    return 0;
+}
 
+/*
+    ----------------------------------------------- FUNCTION IMPLEMENTATIONS -------------------------------------------------------
+*/
 
-            //Makes a firing sound when P1 presses the fire button
-            if (p0Fired == true) {
-                m0SoundTracker++;
+//------------------------------ playFrame ------------------------------
+// Purpose: Play one frame of the game: read the joystick, move the tanks on a
+//          movement tick, move the shells, act on the collisions and put the
+//          result on screen.
+// Parameters: None
+// Preconditions: The game must be on, called once a frame after vertical blank
+// Postconditions: The frame is played and committed, gameOn is cleared if a
+//                 player has won
+void playFrame() {
+    unsigned char shell;
 
-                if (m0SoundTracker < 15) {
-                    _sound(0, m0SoundTracker, 8, 2);
-                } else if (m0SoundTracker == 15) {
-                    m0SoundTracker = 0;
-                    _sound(0, 0, 0, 0); //Turns off sound register for Audio Channel 0
-                    p0Fired = false;
-                }
-            }
+    sampleInput();
 
-            //Makes a firing sound when P1 presses the fire button
-            if (p1Fired == true) {
-                m1SoundTracker++;
+    //Slows down character movement e.g. (60fps/5) = 12moves/second (it is actually slower than this for some reason)
+    if (frameDelayCounter == MOVE_TICK_FRAMES)
+    {
+        movePlayers();
+        frameDelayCounter = 0;
 
-                if (m1SoundTracker < 15) {
-                    _sound(1, m1SoundTracker, 8, 2);
-                } else if (m1SoundTracker == 15) {
-                    m1SoundTracker = 0;
-                    _sound(1, 0, 0, 0); //Turns off sound register for Audio Channel 1
-                    p1Fired = false;
-                }
-            }
+        //if either of the players are hit, spin and move them, rather than letting them fire or move
+        if (p0IsHit && hitTime[0] > 0) spinTank(0);
+        if (p1IsHit && hitTime[1] > 0) spinTank(1);
+        
+        if(j < 12)
+        {
+            SOUND(0, j , 8, 8);
+            j++;
+        }
 
-            if (p0FireAvailable == false) { //start counter to limit p0 fire inputs
-                p0FireDelayCounter++;
-            }
-            if (p0FireDelayCounter >= 60) {
-                p0FireAvailable = true;
-                p0FireDelayCounter = 0;
-            }
-            if (p1FireAvailable == false) { //start counter to limit p0 fire inputs
-                p1FireDelayCounter++;
-            }
+        if(j >= 12) SOUND(0, 0, 0, 0); //Turn off sound register
+    } else {
+        frameDelayCounter++;
+    }
 
-            if (p1FireDelayCounter >= 100) {
-                p1FireAvailable = true;
-                p1FireDelayCounter = 0;
-            }
+    for (shell = 0; shell < MISSILE_POOL_SIZE; shell++) {
+        if (shellExists[shell] == true) {
+            traverseMissile(shell);
+        }
+    }
+
+    //Checking Collision every single frame
+    checkCollision();
+    p1history = p1LastMove; //helps to fix collision bug
+    p0history = p0LastMove; //helps to fix collision bug
+#ifdef SCROLL_ARENA
+    followTanks();                      //before anything is placed on screen
+#endif
+#ifdef BEAM_RACE
+    scheduleFrame();                    //the rest of the frame's work runs while the beam goes down the screen
+#endif
+
+    //Makes a firing sound when P1 presses the fire button
+    if (p0Fired == true) {
+        m0SoundTracker++;
+
+        if (m0SoundTracker < 15) {
+            SOUND(0, m0SoundTracker, 8, 2);
+        } else if (m0SoundTracker == 15) {
+            m0SoundTracker = 0;
+            SOUND(0, 0, 0, 0); //Turns off sound register for Audio Channel 0
+            p0Fired = false;
+        }
+    }
 
+    //Makes a firing sound when P1 presses the fire button
+    if (p1Fired == true) {
+        m1SoundTracker++;
 
-            if (m0exists == true) {
-                traverseMissile(m0direction, m0LastHorizontalLocation, m0LastVerticalLocation, 0);
-            }
-            if (m1exists == true) {
-                traverseMissile(m1direction, m1LastHorizontalLocation, m1LastVerticalLocation, 1);
-            }
+        if (m1SoundTracker < 15) {
+            SOUND(1, m1SoundTracker, 8, 2);
+        } else if (m1SoundTracker == 15) {
+            m1SoundTracker = 0;
+            SOUND(1, 0, 0, 0); //Turns off sound register for Audio Channel 1
+            p1Fired = false;
+        }
+    }
 
-            //Checking Collision every single frame
-            checkCollision();
-            p1history = p1LastMove; //helps to fix collision bug
-            p0history = p0LastMove; //helps to fix collision bug
-
-            //This condition will only be met when either player 1 or player 2 reaches the score of 9,
-            //or charcater 9 (which is 0x0019 in HEX located at Character Memory)
-            if (p0Score == 217 || p1Score == 25) {
-                int tracker = 0;
-
-                for (i = 0; i < 20; i++) {
-                    POKE(charMapAddress + i, 0);
-
-                    if (i >= 6 && i <= 13) {
-                        if (p0Score == 217) {
-                            POKE(charMapAddress + i, characterSetP0[tracker]);
-                        } else if (p1Score == 25) {
-                            POKE(charMapAddress + i, characterSetP1[tracker]);
-                        }
-                        tracker++;
-                    }
-                }
+    RACE_BEAM();
 
-                gameOn = false;
-            }
+    if (p0FireAvailable == false) { //start counter to limit p0 fire inputs
+        p0FireDelayCounter++;
+    }
+    if (p0FireDelayCounter >= P0_FIRE_COOLDOWN) {
+        p0FireAvailable = true;
+        p0FireDelayCounter = 0;
+    }
+    if (p1FireAvailable == false) { //start counter to limit p0 fire inputs
+        p1FireDelayCounter++;
+    }
 
-            waitvsync();
+    if (p1FireDelayCounter >= P1_FIRE_COOLDOWN) {
+        p1FireAvailable = true;
+        p1FireDelayCounter = 0;
+    }
+
+    RACE_BEAM();
+
+    //This condition will only be met when either player 1 or player 2 reaches WIN_SCORE,
+    //the score line character WIN_SCORE past their 0
+    if (p0Score == SCORE_P0_ZERO + WIN_SCORE || p1Score == SCORE_P1_ZERO + WIN_SCORE) {
+        showWinnerBanner();
+        gameOn = false;
+#ifdef PROFILER
+        stopProfiler();                 //only play is profiled, not the banner, level loading or the search
+#endif
+#ifdef MEM_DEBUG
+        scanMemory();
+#endif
+#ifdef LEVELS
+        //start loading the next arena while the banner is up
+        if (levelCount > 0 && !REPLAYING) {
+            levelNumber = (levelNumber + 1) % levelCount;
+            levelSectorsRead = 0;
         }
+#endif
     }
 
-    return 0;
+    //Put the frame's tank and missile positions on screen
+    commitFrame();
 }
 
-/*
-    ----------------------------------------------- FUNCTION IMPLEMENTATIONS -------------------------------------------------------
-*/
+//------------------------------ showWinnerBanner ------------------------------
+// Purpose: Replace the score line with the winner's banner.
+// Parameters: None
+// Preconditions: One of the players has reached WIN_SCORE
+// Postconditions: The score line shows "P1 WINS!" or "P2 WINS!"
+void showWinnerBanner() {
+    int tracker = 0;
+
+    for (i = 0; i < SCORE_LINE_WIDTH; i++) {
+        POKE(charMapAddress + i, 0);
+
+        if (i >= BANNER_COLUMN && i < BANNER_COLUMN + 8) {
+            if (p0Score == SCORE_P0_ZERO + WIN_SCORE) {
+                POKE(charMapAddress + i, characterSetP0[tracker]);
+            } else if (p1Score == SCORE_P1_ZERO + WIN_SCORE) {
+                POKE(charMapAddress + i, characterSetP1[tracker]);
+            }
+            tracker++;
+        }
+    }
+}
 
 //------------------------------ rearrangingDisplayList ------------------------------
 // Purpose: Reconfigure the display list for graphics mode to ensure proper rendering.
@@ -410,54 +1627,65 @@ int main() {
 //          and a jump instruction for vertical blank synchronization.
 //          The resulting display list must have a total of 192 scan lines.
 // Parameters: None
-// Preconditions: The OS object must be initialized with appropriate values.
-// Postconditions: The display list is modified as per the graphics mode requirements.
+// Preconditions: _graphics must have set up screen memory and the display list (OS.savmsc, OS.sdlstl/sdlsth).
+//          With SCROLL_ARENA the score line stays in the OS's screen memory, the bit map is
+//          the arena, and the game's own two display lists give every bit map line
+//          an LMS address, with the window on the middle of the arena.
+// Postconditions: The display list is modified as per the graphics mode requirements, and charMapAddress
+//                 and bitMapAddress point at the score line and bit map.
 void rearrangingDisplayList() {
-    unsigned int *DLIST_ADDRESS  = (OS.sdlstl + OS.sdlsth*256);
-    unsigned char *DLIST = (unsigned char *)DLIST_ADDRESS;
-
-    // Write the Display List for Graphics Mode
-    // Must contain a total of 192 Scan Lines for display list to function properly
-    unsigned char displayList[] = {
-            DL_BLK8,  // 8 blank lines
-            DL_BLK8,
-            DL_BLK8,
-            DL_LMS(DL_CHR20x16x2),
-            0xE0, 0x9C,  // Charcater Memory (Low Byte and High Byte)
-            DL_LMS(DL_MAP40x8x4),
-            0xF4,0x9C,  //Screen memory (Low Byte and High Byte)
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_MAP40x8x4,
-            DL_JVB,  // Jump and vertical blank
-            0x4E, 0x9E  // Jump address (in this case, loop back to the start)
-    };
-
-    for (i = 0; i < 30; i++) {
-        POKE(DLIST + i, displayList[i]);
-    }
-
-    //Setting bit and character map address based on the modified display list 
-    bitMapAddress = PEEK(DLIST+7) + PEEK(DLIST+8)*256;
-    charMapAddress = PEEK(DLIST+4) + PEEK(DLIST+5)*256;
+#ifdef SCROLL_ARENA
+    unsigned int boundary;
+    unsigned int address;
+    unsigned char list;
+    unsigned char n;
+
+    charMapAddress = (unsigned int)OS.savmsc;
+    //ANTIC's memory counter wraps at a 4K boundary, so start the arena where any boundary inside it
+    //falls at the start of a row
+    bitMapAddress = (unsigned int)arenaMemory;
+    boundary = ((unsigned int)bitMapAddress + ARENA_BYTES) & 0xF000;
+    if (boundary > (unsigned int)bitMapAddress) bitMapAddress += (boundary - bitMapAddress) % ARENA_WIDTH;
+
+    //the blank lines and the score line from the template, then one LMS line per bit map row
+    for (list = 0; list < 2; list++) {
+        address = (((unsigned int)scrollListMemory + SCROLL_LIST_SIZE - 1) & ~(SCROLL_LIST_SIZE - 1))
+                  + list * SCROLL_LIST_SIZE;
+        scrollList[list] = address;
+        for (i = 0; i < DL_BITMAP_LMS - 1; i++) POKE(address + i, displayListTemplate[i]);
+        POKEW(address + DL_SCORE_LMS, charMapAddress);
+        for (n = 0; n < PLAYFIELD_ROWS - 1; n++) POKE(address + DL_BITMAP_LMS - 1 + n * 3, DL_LMS(DL_HSCROL(DL_VSCROL(DL_MAP40x8x4))));
+        POKE(address + DL_BITMAP_LMS - 1 + n * 3, DL_LMS(DL_HSCROL(DL_MAP40x8x4)));
+        POKE(address + SCROLL_LIST_BYTES - 3, DL_JVB);
+        POKEW(address + SCROLL_LIST_BYTES - 2, address);
+        listColumn[list] = SCROLL_NONE;
+    }
+
+    //show the first list from the next vertical blank, scrollVBI takes over once the game starts
+    viewLeft = VIEW_LEFT_MAX / 2;
+    viewTop = VIEW_TOP_MAX / 2;
+    scrollBack = 0;
+    commitScroll();
+    scrollPending = 0;
+    waitvsync();                        //so the OS cannot copy the pointer half written
+    POKEW(SDLSTL, scrollListShadow);
+    POKE(HSCROL, hscrolShadow);
+    POKE(VSCROL, vscrolShadow);
+#else
+    unsigned int dlistAddress = OS.sdlstl + OS.sdlsth*256;
+    unsigned int screenAddress = (unsigned int)OS.savmsc;
+
+    //Copy the whole display list, JVB included, then point it at this machine's screen memory:
+    //the score line first and the bit map right after it, inside the memory the OS set aside
+    for (i = 0; i < sizeof(displayListTemplate); i++) {
+        POKE(dlistAddress + i, displayListTemplate[i]);
+    }
+    charMapAddress = screenAddress;
+    bitMapAddress = screenAddress + SCORE_LINE_WIDTH;
+    POKEW(dlistAddress + DL_SCORE_LMS, charMapAddress);
+    POKEW(dlistAddress + DL_BITMAP_LMS, bitMapAddress);
+    POKEW(dlistAddress + DL_JUMP, dlistAddress);
+#endif
 }
 
 //------------------------------ initializeScore ------------------------------
@@ -468,8 +1696,8 @@ void rearrangingDisplayList() {
 //                 score to 0.
 void initializeScore() {
     //Temp code
-    POKE(charMapAddress + 5, 208);
-    POKE(charMapAddress + 14, 16);
+    POKE(charMapAddress + SCORE_P0_COLUMN, SCORE_P0_ZERO);
+    POKE(charMapAddress + SCORE_P1_COLUMN, SCORE_P1_ZERO);
 }
 
 //------------------------------ updatePlayerScore ------------------------------
@@ -478,8 +1706,8 @@ void initializeScore() {
 // Preconditions: Tank to missile collision must be true
 // Postconditions: The scoreboard will be updated
 void updatePlayerScore() {
-    POKE(charMapAddress + 5, p0Score);
-    POKE(charMapAddress + 14, p1Score);
+    POKE(charMapAddress + SCORE_P0_COLUMN, p0Score);
+    POKE(charMapAddress + SCORE_P1_COLUMN, p1Score);
 }
 
 //------------------------------ createBitMap ------------------------------
@@ -488,26 +1716,55 @@ void updatePlayerScore() {
 // Preconditions: None
 // Postconditions: Bit Map will be created
 void createBitMap() {
+#ifdef SCROLL_ARENA
+    unsigned char row;
+    unsigned char column;
+#endif
+
+#ifdef LEVELS
+    if (levelsAvailable) {
+        for (i = 0; i < PLAYFIELD_ROWS * PLAYFIELD_WIDTH; i++) {
+            POKE(bitMapAddress+i, level.bitMap[i]);
+        }
+        POKE(COLOR1, level.color);
+        return;
+    }
+#endif
+
     //Making the top and bottom border
-    for (i = 0; i < 10; i++)
+    for (i = 0; i < ARENA_WIDTH; i++)
     {
         POKE(bitMapAddress+i, 170);
-        POKE(bitMapAddress+210+i, 170);
+        POKE(bitMapAddress+(ARENA_ROWS-1)*ARENA_WIDTH+i, 170);
     }
 
     //Making the left border
-    for (i = 10; i <= 200; i += 10)
+    for (i = ARENA_WIDTH; i <= (ARENA_ROWS-2)*ARENA_WIDTH; i += ARENA_WIDTH)
     {
         POKE(bitMapAddress+i, 128);
     }
 
     //Making the right border
-    for (i = 19; i <= 209; i += 10)
+    for (i = 2*ARENA_WIDTH-1; i < (ARENA_ROWS-1)*ARENA_WIDTH; i += ARENA_WIDTH)
     {
         POKE(bitMapAddress+i, 2);
     }
 
-    POKE(0x2C5, 26);    //Sets bitmap color to yellow
+#ifdef SCROLL_ARENA
+    //Blocks every 4 bytes across and 8 rows down, so there is something to see go by, leaving the rows
+    //the tanks start on clear
+    for (row = 4; row < ARENA_ROWS - 3; row += 8)
+    {
+        if (row * 8 + 8 > TANK_START_ROW + BOARD_TOP - PLAYFIELD_TOP - TANK_HALF
+            && row * 8 < TANK_START_ROW + BOARD_TOP - PLAYFIELD_TOP + TANK_HALF) continue;
+        for (column = 2; column < ARENA_WIDTH - 1; column += 4)
+        {
+            POKE(bitMapAddress + row * ARENA_WIDTH + column, 170);
+        }
+    }
+#endif
+
+    POKE(COLOR1, 26);   //Sets bitmap color to yellow
 }
 
 //------------------------------ enablePMGraphics ------------------------------
@@ -517,24 +1774,49 @@ void createBitMap() {
 // Preconditions: None
 // Postconditions: player and missile base address will be intialized
 void enablePMGraphics() {
-    POKE(0x22F, 62);                    //Enable Player-Missile DMA single line
-    PMBaseAddress = 0x2800;             //the player-missile base address
-    POKE(0xD407, PMBaseAddress);        //Store Player-Missile base address in base register
-    POKE(0xD01D, 3);                    //Enable Player-Missile DMA
+    unsigned char bank;
 
-    playerAddress = (PMBaseAddress * 256) + 1024;
-    missileAddress = (PMBaseAddress * 256) + 768;
+    POKE(0x22F, SDMCTL_VALUE);          //Enable Player-Missile DMA (single or double line) and set the playfield width
 
-    //Clear up default built-in characters in Player's address
-    for (i = 0; i <= 512; i++) {
-        POKE(playerAddress + i, 0);
+    //pmMemory is an assembler label on a PM_BANK_SIZE boundary, which the player-missile base address needs
+    asm("lda #<pmMemory");
+    asm("sta %v", PMBaseAddress);
+    asm("lda #>pmMemory");
+    asm("sta %v+1", PMBaseAddress);
+    POKE(PMBASE, (unsigned int)PMBaseAddress >> 8);    //Store Player-Missile base address (page) in base register
+    POKE(0xD01D, 3);                    //Enable Player-Missile DMA
 
-        //Clear up built in characters in Missile's address
-        if (i <= 256)
-        {
-            POKE(missileAddress + i, 0);
-        }
+    playerAddress = PMBaseAddress + PM_PLAYER_OFFSET;
+    for (bank = 0; bank < PM_BANKS; bank++) {
+        missileAddress[bank] = PMBaseAddress + bank * PM_BANK_SIZE + PM_MISSILE_OFFSET;
+        tankPlayerAddress[bank][0] = PMBaseAddress + bank * PM_BANK_SIZE + PM_PLAYER_OFFSET;
+        tankPlayerAddress[bank][1] = tankPlayerAddress[bank][0] + PM_PLAYER_STRIDE;
+    }
+
+    //Clear up missile and player memory
+    for (i = PM_MISSILE_OFFSET; i < PM_BANK_SIZE * PM_BANKS; i++) {
+        POKE(PMBaseAddress + i, 0);
     }
+
+#ifdef PM_DOUBLE_BUFFER
+    //bank 0 is on screen, draw into bank 1 first
+    pmBack = 1;
+    flipPage = 0;
+    for (bank = 0; bank < 8; bank++) hposShadow[bank] = 0;
+#endif
+#ifdef DEFERRED_VBI
+#ifdef NO_OS
+    //SETVBV is in the OS ROM, so set the vector by hand with the vertical blank interrupt held off
+    POKE(NMIEN, 0);
+    POKEW(VVBLKD, (unsigned int)DEFERRED_VBI);
+    POKE(NMIEN, NMI_VBI);
+#else
+    asm("ldy #<%v", DEFERRED_VBI);
+    asm("ldx #>%v", DEFERRED_VBI);
+    asm("lda #7");
+    asm("jsr %w", SETVBV);
+#endif
+#endif
 }
 
 //------------------------------ setUpTankDisplay ------------------------------
@@ -545,20 +1827,24 @@ void enablePMGraphics() {
 //                 behind sprite. Tank for Player 2 will be created and set to
 //                 point South West behind sprite.
 void setUpTankDisplay() {
-    int counter = 0;
-
     //Set up player 0 tank
-    p0Direction = EAST;
-    p1Direction = WEST;
-    p0VerticalLocation = 131;
-    p0HorizontalLocation = 57;
-    p1VerticalLocation = 387;
-    p1HorizontalLocation = 190;
-
-    p0_r = 80;
-    p0_c = 9;
-    p1_r = 80;
-    p1_c = 142;
+    tankDirection[0] = EAST;
+    tankDirection[1] = WEST;
+    tankRow[0] = TO_FP(TANK_START_ROW);
+    tankColumn[0] = TO_FP(TANK0_START_COLUMN);
+    tankRow[1] = TO_FP(TANK_START_ROW);
+    tankColumn[1] = TO_FP(TANK1_START_COLUMN);
+    aiOpening = AI_OPENING;
+#ifdef LEVELS
+    if (levelsAvailable) {
+        for (i = 0; i < 2; i++) {
+            tankDirection[i] = level.tankDirection[i] * HEADING_SCALE;
+            tankRow[i] = TO_FP(level.tankRow[i]);
+            tankColumn[i] = TO_FP(level.tankColumn[i]);
+        }
+        aiOpening = level.aiOpening;
+    }
+#endif
 
     j = 255;
     m0SoundTracker = 0;
@@ -567,15 +1853,27 @@ void setUpTankDisplay() {
     k = 0;
 
     directionChosen = false;
+#ifdef AI_VM
+    aiPc = 0;
+    aiCounter = 0;
+    aiWait = 0;
+#endif
 
-    p0Score = 208;
-    p1Score = 16;
+    p0Score = SCORE_P0_ZERO;
+    p1Score = SCORE_P1_ZERO;
 
     //variables to keep track of tank firing
     p0Fired = false;
     p1Fired = false;
-    m0exists = false;
-    m1exists = false;
+    for (i = 0; i < MISSILE_POOL_SIZE; i++) {
+        shellExists[i] = false;
+        shellDrawnRow[0][i] = -1;       //PM memory was just cleared
+#ifdef PM_DOUBLE_BUFFER
+        shellDrawnRow[1][i] = -1;
+#endif
+    }
+    shellNext[0] = 0;
+    shellNext[1] = 1;
     p0FireDelayCounter = 0;
     p1FireDelayCounter = 0;
     p0FireAvailable = true;
@@ -590,41 +1888,46 @@ void setUpTankDisplay() {
     hitTime[1] = 0;
 
     //variables to delay tank diagonal movement
-    p0FirstDiag = false;
-    p1FirstDiag = false;
+    tankFirstDiag[0] = false;
+    tankFirstDiag[1] = false;
 
-    for (i = 0; i < 20; i++) {
+    for (i = 0; i < SCORE_LINE_WIDTH; i++) {
         POKE(charMapAddress + i, 0);
     }
 
-    POKE(horizontalRegister_P0, p0HorizontalLocation);
-    POKE(colLumPM0, 70);
-
-    for (i = 131; i < 131+8; i++) {
-        POKE(playerAddress+i, tankPics[EAST][counter]);
-        counter++;
-    }
-
-    counter = 0;
+    //PM memory was just cleared, so nothing is drawn yet
+    tankDrawnRow[0][0] = -1;
+    tankDrawnRow[0][1] = -1;
+#ifdef PM_DOUBLE_BUFFER
+    tankDrawnRow[1][0] = -1;
+    tankDrawnRow[1][1] = -1;
+#endif
+
+    POKE(colLumPM0, TANK0_COLOR);
+    POKE(colLumPM2, TANK0_COLOR);
+#ifdef INVISIBLE_TANKS
+    //the tanks are hidden by turning their player colors off, so the shells get a color of their own
+    POKE(GPRIOR, PEEK(GPRIOR) | 0x10);
+    POKE(COLOR3, SHELL_COLOR);
+    revealTime[0] = 0;
+    revealTime[1] = 0;
+#endif
+    commitTank(0);
 
     //Set up player 1 tank
-    POKE(horizontalRegister_P1, 190);
-    POKE(colLumPM1, 40);
-
-    for (i = 387; i < 395; i++) {
-        POKE(playerAddress+i, tankPics[WEST][counter]);
-        counter++;
-    }
-    counter = 0;
+    POKE(colLumPM1, TANK1_COLOR);
+    POKE(colLumPM3, TANK1_COLOR);
+    commitTank(1);
 }
 
 // The pointPosition function will take in a direction which represents the direction of the line
 // and the point that it needs to evaluate if it's to the left or to the right of.
+// The line runs through the AI tank, p_r and p_c are board pixels.
 // returns 0 when it's on the line, 1 when it's to the right, 2 when it's to the left.
 int pointPosition(int dir, int p_r, int p_c) {
     int a = deltas[dir][0];
     int b = -deltas[dir][1];
-    int c = deltas[dir][1] * p1_r - deltas[dir][0] * p1_c;
+    int c = deltas[dir][1] * FP_INT(tankRow[1]) - deltas[dir][0] * FP_INT(tankColumn[1]);
 
     int res = a * p_c + b * p_r + c;
 
@@ -648,10 +1951,14 @@ unsigned char attack() {
     // II - includes E disculdes S
     // III - includes S disculdes W
     // IV - includes W discludes N
-    int a, b, c, d, e, mask;
-    int startDir;
-    int endDir;
+    int startDir = NORTH;           //the tanks are on top of each other, any quadrant will do
+    int endDir = NORTH_60;
     int r;
+    int p0_r = FP_INT(tankRow[0]);
+    int p0_c = FP_INT(tankColumn[0]);
+    int p1_r = FP_INT(tankRow[1]);
+    int p1_c = FP_INT(tankColumn[1]);
+
     if (p0_r < p1_r && p0_c >= p1_c) {
         // p0 is in AI's quadrant I
         // NORTH_EAST disculding EAST
@@ -675,23 +1982,8 @@ unsigned char attack() {
     }
 
     for (i = startDir; i < endDir; i++) {
-        a = pointPosition(i, p0_r - 2, p0_c - 4);
-        b = pointPosition(i, p0_r + 2, p0_c - 4);
-        c = pointPosition(i, p0_r - 2, p0_c + 3);
-        d = pointPosition(i, p0_r + 2, p0_c + 3);
-        e = pointPosition(i, p0_r, p0_c);
-
-        if (a == 0 || b == 0 || c == 0 || d == 0 || e == 0) {
-            p1Direction = i;
-            updateplayerDir(1);
-            directionChosen = false;
-            return FIRE;
-        }
-
-        mask = 0x00 | (1 << a) | (1 << b) | (1 << c) | (1 << d);
-        if (mask == 0x03) {
-            p1Direction = i;
-            updateplayerDir(1);
+        if (lineHitsTank(i)) {
+            tankDirection[1] = i;
             directionChosen = false;
             return FIRE;
         }
@@ -700,20 +1992,39 @@ unsigned char attack() {
     // pick a number between 0-3
     if (!directionChosen) {
         // choose a random direction in the correct quadrant
-        r = rand() % 4;
-        p1Direction = startDir + r;
-        desiredDirection = p1Direction; 
-        updateplayerDir(1);
+        r = rand() % QUARTER_TURN;
+        tankDirection[1] = startDir + r;
+        desiredDirection = tankDirection[1];
         directionChosen = true;
     } else {
-        p1Direction = desiredDirection;
-        updateplayerDir(1);
+        tankDirection[1] = desiredDirection;
         return FORWARD;
     }
 
     return NOTHING;
 }
 
+// lineHitsTank checks whether a line through the AI tank in direction dir
+// crosses player 1's tank: it goes through its middle or a corner, or
+// passes between its corners.
+bool lineHitsTank(int dir) {
+    int p0_r = FP_INT(tankRow[0]);
+    int p0_c = FP_INT(tankColumn[0]);
+    int a, b, c, d, e, mask;
+
+    FRAME_PATH(aiLines);
+    a = pointPosition(dir, p0_r - 2, p0_c - 4);
+    b = pointPosition(dir, p0_r + 2, p0_c - 4);
+    c = pointPosition(dir, p0_r - 2, p0_c + 3);
+    d = pointPosition(dir, p0_r + 2, p0_c + 3);
+    e = pointPosition(dir, p0_r, p0_c);
+
+    if (a == 0 || b == 0 || c == 0 || d == 0 || e == 0) return true;
+
+    mask = 0x00 | (1 << a) | (1 << b) | (1 << c) | (1 << d);
+    return mask == 0x03;
+}
+
 unsigned char getAIPlayersNextMove() {
     // let's start with the basics let's just move the AI Player to always be at the same row as the 
     // other player. 
@@ -722,13 +2033,193 @@ unsigned char getAIPlayersNextMove() {
     // p0_c and p1_c
     // FORWARD, BACKWARD, LEFT TURN, RIGHT TURN, FIRE
     // unsigned char moves[5] = {0x01, 0x02, 0x04, 0x08, 0x10};
+#ifdef AI_EVASION
+    unsigned char escape = evadeShells();
+
+    //getting out of the way of a shell comes before anything else the AI wants to do
+    if (escape != NOTHING) return escape;
+#endif
 
-    while (k < 72) {
+#ifdef AI_VM
+    return runAIScript();
+#else
+    while (k < aiOpening) {
         k++;
         return FORWARD;
     }
 
     return attack();
+#endif
+}
+
+#ifdef AI_VM
+//------------------------------ aiCondition ------------------------------
+// Purpose: Test one of the conditions the AI scripts branch on.
+// Parameters:
+//   condition - AI_AIMED, AI_LOADED, AI_HIT, AI_CLOSE or AI_CHANCE.
+// Preconditions: None
+// Postconditions: Returns whether the condition holds this tick
+bool aiCondition(unsigned char condition) {
+    int rowStep = FP_INT(tankRow[0]) - FP_INT(tankRow[1]);
+    int columnStep = FP_INT(tankColumn[0]) - FP_INT(tankColumn[1]);
+    unsigned char dir = tankDirection[1];
+
+    switch (condition) {
+    case AI_AIMED:
+        //on the line, and in front of the barrel rather than behind it
+        return lineHitsTank(dir) && rowStep * deltas[dir][0] + columnStep * deltas[dir][1] > 0;
+    case AI_LOADED:
+        return p1FireAvailable;
+    case AI_HIT:
+        return p1IsHit;
+    case AI_CLOSE:
+        return abs(rowStep) + abs(columnStep) < AI_CLOSE_RANGE;
+    default:
+        return (rand() & 3) == 0;
+    }
+}
+
+//------------------------------ runAIScript ------------------------------
+// Purpose: Run the AI's behavior script up to the instruction that picks this
+//          tick's move, or until AI_VM_BUDGET instructions have run.
+// Parameters: None
+// Preconditions: Called once a movement tick, aiScript must end in a JUMP
+// Postconditions: Returns the AI's joystick bits for the tick, aiPc is where
+//                 the script carries on next tick
+unsigned char runAIScript() {
+    const unsigned char *script = aiScript;
+    unsigned char budget;
+
+    if (aiWait > 0) {
+        aiWait--;
+        return NOTHING;
+    }
+
+    for (budget = 0; budget < AI_VM_BUDGET; budget++) {
+        FRAME_PATH(aiInstructions);
+        switch (script[aiPc]) {
+        case AI_OP_MOVE:
+        case AI_OP_TURN:
+            aiPc += 2;
+            return script[aiPc - 1];
+        case AI_OP_AIM:
+            aiPc++;
+            if (!aiCondition(AI_AIMED)) {
+                //pointPosition gives 1 for player 1 anticlockwise of the barrel
+                return pointPosition(tankDirection[1], FP_INT(tankRow[0]), FP_INT(tankColumn[0])) == 1 ? LEFT_TURN : RIGHT_TURN;
+            }
+            break;
+        case AI_OP_FIRE:
+            aiPc++;
+            return FIRE;
+        case AI_OP_WAIT:
+            //WAIT(0) does nothing, the script runs straight on
+            if (script[aiPc + 1] == 0) {
+                aiPc += 2;
+                break;
+            }
+            aiWait = script[aiPc + 1] - 1;
+            aiPc += 2;
+            return NOTHING;
+        case AI_OP_JUMP:
+            aiPc = script[aiPc + 1];
+            break;
+        case AI_OP_IF:
+        case AI_OP_UNLESS:
+            if (aiCondition(script[aiPc + 1]) == (script[aiPc] == AI_OP_IF)) aiPc = script[aiPc + 2];
+            else aiPc += 3;
+            break;
+        case AI_OP_COUNT:
+            aiCounter = script[aiPc + 1] ? script[aiPc + 1] : aiOpening;
+            aiPc += 2;
+            break;
+        default:                                    //AI_OP_LOOP
+            if (aiCounter > 1) {
+                aiCounter--;
+                aiPc = script[aiPc + 1];
+            } else {
+                aiCounter = 0;
+                aiPc += 2;
+            }
+            break;
+        }
+    }
+
+    //out of budget, carry on from aiPc next tick
+    return NOTHING;
+}
+
+//------------------------------ pickAIProfile ------------------------------
+// Purpose: Let START step through the AI profiles while the game is not on,
+//          and show the one picked at the right end of the score line.
+// Parameters: None
+// Preconditions: The game must not be on, the score line must be set up
+// Postconditions: aiScript is the picked profile's script, the score line
+//                 shows its number
+void pickAIProfile() {
+    bool held = (PEEK(CONSOLE_KEYS) & START_KEY) == 0;
+
+    if (held && !startKeyHeld) {
+        aiProfile = (aiProfile + 1) % AI_PROFILES;
+        aiScript = aiProfiles[aiProfile];
+    }
+    startKeyHeld = held;
+    POKE(charMapAddress + AI_PROFILE_COLUMN, AI_PROFILE_ZERO + 1 + aiProfile);
+}
+#endif
+
+//------------------------------ sampleInput ------------------------------
+// Purpose: Read player 1's joystick straight from the hardware ports and latch
+//          any new presses for the next movement tick.
+// Parameters: None
+// Preconditions: Called once a frame
+// Postconditions: inputHeld holds the joystick bits (JOY_UP, JOY_DOWN, JOY_LEFT,
+//                 JOY_RIGHT, JOY_BTN_1) and new presses are added to inputPressed
+void sampleInput() {
+    //the port bits are the joystick bits inverted, which lines them up with FORWARD, BACKWARD, LEFT_TURN and RIGHT_TURN
+    unsigned char held = ~PEEK(PORTA) & 0x0F;
+
+    if (PEEK(TRIG0) == 0) held |= FIRE;
+
+#ifdef INPUT_LATENCY
+    //time the first new press from the frame it is sampled in, a replay's moves are not the joystick's
+    if ((held & ~inputHeld) && latencyPress == 0 && !REPLAYING) {
+        latencyPress = held & ~inputHeld;
+        latencyStart = PEEK(RTCLOK_LOW);
+        latencyShows = LATENCY_WAITING;
+    }
+#endif
+
+    inputPressed |= held & ~inputHeld;
+    inputHeld = held;
+}
+
+//------------------------------ readPlayerInput ------------------------------
+// Purpose: Take player 1's input for a movement tick, or step through the frame
+//          budget scenario script when one is built in.
+// Parameters: None
+// Preconditions: sampleInput must have been called this frame
+// Postconditions: Returns the joystick bits held now plus any pressed since the last
+//                 movement tick, and clears the latched presses
+unsigned char readPlayerInput() {
+#ifdef FRAME_BUDGET_SCENARIO
+    unsigned char input = budgetScript[budgetScriptIndex][0];
+
+    //move on to the next script entry once its ticks are used up, holding on the last entry
+    budgetScriptTicks++;
+    if (budgetScriptTicks >= budgetScript[budgetScriptIndex][1] &&
+        budgetScriptIndex < sizeof(budgetScript) / sizeof(budgetScript[0]) - 1) {
+        budgetScriptIndex++;
+        budgetScriptTicks = 0;
+    }
+
+    return input;
+#else
+    unsigned char input = inputHeld | inputPressed;
+
+    inputPressed = 0;
+    return input;
+#endif
 }
 
 //------------------------------ movePlayers ------------------------------
@@ -738,710 +2229,429 @@ unsigned char getAIPlayersNextMove() {
 // Postconditions: Both tank will do actions based on the user's inputs.
 void movePlayers(){
     //joystick code
-    unsigned char player0move = joy_read(JOY_1);
+    unsigned char player0move = readPlayerInput();
     unsigned char player1move = getAIPlayersNextMove();
+#ifdef INPUT_LATENCY
+    bool couldFire = p0FireAvailable;
+    int lastRow = tankRow[0];
+    int lastColumn = tankColumn[0];
+    unsigned char lastDirection = tankDirection[0];
+#endif
+    FRAME_PATH(movementTicks);
     p0LastMove = player0move;
     p1LastMove = player1move;
+#ifdef FRAME_TRACE
+    traceRecord->input = player0move;
+    traceRecord->aiMove = player1move;
+#endif
+#ifdef XE_BANKS
+    //a replay still asks both players for their moves, so its frames cost what the game's did
+    if (replaying) readReplay(&player0move, &player1move);
+    else logReplay(player0move, player1move);
+#endif
 
     //moving player 1, only if they are not hit
     if(JOY_BTN_1(player0move) && p0FireAvailable == true && !p0IsHit) {fire(0); p0Fired = true;}
     else if(JOY_UP(player0move) && !p0IsHit) {
-        if (!(p0Direction % 2) || ((p0Direction % 2) && p0FirstDiag == true)) moveForward(0);
-        else p0FirstDiag = true;
+        //diagonal headings only move every other tick
+        if (!SLOW_HEADING(tankDirection[0]) || tankFirstDiag[0]) moveForward(0);
+        else tankFirstDiag[0] = true;
     }
     else if(JOY_DOWN(player0move) && !p0IsHit) {
-        if(!(p0Direction % 2) || ((p0Direction % 2) && p0FirstDiag == true)) moveBackward(0);
-        else p0FirstDiag = true;
+        if (!SLOW_HEADING(tankDirection[0]) || tankFirstDiag[0]) moveBackward(0);
+        else tankFirstDiag[0] = true;
     }
     else if(JOY_LEFT(player0move) || JOY_RIGHT(player0move) && !p0IsHit) turnplayer(player0move, 0);
 
+#ifdef INPUT_LATENCY
+    //what the tick did with player 1's move, in the same priority as above
+    if (p0FireAvailable != couldFire) actOnInputLatency(FIRE);
+    else if (tankRow[0] != lastRow || tankColumn[0] != lastColumn) actOnInputLatency(JOY_UP(player0move) ? FORWARD : BACKWARD);
+    else if (tankDirection[0] != lastDirection) actOnInputLatency(JOY_LEFT(player0move) ? LEFT_TURN : RIGHT_TURN);
+    else actOnInputLatency(NOTHING);
+#endif
+
     //moving player 2, only if they are not hit
     if(JOY_BTN_1(player1move) && p1FireAvailable == true && !p1IsHit) {fire(1); p1Fired = true;}
     else if(JOY_UP(player1move) && !p1IsHit) {
-        if (!(p1Direction % 2) || ((p1Direction % 2) && p1FirstDiag == true)) moveForward(1);
-        else p1FirstDiag = true;
+        if (!SLOW_HEADING(tankDirection[1]) || tankFirstDiag[1]) moveForward(1);
+        else tankFirstDiag[1] = true;
     }
     else if(JOY_DOWN(player1move) && !p1IsHit) {
-        if(!(p1Direction % 2) || ((p1Direction % 2) && p1FirstDiag == true)) moveBackward(1);
-        else p1FirstDiag = true;
+        if (!SLOW_HEADING(tankDirection[1]) || tankFirstDiag[1]) moveBackward(1);
+        else tankFirstDiag[1] = true;
     }
     else if(JOY_LEFT(player1move) || JOY_RIGHT(player1move) && !p1IsHit) turnplayer(player1move, 1);
 }
 
 //------------------------------ turnPlayer ------------------------------
 // Purpose: Changes the direction of the specified player's tank based on joystick input.
-//          This function handles tank direction changes, taking into account joystick input
-//          and special cases for smooth and intuitive tank movement.
+//          Turning left from NORTH comes round to WEST_60 and turning right from
+//          WEST_60 comes round to NORTH.
 // Parameters:
 //   turn - The joystick input indicating the desired direction change.
 //   player - The player identifier (0 or 1) indicating which tank's direction to change.
 // Preconditions: The player's current direction and joystick input must be correctly set.
-// Postconditions: The player's tank direction is updated according to the joystick input.
+// Postconditions: The player's tank direction is updated according to the joystick input,
+//                 and is drawn by the next commitFrame.
 void turnplayer(unsigned char turn, int player){
-    //for player 1
-    if (player == 0) {
-        //handling edge cases
-        if (p0Direction == WEST_60 && JOY_RIGHT(turn)) {
-            p0Direction = NORTH;
-        } else if (p0Direction == NORTH && JOY_LEFT(turn)) {
-            p0Direction = WEST_60;
-        }
-
-        //if the joystick is left,
-        else if(JOY_LEFT(turn)){
-            p0Direction = p0Direction - 1;
-        }
-        
-        //if the joystick is right
-        else if(JOY_RIGHT(turn)){
-            p0Direction = p0Direction + 1;
-        }
-
-        updateplayerDir(0);
+    //if the joystick is left,
+    if (JOY_LEFT(turn)) {
+        tankDirection[player] = (tankDirection[player] - 1) & (HEADINGS - 1);
     }
-    
-    //for player 2
-    else if (player == 1) {
-        if (p1Direction == WEST_60 && JOY_RIGHT(turn)) {
-            p1Direction = NORTH;
-        }
-        else if (p1Direction == NORTH && JOY_LEFT(turn)) {
-            p1Direction = WEST_60;
-        }
-        
-        //if the joystick is left,
-        else if (JOY_LEFT(turn)) {
-            p1Direction = p1Direction - 1;
-        }
 
-        //if the joystick is right
-        else if(JOY_RIGHT(turn)){
-            p1Direction = p1Direction + 1;
-        }
-
-        updateplayerDir(1);
+    //if the joystick is right
+    else if (JOY_RIGHT(turn)) {
+        tankDirection[player] = (tankDirection[player] + 1) & (HEADINGS - 1);
     }
 }
 
-//------------------------------ updatePlayerDir ------------------------------
-// Purpose: Updates the visual representation of the specified player's tank.
-//          This function refreshes the display of the tank sprite based on its
-//          current direction, ensuring smooth animation.
+//------------------------------ moveForward ------------------------------
+// Purpose: Move the tank forward one step in the direction it is facing.
 // Parameters:
-//   player - The player identifier (0 or 1) indicating which tank's sprite to update.
-// Preconditions: The player's current direction, position, and tank sprite array (tankPics)
-//                must be correctly set.
-// Postconditions: The tank sprite on the screen reflects the updated direction.
-void updateplayerDir(int player){
-    //updating player 1
-    if (player == 0) {
-        if (p0Direction == SOUTH_WEST || p0Direction == EAST_SOUTH) {
-            int counter = 7;
-            for (i = p0VerticalLocation; i < p0VerticalLocation + 8; i++) {
-                POKE(playerAddress + i, tankPics[p0Direction][counter]);
-                counter--;
-            }
-        } else {
-            int counter = 0;
-            for (i = p0VerticalLocation; i < p0VerticalLocation + 8; i++) {
-                POKE(playerAddress + i, tankPics[p0Direction][counter]);
-                counter++;
-            }
-        }
-    }
-
-    //updating player 2
-    else if (player == 1) {
-        if (p1Direction == SOUTH_WEST || p1Direction == EAST_SOUTH) {
-            int counter = 7;
-            for (i = p1VerticalLocation; i < p1VerticalLocation + 8; i++) {
-                POKE(playerAddress + i, tankPics[p1Direction][counter]);
-                counter--;
-            }
-        } else {
-            int counter = 0;
-            for (i = p1VerticalLocation; i < p1VerticalLocation + 8; i++) {
-                POKE(playerAddress + i, tankPics[p1Direction][counter]);
-                counter++;
-            }
-        }
-    }
+//   tank - The tank identifier (0 or 1) indicating which tank to move.
+// Preconditions: The tank's direction and position must be set.
+// Postconditions: The tank's board position is moved forward; it is drawn there by
+//                 the next commitFrame.
+void moveForward(int tank){
+    FRAME_PATH(tankSteps);
+    tankFirstDiag[tank] = false;
+    tankRow[tank] += deltas[tankDirection[tank]][0];
+    tankColumn[tank] += deltas[tankDirection[tank]][1];
 }
 
-//------------------------------ moveForward ------------------------------
-// Purpose: Move the tank forward in the specified direction.
-//          This function updates the tank's position based on its current
-//          direction and ensures smooth movement, including diagonal cases.
+//------------------------------ moveBackward ------------------------------
+// Purpose: Move the tank backward one step, away from the direction it is facing.
 // Parameters:
 //   tank - The tank identifier (0 or 1) indicating which tank to move.
-// Preconditions: The tank's direction, position, and related variables must be set.
-// Postconditions: The tank's position is updated to move it forward in the specified direction.
-void moveForward(int tank){
-    //moving forward tank 1--------------------------------
-    if (tank == 0) {
-        p0FirstDiag = false;
+// Preconditions: The tank's direction and position must be set.
+// Postconditions: The tank's board position is moved backward; it is drawn there by
+//                 the next commitFrame.
+void moveBackward(int tank) {
+    FRAME_PATH(tankSteps);
+    tankFirstDiag[tank] = false;
+    tankRow[tank] -= deltas[tankDirection[tank]][0];
+    tankColumn[tank] -= deltas[tankDirection[tank]][1];
+}
 
-        //movement for north
-        if (p0Direction == NORTH) {
-            POKE(playerAddress+(p0VerticalLocation+7), 0);
-            p0VerticalLocation--;
-            p0_r--;
-        }
+//-------------------------------check borders------------------------------
+//purpose: during a collision, check to see if the tank is going to spin
+//         out-of-bounds, and correct it by sending it to the opposing
+//         side of the screen, or with SCROLL_ARENA holding it inside the arena
+//parameters: tank, either 0 for tank 1 or 1 for tank 2
+//preconditions: tank location must be set
+//post conditions: tank location may be changed
+//--------------------------------------------------------------------------
+void checkBorders(int tank) {
+    int row = FP_INT(tankRow[tank]);
+    int column = FP_INT(tankColumn[tank]);
+
+#ifdef SCROLL_ARENA
+    //the other side of a scrolling arena is out of sight, so the tank is held inside it instead
+    if (column <= BOARD_WRAP_LEFT) tankColumn[tank] = TO_FP(BOARD_WRAP_LEFT + 1);
+    else if (column >= BOARD_WRAP_RIGHT) tankColumn[tank] = TO_FP(BOARD_WRAP_RIGHT - 1);
+    if (row <= BOARD_WRAP_TOP) tankRow[tank] = TO_FP(BOARD_WRAP_TOP + 1);
+    else if (row >= BOARD_WRAP_BOTTOM) tankRow[tank] = TO_FP(BOARD_WRAP_BOTTOM - 1);
+#else
+    //if they are too far to the left or right
+    if (column <= BOARD_WRAP_LEFT) tankColumn[tank] = TO_FP(BOARD_WRAP_RIGHT);
+    else if (column >= BOARD_WRAP_RIGHT) tankColumn[tank] = TO_FP(BOARD_WRAP_LEFT);
+
+    //if they're too far up or down
+    if (row <= BOARD_WRAP_TOP) tankRow[tank] = TO_FP(BOARD_WRAP_BOTTOM);
+    else if (row >= BOARD_WRAP_BOTTOM) tankRow[tank] = TO_FP(BOARD_WRAP_TOP);
+#endif
+}
 
-        //movement for south
-        if (p0Direction == SOUTH) {
-            POKE(playerAddress+p0VerticalLocation, 0);
-            p0VerticalLocation++;
-            p0_r++;
-        }
+//-----------------------spin tank------------------------
+//purpose: spin the tank if it is hit, but in different
+//         directions depending on what direction it
+//         is hit from
+//parameters: tank, either 0 for tank 1 or 1 for tank 2
+//preconditions: tank direction, location, and player hit
+//               direction must be set (set in collision)
+//post conditions: tank direction and location are changed
+//--------------------------------------------------------
+void spinTank(int tank){
+    //shells between two named headings count as the one anticlockwise of them
+    int hitDir = ((tank == 0) ? p0HitDir : p1HitDir) & ~(HEADING_SCALE - 1);
+    unsigned char direction = tankDirection[tank];
 
-        //movement north-ish cases
-        if (p0Direction == NORTH_15 || p0Direction == NORTH_60 || p0Direction == NORTH_EAST || p0Direction == WEST_15 || p0Direction == WEST_NORTH || p0Direction == WEST_60) {
-            int x = 0;
-            int y = 0;
-
-            //X ifs
-            if (p0Direction == NORTH_EAST || p0Direction == WEST_NORTH || p0Direction == NORTH_15 || p0Direction == WEST_60) x = 1;
-            if (p0Direction == NORTH_60 || p0Direction == WEST_15) x = 2;
-
-            //Y ifs
-            if (p0Direction == NORTH_EAST || p0Direction == WEST_NORTH || p0Direction == NORTH_60 || p0Direction == WEST_15) y = 1;
-            if (p0Direction == NORTH_15 || p0Direction == WEST_60) y = 2;
-            if (p0Direction < 4) {
-                p0HorizontalLocation = p0HorizontalLocation + x;
-                p0_c = p0_c + x;
-            } else {
-                p0HorizontalLocation = p0HorizontalLocation - x;
-                p0_c = p0_c - x;
-            }
-            POKE(playerAddress+(p0VerticalLocation +7), 0);
-            POKE(playerAddress+(p0VerticalLocation +6), 0);
-            p0VerticalLocation = p0VerticalLocation - y;
-            p0_r = p0_r - y;
-            POKE(horizontalRegister_P0, p0HorizontalLocation);
-        }
+    FRAME_PATH(spins);
 
-        //movement south-ish cases
-        if (p0Direction == SOUTH_15 || p0Direction == SOUTH_60 || p0Direction == SOUTH_WEST || p0Direction == EAST_15 || p0Direction == EAST_SOUTH || p0Direction == EAST_60) {
-            int x = 0;
-            int y = 0;
-
-            //X ifs
-            if (p0Direction == SOUTH_WEST || p0Direction == EAST_SOUTH || p0Direction == SOUTH_15 || p0Direction == EAST_60) x = 1;
-            if (p0Direction == SOUTH_60 || p0Direction == EAST_15) x = 2;
-
-            //Y ifs
-            if (p0Direction == SOUTH_WEST || p0Direction == EAST_SOUTH || p0Direction == SOUTH_60 || p0Direction == EAST_15) y = 1;
-            if (p0Direction == SOUTH_15 || p0Direction == EAST_60) y = 2;
-            if (p0Direction < 8) {
-                p0HorizontalLocation = p0HorizontalLocation + x;
-                p0_c = p0_c + x;
-            }
-            else {
-                p0HorizontalLocation = p0HorizontalLocation - x;
-                p0_c = p0_c - x;
-            }
-            POKE(playerAddress+(p0VerticalLocation), 0);
-            POKE(playerAddress+(p0VerticalLocation +1), 0);
-            p0VerticalLocation = p0VerticalLocation + y;
-            p0_r = p0_r + y;
-            POKE(horizontalRegister_P0, p0HorizontalLocation);
-        }
+    //if the tank is hit from the north
+    if(hitDir == NORTH || hitDir == NORTH_EAST || hitDir == EAST_60 || hitDir == NORTH_15){
+        //move left and spin
+        tankColumn[tank] += TO_FP(1);
+        direction = (direction + NORTH_EAST) & (HEADINGS - 1);
+    }
+    //if the tank is hit from the south, west or east
+    else {
+        //move right, down or up and spin
+        if(hitDir == SOUTH || hitDir == SOUTH_15 || hitDir == SOUTH_WEST || hitDir == WEST_60) tankColumn[tank] -= TO_FP(1);
+        if(hitDir == WEST || hitDir == WEST_15 || hitDir == WEST_NORTH || hitDir == SOUTH_60) tankRow[tank] += TO_FP(1);
+        if(hitDir == EAST || hitDir == EAST_15 || hitDir == EAST_SOUTH || hitDir == NORTH_60) tankRow[tank] -= TO_FP(1);
+        direction = (direction - NORTH_EAST) & (HEADINGS - 1);
+    }
+    tankDirection[tank] = direction;
 
-        //movement west
-        if (p0Direction == WEST) {
-            p0HorizontalLocation--;
-            p0_c--;
-            POKE(horizontalRegister_P0, p0HorizontalLocation);
-        }
+    //lower the time that the tank is stuck in "hit" state
+    hitTime[tank] = hitTime[tank] - 1;
+    if (tank == 0) {
+        if(hitTime[0] == 0) p0IsHit = false;
+    } else {
+        if(hitTime[1] == 0) p1IsHit = false;
+        directionChosen = false;
+    }
 
-        //movement east
-        if (p0Direction == EAST) {
-            p0HorizontalLocation++;
-            p0_c++;
-            POKE(horizontalRegister_P0, p0HorizontalLocation);
-        }
+    //check to see if a tank hit a border wall
+    checkBorders(tank);
+}
 
-        updateplayerDir(0);
+//------------------------------ commitTank ------------------------------
+// Purpose: Draw a tank where its board position says it is. The horizontal
+//          position register and the PM memory rows are worked out here from
+//          the board position, and only rows the tank moved off are cleared.
+// Parameters:
+//   tank - The tank identifier (0 or 1) indicating which tank to draw.
+// Preconditions: PM graphics must be enabled (tankPlayerAddress set)
+// Postconditions: The tank's player shows its current position and direction
+void commitTank(unsigned char tank) {
+    unsigned int address = tankPlayerAddress[pmBack][tank];
+    unsigned char direction = tankDirection[tank];
+    unsigned char horizontal = VIEW_HORIZONTAL(FP_INT(tankColumn[tank]) - TANK_HALF);
+    int top = PM_ROW(VIEW_SCANLINE(FP_INT(tankRow[tank]) - TANK_HALF));
+    int lastTop = tankDrawnRow[pmBack][tank];
+    unsigned char n;
+
+#ifdef INVISIBLE_TANKS
+    //collisions still see the player, only its color is turned off
+    POKE(PCOLR0 + tank, (revealTime[tank] > 0 || hitTime[tank] > 0) ? tankColor[tank] : 0);
+    if (revealTime[tank] > 0) revealTime[tank]--;
+#endif
+
+    if (horizontal != tankDrawnHorizontal[tank] || lastTop < 0) {
+        POKE_HPOS(HPOSP0 + tank, horizontal);
+        tankDrawnHorizontal[tank] = horizontal;
+#ifdef INPUT_LATENCY
+        if (tank == 0) endInputLatency(LATENCY_TANK);
+#endif
     }
 
-    //moving forward tank 2------------------------------
-    else if (tank == 1) {
-        p1FirstDiag = false;
+    if (top == lastTop && direction == tankDrawnDirection[pmBack][tank]) return;
 
-        //movement for north
-        if (p1Direction == NORTH) {
-            POKE(playerAddress+(p1VerticalLocation+7), 0);
-            p1VerticalLocation--;
-            p1_r--;
-        }
+#ifdef INPUT_LATENCY
+    if (tank == 0) endInputLatency(LATENCY_TANK);
+#endif
 
-        //movement for south
-        if (p1Direction == SOUTH) {
-            POKE(playerAddress+p1VerticalLocation, 0);
-            p1VerticalLocation++;
-            p1_r++;
+    FRAME_PATH(tankRedraws);
+    //clear the rows the tank has moved off of
+    if (lastTop >= 0) {
+        for (n = 0; n < TANK_ROWS; n++) {
+            if (lastTop + n < top || lastTop + n >= top + TANK_ROWS) POKE(address + lastTop + n, 0);
         }
+    }
 
-        //movement north-ish cases
-        if (p1Direction == NORTH_15 || p1Direction == NORTH_60 || p1Direction == NORTH_EAST || p1Direction == WEST_15 || p1Direction == WEST_NORTH || p1Direction == WEST_60) {
-            int x = 0;
-            int y = 0;
-
-            //X ifs
-            if (p1Direction == NORTH_EAST || p1Direction == WEST_NORTH || p1Direction == NORTH_15 || p1Direction == WEST_60) x = 1;
-            if (p1Direction == NORTH_60 || p1Direction == WEST_15) x = 2;
-
-            //Y ifs
-            if (p1Direction == NORTH_EAST || p1Direction == WEST_NORTH || p1Direction == NORTH_60 || p1Direction == WEST_15) y = 1;
-            if (p1Direction == NORTH_15 || p1Direction == WEST_60) y = 2;
-            if (p1Direction < 4) {
-                p1HorizontalLocation = p1HorizontalLocation + x;
-                p1_c = p1_c + x;
-            } else {
-                p1HorizontalLocation = p1HorizontalLocation - x;
-                p1_c = p1_c - x;
-            }
-
-            POKE(playerAddress+(p1VerticalLocation +7), 0);
-            POKE(playerAddress+(p1VerticalLocation +6), 0);
-            p1VerticalLocation = p1VerticalLocation - y;
-            p1_r = p1_r - y;
-            POKE(horizontalRegister_P1, p1HorizontalLocation);
-        }
+    for (n = 0; n < TANK_ROWS; n++) POKE(address + top + n, tankPics[direction][n]);
 
-        //movement south-ish cases
-        if (p1Direction == SOUTH_15 || p1Direction == SOUTH_60 || p1Direction == SOUTH_WEST || p1Direction == EAST_15 || p1Direction == EAST_SOUTH || p1Direction == EAST_60) {
-            int x = 0;
-            int y = 0;
-
-            //X ifs
-            if (p1Direction == SOUTH_WEST || p1Direction == EAST_SOUTH || p1Direction == SOUTH_15 || p1Direction == EAST_60) x = 1;
-            if (p1Direction == SOUTH_60 || p1Direction == EAST_15) x = 2;
-
-            //Y ifs
-            if (p1Direction == SOUTH_WEST || p1Direction == EAST_SOUTH || p1Direction == SOUTH_60 || p1Direction == EAST_15) y = 1;
-            if (p1Direction == SOUTH_15 || p1Direction == EAST_60) y = 2;
-            if (p1Direction < 8) {
-                p1HorizontalLocation = p1HorizontalLocation + x;
-                p1_c = p1_c + x;
-            } else {
-                p1HorizontalLocation = p1HorizontalLocation - x;
-                p1_c = p1_c - x;
-            }
-            POKE(playerAddress+(p1VerticalLocation), 0);
-            POKE(playerAddress+(p1VerticalLocation +1), 0);
-            p1VerticalLocation = p1VerticalLocation + y;
-            p1_r = p1_r + y;
-            POKE(horizontalRegister_P1, p1HorizontalLocation);
-        }
+    tankDrawnRow[pmBack][tank] = top;
+    tankDrawnDirection[pmBack][tank] = direction;
+}
 
-        //movement west
-        if (p1Direction == WEST) {
-            p1HorizontalLocation--;
-            p1_c--;
-            POKE(horizontalRegister_P1, p1HorizontalLocation);
-        }
+//------------------------------ commitFrame ------------------------------
+// Purpose: Put everything that moved this frame on screen in one go, so that
+//          a tank bounced back off a wall is never seen at the positions in
+//          between.
+//          With BEAM_RACE, each is redrawn once the beam is below it instead.
+// Parameters: None
+// Preconditions: PM graphics must be enabled, with BEAM_RACE scheduleFrame must
+//                have been called
+// Postconditions: Both tanks and every shell are drawn at their board positions
+void commitFrame() {
+#ifdef BEAM_RACE
+    while (raceBeam()) {
+        //nothing left to do but wait for the beam to get below the rest
+    }
+#else
+    unsigned char shell;
+
+    commitTank(0);
+    commitTank(1);
+    for (shell = 0; shell < MISSILE_POOL_SIZE; shell++) commitShell(shell);
+#endif
+
+#ifdef PM_DOUBLE_BUFFER
+    //show the bank just drawn from the next vertical blank on, and draw the next frame into the other one.
+    //flipVBI has always run by the time waitvsync returns, nothing sets CRITIC during play.
+    flipPage = (PMBaseAddress + pmBack * PM_BANK_SIZE) >> 8;
+    pmBack ^= 1;
+#endif
+#ifdef SCROLL_ARENA
+    commitScroll();                     //the window the sprites were just placed in, from the same vertical blank
+#endif
+
+#ifdef INPUT_LATENCY
+    //a change the tick made that did not show in the tick's own frame never will, e.g. a step into a wall
+    //that the collision took back, so the press is dropped rather than credited with a later change
+    if (latencyPress != 0 && latencyShows != LATENCY_WAITING) {
+        latencyPress = 0;
+        inputsDropped++;
+    }
+#endif
+}
 
-        //movement east
-        if (p1Direction == EAST) {
-            p1HorizontalLocation++;
-            p1_c++;
-            POKE(horizontalRegister_P1, p1HorizontalLocation);
-        }
+#ifdef SCROLL_ARENA
+//------------------------------ followTanks ------------------------------
+// Purpose: Move the playfield window to the point halfway between the tanks,
+//          as far as the arena goes. The collision registers only see what is
+//          on screen, so a tank the window cannot take in is held at its edge,
+//          and a shell that leaves it is out of play.
+// Parameters: None
+// Preconditions: The frame's moves and collisions are done
+// Postconditions: viewLeft and viewTop are this frame's window, both tanks and
+//                 every shell in play are inside it
+void followTanks() {
+    unsigned char tank;
+    unsigned char shell;
+    int left = (FP_INT(tankColumn[0]) + FP_INT(tankColumn[1])) / 2 + BOARD_LEFT - PLAYFIELD_LEFT
+               - PLAYFIELD_WIDTH * 8;
+    int top = (FP_INT(tankRow[0]) + FP_INT(tankRow[1])) / 2 + BOARD_TOP - PLAYFIELD_TOP - VIEW_SCANLINES / 2;
+    int low;
+    int high;
+
+    if (left < VIEW_LEFT_MIN) left = VIEW_LEFT_MIN;
+    else if (left > VIEW_LEFT_MAX) left = VIEW_LEFT_MAX;
+    if (top < 0) top = 0;
+    else if (top > VIEW_TOP_MAX) top = VIEW_TOP_MAX;
+    viewLeft = left;
+    viewTop = top;
+
+    for (tank = 0; tank < 2; tank++) {
+        low = TO_FP(left + PLAYFIELD_LEFT - BOARD_LEFT + TANK_HALF);
+        high = TO_FP(left + PLAYFIELD_RIGHT - BOARD_LEFT - TANK_HALF);
+        if (tankColumn[tank] < low) tankColumn[tank] = low;
+        else if (tankColumn[tank] > high) tankColumn[tank] = high;
+        low = TO_FP(top + PLAYFIELD_TOP - BOARD_TOP + TANK_HALF);
+        high = TO_FP(top + PLAYFIELD_TOP + VIEW_SCANLINES - BOARD_TOP - TANK_HALF);
+        if (tankRow[tank] < low) tankRow[tank] = low;
+        else if (tankRow[tank] > high) tankRow[tank] = high;
+    }
 
-        updateplayerDir(1);
+    for (shell = 0; shell < MISSILE_POOL_SIZE; shell++) {
+        if (!shellExists[shell]) continue;
+        low = VIEW_HORIZONTAL(FP_INT(shellColumn[shell]));
+        high = VIEW_SCANLINE(FP_INT(shellRow[shell]));
+        if (low < PLAYFIELD_LEFT || low >= PLAYFIELD_RIGHT
+            || high < PLAYFIELD_TOP || high >= PLAYFIELD_TOP + VIEW_SCANLINES) removeShell(shell);
     }
 }
 
-//------------------------------ moveBackward ------------------------------
-// Purpose: Move the tank backward in the specified direction.
-//          This function updates the tank's position based on its current
-//          direction and ensures smooth movement, including diagonal cases.
-// Parameters:
-//   tank - The tank identifier (0 or 1) indicating which tank to move.
-// Preconditions: The tank's direction, position, and related variables must be set.
-// Postconditions: The tank's position is updated to move it backward in the specified direction.
-void moveBackward(int tank) {
-    //moving backward tank 1-------------------------------
-    if (tank == 0) {
-        p0FirstDiag = false;
+//------------------------------ commitScroll ------------------------------
+// Purpose: Leave the window for scrollVBI to show from the next vertical
+//          blank: the fine scroll, and the display list ANTIC is not showing,
+//          which only needs its LMS addresses rewritten when the window has
+//          moved onto another arena byte or row since that list was last shown.
+// Parameters: None
+// Preconditions: viewLeft and viewTop are set, called once a frame at most
+// Postconditions: scrollPending is set, the other display list is the back one
+void commitScroll() {
+    unsigned char column = (viewLeft + 15) >> 4;    //the byte in the window's first whole column of pixels
+    unsigned char row = viewTop >> 3;
+
+    if (column != listColumn[scrollBack] || row != listRow[scrollBack]) writeScrollList(scrollBack, column, row);
+
+    //a line fetches from the byte before column, HSCROL moves it right until viewLeft is at the window's edge
+    hscrolShadow = (column << 4) - viewLeft;
+    vscrolShadow = viewTop & 7;
+    scrollListShadow = scrollList[scrollBack];
+    scrollPending = 1;                  //last, so scrollVBI never sees the shadows half set
+    scrollBack ^= 1;
+}
 
-        //movement for north
-        if (p0Direction == NORTH) {
-            POKE(playerAddress+p0VerticalLocation, 0);
-            p0VerticalLocation++;
-            p0_r++;
+//------------------------------ writeScrollList ------------------------------
+// Purpose: Point every bit map line of a display list at its row of the arena.
+// Parameters:
+//   list - The display list, 0 or 1.
+//   column - Arena byte in the window's first whole column of pixels.
+//   row - Arena row at the top of the window.
+// Preconditions: rearrangingDisplayList must have built the display lists
+// Postconditions: The list's PLAYFIELD_ROWS LMS addresses show the arena from
+//                 row, column
+void writeScrollList(unsigned char list, unsigned char column, unsigned char row) {
+    unsigned int address = scrollList[list] + DL_BITMAP_LMS;
+    unsigned int line = bitMapAddress + row * ARENA_WIDTH + column - 1;
+    unsigned char n;
+
+    for (n = 0; n < PLAYFIELD_ROWS; n++) {
+        POKEW(address, line);
+        address += 3;
+        line += ARENA_WIDTH;
+    }
+    listColumn[list] = column;
+    listRow[list] = row;
+}
+#endif
+
+#ifdef BEAM_RACE
+//------------------------------ scheduleFrame ------------------------------
+// Purpose: Work out how far down the screen the beam has to be before each
+//          tank and shell can be redrawn: below the lower of the rows it was
+//          drawn on and the rows it is going to, so it is never caught with
+//          half of it moved.
+// Parameters: None
+// Preconditions: The frame's positions are final, called before commitFrame
+// Postconditions: raceLine holds each object's VCOUNT, 0 for nothing to redraw
+void scheduleFrame() {
+    unsigned char tank;
+    unsigned char shell;
+    int top;
+    int row;
+
+    for (tank = 0; tank < 2; tank++) {
+        top = PM_ROW(VIEW_SCANLINE(FP_INT(tankRow[tank]) - TANK_HALF));
+        if (top == tankDrawnRow[pmBack][tank]
+            && tankDirection[tank] == tankDrawnDirection[pmBack][tank]
+            && VIEW_HORIZONTAL(FP_INT(tankColumn[tank]) - TANK_HALF) == tankDrawnHorizontal[tank]) {
+            raceLine[tank] = 0;
+            commitTank(tank);           //nothing moves, but an invisible tank's color may change
+            continue;
         }
+        if (tankDrawnRow[pmBack][tank] > top) top = tankDrawnRow[pmBack][tank];
+        raceLine[tank] = RACE_LINE((top + TANK_ROWS) << PM_SHIFT);
+    }
 
-        //movement for south
-        if(p0Direction == SOUTH){
-            POKE(playerAddress+(p0VerticalLocation+7), 0);
-            p0VerticalLocation--;
-            p0_r--;
-        }
-
-        //movement north-ish cases
-        if(p0Direction == NORTH_15 || p0Direction == NORTH_60 || p0Direction == NORTH_EAST || p0Direction == WEST_15 || p0Direction == WEST_NORTH || p0Direction == WEST_60){
-            int x = 0;
-            int y = 0;
-
-            //X ifs
-            if (p0Direction == NORTH_EAST || p0Direction == WEST_NORTH || p0Direction == NORTH_15 || p0Direction == WEST_60) x = 1;
-            if (p0Direction == NORTH_60 || p0Direction == WEST_15) x = 2;
-
-            //Y ifs
-            if (p0Direction == NORTH_EAST || p0Direction == WEST_NORTH || p0Direction == NORTH_60 || p0Direction == WEST_15) y = 1;
-            if (p0Direction == NORTH_15 || p0Direction == WEST_60) y = 2;
-            if (p0Direction > 4) {
-                p0HorizontalLocation = p0HorizontalLocation + x;
-                p0_c = p0_c + x;
-            } else {
-                p0HorizontalLocation = p0HorizontalLocation - x;
-                p0_c = p0_c - x;
-            }
-            POKE(playerAddress+(p0VerticalLocation), 0);
-            POKE(playerAddress+(p0VerticalLocation + 1), 0);
-            p0VerticalLocation = p0VerticalLocation + y;
-            p0_r = p0_r + y;
-            POKE(horizontalRegister_P0, p0HorizontalLocation);
-        }
-        
-        //movement south-ish cases
-        if (p0Direction == SOUTH_15 || p0Direction == SOUTH_60 || p0Direction == SOUTH_WEST || p0Direction == EAST_15 || p0Direction == EAST_SOUTH || p0Direction == EAST_60){
-            int x = 0;
-            int y = 0;
-
-            //X ifs
-            if (p0Direction == SOUTH_WEST || p0Direction == EAST_SOUTH || p0Direction == SOUTH_15 || p0Direction == EAST_60) x = 1;
-            if (p0Direction == SOUTH_60 || p0Direction == EAST_15) x = 2;
-
-            //Y ifs
-            if (p0Direction == SOUTH_WEST || p0Direction == EAST_SOUTH || p0Direction == SOUTH_60 || p0Direction == EAST_15) y = 1;
-            if (p0Direction == SOUTH_15 || p0Direction == EAST_60) y = 2;
-            if (p0Direction < 8) {
-                p0HorizontalLocation = p0HorizontalLocation - x;
-                p0_c = p0_c - x;
-            } else {
-                p0HorizontalLocation = p0HorizontalLocation + x;
-                p0_c = p0_c + x;
-            }
-            POKE(playerAddress+(p0VerticalLocation + 7), 0);
-            POKE(playerAddress+(p0VerticalLocation +6), 0);
-            p0VerticalLocation = p0VerticalLocation - y;
-            p0_r = p0_r - y;
-            POKE(horizontalRegister_P0, p0HorizontalLocation);
-        }
-
-        //movement west
-        if (p0Direction == WEST){
-            p0HorizontalLocation++;
-            p0_c++;
-            POKE(horizontalRegister_P0, p0HorizontalLocation);
-        }
-
-        //movement east
-        if (p0Direction == EAST){
-            p0HorizontalLocation--;
-            p0_c--;
-            POKE(horizontalRegister_P0, p0HorizontalLocation);
-        }
-
-        updateplayerDir(0);
-    }
-
-
-    //moving backward tank 2-------------------------------
-    if (tank == 1) {
-        p1FirstDiag = false;
-
-        //movement for north
-        if (p1Direction == NORTH) {
-            POKE(playerAddress+p1VerticalLocation, 0);
-            p1VerticalLocation++;
-            p1_r++;
-        }
-
-        //movement for south
-        if (p1Direction == SOUTH) {
-            POKE(playerAddress+(p1VerticalLocation+7), 0);
-            p1VerticalLocation--;
-            p1_r--;
-        }
-
-        //movement north-ish cases
-        if (p1Direction == NORTH_15 || p1Direction == NORTH_60 || p1Direction == NORTH_EAST || p1Direction == WEST_15 || p1Direction == WEST_NORTH || p1Direction == WEST_60) {
-            int x = 0;
-            int y = 0;
-
-            //X ifs
-            if (p1Direction == NORTH_EAST || p1Direction == WEST_NORTH || p1Direction == NORTH_15 || p1Direction == WEST_60) x = 1;
-            if (p1Direction == NORTH_60 || p1Direction == WEST_15) x = 2;
-
-            //Y ifs
-            if (p1Direction == NORTH_EAST || p1Direction == WEST_NORTH || p1Direction == NORTH_60 || p1Direction == WEST_15) y = 1;
-            if (p1Direction == NORTH_15 || p1Direction == WEST_60) y = 2;
-            if (p1Direction > 4) {
-                p1HorizontalLocation = p1HorizontalLocation + x;
-                p1_c = p1_c + x;
-            } else {
-                p1HorizontalLocation = p1HorizontalLocation - x;
-                p1_c = p1_c - x;
-            }
-            POKE(playerAddress+(p1VerticalLocation), 0);
-            POKE(playerAddress+(p1VerticalLocation + 1), 0);
-            p1VerticalLocation = p1VerticalLocation + y;
-            p1_r = p1_r + y;
-            POKE(horizontalRegister_P1, p1HorizontalLocation);
-        }
-
-        //movement south-ish cases
-        if(p1Direction == SOUTH_15 || p1Direction == SOUTH_60 || p1Direction == SOUTH_WEST || p1Direction == EAST_15 || p1Direction == EAST_SOUTH || p1Direction == EAST_60){
-            int x = 0;
-            int y = 0;
-
-            //X ifs
-            if(p1Direction == SOUTH_WEST || p1Direction == EAST_SOUTH || p1Direction == SOUTH_15 || p1Direction == EAST_60) x = 1;
-            if(p1Direction == SOUTH_60 || p1Direction == EAST_15) x = 2;
-
-            //Y ifs
-            if(p1Direction == SOUTH_WEST || p1Direction == EAST_SOUTH || p1Direction == SOUTH_60 || p1Direction == EAST_15) y = 1;
-            if(p1Direction == SOUTH_15 || p1Direction == EAST_60) y = 2;
-            if(p1Direction < 8) {
-                p1HorizontalLocation = p1HorizontalLocation - x;
-                p1_c = p1_c - x;
-            }
-            else {
-                p1HorizontalLocation = p1HorizontalLocation + x;
-                p1_c = p1_c + x;
-            }
-            POKE(playerAddress+(p1VerticalLocation + 7), 0);
-            POKE(playerAddress+(p1VerticalLocation +6), 0);
-            p1VerticalLocation = p1VerticalLocation - y;
-            p1_r = p1_r - y;
-            POKE(horizontalRegister_P1, p1HorizontalLocation);
-        }
-
-        //movement west
-        if(p1Direction == WEST){
-            p1HorizontalLocation++;
-            p1_c++;
-            POKE(horizontalRegister_P1, p1HorizontalLocation);
-        }
-        //movement east
-        if(p1Direction == EAST){
-            p1HorizontalLocation--;
-            p1_c--;
-            POKE(horizontalRegister_P1, p1HorizontalLocation);
-        }
-
-        updateplayerDir(1);
-    }
-}
-
-//-------------------------------check borders------------------------------
-//purpose: during a collision, check to see if the tank is going to spin
-//         out-of-bounds, and correct it by sending it to the opposing
-//         side of the screen
-//parameters: none
-//preconditions: tank location must be set
-//post conditions: tank location may be changed
-//--------------------------------------------------------------------------
-void checkBorders() {
-    //variables to make sure that they don't just jump back across the screen (doesn't trigger as move up right after move down)
-    bool movedLeft0 = false;
-    bool movedLeft1 = false;
-    bool movedup0 = false;
-    bool movedup1 = false;
-
-    //if they are too far to the left
-    if(p0HorizontalLocation <= 50 && p0IsHit){
-        movedLeft0 = true;
-        p0HorizontalLocation = 195;
-        p0_c = 148;
-        // p0_c = 144;
-        POKE(horizontalRegister_P0, p0HorizontalLocation);
-    }
-
-    if(p1HorizontalLocation <= 50 && p1IsHit){
-        movedLeft1 = true;
-        p1HorizontalLocation = 195;
-        p1_c = 148;
-        // p1_c = 144;
-        POKE(horizontalRegister_P1, p1HorizontalLocation);
-    }
-
-    //if they're too far to the right
-    if(p0HorizontalLocation >= 195 && p0IsHit && !movedLeft0){
-        p0HorizontalLocation = 50;
-        p0_c = 0;
-        POKE(horizontalRegister_P0, p0HorizontalLocation);
-    }
-
-    if(p1HorizontalLocation >= 195 && p1IsHit && !movedLeft1){
-        p1HorizontalLocation = 50;
-        p1_c = 0;
-        POKE(horizontalRegister_P1, p1HorizontalLocation);
-    }
-
-    //if they're too far up
-    if(p0VerticalLocation <= 57 && p0IsHit){
-        //delete player from upper location
-        for (i = 0; i < 8; i++) {
-            POKE(playerAddress+(p0VerticalLocation + i), 0);
-        }
-
-        //add them to lower location
-        p0VerticalLocation = 207;
-        movedup0 = true;
-
-        p0_r = 156;
-    }
-    if(p1VerticalLocation <= 312 && p1IsHit){
-        //delete player from upper location
-        for (i = 0; i < 8; i++) {
-            POKE(playerAddress+(p1VerticalLocation + i), 0);
-        }
-
-        POKE(playerAddress+(p1VerticalLocation + 7), 0);
-        //add them to lower location
-        p1VerticalLocation = 464;
-        movedup1 = true;
-        p1_r = 156;
-    }
-
-    //if they're too far down
-    if(p0VerticalLocation >= 207 && p0IsHit && !movedup0){
-        //delete player at lower location
-        for (i = 0; i < 8; i++) {
-            POKE(playerAddress+(p0VerticalLocation + i), 0);
-        }
-
-        //add them to upper location
-        p0VerticalLocation = 57;
-
-        p0_r = 6;
-    }
-    if(p1VerticalLocation >= 464 && p1IsHit && !movedup1){
-        //delete player at lower location
-        for (i = 0; i < 8; i++) {
-            POKE(playerAddress+(p1VerticalLocation + i), 0);
-        }
-
-        //add them to upper location
-        p1VerticalLocation = 312;
-
-        p1_r = 6;
+    for (shell = 0; shell < MISSILE_POOL_SIZE; shell++) {
+        row = shellExists[shell] ? PM_ROW(VIEW_SCANLINE(FP_INT(shellRow[shell]))) : -1;
+        if (shellDrawnRow[pmBack][shell] > row) row = shellDrawnRow[pmBack][shell];
+        raceLine[2 + shell] = row < 0 ? 0 : RACE_LINE((row + 1) << PM_SHIFT);
     }
 }
 
-//-----------------------spin tank------------------------
-//purpose: spin the tank if it is hit, but in different
-//         directions depending on what direction it
-//         is hit from
-//parameters: tank, either 0 for tank 1 or 1 for tank 2
-//preconditions: tank direction, location, and player hit
-//               direction must be set (set in collision)
-//post conditions: tank direction and location are changed
-//--------------------------------------------------------
-void spinTank(int tank){
-
-    //if player 1 is hit
-    if(tank == 0){
-        //if the tank is hit from the north
-        if(p0HitDir == NORTH || p0HitDir == NORTH_EAST || p0HitDir == EAST_60 || p0HitDir == NORTH_15){
-            //move left and spin
-            p0HorizontalLocation++;
-            p0_c++;
-            POKE(horizontalRegister_P0, p0HorizontalLocation);
-            if(p0Direction == WEST_NORTH || p0Direction == WEST_60) p0Direction = NORTH;
-            else p0Direction = p0Direction + 2;
-            updateplayerDir(0);
-        }
-        //if the tank is hit from the south
-        if(p0HitDir == SOUTH || p0HitDir == SOUTH_15 || p0HitDir == SOUTH_WEST || p0HitDir == WEST_60){
-            //move right and spin
-            p0HorizontalLocation--;
-            p0_c--;
-            POKE(horizontalRegister_P0, p0HorizontalLocation);
-            if(p0Direction == NORTH_15 || p0Direction == NORTH) p0Direction = WEST_60;
-            else p0Direction = p0Direction - 2;
-            updateplayerDir(0);
-        }
-        //if the tank is hit from the west
-        if(p0HitDir == WEST || p0HitDir == WEST_15 || p0HitDir == WEST_NORTH || p0HitDir == SOUTH_60){
-            //move down and spin
-            if(p0Direction == NORTH_15 || p0Direction == NORTH) p0Direction = WEST_60;
-            else p0Direction = p0Direction - 2;
-            POKE(playerAddress+p0VerticalLocation, 0);
-            p0VerticalLocation++;
-            p0_r++;
-            updateplayerDir(0);
-        }
-        if(p0HitDir == EAST || p0HitDir == EAST_15 || p0HitDir == EAST_SOUTH || p0HitDir == NORTH_60){
-            //move up and spin
-            if(p0Direction == NORTH_15 || p0Direction == NORTH) p0Direction = WEST_60;
-            else p0Direction = p0Direction - 2;
-            POKE(playerAddress+p0VerticalLocation+7, 0);
-            p0VerticalLocation--;
-            p0_r--;
-            updateplayerDir(0);
-        }
-        //lower the time that the tank is stuck in "hit" state
-        hitTime[0] = hitTime[0] - 1;
-        if(hitTime[0] == 0) p0IsHit = false;
-    }
-
-    //if player 2 is hit
-    if(tank == 1){
-        //if the tank is hit from the north
-        if(p1HitDir == NORTH || p1HitDir == NORTH_15 || p1HitDir == NORTH_EAST || p1HitDir == EAST_60){
-            //move left and spin
-            p1HorizontalLocation++;
-            p1_c++;
-            POKE(horizontalRegister_P1, p1HorizontalLocation);
-            if(p1Direction == WEST_NORTH || p1Direction == WEST_60) p1Direction = NORTH;
-            else p1Direction = p1Direction + 2;
-            updateplayerDir(1);
-        }
-        //if the tank is hit from the south
-        if(p1HitDir == SOUTH || p1HitDir == SOUTH_15 || p1HitDir == SOUTH_WEST || p1HitDir == WEST_60){
-            //move right and spin
-            p1HorizontalLocation--;
-            p1_c--;
-            POKE(horizontalRegister_P1, p1HorizontalLocation);
-            if(p1Direction == NORTH_15 || p1Direction == NORTH) p1Direction = WEST_60;
-            else p1Direction = p1Direction - 2;
-            updateplayerDir(1);
-        }
-        //if the tank is hit from the west
-        if(p1HitDir == WEST || p1HitDir == WEST_15 || p1HitDir == WEST_NORTH || p1HitDir == SOUTH_60){
-            //move down and spin
-            POKE(playerAddress+p1VerticalLocation, 0);
-            p1VerticalLocation++;
-            p1_r++;
-            if(p1Direction == NORTH_15 || p1Direction == NORTH) p1Direction = WEST_60;
-            else p1Direction = p1Direction - 2;
-            updateplayerDir(1);
-        }
-        //if the tank is hit from the east
-        if(p1HitDir == EAST || p1HitDir == EAST_15 || p1HitDir == EAST_SOUTH || p1HitDir == NORTH_60){
-            //move up and spin
-            POKE(playerAddress+p1VerticalLocation+7, 0);
-            p1VerticalLocation--;
-            p1_r--;
-            if(p1Direction == NORTH_15 || p1Direction == NORTH) p1Direction = WEST_60;
-            else p1Direction = p1Direction - 2;
-            updateplayerDir(1);
+//------------------------------ raceBeam ------------------------------
+// Purpose: Redraw every tank and shell the beam has got below since
+//          scheduleFrame. Cheap enough to call between any two pieces of the
+//          frame's work.
+// Parameters: None
+// Preconditions: scheduleFrame must have been called this frame
+// Postconditions: Returns true while something is still waiting for the beam
+bool raceBeam() {
+    unsigned char line = PEEK(VCOUNT);
+    unsigned char object;
+    bool waiting = false;
+
+    for (object = 0; object < RACE_OBJECTS; object++) {
+        if (raceLine[object] == 0) continue;
+        if (line < raceLine[object]) {
+            waiting = true;
+            continue;
         }
-        //lower the time that the tank is stuck in the "hit" state
-        hitTime[1] = hitTime[1] - 1;
-        if(hitTime[1] == 0) p1IsHit = false;
-        directionChosen = false;
+        if (object < 2) commitTank(object);
+        else commitShell(object - 2);
+        raceLine[object] = 0;
     }
-    //check to see if a tank hit a border wall
-    checkBorders();
+    return waiting;
 }
+#endif
 
 //------------------------------ checkCollision ------------------------------
 // Purpose: Move the tank backward in the specified direction.
@@ -1454,6 +2664,12 @@ void spinTank(int tank){
 //                 and ensure to clear collision register after execution (writing
 //                 0's to the collision registers)
 void checkCollision(){
+    unsigned char shell;
+
+#ifdef FRAME_TRACE
+    traceCollisions();
+#endif
+
     //checking for player 1 to playfield collision 
     if(PEEK(P1PF) != 0x0000){
         if(JOY_UP(p1history)){
@@ -1485,37 +2701,36 @@ void checkCollision(){
             moveForward(0);
         }
     }
-    //checking for missile (player 1) to playfield collision
-    if(PEEK(M1PF) != 0x0000){
-        m1exists = false;
-        POKE(missileAddress+m1LastVerticalLocation, 0);
-    }
-    //checking for missile (player 0) to playfield collision
-    if(PEEK(M0PF) != 0x0000){
-        m0exists = false;
-        POKE(missileAddress+m0LastVerticalLocation, 0);
-    }
-    //checking for missile1 to player collision
-    if(PEEK(M1P) != 0x0000){
-        p0HitDir = m1direction;
-        m1exists = false;
-        POKE(missileAddress+m1LastVerticalLocation, 0);
-        p1Score += 1;
-        updatePlayerScore();
-        p0IsHit = true;
-        hitTime[0] = 12;
-        j = 0;
-    }
-    //checking for missile0 to player collision
-    if(PEEK(M0P) != 0x0000){
-        p1HitDir = m0direction;
-        m0exists = false;
-        POKE(missileAddress+m0LastVerticalLocation, 0);
-        p0Score += 1;
-        updatePlayerScore();
-        p1IsHit = true;
-        hitTime[1] = 12;
-        j = 0;
+    for (shell = 0; shell < MISSILE_POOL_SIZE; shell++) {
+        if (shellExists[shell] == false) continue;
+
+        //checking for missile to player collision, only the opposing tank's bit counts
+        if (PEEK(M0P + shell) & ((shell & 1) ? 0x01 : 0x02)) {
+            FRAME_PATH(hits);
+            if (shell & 1) {
+                p0HitDir = shellDirection[shell];
+                p1Score += 1;
+                p0IsHit = true;
+                hitTime[0] = HIT_SPIN_TICKS;
+            } else {
+                p1HitDir = shellDirection[shell];
+                p0Score += 1;
+                p1IsHit = true;
+                hitTime[1] = HIT_SPIN_TICKS;
+            }
+            removeShell(shell);
+            updatePlayerScore();
+            j = 0;
+        }
+
+        //checking for missile to playfield collision
+        else if (PEEK(M0PF + shell) != 0x0000) {
+#ifdef RICOCHET
+            bounceShell(shell);
+#else
+            removeShell(shell);
+#endif
+        }
     }
 
     POKE(HITCLR, 1); // Clear ALL of the Collision Registers
@@ -1523,7 +2738,8 @@ void checkCollision(){
 
 //------------------------------ fire ------------------------------
 // Purpose: Launches a projectile from the specified tank.
-//          This function sets up and fires a projectile in the direction of the tank.
+//          This function sets up and fires a projectile in the direction of the tank,
+//          using one of the tank's shells from the missile pool.
 // Parameters:
 //   tank - The tank identifier (0 or 1) indicating which tank is firing.
 // Preconditions: The tank's direction, position, missile existence, and fire availability
@@ -1532,20 +2748,32 @@ void checkCollision(){
 //                 until a collision occurs. Fire availability is temporarily disabled to
 //                 prevent rapid firing.
 void fire(int tank) {
-    if (tank == 0)
-    {
-        POKE(missileAddress+m0LastVerticalLocation, 0);
-        missileLocationHelper(p0Direction, p0HorizontalLocation, p0VerticalLocation, tank);
-        m0exists = true; //missile exists until colliding
-        p0FireAvailable = false; //prevents missile spamming, starts a counter in the main loop
-    }
-    else if (tank == 1)
-    {
-        POKE(missileAddress+m1LastVerticalLocation, 0);
-        missileLocationHelper(p1Direction, p1HorizontalLocation, p1VerticalLocation, tank);
-        m1exists = true; //missile exists until colliding
-        p1FireAvailable = false; //prevents missile spamming, starts a counter in the main loop
+    unsigned char shell = shellNext[tank];
+    unsigned char n;
+
+    FRAME_PATH(shellsFired);
+
+    //use a shell that is not in flight, otherwise take over the next one in turn
+    for (n = tank; n < MISSILE_POOL_SIZE; n += 2) {
+        if (shellExists[n] == false) {
+            shell = n;
+            break;
+        }
     }
+    shellNext[tank] = (shell + 2 < MISSILE_POOL_SIZE) ? shell + 2 : tank;
+
+    missileLocationHelper(tank, shell);
+
+    if (tank == 0) p0FireAvailable = false; //prevents missile spamming, starts a counter in the main loop
+    else p1FireAvailable = false;
+#ifdef INPUT_LATENCY
+    if (tank == 0) latencyShell = shell;
+#endif
+
+    shellExists[shell] = true; //missile exists until colliding
+#ifdef INVISIBLE_TANKS
+    revealTime[tank] = REVEAL_FRAMES;
+#endif
 }
 
 //------------------------------ missileLocationHelper ------------------------------
@@ -1554,95 +2782,24 @@ void fire(int tank) {
 //          the tip of the tank's barrel.
 // 
 // Parameters:
-//   tankDirection - The direction in which the tank is facing.
-//   pHorizontalLocation - The horizontal position of the tank being passed in.
-//   pVerticalLocation - The vertical position of the tank being passed in.
-//   tank - The tank identifier (0 or 1).
+//   tank - The tank identifier (0 or 1) of the tank firing.
+//   shell - The shell in the missile pool being launched.
 //
-// Preconditions: None
+// Preconditions: The tank's direction and position must be set
 // Postconditions: The missile's launch position is set according to the tank's
-//                 orientation.
-void missileLocationHelper(unsigned int tankDirection, int pHorizontalLocation, int pVerticalLocation, int tank) {
-    int mdirection;
-    int mLastHorizontalLocation = 0;
-    int mLastVerticalLocation = 0;
-
-    if (tankDirection == NORTH) {
-        mLastHorizontalLocation = pHorizontalLocation+4;
-        mLastVerticalLocation = pVerticalLocation;
-        mdirection = NORTH;
-    } else if (tankDirection == NORTH_15) {
-        mLastHorizontalLocation = pHorizontalLocation+5;
-        mLastVerticalLocation = pVerticalLocation;
-        mdirection = NORTH_15;
-    } else if (tankDirection == NORTH_EAST) {
-        mLastHorizontalLocation = pHorizontalLocation+7;
-        mLastVerticalLocation = pVerticalLocation;
-        mdirection = NORTH_EAST;
-    } else if (tankDirection == NORTH_60) {
-        mLastHorizontalLocation = pHorizontalLocation+7;
-        mLastVerticalLocation = pVerticalLocation+2;
-        mdirection = NORTH_60;
-    } else if (tankDirection == EAST) {
-        mLastHorizontalLocation = pHorizontalLocation+7;
-        mLastVerticalLocation = pVerticalLocation+4;
-        mdirection = EAST;
-    } else if (tankDirection == EAST_15) {
-        mLastHorizontalLocation = pHorizontalLocation+7;
-        mLastVerticalLocation = pVerticalLocation+5;
-        mdirection = EAST_15;
-    } else if (tankDirection == EAST_SOUTH) {
-        mLastHorizontalLocation = pHorizontalLocation+7;
-        mLastVerticalLocation = pVerticalLocation+7;
-        mdirection = EAST_SOUTH;
-    } else if (tankDirection == EAST_60) {
-        mLastHorizontalLocation = pHorizontalLocation+5;
-        mLastVerticalLocation = pVerticalLocation+7;
-        mdirection = EAST_60;
-    } else if (tankDirection == SOUTH) {
-        mLastHorizontalLocation = pHorizontalLocation+4;
-        mLastVerticalLocation = pVerticalLocation+7;
-        mdirection = SOUTH;
-    } else if (tankDirection == SOUTH_15) {
-        mLastHorizontalLocation = pHorizontalLocation+2;
-        mLastVerticalLocation = pVerticalLocation+7;
-        mdirection = SOUTH_15;
-    } else if (tankDirection == SOUTH_WEST) {
-        mLastHorizontalLocation = pHorizontalLocation;
-        mLastVerticalLocation = pVerticalLocation+7;
-        mdirection = SOUTH_WEST;
-    } else if (tankDirection == SOUTH_60) {
-        mLastHorizontalLocation = pHorizontalLocation;
-        mLastVerticalLocation = pVerticalLocation+5;
-        mdirection = SOUTH_60;
-    } else if (tankDirection == WEST) {
-        mLastHorizontalLocation = pHorizontalLocation;
-        mLastVerticalLocation = pVerticalLocation+4;
-        mdirection = WEST;
-    } else if (tankDirection == WEST_15) {
-        mLastHorizontalLocation = pHorizontalLocation;
-        mLastVerticalLocation = pVerticalLocation+2;
-        mdirection = WEST_15;
-    } else if (tankDirection == WEST_NORTH) {
-        mLastHorizontalLocation = pHorizontalLocation;
-        mLastVerticalLocation = pVerticalLocation;
-        mdirection = WEST_NORTH;
-    } else if (tankDirection == WEST_60) {
-        mLastHorizontalLocation = pHorizontalLocation+2;
-        mLastVerticalLocation = pVerticalLocation+2;
-        mdirection = WEST_60;
-    }
-
-    //Update missile location based on which player is being passed in
-    if (tank == 0) {
-        m0LastHorizontalLocation = mLastHorizontalLocation;
-        m0LastVerticalLocation = mLastVerticalLocation;
-        m0direction = mdirection;
-    } else if (tank == 1) {
-        m1LastHorizontalLocation = mLastHorizontalLocation;
-        m1LastVerticalLocation = mLastVerticalLocation - 256; //-256 because in RAM, the vertical position of player 1 ranges from 257 - 512
-        m1direction = mdirection;
-    }
+//                 orientation; it is drawn there by the next commitFrame.
+void missileLocationHelper(int tank, unsigned char shell) {
+    unsigned char direction = tankDirection[tank];
+
+    shellDirection[shell] = direction;
+#ifdef RICOCHET
+    shellBounces[shell] = 0;
+    shellBounceGuard[shell] = 0;
+#endif
+
+    //barrelTips are measured from the top left corner of the sprite
+    shellColumn[shell] = tankColumn[tank] + TO_FP(barrelTips[direction][0] - TANK_HALF);
+    shellRow[shell] = tankRow[tank] + TO_FP(barrelTips[direction][1] - TANK_HALF);
 }
 
 //------------------------------ traverseMissile ------------------------------
@@ -1651,124 +2808,1917 @@ void missileLocationHelper(unsigned int tankDirection, int pHorizontalLocation,
 //          allowing for simultaneous tank movement.
 //
 // Parameters:
-//   missileDirection - The direction in which the missile is fired.
-//   mHorizontalLocation - The horizontal position of the missile.
-//   mVerticalLocation - The vertical position of the missile.
-//   tank - The tank identifier.
-// Preconditions: None
-// Postconditions: The missile animation progresses, considering tank movement.
-void traverseMissile(unsigned int missileDirection, int mHorizontalLocation, int mVerticalLocation, int tank)
+//   shell - The shell in the missile pool to move.
+// Preconditions: The shell must exist
+// Postconditions: The missile progresses one step in its direction.
+void traverseMissile(unsigned char shell)
 {
-    POKE(missileAddress+mVerticalLocation, 0);
+    unsigned char missileDirection = shellDirection[shell];
 
-    if (missileDirection == NORTH)
-    {
-        mVerticalLocation--;
+    FRAME_PATH(shellSteps);
+#ifdef RICOCHET
+    if (shellBounceGuard[shell] > 0) shellBounceGuard[shell]--;
+#endif
+
+    shellRow[shell] += deltas[missileDirection][0];
+    shellColumn[shell] += deltas[missileDirection][1];
+}
+
+//------------------------------ commitShell ------------------------------
+// Purpose: Draw a shell where its board position says it is, or clear it if it
+//          is no longer in play. Missiles share one byte per scanline in missile
+//          memory, so only this shell's bits are cleared and set and the other
+//          shells on the same row are left alone.
+// Parameters:
+//   shell - The shell in the missile pool to draw.
+// Preconditions: PM graphics must be enabled
+// Postconditions: The shell is drawn at its board position, or not at all
+void commitShell(unsigned char shell)
+{
+    unsigned int address = missileAddress[pmBack];
+    int lastRow = shellDrawnRow[pmBack][shell];
+    int row = -1;
+
+    if (shellExists[shell]) {
+        row = PM_ROW(VIEW_SCANLINE(FP_INT(shellRow[shell])));
+        POKE_HPOS(HPOSM0 + shell, VIEW_HORIZONTAL(FP_INT(shellColumn[shell])));
     }
-    else if (missileDirection == NORTH_15)
-    {
-        mVerticalLocation -= 2;
-        mHorizontalLocation++;
+
+    //moves that stay on the same PM memory row only need the position register
+    if (row == lastRow) return;
+
+    if (lastRow >= 0) POKE(address + lastRow, PEEK(address + lastRow) & ~shellMask[shell]);
+    if (row >= 0) POKE(address + row, PEEK(address + row) | shellMask[shell]);
+
+#ifdef INPUT_LATENCY
+    //the shell player 1 just fired being drawn, a shell it took over included
+    if (shell == latencyShell && row >= 0) endInputLatency(LATENCY_SHELL);
+#endif
+    shellDrawnRow[pmBack][shell] = row;
+}
+
+//------------------------------ removeShell ------------------------------
+// Purpose: Take a shell out of play.
+// Parameters:
+//   shell - The shell in the missile pool to remove.
+// Preconditions: The shell must exist
+// Postconditions: The shell no longer exists; the next commitFrame clears it
+void removeShell(unsigned char shell)
+{
+    FRAME_PATH(shellsRemoved);
+    shellExists[shell] = false;
+}
+
+#ifdef RICOCHET
+//------------------------------ playfieldAt ------------------------------
+// Purpose: Check whether there is a wall in the playfield bit map under a
+//          missile position, anywhere in the arena with SCROLL_ARENA.
+// Parameters:
+//   column - Board column, in fixed point.
+//   row - Board row, in fixed point.
+// Preconditions: bitMapAddress must be set
+// Postconditions: Returns true if the bit map pixel at that position is set
+bool playfieldAt(int column, int row) {
+    int horizontal = FP_INT(column) + BOARD_LEFT;
+    int vertical = FP_INT(row) + BOARD_TOP;
+    unsigned char pixel;
+    unsigned char line;
+
+    if (horizontal < PLAYFIELD_LEFT || vertical < PLAYFIELD_TOP) return true;
+
+    pixel = (horizontal - PLAYFIELD_LEFT) >> 2;
+    line = (vertical - PLAYFIELD_TOP) >> 3;
+    if (pixel >= ARENA_WIDTH * 4 || line >= ARENA_ROWS) return true;
+
+    //4 pixels per byte, the leftmost pixel in the top 2 bits
+    return (PEEK(bitMapAddress + line * ARENA_WIDTH + (pixel >> 2)) << ((pixel & 3) * 2)) & 0xC0;
+}
+
+//------------------------------ bounceShell ------------------------------
+// Purpose: Bounce a shell that ran into a wall. The collision registers report
+//          where the shell was drawn last frame, one step behind where it is now,
+//          so the shell is put back at that spot and the steps on either side of
+//          it tell which way the wall runs.
+// Parameters:
+//   shell - The shell in the missile pool that hit a wall.
+// Preconditions: The shell must exist and the missile to playfield register must be set
+// Postconditions: The shell leaves in its reflected direction, or is removed if it
+//                 has used up its bounces
+void bounceShell(unsigned char shell) {
+    unsigned char missileDirection = shellDirection[shell];
+    int rowStep = deltas[missileDirection][0];
+    int columnStep = deltas[missileDirection][1];
+    int hitRow;
+    int hitColumn;
+    unsigned char wall;
+
+    FRAME_PATH(shellBounces);
+
+    //still backing out of the wall it just bounced off
+    if (shellBounceGuard[shell] > 0) return;
+
+    if (shellBounces[shell] == RICOCHET_BOUNCES) {
+        removeShell(shell);
+        return;
     }
-    else if (missileDirection == NORTH_EAST)
-    {
-        mVerticalLocation--;
-        mHorizontalLocation++;
+
+    hitColumn = shellColumn[shell] - columnStep;
+    hitRow = shellRow[shell] - rowStep;
+
+    //only the column step reaches the wall: the wall runs vertically, and so on
+    if (playfieldAt(hitColumn, hitRow - rowStep)) wall = WALL_VERTICAL;
+    else if (playfieldAt(hitColumn - columnStep, hitRow)) wall = WALL_HORIZONTAL;
+    else wall = WALL_CORNER;
+
+    shellDirection[shell] = reflectDirection[wall][missileDirection];
+    shellBounces[shell]++;
+    shellBounceGuard[shell] = BOUNCE_GUARD_FRAMES;
+    shellRow[shell] = hitRow;
+    shellColumn[shell] = hitColumn;
+}
+#endif
+
+#ifdef FRAME_BUDGET
+//------------------------------ vblankPhase ------------------------------
+// Purpose: Convert a VCOUNT reading into the number of VCOUNT lines since the
+//          last vertical blank interrupt, so frames that wrap past the bottom
+//          of the screen still count up.
+// Parameters:
+//   line - VCOUNT reading
+// Preconditions: vcountLines must be set for the TV standard
+// Postconditions: Returns 0 at the vertical blank up to vcountLines - 1 just before the next one
+unsigned char vblankPhase(unsigned char line) {
+    if (line >= VBI_VCOUNT) return line - VBI_VCOUNT;
+    return line + vcountLines - VBI_VCOUNT;
+}
+
+//------------------------------ beginFrameBudget ------------------------------
+// Purpose: Stamp the beam position the frame's game logic starts at.
+// Parameters: None
+// Preconditions: Called right after waitvsync returns
+// Postconditions: frameStartTick and frameStartLine hold the starting position
+void beginFrameBudget() {
+    frameStartTick = PEEK(RTCLOK_LOW);
+    frameStartLine = PEEK(VCOUNT);
+}
+
+//------------------------------ endFrameBudget ------------------------------
+// Purpose: Record how many scanlines the frame's game logic used and whether
+//          it ran past the next vertical blank.
+// Parameters: None
+// Preconditions: beginFrameBudget must have been called at the start of the frame
+// Postconditions: frameScanlines, worstFrameScanlines, framesMeasured and
+//                 framesOverBudget are updated
+void endFrameBudget() {
+    unsigned int scanlines = frameBudgetScanlines();
+
+    frameScanlines[frameLogIndex] = scanlines;
+    frameLogIndex = (frameLogIndex + 1) & (FRAME_LOG_SIZE - 1);
+    framesMeasured++;
+
+    if (scanlines > worstFrameScanlines) worstFrameScanlines = scanlines;
+
+    //a vertical blank went by while the logic was still running, so waitvsync will wait for the one after it
+    if (frameTicks != 0) framesOverBudget++;
+
+#ifdef FRAME_BUDGET_SCENARIO
+    if (frameLogIndex == 0) writeBudgetFrames(FRAME_LOG_SIZE);
+#endif
+}
+
+#ifdef FRAME_BUDGET_SCENARIO
+//------------------------------ writeBudgetFrames ------------------------------
+// Purpose: Append the first count entries of frameScanlines to the scenario report.
+//          The write comes after the frame is measured, so a slow host device
+//          only delays the next frame's start and is never counted in it.
+// Parameters: count - frames to write, from frameScanlines[0]
+// Preconditions: budgetReport is open, or NULL if the host device is missing
+// Postconditions: The frames are on the host, with the OS ROM back out if it was
+void writeBudgetFrames(unsigned char count) {
+    if (budgetReport == NULL) return;
+#ifdef NO_OS
+    if (osFree) osOn();                 //CIO is in the OS ROM
+#endif
+    fwrite(frameScanlines, sizeof(frameScanlines[0]), count, budgetReport);
+#ifdef NO_OS
+    if (osFree) osOff();
+#endif
+}
+
+//------------------------------ finishBudgetReport ------------------------------
+// Purpose: Write the frames still in frameScanlines and the trailer, close the
+//          report and stop, so the suite knows the scenario is over.
+// Parameters: None
+// Preconditions: endFrameBudget has been called for the last frame
+// Postconditions: Never returns
+void finishBudgetReport() {
+    budgetTrailer.gameOver = !gameOn;
+    budgetTrailer.framesMeasured = framesMeasured;
+    budgetTrailer.framesOverBudget = framesOverBudget;
+    budgetTrailer.worstFrameScanlines = worstFrameScanlines;
+    budgetTrailer.vcountLines = vcountLines;
+
+    if (frameLogIndex != 0) writeBudgetFrames(frameLogIndex);
+    if (budgetReport != NULL) {
+#ifdef NO_OS
+        if (osFree) osOn();
+#endif
+        fwrite(&budgetTrailer, sizeof(budgetTrailer), 1, budgetReport);
+        fclose(budgetReport);
     }
-    else if (missileDirection == NORTH_60)
-    {
-        mVerticalLocation--;
-        mHorizontalLocation += 2;
+
+    while (true) waitvsync();
+}
+#endif
+
+//------------------------------ frameBudgetScanlines ------------------------------
+// Purpose: Work out how many scanlines have gone by since beginFrameBudget.
+// Parameters: None
+// Preconditions: beginFrameBudget must have been called at the start of the frame
+// Postconditions: Returns the scanlines, frameTicks is the vertical blanks in between
+unsigned int frameBudgetScanlines() {
+    unsigned char endTick = PEEK(RTCLOK_LOW);
+    unsigned char endLine = PEEK(VCOUNT);
+
+    frameTicks = endTick - frameStartTick;
+    return (frameTicks * vcountLines + vblankPhase(endLine) - vblankPhase(frameStartLine)) * 2;
+}
+#endif
+
+#ifdef FRAME_TRACE
+//------------------------------ traceCollisions ------------------------------
+// Purpose: Copy the collision registers into the frame's trace record before
+//          checkCollision acts on them and clears them.
+// Parameters: None
+// Preconditions: None
+// Postconditions: The collision bytes of traceRecord are set
+void traceCollisions() {
+    unsigned char n;
+
+    for (n = 0; n < 4; n++) {
+        traceRecord->missilePlayfield[n] = PEEK(M0PF + n);
+        traceRecord->missilePlayer[n] = PEEK(M0P + n);
     }
-    else if (missileDirection == EAST)
-    {
-        mHorizontalLocation++;
+    traceRecord->playerPlayfield[0] = PEEK(P0PF);
+    traceRecord->playerPlayfield[1] = PEEK(P1PF);
+}
+
+//------------------------------ endFrameTrace ------------------------------
+// Purpose: Finish the frame's trace record with the positions commitFrame just
+//          drew and the scanlines endFrameBudget just measured, then move on to
+//          the next record in the ring buffer.
+// Parameters: None
+// Preconditions: endFrameBudget must have been called for the frame
+// Postconditions: traceRecord points at a cleared record for the next frame
+void endFrameTrace() {
+    unsigned char n;
+
+    traceRecord->frame = frameTrace.frames;
+    traceRecord->scanlines = frameScanlines[(frameLogIndex - 1) & (FRAME_LOG_SIZE - 1)];
+
+    for (n = 0; n < 2; n++) {
+        traceRecord->tankRow[n] = FP_INT(tankRow[n]);
+        traceRecord->tankColumn[n] = FP_INT(tankColumn[n]);
+        traceRecord->tankDirection[n] = tankDirection[n];
     }
-    else if (missileDirection == EAST_15)
-    {
-        mVerticalLocation++;
-        mHorizontalLocation += 2;
+    if (p0IsHit) traceRecord->tankDirection[0] |= TRACE_HIT;
+    if (p1IsHit) traceRecord->tankDirection[1] |= TRACE_HIT;
+
+    for (n = 0; n < 4; n++) {
+        if (n < MISSILE_POOL_SIZE && shellExists[n]) {
+            traceRecord->shellRow[n] = FP_INT(shellRow[n]);
+            traceRecord->shellColumn[n] = FP_INT(shellColumn[n]);
+            traceRecord->shellDirection[n] = shellDirection[n];
+        } else {
+            traceRecord->shellRow[n] = TRACE_NO_SHELL;
+            traceRecord->shellColumn[n] = TRACE_NO_SHELL;
+            traceRecord->shellDirection[n] = 0;
+        }
     }
-    else if (missileDirection == EAST_SOUTH)
-    {
-        mVerticalLocation++;
-        mHorizontalLocation++;
+
+    frameTrace.frames++;
+    frameTrace.next++;
+    if (frameTrace.next == TRACE_RECORDS) {
+        frameTrace.next = 0;
+        frameTrace.wrapped = 1;
     }
-    else if (missileDirection == EAST_60)
-    {
-        mVerticalLocation += 2;
-        mHorizontalLocation++;
+
+    traceRecord = &frameTrace.records[frameTrace.next];
+    traceRecord->input = 0;
+    traceRecord->aiMove = TRACE_NO_MOVE;
+    for (n = 0; n < 4; n++) {
+        traceRecord->missilePlayfield[n] = 0;
+        traceRecord->missilePlayer[n] = 0;
     }
-    else if (missileDirection == SOUTH)
-    {
-        mVerticalLocation++;
+    traceRecord->playerPlayfield[0] = 0;
+    traceRecord->playerPlayfield[1] = 0;
+}
+#endif
+
+#ifdef INPUT_LATENCY
+//------------------------------ actOnInputLatency ------------------------------
+// Purpose: Tie the press being timed to what the movement tick did with player
+//          1's move: wait for the tank to be redrawn if the tick moved or turned
+//          it for one of the press's directions, or for the new shell if it
+//          fired for the press's fire button, and drop the press otherwise.
+// Parameters:
+//   acted - The move the tick carried out (FIRE, FORWARD, BACKWARD, LEFT_TURN
+//           or RIGHT_TURN), NOTHING if it did nothing for player 1.
+// Preconditions: Called once a movement tick, after player 1's move
+// Postconditions: latencyShows says what to wait for, or the press is dropped
+//                 and counted in inputsDropped
+void actOnInputLatency(unsigned char acted) {
+    if (latencyPress == 0 || latencyShows != LATENCY_WAITING) return;
+
+    if (acted & latencyPress) {
+        latencyShows = acted == FIRE ? LATENCY_SHELL : LATENCY_TANK;
+    } else {
+        latencyPress = 0;
+        inputsDropped++;
     }
-    else if (missileDirection == SOUTH_15)
-    {
-        mVerticalLocation += 2;
-        mHorizontalLocation--;
+}
+
+//------------------------------ endInputLatency ------------------------------
+// Purpose: Count how many frames the press being timed took to show on screen,
+//          once the change it asked for is drawn. With PM_DOUBLE_BUFFER that is
+//          one frame later, at the PMBASE flip.
+// Parameters:
+//   shows - LATENCY_TANK when player 1's tank is redrawn, LATENCY_SHELL when
+//           the shell it fired is drawn.
+// Preconditions: Called from the commit functions
+// Postconditions: If the press was waiting for this change, it is added to
+//                 inputLatency and is no longer pending
+void endInputLatency(unsigned char shows) {
+    unsigned char frames;
+
+    if (latencyPress == 0 || latencyShows != shows) return;
+
+    frames = (unsigned char)(PEEK(RTCLOK_LOW) - latencyStart) + LATENCY_FLIP_FRAMES;
+    if (frames >= LATENCY_BUCKETS) frames = LATENCY_BUCKETS - 1;
+    inputLatency[frames]++;
+    latencyPress = 0;
+}
+#endif
+
+#ifdef MEM_DEBUG
+//------------------------------ paintMemory ------------------------------
+// Purpose: Fill the free memory between the top of the heap and the C stack with
+//          MEM_SENTINEL, so scanMemory can tell how deep the stack has gone.
+// Parameters:
+//   stackTop - Address of one of main's locals, the top of the stack in use.
+// Preconditions: Called first thing in main, before anything else is on the stack
+// Postconditions: memReport holds the heap and stack addresses
+void paintMemory(unsigned int stackTop) {
+    unsigned char *address;
+
+    memReport.stackTop = stackTop;
+    memReport.heapOrigin = (unsigned int)_heaporg;
+    memReport.heapTop = (unsigned int)_heapptr;
+    memReport.heapEnd = (unsigned int)_heapend;
+    memReport.pmUnused = PM_BANKS * PM_MISSILE_OFFSET;
+
+    //stop short of this function's own frame, which sits just under main's
+    for (address = (unsigned char *)_heapptr; address < (unsigned char *)(stackTop - MEM_PAINT_MARGIN); address++) {
+        *address = MEM_SENTINEL;
     }
-    else if (missileDirection == SOUTH_WEST)
-    {
-        mVerticalLocation++;
-        mHorizontalLocation--;
+}
+
+//------------------------------ scanMemory ------------------------------
+// Purpose: Update the stack and heap high-water marks in memReport.
+// Parameters: None
+// Preconditions: paintMemory must have been called
+// Postconditions: memReport's stackLow, stackUsed, heapTop and freeBetween are up to date
+void scanMemory() {
+    unsigned char *address = (unsigned char *)_heapptr;
+
+    if ((unsigned int)_heapptr > memReport.heapTop) memReport.heapTop = (unsigned int)_heapptr;
+
+    //the first byte up from the heap that is not the sentinel is the deepest the stack has reached
+    while ((unsigned int)address < memReport.stackTop && *address == MEM_SENTINEL) address++;
+
+    memReport.stackLow = (unsigned int)address;
+    memReport.stackUsed = memReport.stackTop - memReport.stackLow;
+    memReport.freeBetween = memReport.stackLow - memReport.heapTop;
+}
+#endif
+
+#ifdef LEVELS
+//------------------------------ readSector ------------------------------
+// Purpose: Start reading one sector of the level disk: point the serial IRQ
+//          vectors at the game's handlers, set the serial port up as the OS's
+//          SIO does and send the first byte of the command frame. The handlers
+//          send the rest and take the drive's answer, pollSector collects it.
+// Parameters:
+//   sector - Sector number, from 1.
+// Preconditions: No read is under way, the game is not on
+// Postconditions: The command frame is going out, sioState is SIO_SENDING
+void readSector(unsigned int sector) {
+    unsigned char lines, line;
+
+    sioSector = sector;
+    sioCommand[0] = DISK_DEVICE + LEVEL_DRIVE - 1;
+    sioCommand[1] = DISK_READ;
+    sioCommand[2] = (unsigned char)sector;
+    sioCommand[3] = (unsigned char)(sector >> 8);
+    sioCommand[4] = sioChecksum(sioCommand, SIO_COMMAND_SIZE - 1);
+    sioIndex = 1;
+    sioState = SIO_SENDING;
+    sioStarted = PEEK(RTCLOK_LOW);
+
+    asm("sei");
+    memcpy(osSerialVectors, (void *)VSERIN, sizeof(osSerialVectors));
+    POKEW(VSERIN, (unsigned int)sioInputIRQ);
+    POKEW(VSEROR, (unsigned int)sioOutputIRQ);
+    POKEW(VSEROC, (unsigned int)sioDoneIRQ);
+    POKE(AUDCTL, SIO_AUDCTL);
+    POKE(AUDF3, SIO_BAUD);
+    POKE(AUDF4, 0);
+    POKE(AUDC3, 0);
+    POKE(AUDC4, 0);
+    POKE(SKCTL, SKCTL_SEND);
+    POKE(SKRES, 0);
+    POKE(PBCTL, PBCTL_COMMAND);
+    asm("cli");
+
+    //the drive wants the command line low for about a millisecond before the frame starts
+    for (lines = 0; lines < SIO_COMMAND_LINES; lines++) {
+        line = PEEK(VCOUNT);
+        while (PEEK(VCOUNT) == line) {
+        }
     }
-    else if (missileDirection == SOUTH_60)
-    {
-        mVerticalLocation++;
-        mHorizontalLocation -= 2;
+
+    asm("sei");
+    POKE(SEROUT, sioCommand[0]);
+    POKE(POKMSK, (PEEK(POKMSK) & ~SERIAL_IRQS) | SERIAL_OUT_IRQ);
+    POKE(IRQEN, PEEK(POKMSK));
+    asm("cli");
+}
+
+//------------------------------ pollSector ------------------------------
+// Purpose: See how the read readSector started is getting on. Once it is
+//          over, put the serial port and its IRQ vectors back as the OS keeps
+//          them, and check the data frame; a read that failed or timed out is
+//          started again, up to SIO_RETRIES times.
+// Parameters:
+//   buffer - SECTOR_SIZE bytes the sector is copied to once it is in.
+// Preconditions: readSector has started a read
+// Postconditions: Returns SIO_DONE with the sector in buffer and sioState back
+//                 to SIO_IDLE, SIO_FAILED once the retries are used up, or the
+//                 state of the read still under way
+unsigned char pollSector(unsigned char *buffer) {
+    unsigned char state = sioState;
+
+    if (state != SIO_DONE && state != SIO_FAILED) {
+        if ((unsigned char)(PEEK(RTCLOK_LOW) - sioStarted) < SIO_TIMEOUT_FRAMES) return state;
+        state = SIO_FAILED;
     }
-    else if (missileDirection == WEST)
-    {
-        mHorizontalLocation--;
+
+    asm("sei");
+    POKE(POKMSK, PEEK(POKMSK) & ~SERIAL_IRQS);
+    POKE(IRQEN, PEEK(POKMSK));
+    POKE(PBCTL, PBCTL_IDLE);
+    POKE(SKCTL, PEEK(SSKCTL));
+    POKE(AUDC3, 0);
+    POKE(AUDC4, 0);
+    memcpy((void *)VSERIN, osSerialVectors, sizeof(osSerialVectors));
+    sioState = SIO_IDLE;
+    asm("cli");
+
+    if (state == SIO_DONE && sioChecksum(sioData, SECTOR_SIZE) == sioData[SECTOR_SIZE]) {
+        memcpy(buffer, sioData, SECTOR_SIZE);
+        sioRetries = 0;
+        return SIO_DONE;
     }
-    else if (missileDirection == WEST_15)
-    {
-        mVerticalLocation--;
-        mHorizontalLocation -= 2;
+    if (sioRetries < SIO_RETRIES) {
+        sioRetries++;
+        readSector(sioSector);
+        return SIO_SENDING;
     }
-    else if (missileDirection == WEST_NORTH)
-    {
-        mVerticalLocation--;
-        mHorizontalLocation--;
+    sioRetries = 0;
+    return SIO_FAILED;
+}
+
+//------------------------------ sioChecksum ------------------------------
+// Purpose: The SIO checksum of some bytes: their sum, with every carry out of
+//          the top bit added back in at the bottom.
+// Parameters:
+//   bytes - The bytes.
+//   length - How many, 1 - 255.
+// Preconditions: None
+// Postconditions: Returns the checksum
+unsigned char sioChecksum(unsigned char *bytes, unsigned char length) {
+    unsigned int sum = 0;
+    unsigned char i;
+
+    for (i = 0; i < length; i++) {
+        sum += bytes[i];
+        if (sum > 0xFF) sum -= 0xFF;
     }
-    else if (missileDirection == WEST_60)
-    {
-        mVerticalLocation -= 2;
-        mHorizontalLocation--;
+    return (unsigned char)sum;
+}
+
+#ifdef XE_BANKS
+#pragma code-name (push, "LOWCODE")     //can interrupt an extended memory copy
+#endif
+//------------------------------ sioOutputIRQ ------------------------------
+// Purpose: Serial output needed IRQ: send the next byte of the command frame,
+//          or once the last one is on its way, wait for it to finish going out.
+// Parameters: None
+// Preconditions: Entered through VSEROR with A pushed, by the OS's IRQ handler
+//                or irqHandler
+// Postconditions: The IRQ is acknowledged, sioIndex is one byte on
+void sioOutputIRQ() {
+    asm("txa");
+    asm("pha");
+    asm("ldx %v", sioIndex);
+    asm("cpx #%b", SIO_COMMAND_SIZE);
+    asm("bcs %g", frameSent);
+    asm("lda %v,x", sioCommand);
+    asm("sta %w", SEROUT);
+    asm("inx");
+    asm("stx %v", sioIndex);
+    asm("lda %b", POKMSK);
+    asm("and #%b", (unsigned char)~SERIAL_OUT_IRQ);
+    asm("sta %w", IRQEN);
+    asm("lda %b", POKMSK);
+    asm("sta %w", IRQEN);
+    asm("jmp %g", outputDone);
+frameSent:
+    //the last byte is in the shift register, so the next IRQ wanted is the one for it going out
+    asm("lda %b", POKMSK);
+    asm("and #%b", (unsigned char)~SERIAL_OUT_IRQ);
+    asm("ora #%b", SERIAL_DONE_IRQ);
+    asm("sta %b", POKMSK);
+    asm("sta %w", IRQEN);
+outputDone:
+    asm("pla");
+    asm("tax");
+    asm("pla");
+    asm("rti");
+}
+
+//------------------------------ sioDoneIRQ ------------------------------
+// Purpose: Serial output complete IRQ: the command frame is out, so raise the
+//          command line and turn the port round to hear the drive's answer.
+// Parameters: None
+// Preconditions: Entered through VSEROC with A pushed, by the OS's IRQ handler
+//                or irqHandler
+// Postconditions: sioState is SIO_WAIT_ACK, only the serial input IRQ is on
+void sioDoneIRQ() {
+    asm("lda #%b", PBCTL_IDLE);
+    asm("sta %w", PBCTL);
+    asm("lda %b", POKMSK);
+    asm("and #%b", (unsigned char)~SERIAL_DONE_IRQ);
+    asm("ora #%b", SERIAL_IN_IRQ);
+    asm("sta %b", POKMSK);
+    asm("sta %w", IRQEN);
+    asm("lda #%b", SKCTL_RECEIVE);
+    asm("sta %w", SKCTL);
+    asm("sta %w", SKRES);
+    asm("lda #0");
+    asm("sta %v", sioIndex);
+    asm("lda #%b", SIO_WAIT_ACK);
+    asm("sta %v", sioState);
+    asm("pla");
+    asm("rti");
+}
+
+//------------------------------ sioInputIRQ ------------------------------
+// Purpose: Serial input ready IRQ: take one byte of the drive's answer, the
+//          acknowledge, the complete, then the data frame and its checksum.
+// Parameters: None
+// Preconditions: Entered through VSERIN with A pushed, by the OS's IRQ handler
+//                or irqHandler
+// Postconditions: The byte is stored or acted on and the IRQ acknowledged;
+//                 sioState is SIO_DONE once the checksum is in, or SIO_FAILED if
+//                 the drive answered with something other than what was due
+void sioInputIRQ() {
+    asm("txa");
+    asm("pha");
+    asm("lda %w", SERIN);
+    asm("ldx %v", sioState);
+    asm("cpx #%b", SIO_RECEIVING);
+    asm("bne %g", notData);
+    asm("ldx %v", sioIndex);
+    asm("sta %v,x", sioData);
+    asm("inx");
+    asm("stx %v", sioIndex);
+    asm("cpx #%b", SECTOR_SIZE + 1);
+    asm("bne %g", inputDone);
+    asm("lda #%b", SIO_DONE);
+    asm("bne %g", newState);
+notData:
+    asm("cpx #%b", SIO_WAIT_ACK);
+    asm("bne %g", notAck);
+    asm("cmp #%b", SIO_ACK);
+    asm("bne %g", inputFailed);
+    asm("lda #%b", SIO_WAIT_COMPLETE);
+    asm("bne %g", newState);
+notAck:
+    asm("cpx #%b", SIO_WAIT_COMPLETE);
+    asm("bne %g", inputDone);           //nothing is due, a stray byte
+    asm("cmp #%b", SIO_COMPLETE);
+    asm("bne %g", inputFailed);
+    asm("lda #%b", SIO_RECEIVING);
+    asm("bne %g", newState);
+inputFailed:
+    asm("lda #%b", SIO_FAILED);
+newState:
+    asm("sta %v", sioState);
+inputDone:
+    asm("lda %b", POKMSK);
+    asm("and #%b", (unsigned char)~SERIAL_IN_IRQ);
+    asm("sta %w", IRQEN);
+    asm("lda %b", POKMSK);
+    asm("sta %w", IRQEN);
+    asm("pla");
+    asm("tax");
+    asm("pla");
+    asm("rti");
+}
+#ifdef XE_BANKS
+#pragma code-name (pop)
+#endif
+
+//------------------------------ streamLevel ------------------------------
+// Purpose: Move the level disk on without waiting for it: start reading the
+//          next sector (the directory first, then the sectors of level
+//          levelNumber), or take in the one under way if it has arrived.
+//          Called on every pass of the start screen loop while the game is not
+//          on, so loading never holds anything up.
+// Parameters: None
+// Preconditions: The game must not be on
+// Postconditions: A read is started or under way, or one more sector is in;
+//                 levelsAvailable is cleared if the disk is missing or is not a
+//                 level disk
+void streamLevel() {
+    unsigned char *buffer = (unsigned char *)&level;
+    unsigned char state;
+
+    if (!levelsAvailable || levelSectorsRead == LEVEL_SECTORS) return;
+
+#ifdef LEVEL_CACHE_SLOTS
+    //arenas already read off the disk come back out of extended memory, or from under the OS ROM, in one go
+    if (sioState == SIO_IDLE && levelCount > 0 && levelNumber < LEVEL_CACHE_SLOTS && levelCached[levelNumber]) {
+#ifdef XE_BANKS
+        bankRead(LEVEL_CACHE_BANK, levelNumber * sizeof(Level), buffer, 0);
+#else
+        memcpy(buffer, LEVEL_CACHE_ADDRESS(levelNumber), sizeof(Level));
+#endif
+        levelSectorsRead = LEVEL_SECTORS;
+        return;
+    }
+#endif
+
+    if (sioState == SIO_IDLE) {
+        readSector(levelCount == 0 ? LEVEL_DIRECTORY : LEVEL_FIRST_SECTOR + levelNumber * LEVEL_SECTORS + levelSectorsRead);
+        return;
     }
 
+    state = pollSector(levelCount == 0 ? buffer : buffer + levelSectorsRead * SECTOR_SIZE);
+    if (state == SIO_FAILED) {
+        levelsAvailable = false;
+        return;
+    }
+    if (state != SIO_DONE) return;
+
+    //directory: "TKLV", version, number of levels
+    if (levelCount == 0) {
+        if (buffer[0] != 'T' || buffer[1] != 'K' || buffer[2] != 'L' || buffer[3] != 'V'
+                || buffer[4] != LEVEL_VERSION || buffer[5] == 0) {
+            levelsAvailable = false;
+            return;
+        }
+        levelCount = buffer[5];
+        return;
+    }
+    levelSectorsRead++;
 
-    if (tank == 0)
-    {
-        m0LastHorizontalLocation = mHorizontalLocation; //saving new location to global variables
-        m0LastVerticalLocation = mVerticalLocation; //saving new location to global variables
+#ifdef XE_BANKS
+    if (levelSectorsRead == LEVEL_SECTORS && xeBanks > LEVEL_CACHE_BANK && levelNumber < LEVEL_CACHE_SLOTS) {
+        bankWrite(LEVEL_CACHE_BANK, levelNumber * sizeof(Level), buffer, 0);
+        levelCached[levelNumber] = true;
+    }
+#elif defined(NO_OS)
+    if (levelSectorsRead == LEVEL_SECTORS && osFree && levelNumber < LEVEL_CACHE_SLOTS) {
+        memcpy(LEVEL_CACHE_ADDRESS(levelNumber), buffer, sizeof(Level));
+        levelCached[levelNumber] = true;
+    }
+#endif
+}
+#endif
+
+#ifdef PM_DOUBLE_BUFFER
+#ifdef XE_BANKS
+#pragma code-name (push, "LOWCODE")     //can interrupt an extended memory copy
+#endif
+//------------------------------ flipVBI ------------------------------
+// Purpose: Deferred vertical blank routine: show the player-missile bank the
+//          game finished drawing, and move the players and missiles to where
+//          that frame has them, all before the first displayed scanline.
+//          With SCROLL_ARENA it goes on to scrollVBI.
+// Parameters: None
+// Preconditions: Installed with SETVBV, only ever run by the OS vertical blank
+// Postconditions: PMBASE and the horizontal position registers show the last
+//                 committed frame, flipPage is cleared
+void flipVBI() {
+    asm("lda %v", flipPage);
+    asm("beq %g", flipDone);
+    asm("sta %w", PMBASE);
+    asm("ldx #7");
+copyPositions:
+    asm("lda %v,x", hposShadow);
+    asm("sta %w,x", HPOSP0);
+    asm("dex");
+    asm("bpl %g", copyPositions);
+    asm("lda #0");
+    asm("sta %v", flipPage);
+flipDone:
+#ifdef SCROLL_ARENA
+    asm("jmp %v", scrollVBI);
+#elif defined(NO_OS)
+    asm("jmp %v", vbiExit);             //does what XITVBV does, with or without the OS ROM in
+#else
+    asm("jmp %w", XITVBV);
+#endif
+}
+#ifdef XE_BANKS
+#pragma code-name (pop)
+#endif
+#endif
+
+#ifdef SCROLL_ARENA
+#ifdef XE_BANKS
+#pragma code-name (push, "LOWCODE")     //can interrupt an extended memory copy
+#endif
+//------------------------------ scrollVBI ------------------------------
+// Purpose: Deferred vertical blank routine: switch to the display list and
+//          fine scroll commitScroll left for the last committed frame, before
+//          ANTIC reads the display list. The OS copies SDLSTL into DLISTL every
+//          vertical blank, so both are set.
+// Parameters: None
+// Preconditions: Installed with SETVBV or jumped to from flipVBI, only ever
+//                run by the vertical blank
+// Postconditions: The last committed view is on screen, scrollPending is cleared
+void scrollVBI() {
+    asm("lda %v", scrollPending);
+    asm("beq %g", scrollDone);
+    asm("lda %v", hscrolShadow);
+    asm("sta %w", HSCROL);
+    asm("lda %v", vscrolShadow);
+    asm("sta %w", VSCROL);
+    asm("lda %v", scrollListShadow);
+    asm("sta %w", DLISTL);
+    asm("sta %w", SDLSTL);
+    asm("lda %v+1", scrollListShadow);
+    asm("sta %w", DLISTL + 1);
+    asm("sta %w", SDLSTL + 1);
+    asm("lda #0");
+    asm("sta %v", scrollPending);
+scrollDone:
+#ifdef NO_OS
+    asm("jmp %v", vbiExit);
+#else
+    asm("jmp %w", XITVBV);
+#endif
+}
+#ifdef XE_BANKS
+#pragma code-name (pop)
+#endif
+#endif
+
+#if defined(NO_OS) || defined(PROFILER)
+//------------------------------ idleLoops ------------------------------
+// Purpose: Count how many times a loop that does nothing runs in one frame,
+//          as a measure of the time the vertical blank handler leaves.
+// Parameters: None
+// Preconditions: The vertical blank interrupt must be on
+// Postconditions: Returns the loops run from one vertical blank to the next
+unsigned int idleLoops() {
+    unsigned int loops = 0;
+    unsigned char tick;
+
+    waitvsync();
+    tick = PEEK(RTCLOK_LOW);
+    while (PEEK(RTCLOK_LOW) == tick) loops++;
+    return loops;
+}
+#endif
 
-        POKE(horizontalRegister_M0, mHorizontalLocation);
+#ifdef NO_OS
 
-        if (m0LastVerticalLocation == m1LastVerticalLocation && m1exists == true)
-        {
-            POKE(missileAddress+mVerticalLocation, 10);
+//------------------------------ osOff ------------------------------
+// Purpose: Switch the OS ROM out for the RAM under it and point the NMI and
+//          IRQ vectors there at the game's own handlers. An 800 has no RAM
+//          there, which the probe finds, and keeps its OS.
+// Parameters: None
+// Preconditions: The display list, shadow registers and clock must be set up
+//                (the OS has done that by the time main runs)
+// Postconditions: Returns true and sets osFree if the OS ROM is out. The first
+//                 time, the ROM font is copied to the RAM under it, so the score
+//                 line and winner banner (CHBAS at OS_FONT) still have their font.
+bool osOff() {
+    unsigned int i;
+    unsigned char c;
+
+    asm("sei");
+    POKE(NMIEN, 0);
+    POKE(PORTB, PEEK(PORTB) & ~PORTB_OS_ROM);
+
+    POKE(OS_RAM_PROBE, 0x55);
+    osFree = PEEK(OS_RAM_PROBE) == 0x55;
+    POKE(OS_RAM_PROBE, 0xAA);
+    osFree = osFree && PEEK(OS_RAM_PROBE) == 0xAA;
+
+    if (osFree && !osFontCopied) {
+        //writes to the ROM's addresses are lost while it is in, so each byte is read with it in and written with it out
+        for (i = 0; i < OS_FONT_SIZE; i++) {
+            POKE(PORTB, PEEK(PORTB) | PORTB_OS_ROM);
+            c = PEEK(OS_FONT + i);
+            POKE(PORTB, PEEK(PORTB) & ~PORTB_OS_ROM);
+            POKE(OS_FONT + i, c);
         }
-        else
-        {
-            POKE(missileAddress+mVerticalLocation, 2);
+        osFontCopied = true;
+    }
+
+    if (osFree) {
+        POKEW(NMI_VECTOR, (unsigned int)nmiHandler);
+        POKEW(IRQ_VECTOR, (unsigned int)irqHandler);
+        if (PEEKW(VVBLKD) == XITVBV) POKEW(VVBLKD, (unsigned int)vbiExit);
+        //only the profiler's timer IRQ, which the game answers itself, stays on
+        osPokmsk = PEEK(POKMSK) & ~TIMER4_IRQ;
+        POKE(POKMSK, PEEK(POKMSK) & TIMER4_IRQ);
+        POKE(IRQEN, PEEK(POKMSK));
+    } else {
+        POKE(PORTB, PEEK(PORTB) | PORTB_OS_ROM);
+    }
+
+    POKE(NMIEN, NMI_VBI);
+    asm("cli");
+    return osFree;
+}
+
+//------------------------------ osOn ------------------------------
+// Purpose: Bring the OS ROM back in for a call into it, such as CIO. Its own
+//          vertical blank runs until osOff, ending through VVBLKD as usual.
+// Parameters: None
+// Preconditions: osOff must have switched the OS ROM out
+// Postconditions: The OS ROM and its interrupt handlers are in
+void osOn() {
+    asm("sei");
+    POKE(NMIEN, 0);
+    POKE(PORTB, PEEK(PORTB) | PORTB_OS_ROM);
+    POKE(POKMSK, osPokmsk | (PEEK(POKMSK) & TIMER4_IRQ));
+    POKE(IRQEN, PEEK(POKMSK));
+    POKE(NMIEN, NMI_VBI);
+    asm("cli");
+}
+
+#ifdef XE_BANKS
+#pragma code-name (push, "LOWCODE")     //can interrupt an extended memory copy
+#endif
+//------------------------------ nmiHandler ------------------------------
+// Purpose: The vertical blank interrupt without the OS: tick the clock
+//          waitvsync watches and copy the shadow registers the game sets into
+//          the hardware, then go on to the deferred routine in VVBLKD.
+// Parameters: None
+// Preconditions: Only ever run through the NMI vector, with the OS ROM out
+// Postconditions: RTCLOK is one frame on, the display, priority and colors
+//                 match their shadows
+void nmiHandler() {
+    asm("pha");
+    asm("txa");
+    asm("pha");
+    asm("tya");
+    asm("pha");
+    asm("sta %w", NMIRES);
+    asm("inc %b", RTCLOK_LOW);
+    asm("bne %g", copyShadows);
+    asm("inc %b", RTCLOK_MID);
+    asm("bne %g", copyShadows);
+    asm("inc %b", RTCLOK_HIGH);
+copyShadows:
+    asm("lda %w", SDMCTL);
+    asm("sta %w", DMACTL);
+    asm("lda %w", SDLSTL);
+    asm("sta %w", DLISTL);
+    asm("lda %w", SDLSTL + 1);
+    asm("sta %w", DLISTL + 1);
+    asm("lda %w", CHBAS);
+    asm("sta %w", CHBASE);
+    asm("lda %w", GPRIOR);
+    asm("sta %w", PRIOR);
+    asm("ldx #8");
+copyColors:
+    asm("lda %w,x", PCOLR0);
+    asm("sta %w,x", COLPM0);
+    asm("dex");
+    asm("bpl %g", copyColors);
+    asm("jmp (%w)", VVBLKD);
+}
+
+//------------------------------ vbiExit ------------------------------
+// Purpose: End the vertical blank interrupt as the OS's XITVBV does, so a
+//          deferred routine can end here with the OS ROM in or out.
+// Parameters: None
+// Preconditions: Jumped to at the end of the vertical blank, with Y, X and A
+//                pushed as nmiHandler pushes them
+// Postconditions: Returns from the interrupt
+void vbiExit() {
+    asm("pla");
+    asm("tay");
+    asm("pla");
+    asm("tax");
+    asm("pla");
+    asm("rti");
+}
+
+//------------------------------ irqHandler ------------------------------
+// Purpose: The IRQ handler without the OS. The level disk's serial IRQs and
+//          the profiler's timer are the only ones left on, so they go to
+//          VSERIN, VSEROR, VSEROC and VTIMR4 as the OS would send them;
+//          otherwise this only catches a BRK.
+// Parameters: None
+// Preconditions: Only ever run through the IRQ vector, with the OS ROM out
+// Postconditions: Returns from the interrupt
+void irqHandler() {
+#if defined(PROFILER) || defined(LEVELS)
+    asm("pha");
+#ifdef LEVELS
+    asm("lda %w", IRQST);
+    asm("and #%b", SERIAL_IN_IRQ);
+    asm("bne %g", notSerialIn);
+    asm("jmp (%w)", VSERIN);
+notSerialIn:
+    asm("lda %w", IRQST);
+    asm("and #%b", SERIAL_OUT_IRQ);
+    asm("bne %g", notSerialOut);
+    asm("jmp (%w)", VSEROR);
+notSerialOut:
+    //output complete is not latched, so it only counts while it is turned on
+    asm("lda %b", POKMSK);
+    asm("and #%b", SERIAL_DONE_IRQ);
+    asm("beq %g", notSerialDone);
+    asm("lda %w", IRQST);
+    asm("and #%b", SERIAL_DONE_IRQ);
+    asm("bne %g", notSerialDone);
+    asm("jmp (%w)", VSEROC);
+notSerialDone:
+#endif
+#ifdef PROFILER
+    asm("jmp (%w)", VTIMR4);
+#else
+    asm("pla");
+    asm("rti");
+#endif
+#else
+    asm("rti");
+#endif
+}
+#ifdef XE_BANKS
+#pragma code-name (pop)
+#endif
+#endif
+
+#ifdef PROFILER
+//------------------------------ initProfiler ------------------------------
+// Purpose: Point timer 4's IRQ at profileIRQ and measure what sampling costs
+//          a frame, then clear the samples the measurement took.
+// Parameters: None
+// Preconditions: Called once at startup, after osOff with NO_OS
+// Postconditions: profileReport holds the overhead, the histogram is empty
+void initProfiler() {
+    unsigned int bucket;
+
+    POKEW(VTIMR4, (unsigned int)profileIRQ);
+    profileReport.loopsWithout = idleLoops();
+    startProfiler();
+    profileReport.loopsWith = idleLoops();
+    stopProfiler();
+    profileReport.overheadCycles = (unsigned long)(profileReport.loopsWithout - profileReport.loopsWith)
+                                   * CPU_CYCLES_PER_FRAME / profileReport.loopsWithout;
+
+    profileReport.samples = 0;
+    profileReport.outside = 0;
+    for (bucket = 0; bucket < PROFILE_BUCKETS; bucket++) profileHistogram[bucket] = 0;
+}
+
+//------------------------------ startProfiler ------------------------------
+// Purpose: Start timer 4 and its IRQ, unless PROFILE_LIMIT samples are in.
+//          SIO leaves channels 3 and 4 joined for its baud rate, so the audio
+//          control and timer 4 are set up again every time.
+// Parameters: None
+// Preconditions: initProfiler must have been called
+// Postconditions: profileIRQ runs about 2000 times a second
+void startProfiler() {
+    if (profileReport.samples >= PROFILE_LIMIT) return;
+
+    asm("sei");
+    POKE(AUDCTL, 0);
+    POKE(AUDC4, 0);
+    POKE(AUDF4, PROFILE_AUDF);
+    POKE(SKCTL, 3);
+    POKE(POKMSK, PEEK(POKMSK) | TIMER4_IRQ);
+    POKE(IRQEN, PEEK(POKMSK));
+    POKE(STIMER, 0);
+    asm("cli");
+}
+
+//------------------------------ stopProfiler ------------------------------
+// Purpose: Turn timer 4's IRQ off.
+// Parameters: None
+// Preconditions: None
+// Postconditions: No more samples are taken until startProfiler
+void stopProfiler() {
+    asm("sei");
+    POKE(POKMSK, PEEK(POKMSK) & ~TIMER4_IRQ);
+    POKE(IRQEN, PEEK(POKMSK));
+    asm("cli");
+}
+
+#ifdef XE_BANKS
+#pragma code-name (push, "LOWCODE")     //can interrupt an extended memory copy
+#endif
+//------------------------------ profileIRQ ------------------------------
+// Purpose: Timer 4 IRQ: add one to the histogram bucket of the program
+//          counter the IRQ interrupted, or to the outside count. Borrows the
+//          C runtime's ptr1, putting it back before returning.
+// Parameters: None
+// Preconditions: Entered through VTIMR4 with A pushed, by the OS's IRQ
+//                handler or irqHandler, so the stack holds A, the status and
+//                the return address
+// Postconditions: The sample is counted and the IRQ acknowledged, timer 4's
+//                 IRQ is turned off once PROFILE_LIMIT samples are in
+void profileIRQ() {
+    asm("txa");
+    asm("pha");
+    asm("tya");
+    asm("pha");
+    asm("lda ptr1");
+    asm("pha");
+    asm("lda ptr1+1");
+    asm("pha");
+
+    //the stack holds ptr1 (2 bytes), Y, X, A, the status, then the return address
+    asm("tsx");
+    asm("lda $0108,x");
+    asm("sec");
+    asm("sbc #%b", PROFILE_START >> 8);
+    asm("cmp #%b", (PROFILE_END - PROFILE_START) >> 8);
+    asm("bcs %g", notProgram);
+
+    //the bucket's offset is (address - PROFILE_START) / PROFILE_BUCKET * 2, which is the address over 8
+    //with bit 0 cleared: the page over 8 in the high byte, the page's low 3 bits and the low byte over 8
+    //in the low byte
+    asm("tay");
+    asm("lsr a");
+    asm("lsr a");
+    asm("lsr a");
+    asm("sta ptr1+1");
+    asm("tya");
+    asm("asl a");
+    asm("asl a");
+    asm("asl a");
+    asm("asl a");
+    asm("asl a");
+    asm("sta ptr1");
+    asm("lda $0107,x");
+    asm("lsr a");
+    asm("lsr a");
+    asm("lsr a");
+    asm("ora ptr1");
+    asm("and #$FE");
+    asm("clc");
+    asm("adc #<%v", profileHistogram);
+    asm("sta ptr1");
+    asm("lda ptr1+1");
+    asm("adc #>%v", profileHistogram);
+    asm("sta ptr1+1");
+
+    asm("ldy #0");
+    asm("lda (ptr1),y");
+    asm("clc");
+    asm("adc #1");
+    asm("sta (ptr1),y");
+    asm("bcc %g", sampleCounted);
+    asm("iny");
+    asm("lda (ptr1),y");
+    asm("adc #0");
+    asm("sta (ptr1),y");
+    asm("jmp %g", sampleCounted);
+notProgram:
+    asm("inc %v+2", profileReport);
+    asm("bne %g", sampleCounted);
+    asm("inc %v+3", profileReport);
+sampleCounted:
+    asm("inc %v", profileReport);
+    asm("bne %g", acknowledge);
+    asm("inc %v+1", profileReport);
+    asm("lda %v+1", profileReport);
+    asm("cmp #%b", PROFILE_LIMIT >> 8);
+    asm("bne %g", acknowledge);
+    asm("lda %b", POKMSK);
+    asm("and #%b", (unsigned char)~TIMER4_IRQ);
+    asm("sta %b", POKMSK);
+acknowledge:
+    //clearing the timer's IRQEN bit and setting it again is what acknowledges it
+    asm("lda %b", POKMSK);
+    asm("and #%b", (unsigned char)~TIMER4_IRQ);
+    asm("sta %w", IRQEN);
+    asm("lda %b", POKMSK);
+    asm("sta %w", IRQEN);
+
+    asm("pla");
+    asm("sta ptr1+1");
+    asm("pla");
+    asm("sta ptr1");
+    asm("pla");
+    asm("tay");
+    asm("pla");
+    asm("tax");
+    asm("pla");
+    asm("rti");
+}
+#ifdef XE_BANKS
+#pragma code-name (pop)
+#endif
+#endif
+
+#ifdef AI_EVASION
+//------------------------------ initThreatSweep ------------------------------
+// Purpose: Build the threatSweep tables: follow a shell in each of the
+//          QUARTER_TURN directions from NORTH for THREAT_FRAMES frames and mark
+//          every cell a tank's middle could be in for the shell to be inside
+//          its sprite.
+// Parameters: None
+// Preconditions: None
+// Postconditions: threatSweep is filled in
+void initThreatSweep() {
+    unsigned char direction;
+    unsigned char frame;
+    int row, column, r, c;
+
+    for (direction = 0; direction < QUARTER_TURN; direction++) {
+        for (frame = 1; frame <= THREAT_FRAMES; frame++) {
+            row = FP_INT(deltas[direction][0] * frame);
+            column = FP_INT(deltas[direction][1] * frame);
+
+            //the shell is inside the sprite when the tank's middle is within TANK_HALF of it
+            for (r = (row - TANK_HALF + SWEEP_REACH) >> SWEEP_CELL_SHIFT; r <= (row + TANK_HALF + SWEEP_REACH) >> SWEEP_CELL_SHIFT; r++) {
+                for (c = (column - TANK_HALF + SWEEP_REACH) >> SWEEP_CELL_SHIFT; c <= (column + TANK_HALF + SWEEP_REACH) >> SWEEP_CELL_SHIFT; c++) {
+                    if (r >= 0 && r < SWEEP_CELLS && c >= 0 && c < SWEEP_CELLS) threatSweep[direction][r] |= 1U << c;
+                }
+            }
         }
     }
-    else if (tank == 1)
-    {
-        m1LastHorizontalLocation = mHorizontalLocation; //saving new location to global variables
-        m1LastVerticalLocation = mVerticalLocation; //saving new location to global variables
+}
 
-        POKE(horizontalRegister_M1, mHorizontalLocation);
+//------------------------------ inThreatSweep ------------------------------
+// Purpose: Check whether a tank would be hit by a shell within THREAT_FRAMES
+//          frames, from where the tank is relative to the shell.
+// Parameters:
+//   direction - The shell's direction.
+//   row - Board rows from the shell to the middle of the tank.
+//   column - Board columns from the shell to the middle of the tank.
+// Preconditions: initThreatSweep must have run
+// Postconditions: Returns true if the shell's path crosses the tank's sprite
+bool inThreatSweep(unsigned char direction, int row, int column) {
+    int turned;
+
+    FRAME_PATH(threatLookups);
+
+    //turn the offset back a quarter turn at a time until the shell heads between NORTH and EAST
+    while (direction >= QUARTER_TURN) {
+        turned = row;
+        row = -column;
+        column = turned;
+        direction -= QUARTER_TURN;
+    }
 
-        if (m1LastVerticalLocation == m0LastVerticalLocation && m0exists == true)
-        {
-            POKE(missileAddress+mVerticalLocation, 10);
+    row += SWEEP_REACH;
+    column += SWEEP_REACH;
+    if (row < 0 || row >= SWEEP_CELLS * SWEEP_CELL_SIZE || column < 0 || column >= SWEEP_CELLS * SWEEP_CELL_SIZE) return false;
+    return (threatSweep[direction][row >> SWEEP_CELL_SHIFT] >> (column >> SWEEP_CELL_SHIFT)) & 1;
+}
+
+//------------------------------ evadeShells ------------------------------
+// Purpose: Find player 1's shells that are about to hit the AI tank and pick
+//          a move that takes the tank out of their path.
+// Parameters: None
+// Preconditions: Called on a movement tick
+// Postconditions: Returns FORWARD or BACKWARD if that gets the tank out of the
+//                 way of every threatening shell, NOTHING if no shell threatens
+//                 it or neither move helps
+unsigned char evadeShells() {
+    int row = FP_INT(tankRow[1]);
+    int column = FP_INT(tankColumn[1]);
+    //how far a move takes the tank before the shells have flown THREAT_FRAMES frames
+    int rowStep = FP_INT(deltas[tankDirection[1]][0] * (THREAT_FRAMES / MOVE_TICK_FRAMES));
+    int columnStep = FP_INT(deltas[tankDirection[1]][1] * (THREAT_FRAMES / MOVE_TICK_FRAMES));
+    bool threatened = false;
+    bool forwardHit = false;
+    bool backwardHit = false;
+    unsigned char shell;
+    unsigned char direction;
+    int shellR, shellC;
+
+    if (p1IsHit) return NOTHING;
+
+    //player 1's shells are the even ones
+    for (shell = 0; shell < MISSILE_POOL_SIZE; shell += 2) {
+        if (!shellExists[shell]) continue;
+        direction = shellDirection[shell];
+        shellR = FP_INT(shellRow[shell]);
+        shellC = FP_INT(shellColumn[shell]);
+        if (!inThreatSweep(direction, row - shellR, column - shellC)) continue;
+
+        threatened = true;
+        if (inThreatSweep(direction, row + rowStep - shellR, column + columnStep - shellC)) forwardHit = true;
+        if (inThreatSweep(direction, row - rowStep - shellR, column - columnStep - shellC)) backwardHit = true;
+    }
+
+    if (!threatened) return NOTHING;
+    if (!forwardHit) return FORWARD;
+    if (!backwardHit) return BACKWARD;
+    return NOTHING;
+}
+#endif
+
+#ifdef XE_BANKS
+//------------------------------ initBanks ------------------------------
+// Purpose: Work out the PORTB value for main memory and for each extended
+//          memory bank, find how many banks there are and size the input log.
+// Parameters: None
+// Preconditions: Called once at startup
+// Postconditions: xeBanks, mainPortb, bankPortb and replayCapacity are set
+void initBanks() {
+    unsigned char bank;
+
+    //keep the OS ROM, BASIC and self test bits as they are
+    mainPortb = PEEK(PORTB) | XE_PORTB_CPU | XE_PORTB_ANTIC;
+    for (bank = 0; bank < XE_BANK_COUNT; bank++) {
+        bankPortb[bank] = (mainPortb & ~(XE_PORTB_BANK_BITS | XE_PORTB_CPU)) | (bank << 2);
+    }
+    probeBanks();
+
+    if (xeBanks == 0) replayCapacity = REPLAY_BASE_TICKS;
+    else if (xeBanks < REPLAY_BANKS) replayCapacity = xeBanks * REPLAY_BANK_TICKS;
+    else replayCapacity = REPLAY_BANKS * REPLAY_BANK_TICKS;
+}
+
+#pragma code-name (push, "LOWCODE")     //runs with a bank in the window
+//------------------------------ probeBanks ------------------------------
+// Purpose: Count the extended memory banks: write each bank's number into its
+//          first byte, then read them back. On an 800 or a 64K XL the writes
+//          all land in main memory and bank 0 does not read back 0.
+// Parameters: None
+// Preconditions: mainPortb and bankPortb are set
+// Postconditions: xeBanks is the number of banks, from bank 0, that read back
+//                 their own number; main memory is in the window and $4000 is
+//                 as it was
+void probeBanks() {
+    asm("lda %w", XE_WINDOW);
+    asm("sta %v", bankSave);
+    asm("ldx #%b", XE_BANK_COUNT - 1);
+markBanks:
+    asm("lda %v,x", bankPortb);
+    asm("sta %w", PORTB);
+    asm("stx %w", XE_WINDOW);
+    asm("dex");
+    asm("bpl %g", markBanks);
+    asm("lda %v", mainPortb);
+    asm("sta %w", PORTB);
+    asm("lda #$FF");
+    asm("sta %w", XE_WINDOW);
+
+    asm("ldx #0");
+countBanks:
+    asm("lda %v,x", bankPortb);
+    asm("sta %w", PORTB);
+    asm("txa");
+    asm("cmp %w", XE_WINDOW);
+    asm("bne %g", countDone);
+    asm("inx");
+    asm("cpx #%b", XE_BANK_COUNT);
+    asm("bne %g", countBanks);
+countDone:
+    asm("lda %v", mainPortb);
+    asm("sta %w", PORTB);
+    asm("lda %v", bankSave);
+    asm("sta %w", XE_WINDOW);
+    asm("stx %v", xeBanks);
+}
+
+//------------------------------ bankToRam ------------------------------
+// Purpose: Copy bankLength bytes from bankWindow in the bank bankSelect to
+//          bankRam in main memory. The bank is only in for the load of each
+//          byte, so bankRam can be anywhere, the window included.
+// Parameters: None, bankSelect, bankWindow, bankRam and bankLength are set by bankRead
+// Preconditions: The copy does not run past the end of the window
+// Postconditions: The bytes are copied, main memory is in the window
+void bankToRam() {
+    asm("lda %v", bankWindow);
+    asm("sta ptr1");
+    asm("lda %v+1", bankWindow);
+    asm("sta ptr1+1");
+    asm("lda %v", bankRam);
+    asm("sta ptr2");
+    asm("lda %v+1", bankRam);
+    asm("sta ptr2+1");
+    asm("ldy #0");
+copyFromBank:
+    asm("lda %v", bankSelect);
+    asm("sta %w", PORTB);
+    asm("lda (ptr1),y");
+    asm("ldx %v", mainPortb);
+    asm("stx %w", PORTB);
+    asm("sta (ptr2),y");
+    asm("iny");
+    asm("cpy %v", bankLength);
+    asm("bne %g", copyFromBank);
+}
+
+//------------------------------ ramToBank ------------------------------
+// Purpose: Copy bankLength bytes from bankRam in main memory to bankWindow in
+//          the bank bankSelect, with the bank only in for the store of each byte.
+// Parameters: None, bankSelect, bankWindow, bankRam and bankLength are set by bankWrite
+// Preconditions: The copy does not run past the end of the window
+// Postconditions: The bytes are copied, main memory is in the window
+void ramToBank() {
+    asm("lda %v", bankWindow);
+    asm("sta ptr1");
+    asm("lda %v+1", bankWindow);
+    asm("sta ptr1+1");
+    asm("lda %v", bankRam);
+    asm("sta ptr2");
+    asm("lda %v+1", bankRam);
+    asm("sta ptr2+1");
+    asm("ldy #0");
+copyToBank:
+    asm("lda (ptr2),y");
+    asm("ldx %v", bankSelect);
+    asm("stx %w", PORTB);
+    asm("sta (ptr1),y");
+    asm("ldx %v", mainPortb);
+    asm("stx %w", PORTB);
+    asm("iny");
+    asm("cpy %v", bankLength);
+    asm("bne %g", copyToBank);
+}
+#pragma code-name (pop)
+
+//------------------------------ bankRead ------------------------------
+// Purpose: Copy bytes out of an extended memory bank.
+// Parameters:
+//   bank - Bank to read, below xeBanks.
+//   offset - Where in the bank to start, from 0.
+//   ram - Where to copy the bytes to.
+//   length - Bytes to copy, 1 - 255 or 0 for 256.
+// Preconditions: offset + length is at most XE_BANK_SIZE
+// Postconditions: The bytes are copied to ram
+void bankRead(unsigned char bank, unsigned int offset, void *ram, unsigned char length) {
+    bankSelect = bankPortb[bank];
+    bankWindow = (unsigned char *)(XE_WINDOW + offset);
+    bankRam = (unsigned char *)ram;
+    bankLength = length;
+    bankToRam();
+}
+
+//------------------------------ bankWrite ------------------------------
+// Purpose: Copy bytes into an extended memory bank.
+// Parameters:
+//   bank - Bank to write, below xeBanks.
+//   offset - Where in the bank to start, from 0.
+//   ram - The bytes to copy.
+//   length - Bytes to copy, 1 - 255 or 0 for 256.
+// Preconditions: offset + length is at most XE_BANK_SIZE
+// Postconditions: The bytes are copied into the bank
+void bankWrite(unsigned char bank, unsigned int offset, const void *ram, unsigned char length) {
+    bankSelect = bankPortb[bank];
+    bankWindow = (unsigned char *)(XE_WINDOW + offset);
+    bankRam = (unsigned char *)ram;
+    bankLength = length;
+    ramToBank();
+}
+
+//------------------------------ logReplay ------------------------------
+// Purpose: Add one movement tick to the match input log.
+// Parameters:
+//   input - Player 1's joystick for the tick.
+//   aiMove - The AI's move for the tick.
+// Preconditions: Called once a movement tick while the game is on
+// Postconditions: The tick is logged, unless the log is full
+void logReplay(unsigned char input, unsigned char aiMove) {
+    unsigned char entry[2];
+
+    if (replayTicks >= replayCapacity) return;
+
+    if (xeBanks == 0) {
+        replayBase[replayTicks * 2] = input;
+        replayBase[replayTicks * 2 + 1] = aiMove;
+    } else {
+        entry[0] = input;
+        entry[1] = aiMove;
+        bankWrite(replayTicks / REPLAY_BANK_TICKS, (replayTicks % REPLAY_BANK_TICKS) * 2, entry, 2);
+    }
+    replayTicks++;
+}
+
+//------------------------------ readReplay ------------------------------
+// Purpose: Take the next movement tick out of the match input log for a replay.
+//          The replay ends when the log does, at the game over it recorded or
+//          where the log filled up.
+// Parameters:
+//   input - Set to player 1's joystick for the tick.
+//   aiMove - Set to the AI's move for the tick.
+// Preconditions: Called once a movement tick while replaying
+// Postconditions: The tick's moves are set, or both are NOTHING and the game is
+//                 over if the log has run out
+void readReplay(unsigned char *input, unsigned char *aiMove) {
+    unsigned char entry[2];
+
+    if (replayPlayed >= replayTicks) {
+        *input = NOTHING;
+        *aiMove = NOTHING;
+        gameOn = false;
+        return;
+    }
+
+    if (xeBanks == 0) {
+        entry[0] = replayBase[replayPlayed * 2];
+        entry[1] = replayBase[replayPlayed * 2 + 1];
+    } else {
+        bankRead(replayPlayed / REPLAY_BANK_TICKS, (replayPlayed % REPLAY_BANK_TICKS) * 2, entry, 2);
+    }
+    *input = entry[0];
+    *aiMove = entry[1];
+    replayPlayed++;
+}
+#endif
+
+#ifdef FRAME_SEARCH
+//------------------------------ beginFrameSearch ------------------------------
+// Purpose: Keep the start of a new game as the base of the search's random
+//          starting points, and forget the last game's costliest frames.
+// Parameters: None
+// Preconditions: The game has just been set up
+// Postconditions: searchStart and frameState hold the start of the game, no
+//                 seeds are kept
+void beginFrameSearch() {
+    unsigned char n;
+
+    saveSearchState(&searchStart);
+    frameState = searchStart;
+    for (n = 0; n < SEARCH_SEEDS; n++) seedScanlines[n] = 0;
+}
+
+//------------------------------ keepSearchSeed ------------------------------
+// Purpose: Keep the frame just played as a starting point for the search if it
+//          is one of the costliest of the game so far.
+// Parameters:
+//   scanlines - Scanlines the frame took.
+// Preconditions: frameState holds the state the frame started from
+// Postconditions: The frame replaces the cheapest seed if it cost more
+void keepSearchSeed(unsigned int scanlines) {
+    unsigned char n;
+    unsigned char cheapest = 0;
+
+    for (n = 1; n < SEARCH_SEEDS; n++) {
+        if (seedScanlines[n] < seedScanlines[cheapest]) cheapest = n;
+    }
+    if (scanlines <= seedScanlines[cheapest]) return;
+
+    searchSeeds[cheapest] = frameState;
+    seedScanlines[cheapest] = scanlines;
+}
+
+//------------------------------ searchWorstFrame ------------------------------
+// Purpose: Search for the game state whose frame takes the most scanlines. Each
+//          starting point, the game's costliest frames and scrambled copies of
+//          the start of the game, is climbed by mutating one part of the state
+//          at a time and keeping the mutation if its frame costs at least as
+//          much. A new worst state is then cut down to a reproducer by taking
+//          out each part that does not make its frame any cheaper. The
+//          searched states are played without sound, and neither the match
+//          log nor the frame trace keeps them.
+// Parameters: None
+// Preconditions: Called after a game over, with the winner banner up
+// Postconditions: frameSearch holds the worst frame found so far, the game over
+//                 is back on screen as it was
+void searchWorstFrame() {
+    int p0Final = p0Score;
+    int p1Final = p1Score;
+#ifdef LEVELS
+    unsigned char nextLevel = levelNumber;
+    unsigned char nextLevelSectors = levelSectorsRead;
+#endif
+#ifdef XE_BANKS
+    unsigned int gameReplayTicks = replayTicks;
+#endif
+#ifdef FRAME_TRACE
+    FrameRecord *gameTraceRecord = traceRecord;
+#endif
+    bool improved = false;
+    unsigned int best, trial;
+    unsigned char start, step, field;
+
+    frameSearch.budget = vcountLines * 2;
+    saveSearchState(&gameOverState);
+    searching = true;
+#ifdef FRAME_TRACE
+    traceRecord = &searchTraceRecord;
+#endif
+
+    for (start = 0; start < SEARCH_SEEDS + SEARCH_RANDOM_STARTS; start++) {
+        if (start < SEARCH_SEEDS) {
+            if (seedScanlines[start] == 0) continue;
+            searchBest = searchSeeds[start];
+        } else {
+            searchBest = searchStart;
+            for (step = 0; step < SEARCH_SCRAMBLE; step++) mutateSearchState(&searchBest);
         }
-        else
-        {
-            POKE(missileAddress+mVerticalLocation, 8);
+        best = playSearchState(&searchBest);
+
+        //ties are kept too, so the search can wander across changes that cost nothing
+        for (step = 0; step < SEARCH_STEPS; step++) {
+            searchTrial = searchBest;
+            mutateSearchState(&searchTrial);
+            trial = playSearchState(&searchTrial);
+            if (trial >= best) {
+                searchBest = searchTrial;
+                best = trial;
+            }
+        }
+
+        if (best > frameSearch.worstScanlines) {
+            worstState = searchBest;
+            frameSearch.worstScanlines = best;
+            improved = true;
+        }
+    }
+
+    if (improved) {
+        //play it once more for its path
+        frameSearch.worstScanlines = playSearchState(&worstState);
+        frameSearch.worstPath = framePath;
+        recordSearchState(&worstState, &frameSearch.worst);
+
+        searchBest = worstState;
+        for (field = 0; field < SEARCH_FIELDS; field++) {
+            searchTrial = searchBest;
+            if (!quietenSearchState(&searchTrial, field)) continue;
+            if (playSearchState(&searchTrial) >= frameSearch.worstScanlines) searchBest = searchTrial;
+        }
+        frameSearch.reproducerScanlines = playSearchState(&searchBest);
+        frameSearch.reproducerPath = framePath;
+        recordSearchState(&searchBest, &frameSearch.reproducer);
+    }
+    frameSearch.searches++;
+    searching = false;
+#ifdef FRAME_TRACE
+    traceRecord = gameTraceRecord;
+#endif
+#ifdef XE_BANKS
+    replayTicks = gameReplayTicks;      //the search's ticks were logged past the game's, drop them
+#endif
+
+    //put the game over back the way it was, with the tanks and shells where the game ended
+    loadSearchState(&gameOverState);
+#ifdef SCROLL_ARENA
+    followTanks();
+#endif
+#ifdef BEAM_RACE
+    scheduleFrame();
+#endif
+    commitFrame();
+    inputPressed = 0;                   //the next press starts a new game as usual
+    p0Score = p0Final;
+    p1Score = p1Final;
+    gameOn = false;
+    showWinnerBanner();
+    _sound(0, 0, 0, 0);
+    _sound(1, 0, 0, 0);
+#ifdef LEVELS
+    levelNumber = nextLevel;
+    levelSectorsRead = nextLevelSectors;
+#endif
+}
+
+//------------------------------ playSearchState ------------------------------
+// Purpose: Set the game up in a state, show it for a whole frame so the
+//          collision registers see it, then play and time one frame from it.
+// Parameters:
+//   state - The state to play.
+// Preconditions: PM graphics must be enabled, takes three frames
+// Postconditions: Returns the scanlines the frame took, framePath is what it did
+unsigned int playSearchState(const SearchState *state) {
+    unsigned int scanlines;
+
+    loadSearchState(state);
+#ifdef SCROLL_ARENA
+    followTanks();
+#endif
+#ifdef BEAM_RACE
+    scheduleFrame();
+#endif
+    commitFrame();
+    waitvsync();                        //flipVBI shows it from here with PM_DOUBLE_BUFFER
+    POKE(HITCLR, 1);
+    waitvsync();
+
+    memset(&framePath, 0, sizeof(framePath));
+    beginFrameBudget();
+    playFrame();
+    scanlines = frameBudgetScanlines();
+
+    frameSearch.evaluations++;
+    return scanlines;
+}
+
+//------------------------------ saveSearchState ------------------------------
+// Purpose: Copy the game's variables into a search state.
+// Parameters:
+//   state - Where to copy them.
+// Preconditions: Called between frames
+// Postconditions: state holds everything the next frame depends on
+void saveSearchState(SearchState *state) {
+    memcpy(state->tankRow, tankRow, sizeof(tankRow));
+    memcpy(state->tankColumn, tankColumn, sizeof(tankColumn));
+    memcpy(state->tankDirection, tankDirection, sizeof(tankDirection));
+    memcpy(state->tankFirstDiag, tankFirstDiag, sizeof(tankFirstDiag));
+    memcpy(state->hitTime, hitTime, sizeof(hitTime));
+    memcpy(state->shellRow, shellRow, sizeof(shellRow));
+    memcpy(state->shellColumn, shellColumn, sizeof(shellColumn));
+    memcpy(state->shellDirection, shellDirection, sizeof(shellDirection));
+    memcpy(state->shellExists, shellExists, sizeof(shellExists));
+    memcpy(state->shellNext, shellNext, sizeof(shellNext));
+#ifdef RICOCHET
+    memcpy(state->shellBounces, shellBounces, sizeof(shellBounces));
+    memcpy(state->shellBounceGuard, shellBounceGuard, sizeof(shellBounceGuard));
+#endif
+#ifdef INVISIBLE_TANKS
+    memcpy(state->revealTime, revealTime, sizeof(revealTime));
+#endif
+    state->isHit[0] = p0IsHit;
+    state->isHit[1] = p1IsHit;
+    state->hitDir[0] = p0HitDir;
+    state->hitDir[1] = p1HitDir;
+    state->fireAvailable[0] = p0FireAvailable;
+    state->fireAvailable[1] = p1FireAvailable;
+    state->fireDelayCounter[0] = p0FireDelayCounter;
+    state->fireDelayCounter[1] = p1FireDelayCounter;
+    state->fired[0] = p0Fired;
+    state->fired[1] = p1Fired;
+    state->soundTracker[0] = m0SoundTracker;
+    state->soundTracker[1] = m1SoundTracker;
+    state->hitSound = j;
+    state->frameDelayCounter = frameDelayCounter;
+    state->input = inputHeld | inputPressed;
+    state->lastMove[0] = p0LastMove;
+    state->lastMove[1] = p1LastMove;
+    state->history[0] = p0history;
+    state->history[1] = p1history;
+    state->aiMoves = k;
+    state->directionChosen = directionChosen;
+    state->desiredDirection = desiredDirection;
+#ifdef AI_VM
+    state->aiProfile = aiProfile;
+    state->aiPc = aiPc;
+    state->aiCounter = aiCounter;
+    state->aiWait = aiWait;
+#endif
+}
+
+//------------------------------ loadSearchState ------------------------------
+// Purpose: Copy a search state into the game's variables.
+// Parameters:
+//   state - The state to copy.
+// Preconditions: None
+// Postconditions: The next frame played starts from state, with both scores
+//                 at 0 and player 1's input latched as if just pressed
+void loadSearchState(const SearchState *state) {
+    memcpy(tankRow, state->tankRow, sizeof(tankRow));
+    memcpy(tankColumn, state->tankColumn, sizeof(tankColumn));
+    memcpy(tankDirection, state->tankDirection, sizeof(tankDirection));
+    memcpy(tankFirstDiag, state->tankFirstDiag, sizeof(tankFirstDiag));
+    memcpy(hitTime, state->hitTime, sizeof(hitTime));
+    memcpy(shellRow, state->shellRow, sizeof(shellRow));
+    memcpy(shellColumn, state->shellColumn, sizeof(shellColumn));
+    memcpy(shellDirection, state->shellDirection, sizeof(shellDirection));
+    memcpy(shellExists, state->shellExists, sizeof(shellExists));
+    memcpy(shellNext, state->shellNext, sizeof(shellNext));
+#ifdef RICOCHET
+    memcpy(shellBounces, state->shellBounces, sizeof(shellBounces));
+    memcpy(shellBounceGuard, state->shellBounceGuard, sizeof(shellBounceGuard));
+#endif
+#ifdef INVISIBLE_TANKS
+    memcpy(revealTime, state->revealTime, sizeof(revealTime));
+#endif
+    p0IsHit = state->isHit[0];
+    p1IsHit = state->isHit[1];
+    p0HitDir = state->hitDir[0];
+    p1HitDir = state->hitDir[1];
+    p0FireAvailable = state->fireAvailable[0];
+    p1FireAvailable = state->fireAvailable[1];
+    p0FireDelayCounter = state->fireDelayCounter[0];
+    p1FireDelayCounter = state->fireDelayCounter[1];
+    p0Fired = state->fired[0];
+    p1Fired = state->fired[1];
+    m0SoundTracker = state->soundTracker[0];
+    m1SoundTracker = state->soundTracker[1];
+    j = state->hitSound;
+    frameDelayCounter = state->frameDelayCounter;
+    inputHeld = 0;
+    inputPressed = state->input;
+    p0LastMove = state->lastMove[0];
+    p1LastMove = state->lastMove[1];
+    p0history = state->history[0];
+    p1history = state->history[1];
+    k = state->aiMoves;
+    directionChosen = state->directionChosen;
+    desiredDirection = state->desiredDirection;
+#ifdef AI_VM
+    aiProfile = state->aiProfile;
+    aiScript = aiProfiles[aiProfile];
+    aiPc = state->aiPc;
+    aiCounter = state->aiCounter;
+    aiWait = state->aiWait;
+#endif
+
+    //the scores are not part of the state, a hit must not end the game being searched
+    p0Score = SCORE_P0_ZERO;
+    p1Score = SCORE_P1_ZERO;
+    gameOn = true;
+}
+
+//------------------------------ mutateSearchState ------------------------------
+// Purpose: Change one part of a search state at random: move or turn a tank,
+//          set it spinning, put a shell next to a tank or take it away, or
+//          change the input, the last moves, the reloads, the movement tick or
+//          the AI's progress.
+// Parameters:
+//   state - The state to change.
+// Preconditions: None
+// Postconditions: state has one part changed, tanks and shells stay on the board
+void mutateSearchState(SearchState *state) {
+    unsigned char tank = rand() & 1;
+    unsigned char shell = rand() % MISSILE_POOL_SIZE;
+    unsigned char target = (shell & 1) ? 0 : 1;         //the tank the shell was fired at
+
+    switch (rand() % 10) {
+    case 0:
+        state->tankRow[tank] = clampBoard(state->tankRow[tank] + TO_FP((rand() & 15) - 8), BOARD_WRAP_TOP + 1, BOARD_WRAP_BOTTOM - 1);
+        state->tankColumn[tank] = clampBoard(state->tankColumn[tank] + TO_FP((rand() & 15) - 8), BOARD_WRAP_LEFT + 1, BOARD_WRAP_RIGHT - 1);
+        break;
+    case 1:
+        state->tankDirection[tank] = rand() & (HEADINGS - 1);
+        break;
+    case 2:
+        state->isHit[tank] = !state->isHit[tank];
+        state->hitTime[tank] = state->isHit[tank] ? 1 + rand() % HIT_SPIN_TICKS : 0;
+        state->hitDir[tank] = rand() & (HEADINGS - 1);
+        break;
+    case 3:
+        state->shellExists[shell] = !state->shellExists[shell];
+        state->shellRow[shell] = clampBoard(state->tankRow[target] + TO_FP((rand() & 31) - 16), BOARD_WRAP_TOP, BOARD_WRAP_BOTTOM);
+        state->shellColumn[shell] = clampBoard(state->tankColumn[target] + TO_FP((rand() & 31) - 16), BOARD_WRAP_LEFT, BOARD_WRAP_RIGHT);
+        state->shellDirection[shell] = rand() & (HEADINGS - 1);
+#ifdef RICOCHET
+        state->shellBounces[shell] = rand() % (RICOCHET_BOUNCES + 1);
+        state->shellBounceGuard[shell] = 0;
+#endif
+        break;
+    case 4:
+        state->shellRow[shell] = clampBoard(state->shellRow[shell] + TO_FP((rand() & 7) - 4), BOARD_WRAP_TOP, BOARD_WRAP_BOTTOM);
+        state->shellColumn[shell] = clampBoard(state->shellColumn[shell] + TO_FP((rand() & 7) - 4), BOARD_WRAP_LEFT, BOARD_WRAP_RIGHT);
+        state->shellDirection[shell] = rand() & (HEADINGS - 1);
+        break;
+    case 5:
+        state->input = searchMoves[rand() % 6];
+        break;
+    case 6:
+        state->history[tank] = searchMoves[rand() % 3];
+        state->lastMove[tank] = state->history[tank];
+        break;
+    case 7:
+        state->fireAvailable[tank] = !state->fireAvailable[tank];
+        break;
+    case 8:
+        state->frameDelayCounter = (rand() & 1) ? MOVE_TICK_FRAMES : rand() % MOVE_TICK_FRAMES;
+        break;
+    default:
+        state->aiMoves = (rand() & 1) ? aiOpening : rand() % (aiOpening + 1);
+        state->directionChosen = rand() & 1;
+#ifdef AI_VM
+        state->aiWait = 0;
+#endif
+        break;
+    }
+}
+
+//------------------------------ quietenSearchState ------------------------------
+// Purpose: Take one part out of a search state: stop a spin, take a shell out
+//          of play, or set the input, a last move, the reloads, the movement
+//          tick or the AI to what costs the least.
+// Parameters:
+//   state - The state to change.
+//   field - The part to take out, below SEARCH_FIELDS.
+// Preconditions: None
+// Postconditions: Returns true if state was changed, false if that part was
+//                 already quiet
+bool quietenSearchState(SearchState *state, unsigned char field) {
+    switch (field) {
+    case 0:
+    case 1:
+        if (!state->isHit[field]) return false;
+        state->isHit[field] = false;
+        state->hitTime[field] = 0;
+        return true;
+    case 2:
+        if (state->input == NOTHING) return false;
+        state->input = NOTHING;
+        return true;
+    case 3:
+    case 4:
+        if (state->history[field - 3] == NOTHING) return false;
+        state->history[field - 3] = NOTHING;
+        state->lastMove[field - 3] = NOTHING;
+        return true;
+    case 5:
+        if (!state->fireAvailable[0] && !state->fireAvailable[1]) return false;
+        state->fireAvailable[0] = false;
+        state->fireAvailable[1] = false;
+        return true;
+    case 6:
+        if (state->frameDelayCounter != MOVE_TICK_FRAMES) return false;
+        state->frameDelayCounter = 0;
+        return true;
+    case 7:
+#ifdef AI_VM
+        //a WAIT is the cheapest tick a script has
+        if (state->aiWait > 0) return false;
+        state->aiWait = 1;
+#else
+        //the opening drives forward without looking at player 1
+        if (state->aiMoves < aiOpening) return false;
+        state->aiMoves = 0;
+#endif
+        return true;
+    default:
+        if (!state->shellExists[field - 8]) return false;
+        state->shellExists[field - 8] = false;
+        return true;
+    }
+}
+
+//------------------------------ recordSearchState ------------------------------
+// Purpose: Write a search state out in board pixels for the frameSearch report.
+// Parameters:
+//   state - The state to write out.
+//   record - Where to write it.
+// Preconditions: None
+// Postconditions: record describes state
+void recordSearchState(const SearchState *state, SearchRecord *record) {
+    unsigned char n;
+
+    for (n = 0; n < 2; n++) {
+        record->tankRow[n] = FP_INT(state->tankRow[n]);
+        record->tankColumn[n] = FP_INT(state->tankColumn[n]);
+        record->tankDirection[n] = state->tankDirection[n];
+        record->hitTime[n] = state->isHit[n] ? state->hitTime[n] : 0;
+        record->hitDirection[n] = state->hitDir[n];
+        record->history[n] = state->history[n];
+    }
+
+    for (n = 0; n < 4; n++) {
+        if (n < MISSILE_POOL_SIZE && state->shellExists[n]) {
+            record->shellRow[n] = FP_INT(state->shellRow[n]);
+            record->shellColumn[n] = FP_INT(state->shellColumn[n]);
+            record->shellDirection[n] = state->shellDirection[n];
+        } else {
+            record->shellRow[n] = SEARCH_NO_SHELL;
+            record->shellColumn[n] = SEARCH_NO_SHELL;
+            record->shellDirection[n] = 0;
         }
     }
-}
\ No newline at end of file
+
+    record->input = state->input;
+    record->fireReady = (state->fireAvailable[0] ? 1 : 0) | (state->fireAvailable[1] ? 2 : 0);
+    record->ticksAway = MOVE_TICK_FRAMES - state->frameDelayCounter;
+    record->aiOpening = state->aiMoves < aiOpening ? aiOpening - state->aiMoves : 0;
+}
+
+//------------------------------ clampBoard ------------------------------
+// Purpose: Keep a fixed point board position between two board pixels.
+// Parameters:
+//   position - Board row or column, in fixed point.
+//   low - Lowest board pixel allowed.
+//   high - Highest board pixel allowed.
+// Preconditions: low <= high
+// Postconditions: Returns position, moved to low or high if it was outside them
+int clampBoard(int position, int low, int high) {
+    if (position < TO_FP(low)) return TO_FP(low);
+    if (position > TO_FP(high)) return TO_FP(high);
+    return position;
+}
+#endif
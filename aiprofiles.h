@@ -0,0 +1,122 @@
+/*
+    ----------------------------------------------- aiprofiles.h ------------------------------------------------------
+    Description                 : AI behavior scripts for the -DAI_VM build of TankCombat.c
+    --------------------------------------------------------------------------------------------------------------------
+    Each difficulty profile is a short bytecode script that runAIScript steps through on every movement
+    tick. An instruction that picks the AI's move for the tick (MOVE, TURN, FIRE, WAIT, or AIM when it
+    has to turn) ends the tick, and the script carries on from the next instruction on the next tick.
+    Everything else (branches, counters, AIM when already on target, WAIT 0) runs straight on, up to
+    AI_VM_BUDGET instructions a tick; a tick that runs out of budget does nothing and picks up where it
+    left off, so no script can cost more than AI_VM_BUDGET instructions a tick.
+
+    Branch targets are byte offsets from the start of the script, noted on the left of each line.
+
+        MOVE m          drive this tick, m = FORWARD or BACKWARD
+        TURN t          turn this tick, t = LEFT_TURN or RIGHT_TURN
+        AIM             turn one step toward player 1, or go straight on if already on target
+        FIRE            fire this tick
+        WAIT n          do nothing for n ticks, WAIT 0 does nothing and runs straight on
+        JUMP a          go to a
+        IF c a          go to a if condition c holds
+        UNLESS c a      go to a if condition c does not hold
+        COUNT n         set the loop counter to n, 0 sets it to the arena's AI opening
+        LOOP a          count down, go to a until the counter reaches 0 (the loop runs at least once)
+
+    Conditions: AIMED (player 1 is in the line of fire ahead), LOADED (a shell is ready), HIT (spinning
+    from a hit), CLOSE (player 1 is within AI_CLOSE_RANGE pixels), CHANCE (one tick in four).
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#ifndef AIPROFILES_H
+#define AIPROFILES_H
+
+#define AI_OP_MOVE          0
+#define AI_OP_TURN          1
+#define AI_OP_AIM           2
+#define AI_OP_FIRE          3
+#define AI_OP_WAIT          4
+#define AI_OP_JUMP          5
+#define AI_OP_IF            6
+#define AI_OP_UNLESS        7
+#define AI_OP_COUNT         8
+#define AI_OP_LOOP          9
+
+#define AI_AIMED            0
+#define AI_LOADED           1
+#define AI_HIT              2
+#define AI_CLOSE            3
+#define AI_CHANCE           4
+
+#define MOVE(m)             AI_OP_MOVE, (m)
+#define TURN(t)             AI_OP_TURN, (t)
+#define AIM                 AI_OP_AIM
+#define FIRE_SHELL          AI_OP_FIRE
+#define WAIT(n)             AI_OP_WAIT, (n)
+#define JUMP(a)             AI_OP_JUMP, (a)
+#define IF(c, a)            AI_OP_IF, AI_##c, (a)
+#define UNLESS(c, a)        AI_OP_UNLESS, AI_##c, (a)
+#define COUNT(n)            AI_OP_COUNT, (n)
+#define LOOP(a)             AI_OP_LOOP, (a)
+
+#define AI_PROFILES         3
+
+//Easy: drives out, then takes its time lining up a shot
+const unsigned char aiEasy[] = {
+    /*  0 */ COUNT(0),
+    /*  2 */ MOVE(FORWARD),
+    /*  4 */ LOOP(2),
+    /*  6 */ WAIT(3),
+    /*  8 */ AIM,
+    /*  9 */ UNLESS(AIMED, 6),
+    /* 12 */ UNLESS(LOADED, 6),
+    /* 15 */ FIRE_SHELL,
+    /* 16 */ JUMP(6)
+};
+
+//Normal: drives out, then turns toward player 1 every tick, fires when lined up and now and then closes in
+const unsigned char aiNormal[] = {
+    /*  0 */ COUNT(0),
+    /*  2 */ MOVE(FORWARD),
+    /*  4 */ LOOP(2),
+    /*  6 */ AIM,
+    /*  7 */ UNLESS(AIMED, 16),
+    /* 10 */ UNLESS(LOADED, 16),
+    /* 13 */ FIRE_SHELL,
+    /* 14 */ JUMP(6),
+    /* 16 */ UNLESS(CHANCE, 6),
+    /* 19 */ MOVE(FORWARD),
+    /* 21 */ JUMP(6)
+};
+
+//Hard: keeps its aim, closes in while it has no line of fire and backs off while reloading up close
+const unsigned char aiHard[] = {
+    /*  0 */ COUNT(0),
+    /*  2 */ MOVE(FORWARD),
+    /*  4 */ LOOP(2),
+    /*  6 */ AIM,
+    /*  7 */ UNLESS(AIMED, 19),
+    /* 10 */ UNLESS(LOADED, 14),
+    /* 13 */ FIRE_SHELL,
+    /* 14 */ IF(CLOSE, 26),
+    /* 17 */ JUMP(6),
+    /* 19 */ IF(CLOSE, 6),
+    /* 22 */ MOVE(FORWARD),
+    /* 24 */ JUMP(6),
+    /* 26 */ MOVE(BACKWARD),
+    /* 28 */ JUMP(6)
+};
+
+const unsigned char *const aiProfiles[AI_PROFILES] = {aiEasy, aiNormal, aiHard};
+
+//the script words are only for writing the tables above
+#undef MOVE
+#undef TURN
+#undef AIM
+#undef FIRE_SHELL
+#undef WAIT
+#undef JUMP
+#undef IF
+#undef UNLESS
+#undef COUNT
+#undef LOOP
+
+#endif
@@ -0,0 +1,109 @@
+/*
+    tankgfx.h: generated by tools/mksprites from assets/tanks.txt, do not edit.
+    Pictures are in the order they are shown on screen, so they are copied to player memory as they are.
+*/
+
+//Tank pictures, one player memory byte per row
+#ifdef PM_DOUBLE_LINE
+//Each PM memory row covers two scanlines, so pairs of picture rows are merged to keep the tanks 8 scanlines tall
+const unsigned char tankPics[16][4] = {
+        {0x08,0x7F,0x7F,0x63},                         //NORTH
+        {0x64,0xFF,0xFF,0x0E},                         //NORTH_15
+        {0x3B,0xFF,0xDF,0x1C},                         //NORTH_EAST
+        {0x7C,0xFF,0x1F,0x3E},                         //NORTH_60
+        {0xFC,0xFC,0x3F,0xFC},                         //EAST
+        {0x3E,0x1F,0xFF,0x7C},                         //EAST_15
+        {0x1C,0xDF,0xFF,0x3B},                         //EAST_SOUTH
+        {0x0E,0xFF,0xFF,0x64},                         //EAST_60
+        {0x63,0x7F,0x7F,0x08},                         //SOUTH
+        {0x70,0xFF,0xFF,0x26},                         //SOUTH_15
+        {0x38,0xFB,0xFF,0xDC},                         //SOUTH_WEST
+        {0x7C,0xF8,0xFF,0x3E},                         //SOUTH_60
+        {0x3F,0x3F,0xFC,0x3F},                         //WEST
+        {0x3E,0xFF,0xF8,0x7C},                         //WEST_15
+        {0xDC,0xFF,0xFB,0x38},                         //WEST_NORTH
+        {0x26,0xFF,0xFF,0x70}                          //WEST_60
+};
+#else
+const unsigned char tankPics[16][8] = {
+        {0x08,0x08,0x6B,0x7F,0x7F,0x7F,0x63,0x63},     //NORTH
+        {0x24,0x64,0x79,0xFF,0xFF,0x4E,0x0E,0x04},     //NORTH_15
+        {0x19,0x3A,0x7C,0xFF,0xDF,0x0E,0x1C,0x18},     //NORTH_EAST
+        {0x1C,0x78,0xFB,0x7C,0x1C,0x1F,0x3E,0x18},     //NORTH_60
+        {0x00,0xFC,0xFC,0x38,0x3F,0x38,0xFC,0xFC},     //EAST
+        {0x18,0x3E,0x1F,0x1C,0x7C,0xFB,0x78,0x1C},     //EAST_15
+        {0x18,0x1C,0x0E,0xDF,0xFF,0x7C,0x3A,0x19},     //EAST_SOUTH
+        {0x04,0x0E,0x4E,0xFF,0xFF,0x79,0x64,0x24},     //EAST_60
+        {0x63,0x63,0x7F,0x7F,0x7F,0x6B,0x08,0x08},     //SOUTH
+        {0x20,0x70,0x72,0xFF,0xFF,0x9E,0x26,0x24},     //SOUTH_15
+        {0x18,0x38,0x70,0xFB,0xFF,0x3E,0x5C,0x98},     //SOUTH_WEST
+        {0x18,0x7C,0xF8,0x38,0x3E,0xDF,0x1E,0x38},     //SOUTH_60
+        {0x00,0x3F,0x3F,0x1C,0xFC,0x1C,0x3F,0x3F},     //WEST
+        {0x38,0x1E,0xDF,0x3E,0x38,0xF8,0x7C,0x18},     //WEST_15
+        {0x98,0x5C,0x3E,0xFF,0xFB,0x70,0x38,0x18},     //WEST_NORTH
+        {0x24,0x26,0x9E,0xFF,0xFF,0x72,0x70,0x20}      //WEST_60
+};
+#endif
+
+#ifdef TANK_HULLS
+//Solid tank outlines, the pictures with the gaps inside each row filled in
+#ifdef PM_DOUBLE_LINE
+const unsigned char tankHull[16][4] = {
+        {0x08,0x7F,0x7F,0x7F},                         //NORTH
+        {0x7C,0xFF,0xFF,0x0E},                         //NORTH_15
+        {0x3F,0xFF,0xFF,0x1C},                         //NORTH_EAST
+        {0x7C,0xFF,0x1F,0x3E},                         //NORTH_60
+        {0xFC,0xFC,0x3F,0xFC},                         //EAST
+        {0x3E,0x1F,0xFF,0x7C},                         //EAST_15
+        {0x1C,0xFF,0xFF,0x3F},                         //EAST_SOUTH
+        {0x0E,0xFF,0xFF,0x7C},                         //EAST_60
+        {0x7F,0x7F,0x7F,0x08},                         //SOUTH
+        {0x70,0xFF,0xFF,0x3E},                         //SOUTH_15
+        {0x38,0xFF,0xFF,0xFC},                         //SOUTH_WEST
+        {0x7C,0xF8,0xFF,0x3E},                         //SOUTH_60
+        {0x3F,0x3F,0xFC,0x3F},                         //WEST
+        {0x3E,0xFF,0xF8,0x7C},                         //WEST_15
+        {0xFC,0xFF,0xFF,0x38},                         //WEST_NORTH
+        {0x3E,0xFF,0xFF,0x70}                          //WEST_60
+};
+#else
+const unsigned char tankHull[16][8] = {
+        {0x08,0x08,0x7F,0x7F,0x7F,0x7F,0x7F,0x7F},     //NORTH
+        {0x3C,0x7C,0x7F,0xFF,0xFF,0x7E,0x0E,0x04},     //NORTH_15
+        {0x1F,0x3E,0x7C,0xFF,0xFF,0x0E,0x1C,0x18},     //NORTH_EAST
+        {0x1C,0x78,0xFF,0x7C,0x1C,0x1F,0x3E,0x18},     //NORTH_60
+        {0x00,0xFC,0xFC,0x38,0x3F,0x38,0xFC,0xFC},     //EAST
+        {0x18,0x3E,0x1F,0x1C,0x7C,0xFF,0x78,0x1C},     //EAST_15
+        {0x18,0x1C,0x0E,0xFF,0xFF,0x7C,0x3E,0x1F},     //EAST_SOUTH
+        {0x04,0x0E,0x7E,0xFF,0xFF,0x7F,0x7C,0x3C},     //EAST_60
+        {0x7F,0x7F,0x7F,0x7F,0x7F,0x7F,0x08,0x08},     //SOUTH
+        {0x20,0x70,0x7E,0xFF,0xFF,0xFE,0x3E,0x3C},     //SOUTH_15
+        {0x18,0x38,0x70,0xFF,0xFF,0x3E,0x7C,0xF8},     //SOUTH_WEST
+        {0x18,0x7C,0xF8,0x38,0x3E,0xFF,0x1E,0x38},     //SOUTH_60
+        {0x00,0x3F,0x3F,0x1C,0xFC,0x1C,0x3F,0x3F},     //WEST
+        {0x38,0x1E,0xFF,0x3E,0x38,0xF8,0x7C,0x18},     //WEST_15
+        {0xF8,0x7C,0x3E,0xFF,0xFF,0x70,0x38,0x18},     //WEST_NORTH
+        {0x3C,0x3E,0xFE,0xFF,0xFF,0x7E,0x70,0x20}      //WEST_60
+};
+#endif
+#endif
+
+// horizontal, vertical offset from the tank's sprite corner to the tip of its barrel
+const unsigned char barrelTips[16][2] = {
+    {4, 0},             // NORTH
+    {5, 0},             // NORTH_15
+    {7, 0},             // NORTH_EAST
+    {7, 2},             // NORTH_60
+    {7, 4},             // EAST
+    {7, 5},             // EAST_15
+    {7, 7},             // EAST_SOUTH
+    {5, 7},             // EAST_60
+    {4, 7},             // SOUTH
+    {2, 7},             // SOUTH_15
+    {0, 7},             // SOUTH_WEST
+    {0, 5},             // SOUTH_60
+    {0, 4},             // WEST
+    {0, 2},             // WEST_15
+    {0, 0},             // WEST_NORTH
+    {2, 0}              // WEST_60
+};
@@ -0,0 +1,242 @@
+/*
+    tankgfx32.h: generated by tools/mksprites from assets/tanks.txt, do not edit.
+    Pictures are in the order they are shown on screen, so they are copied to player memory as they are.
+    32 headings for -DHEADINGS_32: the odd headings are turned from the artwork 11.25 degrees away.
+*/
+
+//Tank pictures, one player memory byte per row
+#ifdef PM_DOUBLE_LINE
+//Each PM memory row covers two scanlines, so pairs of picture rows are merged to keep the tanks 8 scanlines tall
+const unsigned char tankPics[32][4] = {
+        {0x08,0x7F,0x7F,0x63},                         //NORTH
+        {0x0C,0x7F,0x7F,0xE7},                         //11.25 degrees
+        {0x64,0xFF,0xFF,0x0E},                         //NORTH_15
+        {0x3A,0x7F,0xDE,0x1C},                         //33.75 degrees
+        {0x3B,0xFF,0xDF,0x1C},                         //NORTH_EAST
+        {0x3D,0xFE,0x5F,0x3C},                         //56.25 degrees
+        {0x7C,0xFF,0x1F,0x3E},                         //NORTH_60
+        {0x7C,0xFF,0x3E,0x7E},                         //78.75 degrees
+        {0xFC,0xFC,0x3F,0xFC},                         //EAST
+        {0xFC,0x7C,0xFF,0xF8},                         //101.25 degrees
+        {0x3E,0x1F,0xFF,0x7C},                         //EAST_15
+        {0x3C,0x5F,0xFE,0x3D},                         //123.75 degrees
+        {0x1C,0xDF,0xFF,0x3B},                         //EAST_SOUTH
+        {0x1C,0xDE,0x7F,0x3A},                         //146.25 degrees
+        {0x0E,0xFF,0xFF,0x64},                         //EAST_60
+        {0xE7,0x7F,0x7F,0x0C},                         //168.75 degrees
+        {0x63,0x7F,0x7F,0x08},                         //SOUTH
+        {0x73,0x7F,0x7F,0x1A},                         //191.25 degrees
+        {0x70,0xFF,0xFF,0x26},                         //SOUTH_15
+        {0x38,0x7B,0xFE,0x5C},                         //213.75 degrees
+        {0x38,0xFB,0xFF,0xDC},                         //SOUTH_WEST
+        {0x3C,0xFA,0x7F,0xBC},                         //236.25 degrees
+        {0x7C,0xF8,0xFF,0x3E},                         //SOUTH_60
+        {0x3F,0x3E,0xFF,0x1F},                         //258.75 degrees
+        {0x3F,0x3F,0xFC,0x3F},                         //WEST
+        {0x3E,0xFF,0x7C,0x7E},                         //281.25 degrees
+        {0x3E,0xFF,0xF8,0x7C},                         //WEST_15
+        {0xBC,0x7F,0xFA,0x3C},                         //303.75 degrees
+        {0xDC,0xFF,0xFB,0x38},                         //WEST_NORTH
+        {0x5C,0xFE,0x7B,0x38},                         //326.25 degrees
+        {0x26,0xFF,0xFF,0x70},                         //WEST_60
+        {0x1A,0x7F,0x7F,0x73}                          //348.75 degrees
+};
+#else
+const unsigned char tankPics[32][8] = {
+        {0x08,0x08,0x6B,0x7F,0x7F,0x7F,0x63,0x63},     //NORTH
+        {0x04,0x0C,0x68,0x7F,0x7F,0x7F,0xE7,0x46},     //11.25 degrees
+        {0x24,0x64,0x79,0xFF,0xFF,0x4E,0x0E,0x04},     //NORTH_15
+        {0x32,0x38,0x7F,0x7F,0xDE,0xCE,0x1C,0x0C},     //33.75 degrees
+        {0x19,0x3A,0x7C,0xFF,0xDF,0x0E,0x1C,0x18},     //NORTH_EAST
+        {0x0C,0x3D,0xFC,0xFE,0x5F,0x0F,0x3C,0x30},     //56.25 degrees
+        {0x1C,0x78,0xFB,0x7C,0x1C,0x1F,0x3E,0x18},     //NORTH_60
+        {0x00,0x7C,0xFC,0xFB,0x3E,0x38,0x7E,0x7C},     //78.75 degrees
+        {0x00,0xFC,0xFC,0x38,0x3F,0x38,0xFC,0xFC},     //EAST
+        {0x40,0xFC,0x7C,0x38,0x3E,0xFB,0xF8,0x78},     //101.25 degrees
+        {0x18,0x3E,0x1F,0x1C,0x7C,0xFB,0x78,0x1C},     //EAST_15
+        {0x30,0x3C,0x0F,0x5F,0xFE,0xFC,0x3D,0x0C},     //123.75 degrees
+        {0x18,0x1C,0x0E,0xDF,0xFF,0x7C,0x3A,0x19},     //EAST_SOUTH
+        {0x0C,0x1C,0xCE,0xDE,0x7F,0x7F,0x38,0x32},     //146.25 degrees
+        {0x04,0x0E,0x4E,0xFF,0xFF,0x79,0x64,0x24},     //EAST_60
+        {0x46,0xE7,0x7F,0x7F,0x7F,0x68,0x0C,0x04},     //168.75 degrees
+        {0x63,0x63,0x7F,0x7F,0x7F,0x6B,0x08,0x08},     //SOUTH
+        {0x30,0x73,0x7F,0x7F,0x7F,0x6B,0x1A,0x10},     //191.25 degrees
+        {0x20,0x70,0x72,0xFF,0xFF,0x9E,0x26,0x24},     //SOUTH_15
+        {0x30,0x38,0x73,0x7B,0xFE,0xFE,0x1C,0x4C},     //213.75 degrees
+        {0x18,0x38,0x70,0xFB,0xFF,0x3E,0x5C,0x98},     //SOUTH_WEST
+        {0x0C,0x3C,0xF0,0xFA,0x7F,0x3F,0xBC,0x30},     //236.25 degrees
+        {0x18,0x7C,0xF8,0x38,0x3E,0xDF,0x1E,0x38},     //SOUTH_60
+        {0x02,0x3F,0x3E,0x1C,0x7C,0xDF,0x1F,0x1E},     //258.75 degrees
+        {0x00,0x3F,0x3F,0x1C,0xFC,0x1C,0x3F,0x3F},     //WEST
+        {0x00,0x3E,0x3F,0xDF,0x7C,0x1C,0x7E,0x3E},     //281.25 degrees
+        {0x38,0x1E,0xDF,0x3E,0x38,0xF8,0x7C,0x18},     //WEST_15
+        {0x30,0xBC,0x3F,0x7F,0xFA,0xF0,0x3C,0x0C},     //303.75 degrees
+        {0x98,0x5C,0x3E,0xFF,0xFB,0x70,0x38,0x18},     //WEST_NORTH
+        {0x4C,0x1C,0xFE,0xFE,0x7B,0x73,0x38,0x30},     //326.25 degrees
+        {0x24,0x26,0x9E,0xFF,0xFF,0x72,0x70,0x20},     //WEST_60
+        {0x10,0x1A,0x6B,0x7F,0x7F,0x7F,0x73,0x30}      //348.75 degrees
+};
+#endif
+
+#ifdef TANK_HULLS
+//Solid tank outlines, the pictures with the gaps inside each row filled in
+#ifdef PM_DOUBLE_LINE
+const unsigned char tankHull[32][4] = {
+        {0x08,0x7F,0x7F,0x7F},                         //NORTH
+        {0x0C,0x7F,0x7F,0xFF},                         //11.25 degrees
+        {0x7C,0xFF,0xFF,0x0E},                         //NORTH_15
+        {0x3E,0x7F,0xFE,0x1C},                         //33.75 degrees
+        {0x3F,0xFF,0xFF,0x1C},                         //NORTH_EAST
+        {0x3F,0xFE,0x7F,0x3C},                         //56.25 degrees
+        {0x7C,0xFF,0x1F,0x3E},                         //NORTH_60
+        {0x7C,0xFF,0x3E,0x7E},                         //78.75 degrees
+        {0xFC,0xFC,0x3F,0xFC},                         //EAST
+        {0xFC,0x7C,0xFF,0xF8},                         //101.25 degrees
+        {0x3E,0x1F,0xFF,0x7C},                         //EAST_15
+        {0x3C,0x7F,0xFE,0x3F},                         //123.75 degrees
+        {0x1C,0xFF,0xFF,0x3F},                         //EAST_SOUTH
+        {0x1C,0xFE,0x7F,0x3E},                         //146.25 degrees
+        {0x0E,0xFF,0xFF,0x7C},                         //EAST_60
+        {0xFF,0x7F,0x7F,0x0C},                         //168.75 degrees
+        {0x7F,0x7F,0x7F,0x08},                         //SOUTH
+        {0x7F,0x7F,0x7F,0x1E},                         //191.25 degrees
+        {0x70,0xFF,0xFF,0x3E},                         //SOUTH_15
+        {0x38,0x7F,0xFE,0x7C},                         //213.75 degrees
+        {0x38,0xFF,0xFF,0xFC},                         //SOUTH_WEST
+        {0x3C,0xFE,0x7F,0xFC},                         //236.25 degrees
+        {0x7C,0xF8,0xFF,0x3E},                         //SOUTH_60
+        {0x3F,0x3E,0xFF,0x1F},                         //258.75 degrees
+        {0x3F,0x3F,0xFC,0x3F},                         //WEST
+        {0x3E,0xFF,0x7C,0x7E},                         //281.25 degrees
+        {0x3E,0xFF,0xF8,0x7C},                         //WEST_15
+        {0xFC,0x7F,0xFE,0x3C},                         //303.75 degrees
+        {0xFC,0xFF,0xFF,0x38},                         //WEST_NORTH
+        {0x7C,0xFE,0x7F,0x38},                         //326.25 degrees
+        {0x3E,0xFF,0xFF,0x70},                         //WEST_60
+        {0x1E,0x7F,0x7F,0x7F}                          //348.75 degrees
+};
+#else
+const unsigned char tankHull[32][8] = {
+        {0x08,0x08,0x7F,0x7F,0x7F,0x7F,0x7F,0x7F},     //NORTH
+        {0x04,0x0C,0x78,0x7F,0x7F,0x7F,0xFF,0x7E},     //11.25 degrees
+        {0x3C,0x7C,0x7F,0xFF,0xFF,0x7E,0x0E,0x04},     //NORTH_15
+        {0x3E,0x38,0x7F,0x7F,0xFE,0xFE,0x1C,0x0C},     //33.75 degrees
+        {0x1F,0x3E,0x7C,0xFF,0xFF,0x0E,0x1C,0x18},     //NORTH_EAST
+        {0x0C,0x3F,0xFC,0xFE,0x7F,0x0F,0x3C,0x30},     //56.25 degrees
+        {0x1C,0x78,0xFF,0x7C,0x1C,0x1F,0x3E,0x18},     //NORTH_60
+        {0x00,0x7C,0xFC,0xFF,0x3E,0x38,0x7E,0x7C},     //78.75 degrees
+        {0x00,0xFC,0xFC,0x38,0x3F,0x38,0xFC,0xFC},     //EAST
+        {0x40,0xFC,0x7C,0x38,0x3E,0xFF,0xF8,0x78},     //101.25 degrees
+        {0x18,0x3E,0x1F,0x1C,0x7C,0xFF,0x78,0x1C},     //EAST_15
+        {0x30,0x3C,0x0F,0x7F,0xFE,0xFC,0x3F,0x0C},     //123.75 degrees
+        {0x18,0x1C,0x0E,0xFF,0xFF,0x7C,0x3E,0x1F},     //EAST_SOUTH
+        {0x0C,0x1C,0xFE,0xFE,0x7F,0x7F,0x38,0x3E},     //146.25 degrees
+        {0x04,0x0E,0x7E,0xFF,0xFF,0x7F,0x7C,0x3C},     //EAST_60
+        {0x7E,0xFF,0x7F,0x7F,0x7F,0x78,0x0C,0x04},     //168.75 degrees
+        {0x7F,0x7F,0x7F,0x7F,0x7F,0x7F,0x08,0x08},     //SOUTH
+        {0x30,0x7F,0x7F,0x7F,0x7F,0x7F,0x1E,0x10},     //191.25 degrees
+        {0x20,0x70,0x7E,0xFF,0xFF,0xFE,0x3E,0x3C},     //SOUTH_15
+        {0x30,0x38,0x7F,0x7F,0xFE,0xFE,0x1C,0x7C},     //213.75 degrees
+        {0x18,0x38,0x70,0xFF,0xFF,0x3E,0x7C,0xF8},     //SOUTH_WEST
+        {0x0C,0x3C,0xF0,0xFE,0x7F,0x3F,0xFC,0x30},     //236.25 degrees
+        {0x18,0x7C,0xF8,0x38,0x3E,0xFF,0x1E,0x38},     //SOUTH_60
+        {0x02,0x3F,0x3E,0x1C,0x7C,0xFF,0x1F,0x1E},     //258.75 degrees
+        {0x00,0x3F,0x3F,0x1C,0xFC,0x1C,0x3F,0x3F},     //WEST
+        {0x00,0x3E,0x3F,0xFF,0x7C,0x1C,0x7E,0x3E},     //281.25 degrees
+        {0x38,0x1E,0xFF,0x3E,0x38,0xF8,0x7C,0x18},     //WEST_15
+        {0x30,0xFC,0x3F,0x7F,0xFE,0xF0,0x3C,0x0C},     //303.75 degrees
+        {0xF8,0x7C,0x3E,0xFF,0xFF,0x70,0x38,0x18},     //WEST_NORTH
+        {0x7C,0x1C,0xFE,0xFE,0x7F,0x7F,0x38,0x30},     //326.25 degrees
+        {0x3C,0x3E,0xFE,0xFF,0xFF,0x7E,0x70,0x20},     //WEST_60
+        {0x10,0x1E,0x7F,0x7F,0x7F,0x7F,0x7F,0x30}      //348.75 degrees
+};
+#endif
+#endif
+
+// horizontal, vertical offset from the tank's sprite corner to the tip of its barrel
+const unsigned char barrelTips[32][2] = {
+    {4, 0},             // NORTH
+    {5, 0},             // 11.25 degrees
+    {5, 0},             // NORTH_15
+    {6, 0},             // 33.75 degrees
+    {7, 0},             // NORTH_EAST
+    {7, 1},             // 56.25 degrees
+    {7, 2},             // NORTH_60
+    {7, 3},             // 78.75 degrees
+    {7, 4},             // EAST
+    {7, 5},             // 101.25 degrees
+    {7, 5},             // EAST_15
+    {7, 6},             // 123.75 degrees
+    {7, 7},             // EAST_SOUTH
+    {6, 7},             // 146.25 degrees
+    {5, 7},             // EAST_60
+    {5, 7},             // 168.75 degrees
+    {4, 7},             // SOUTH
+    {3, 7},             // 191.25 degrees
+    {2, 7},             // SOUTH_15
+    {1, 7},             // 213.75 degrees
+    {0, 7},             // SOUTH_WEST
+    {0, 6},             // 236.25 degrees
+    {0, 5},             // SOUTH_60
+    {0, 5},             // 258.75 degrees
+    {0, 4},             // WEST
+    {0, 3},             // 281.25 degrees
+    {0, 2},             // WEST_15
+    {0, 1},             // 303.75 degrees
+    {0, 0},             // WEST_NORTH
+    {1, 0},             // 326.25 degrees
+    {2, 0},             // WEST_60
+    {3, 0}              // 348.75 degrees
+};
+
+// row, column step of one move, one board pixel along the true heading
+#if FP_ONE != 16
+#error tankgfx32.h steps are made for FP_ONE 16, run tools/mksprites again
+#endif
+const short deltas[32][2] = {
+    {-16, 0},                    // NORTH
+    {-16, 3},                    // 11.25 degrees
+    {-15, 6},                    // NORTH_15
+    {-13, 9},                    // 33.75 degrees
+    {-11, 11},                   // NORTH_EAST
+    {-9, 13},                    // 56.25 degrees
+    {-6, 15},                    // NORTH_60
+    {-3, 16},                    // 78.75 degrees
+    {0, 16},                     // EAST
+    {3, 16},                     // 101.25 degrees
+    {6, 15},                     // EAST_15
+    {9, 13},                     // 123.75 degrees
+    {11, 11},                    // EAST_SOUTH
+    {13, 9},                     // 146.25 degrees
+    {15, 6},                     // EAST_60
+    {16, 3},                     // 168.75 degrees
+    {16, 0},                     // SOUTH
+    {16, -3},                    // 191.25 degrees
+    {15, -6},                    // SOUTH_15
+    {13, -9},                    // 213.75 degrees
+    {11, -11},                   // SOUTH_WEST
+    {9, -13},                    // 236.25 degrees
+    {6, -15},                    // SOUTH_60
+    {3, -16},                    // 258.75 degrees
+    {0, -16},                    // WEST
+    {-3, -16},                   // 281.25 degrees
+    {-6, -15},                   // WEST_15
+    {-9, -13},                   // 303.75 degrees
+    {-11, -11},                  // WEST_NORTH
+    {-13, -9},                   // 326.25 degrees
+    {-15, -6},                   // WEST_60
+    {-16, -3}                    // 348.75 degrees
+};
+
+#ifdef RICOCHET
+//direction a shell leaves a wall in, indexed by [wall orientation][direction it came in]
+//vertical walls mirror the column step, horizontal walls mirror the row step and corners send it straight back
+const unsigned char reflectDirection[3][32] = {
+    {0, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+     16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1},    // WALL_VERTICAL
+    {16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1,
+     0, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17},    // WALL_HORIZONTAL
+    {16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
+     0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15}     // WALL_CORNER
+};
+#endif
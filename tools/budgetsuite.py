@@ -0,0 +1,216 @@
+#!/usr/bin/env python3
+"""
+    ----------------------------------------------- budgetsuite.py ----------------------------------------------------
+    Description                 : Builds TankCombat with -DFRAME_BUDGET for every frame budget scenario, runs each
+                                  build headless in the atari800 emulator in parallel, and gives every build a
+                                  PASS or FAIL verdict from the frames it measured
+    Usage                       : tools/budgetsuite.py [options]
+    --------------------------------------------------------------------------------------------------------------------
+    Options:
+        --scenarios <list>      Scenarios to run, comma separated (default 1,2,3)
+        --define <NAME[=value]> Extra build option for every build, may be repeated (e.g. --define NO_OS)
+        --compare <NAME>        Run every scenario twice, without and with -D<NAME>, and print the difference
+        --frames <n>            Frames a scenario runs before it reports (default 3600, one NTSC minute)
+        --jobs <n>              Emulators running at once (default: one per core)
+        --timeout <seconds>     Wall clock time a run may take before it fails (default 300)
+        --emulator <path>       atari800 binary (default atari800 on the PATH)
+        --emulator-args <args>  Extra emulator arguments, one string (e.g. "-pal -xe")
+        --keep <dir>            Keep the builds and reports in <dir> instead of a temporary directory
+
+    Each build writes its report to H:BUDGET.BIN, which the emulator's host device maps to the run's own
+    directory. The report is every frame's scanlines as 16 bit words followed by a 13 byte trailer:
+    "TKFB", scenario, game over flag, frames measured, frames over budget, worst frame and VCOUNT lines
+    per frame. A build fails if any frame missed vertical blank, or if it never wrote its trailer.
+    Exits with 1 if any build fails.
+"""
+import argparse
+import concurrent.futures
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+import time
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCES = ["TankCombat.c", "variants.h", "tankgfx.h", "tankgfx32.h", "aiprofiles.h"]
+REPORT_FILE = "BUDGET.BIN"
+
+# budgetTrailer in TankCombat.c, little endian
+TRAILER_FORMAT = "<4sBBHHHB"
+TRAILER_SIZE = struct.calcsize(TRAILER_FORMAT)
+TRAILER_MAGIC = b"TKFB"
+
+SCENARIO_NAMES = {1: "both firing", 2: "wall scrubbing", 3: "taking hits"}
+
+
+def build(directory, scenario, defines, frames):
+    """Compile one build into directory, with its own copy of the sources so builds can run side by side."""
+    os.makedirs(directory, exist_ok=True)
+    for source in SOURCES:
+        shutil.copy(os.path.join(REPO, source), directory)
+
+    command = ["cl65", "-t", "atari", "-O", "-DFRAME_BUDGET", "-DFRAME_BUDGET_SCENARIO=%d" % scenario,
+               "-DFRAME_BUDGET_FRAMES=%d" % frames]
+    command += ["-D" + define for define in defines]
+    command += ["-m", "TankCombat.map", "-o", "TankCombat.xex", "TankCombat.c"]
+    result = subprocess.run(command, cwd=directory, capture_output=True, text=True)
+    if result.returncode != 0:
+        return result.stdout + result.stderr
+    return None
+
+
+def read_report(path):
+    """Return (frames, trailer) from a finished report, or None if the trailer is not there yet."""
+    try:
+        with open(path, "rb") as report:
+            data = report.read()
+    except OSError:
+        return None
+
+    if len(data) < TRAILER_SIZE or data[-TRAILER_SIZE:-TRAILER_SIZE + 4] != TRAILER_MAGIC:
+        return None
+    magic, scenario, game_over, measured, over, worst, vcount_lines = struct.unpack(TRAILER_FORMAT,
+                                                                                   data[-TRAILER_SIZE:])
+    body = data[:-TRAILER_SIZE]
+    frames = list(struct.unpack("<%dH" % (len(body) // 2), body[:len(body) // 2 * 2]))
+    trailer = {"scenario": scenario, "gameOver": game_over, "framesMeasured": measured,
+               "framesOverBudget": over, "worstFrameScanlines": worst, "vcountLines": vcount_lines}
+    return frames, trailer
+
+
+def run(directory, options):
+    """Boot the build headless and wait for its report, then stop the emulator."""
+    report_path = os.path.join(directory, REPORT_FILE)
+    if os.path.exists(report_path):
+        os.remove(report_path)
+
+    environment = dict(os.environ, SDL_VIDEODRIVER="dummy", SDL_AUDIODRIVER="dummy")
+    command = [options.emulator, "-xl", "-nobasic", "-nosound", "-turbo",
+               "-hreadwrite", "-H1", directory]
+    command += options.emulator_args.split()
+    command.append(os.path.join(directory, "TankCombat.xex"))
+    with open(os.path.join(directory, "emulator.log"), "w") as log:
+        emulator = subprocess.Popen(command, cwd=directory, env=environment, stdin=subprocess.DEVNULL,
+                                    stdout=log, stderr=subprocess.STDOUT)
+        deadline = time.monotonic() + options.timeout
+        report = None
+        try:
+            while time.monotonic() < deadline:
+                report = read_report(report_path)
+                if report is not None or emulator.poll() is not None:
+                    report = report or read_report(report_path)
+                    break
+                time.sleep(0.5)
+        finally:
+            if emulator.poll() is None:
+                emulator.kill()
+            emulator.wait()
+    return report
+
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def judge(name, directory, scenario, defines, options):
+    """Build and run one scenario, returning its result line's fields."""
+    result = {"name": name, "scenario": scenario, "defines": defines}
+    error = build(directory, scenario, defines, options.frames)
+    if error is not None:
+        result["verdict"] = "FAIL"
+        result["reason"] = "build failed:\n" + error
+        return result
+
+    report = run(directory, options)
+    if report is None:
+        result["verdict"] = "FAIL"
+        result["reason"] = "no report within %d seconds (see %s)" % (options.timeout,
+                                                                    os.path.join(directory, "emulator.log"))
+        return result
+
+    frames, trailer = report
+    result.update(trailer)
+    if not frames or len(frames) != trailer["framesMeasured"]:
+        result["verdict"] = "FAIL"
+        result["reason"] = "report has %d frames, the trailer says %d" % (len(frames), trailer["framesMeasured"])
+        return result
+
+    result["mean"] = sum(frames) / len(frames)
+    result["p99"] = percentile(frames, 0.99)
+    result["worst"] = max(frames)
+    result["verdict"] = "PASS" if trailer["framesOverBudget"] == 0 else "FAIL"
+    if result["verdict"] == "FAIL":
+        result["reason"] = "%d frames missed vertical blank" % trailer["framesOverBudget"]
+    return result
+
+
+def print_result(result):
+    label = "%d %-15s %s" % (result["scenario"], SCENARIO_NAMES.get(result["scenario"], ""),
+                             " ".join("-D" + define for define in result["defines"]) or "-")
+    if "mean" in result:
+        print("%-50s %6d %8.1f %6d %6d %6d  %s" % (label, result["framesMeasured"], result["mean"], result["p99"],
+                                                   result["worst"], result["framesOverBudget"], result["verdict"]))
+    else:
+        print("%-50s %6s %8s %6s %6s %6s  %s" % (label, "-", "-", "-", "-", "-", result["verdict"]))
+    if "reason" in result:
+        print("    " + result["reason"].rstrip().replace("\n", "\n    "))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--scenarios", default="1,2,3")
+    parser.add_argument("--define", action="append", default=[])
+    parser.add_argument("--compare")
+    parser.add_argument("--frames", type=int, default=3600)
+    parser.add_argument("--jobs", type=int, default=os.cpu_count())
+    parser.add_argument("--timeout", type=int, default=300)
+    parser.add_argument("--emulator", default="atari800")
+    parser.add_argument("--emulator-args", default="")
+    parser.add_argument("--keep")
+    options = parser.parse_args()
+
+    if not 0 < options.frames < 65536:
+        sys.exit("budgetsuite: --frames must be between 1 and 65535")
+    for tool in ("cl65", options.emulator):
+        if shutil.which(tool) is None:
+            sys.exit("budgetsuite: %s is not on the PATH" % tool)
+
+    scenarios = [int(scenario) for scenario in options.scenarios.split(",")]
+    variants = [("base", options.define)]
+    if options.compare:
+        variants.append((options.compare, options.define + [options.compare]))
+
+    work = options.keep or tempfile.mkdtemp(prefix="budgetsuite.")
+    jobs = []
+    with concurrent.futures.ThreadPoolExecutor(max_workers=options.jobs) as pool:
+        for scenario in scenarios:
+            for name, defines in variants:
+                directory = os.path.abspath(os.path.join(work, "%s.%d" % (name, scenario)))
+                jobs.append(pool.submit(judge, name, directory, scenario, defines, options))
+    results = [job.result() for job in jobs]
+
+    print("%-50s %6s %8s %6s %6s %6s  %s" % ("scenario / build options", "frames", "mean", "p99", "worst", "over",
+                                             "verdict"))
+    for result in results:
+        print_result(result)
+
+    if options.compare:
+        print("\nWith -D%s minus without, in scanlines" % options.compare)
+        for scenario in scenarios:
+            pair = [result for result in results if result["scenario"] == scenario]
+            if all("mean" in result for result in pair):
+                without, with_option = pair
+                print("%d %-15s mean %+7.1f  p99 %+4d  worst %+4d" % (
+                    scenario, SCENARIO_NAMES.get(scenario, ""), with_option["mean"] - without["mean"],
+                    with_option["p99"] - without["p99"], with_option["worst"] - without["worst"]))
+
+    if not options.keep:
+        shutil.rmtree(work, ignore_errors=True)
+    sys.exit(0 if all(result["verdict"] == "PASS" for result in results) else 1)
+
+
+if __name__ == "__main__":
+    main()
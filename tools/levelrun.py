@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""
+    ----------------------------------------------- levelrun.py -------------------------------------------------------
+    Description                 : Builds the level disk with tools/mklevels and TankCombat with -DLEVELS, then runs
+                                  the game in the atari800 emulator with the disk in D2:
+    Usage                       : tools/levelrun.py [options]
+    --------------------------------------------------------------------------------------------------------------------
+    Options:
+        --levels <file>         Arena artwork to build the disk from (default assets/levels.txt)
+        --define <NAME[=value]> Extra build option, may be repeated (e.g. --define NO_OS, --define XE_BANKS)
+        --emulator <path>       atari800 binary (default atari800 on the PATH)
+        --emulator-args <args>  Extra emulator arguments, one string (e.g. "-pal -xe" for XE_BANKS)
+        --cc <compiler>         Host C compiler for mklevels (default cc)
+        --keep <dir>            Keep the builds and disks in <dir> instead of a temporary directory
+
+    The emulator loads TankCombat.xex itself, so D1: only holds a blank disk and the level disk goes in D2:,
+    where the game looks for it. The game reads the disk through POKEY's serial port with its own
+    interrupt handlers, so leave the emulator's SIO patch as it is: the patch only speeds up calls to the
+    OS's SIOV, which the game does not make, and the game's reads go over the emulated serial bus.
+"""
+import argparse
+import os
+import shutil
+import struct
+import subprocess
+import sys
+import tempfile
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SOURCES = ["TankCombat.c", "variants.h", "tankgfx.h", "tankgfx32.h", "aiprofiles.h"]
+
+# a single density disk, as mklevels writes
+SECTOR_SIZE = 128
+SECTORS = 720
+ATR_MAGIC = 0x0296
+
+
+def run(command, directory):
+    """Run one build step, stopping with its output if it fails."""
+    result = subprocess.run(command, cwd=directory, capture_output=True, text=True)
+    if result.returncode != 0:
+        sys.exit("levelrun: %s failed:\n%s%s" % (command[0], result.stdout, result.stderr))
+
+
+def write_blank_disk(path):
+    """Write an empty single density ATR for D1:, so the level disk can go in D2:."""
+    paragraphs = SECTORS * SECTOR_SIZE // 16
+    with open(path, "wb") as disk:
+        disk.write(struct.pack("<HHHH8x", ATR_MAGIC, paragraphs & 0xFFFF, SECTOR_SIZE, paragraphs >> 16))
+        disk.write(bytes(SECTORS * SECTOR_SIZE))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--levels", default=os.path.join(REPO, "assets", "levels.txt"))
+    parser.add_argument("--define", action="append", default=[])
+    parser.add_argument("--emulator", default="atari800")
+    parser.add_argument("--emulator-args", default="")
+    parser.add_argument("--cc", default="cc")
+    parser.add_argument("--keep")
+    options = parser.parse_args()
+
+    for tool in (options.cc, "cl65", options.emulator):
+        if shutil.which(tool) is None:
+            sys.exit("levelrun: %s is not on the PATH" % tool)
+
+    work = os.path.abspath(options.keep or tempfile.mkdtemp(prefix="levelrun."))
+    os.makedirs(work, exist_ok=True)
+    for source in SOURCES:
+        shutil.copy(os.path.join(REPO, source), work)
+
+    run([options.cc, "-O2", "-o", "mklevels", os.path.join(REPO, "tools", "mklevels.c")], work)
+    run([os.path.join(work, "mklevels"), os.path.abspath(options.levels), "levels.atr"], work)
+    write_blank_disk(os.path.join(work, "blank.atr"))
+
+    command = ["cl65", "-t", "atari", "-O", "-DLEVELS"]
+    command += ["-D" + define for define in options.define]
+    command += ["-m", "TankCombat.map", "-o", "TankCombat.xex", "TankCombat.c"]
+    run(command, work)
+
+    # the executable has to come first to be booted, then the disks go in D1: and D2: in order
+    command = [options.emulator, "-xl", "-nobasic"] + options.emulator_args.split()
+    command += [os.path.join(work, "TankCombat.xex"), os.path.join(work, "blank.atr"),
+                os.path.join(work, "levels.atr")]
+    try:
+        status = subprocess.call(command, cwd=work)
+    finally:
+        if not options.keep:
+            shutil.rmtree(work, ignore_errors=True)
+    sys.exit(status)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,750 @@
+/*
+    ----------------------------------------------- matchserver.c ------------------------------------------------------
+    Description                 : Host match server for bot ladders, playing TankCombat games between bots that
+                                  connect over a local socket
+    Compiler                    : Any C11 compiler on Linux (uses epoll, timerfd, eventfd and pthreads)
+    Build                       : cc -O2 -pthread -o matchserver tools/matchserver.c tools/tankcore.c
+    --------------------------------------------------------------------------------------------------------------------
+    Usage:
+        matchserver [options]
+            --socket <path>     Unix socket bots connect to (default tankcombat.sock)
+            --workers <n>       Worker threads stepping sessions (default: one per core)
+            --sessions <n>      Most sessions at once, split over the workers (default 4096)
+            --vs-ai             Each bot plays the C AI on its own, rather than the next bot to connect
+            --load <n>          Connect n sessions' worth of built in bots, to measure what the server holds
+            --seconds <n>       Stop after n seconds (default: run until interrupted)
+
+    Bots connect with a SOCK_SEQPACKET socket. Two bots in a row are paired into a session (or each bot
+    gets a session against the C AI with --vs-ai) and play one game after another on the built in arena
+    until either disconnects, which ends the session for both.
+
+    A bot sends single byte messages: the joystick bits it wants (FORWARD 0x01, BACKWARD 0x02, LEFT_TURN
+    0x04, RIGHT_TURN 0x08, FIRE 0x10). The last one received is used on every movement tick until the next
+    one arrives, like a joystick held down. The server sends an OBSERVATION_BYTES message when the session
+    starts, after every movement tick and at every game over, laid out as below, all little endian. Rows
+    and columns are board pixels in fixed point (TANK_FP_SHIFT). An observation a bot has not made room for
+    is dropped rather than waiting for it.
+
+         0  frame (4)               4  tank the bot plays (1)   5  scores (2)   7  game over (1)   8  winner (1)
+         9  per tank: row (2), column (2), direction (1), spin ticks left (1), reloaded (1), 7 bytes each
+        23  per shell: row (2), column (2), direction (1), in flight (1), 6 bytes each
+
+    Each worker owns a slice of the session pool and steps all of its sessions one frame on every 60 Hz
+    tick of its own timer, between reading bot messages from its own epoll. Sessions and connections are
+    all set up before the first bot connects; a tick allocates nothing. Every REPORT_TICKS ticks each
+    worker prints the time its ticks took, and at the end the whole run's percentiles are printed. A
+    tick that takes longer than a frame shows up as a missed tick.
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tankcore.h"
+
+#define TICK_NS             16666667       //one frame at 60 Hz
+#define TICK_US             16667
+#define BUCKET_US           10             //tick time histogram resolution
+#define HISTOGRAM_BUCKETS   (TICK_US / BUCKET_US + 2)   //the last bucket is every tick over a frame
+#define REPORT_TICKS        600            //ten seconds
+#define OBSERVATION_BYTES   47
+#define HANDOFF_SLOTS       256            //sessions queued for a worker to pick up
+#define MAX_WORKERS         64
+#define EPOLL_BATCH         256
+#define AI_PLAYS            (-1)           //Connection fd of a tank the C AI plays
+
+typedef struct Session Session;
+
+//One bot's end of a session
+typedef struct {
+    int fd;                                 //AI_PLAYS when the C AI plays this tank or the session is free
+    uint8_t tank;
+    uint8_t move;                           //joystick bits last received
+    Session *session;
+} Connection;
+
+struct Session {
+    TankGame game;
+    Connection bots[2];
+    uint8_t inUse;
+    int nextFree;                           //free list link, index within the worker's slice
+};
+
+//New session's sockets, from the accepting thread to a worker
+typedef struct {
+    int fds[2];
+} Handoff;
+
+typedef struct {
+    pthread_t thread;
+    int index;
+    int epoll;
+    int timer;
+    int wake;                               //eventfd, written when a handoff is queued
+    Session *sessions;                      //this worker's slice of the pool
+    int capacity;
+    int freeList;
+    int active;
+    uint32_t seed;
+
+    pthread_mutex_t lock;                   //guards the handoff ring
+    Handoff handoff[HANDOFF_SLOTS];
+    unsigned handoffHead;
+    unsigned handoffTail;
+
+    //statistics, only touched by the worker until it has been joined
+    uint32_t recent[HISTOGRAM_BUCKETS];     //tick times since the last report
+    uint32_t total[HISTOGRAM_BUCKETS];      //tick times of the whole run
+    uint64_t ticks;
+    uint64_t missed;
+    uint64_t maxNs;
+    uint64_t recentMaxNs;
+    uint64_t recentMissed;
+    uint64_t games;
+    uint64_t dropped;                       //observations a bot had no room for
+    uint64_t rejected;                      //sessions turned away with the pool full
+} Worker;
+
+static Worker workers[MAX_WORKERS];
+static int workerCount;
+static Session *pool;
+static atomic_int stopping;
+static const char *socketPath = "tankcombat.sock";
+static int vsAI;
+
+//epoll tags for a worker's own descriptors
+static char timerTag;
+static char wakeTag;
+
+//------------------------------ fail ------------------------------
+// Purpose: Print an error and exit.
+// Parameters:
+//   message - What went wrong.
+//   detail - The call or value it went wrong with.
+// Preconditions: None
+// Postconditions: Does not return
+static void fail(const char *message, const char *detail) {
+    fprintf(stderr, "matchserver: %s: %s (%s)\n", message, detail, strerror(errno));
+    exit(1);
+}
+
+//------------------------------ nowNs ------------------------------
+// Purpose: Read the monotonic clock.
+// Parameters: None
+// Preconditions: None
+// Postconditions: Returns the time in nanoseconds
+static uint64_t nowNs(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+//------------------------------ percentileMs ------------------------------
+// Purpose: Read a percentile off a tick time histogram.
+// Parameters:
+//   histogram - HISTOGRAM_BUCKETS counts.
+//   fraction - The percentile, 0.5 for the median.
+// Preconditions: None
+// Postconditions: Returns the top of the bucket the percentile falls in, in
+//                 milliseconds, or 0 for an empty histogram
+static double percentileMs(const uint32_t *histogram, double fraction) {
+    uint64_t count = 0;
+    uint64_t seen = 0;
+    uint64_t want;
+    int n;
+
+    for (n = 0; n < HISTOGRAM_BUCKETS; n++) count += histogram[n];
+    if (count == 0) return 0.0;
+    want = (uint64_t)(fraction * (double)count);
+    if (want == 0) want = 1;
+
+    for (n = 0; n < HISTOGRAM_BUCKETS; n++) {
+        seen += histogram[n];
+        if (seen >= want) break;
+    }
+    return (n + 1) * BUCKET_US / 1000.0;
+}
+
+//------------------------------ writeObservation ------------------------------
+// Purpose: Lay out what a bot sees of its game, as described at the top.
+// Parameters:
+//   out - OBSERVATION_BYTES bytes.
+//   game - The game.
+//   tank - The tank the bot plays.
+// Preconditions: None
+// Postconditions: out holds the observation
+static void writeObservation(uint8_t *out, const TankGame *game, int tank) {
+    uint8_t *p = out;
+    int n;
+
+    p[0] = (uint8_t)game->frame;
+    p[1] = (uint8_t)(game->frame >> 8);
+    p[2] = (uint8_t)(game->frame >> 16);
+    p[3] = (uint8_t)(game->frame >> 24);
+    p[4] = (uint8_t)tank;
+    p[5] = game->score[0];
+    p[6] = game->score[1];
+    p[7] = game->over;
+    p[8] = game->winner;
+    p += 9;
+
+    for (n = 0; n < 2; n++) {
+        p[0] = (uint8_t)game->tankRow[n];
+        p[1] = (uint8_t)((uint16_t)game->tankRow[n] >> 8);
+        p[2] = (uint8_t)game->tankColumn[n];
+        p[3] = (uint8_t)((uint16_t)game->tankColumn[n] >> 8);
+        p[4] = game->tankDirection[n];
+        p[5] = game->isHit[n] ? game->hitTime[n] : 0;
+        p[6] = game->fireAvailable[n];
+        p += 7;
+    }
+
+    for (n = 0; n < TANK_SHELLS; n++) {
+        p[0] = (uint8_t)game->shellRow[n];
+        p[1] = (uint8_t)((uint16_t)game->shellRow[n] >> 8);
+        p[2] = (uint8_t)game->shellColumn[n];
+        p[3] = (uint8_t)((uint16_t)game->shellColumn[n] >> 8);
+        p[4] = game->shellDirection[n];
+        p[5] = game->shellExists[n];
+        p += 6;
+    }
+}
+
+//------------------------------ closeSession ------------------------------
+// Purpose: End a session: close both bots' sockets and put it back on the
+//          worker's free list.
+// Parameters:
+//   worker - The worker that owns the session.
+//   session - The session.
+// Preconditions: The session is in use
+// Postconditions: The session is free
+static void closeSession(Worker *worker, Session *session) {
+    int n;
+
+    for (n = 0; n < 2; n++) {
+        Connection *bot = &session->bots[n];
+
+        if (bot->fd >= 0) {
+            epoll_ctl(worker->epoll, EPOLL_CTL_DEL, bot->fd, NULL);
+            close(bot->fd);
+        }
+        bot->fd = -1;
+    }
+    session->inUse = 0;
+    session->nextFree = worker->freeList;
+    worker->freeList = (int)(session - worker->sessions);
+    worker->active--;
+}
+
+//------------------------------ sendObservations ------------------------------
+// Purpose: Send each bot in a session what it sees of its game.
+// Parameters:
+//   worker - The worker that owns the session.
+//   session - The session.
+// Preconditions: The session is in use
+// Postconditions: Returns 0 if a bot's socket has gone, 1 otherwise
+static int sendObservations(Worker *worker, Session *session) {
+    uint8_t observation[OBSERVATION_BYTES];
+    int n;
+
+    for (n = 0; n < 2; n++) {
+        Connection *bot = &session->bots[n];
+
+        if (bot->fd < 0) continue;
+        writeObservation(observation, &session->game, n);
+        if (send(bot->fd, observation, sizeof(observation), MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) return 0;
+            worker->dropped++;
+        }
+    }
+    return 1;
+}
+
+//------------------------------ openSession ------------------------------
+// Purpose: Start a session for sockets handed over by the accepting thread.
+// Parameters:
+//   worker - The worker to run it.
+//   handoff - The bots' sockets, fds[1] AI_PLAYS for a game against the C AI.
+// Preconditions: None
+// Postconditions: The session's first game has started, or the sockets are
+//                 closed if the worker's slice of the pool is full
+static void openSession(Worker *worker, const Handoff *handoff) {
+    Session *session;
+    struct epoll_event event;
+    int n;
+
+    if (worker->freeList < 0) {
+        for (n = 0; n < 2; n++) {
+            if (handoff->fds[n] >= 0) close(handoff->fds[n]);
+        }
+        worker->rejected++;
+        return;
+    }
+
+    session = &worker->sessions[worker->freeList];
+    worker->freeList = session->nextFree;
+    worker->active++;
+    session->inUse = 1;
+
+    worker->seed = worker->seed * 1664525u + 1013904223u;
+    tankInit(&session->game, NULL, worker->seed);
+
+    for (n = 0; n < 2; n++) {
+        Connection *bot = &session->bots[n];
+
+        bot->fd = handoff->fds[n];
+        bot->tank = (uint8_t)n;
+        bot->move = TANK_NOTHING;
+        bot->session = session;
+        if (bot->fd < 0) continue;
+
+        event.events = EPOLLIN;
+        event.data.ptr = bot;
+        if (epoll_ctl(worker->epoll, EPOLL_CTL_ADD, bot->fd, &event) != 0) {
+            closeSession(worker, session);
+            return;
+        }
+    }
+
+    if (!sendObservations(worker, session)) closeSession(worker, session);
+}
+
+//------------------------------ readMoves ------------------------------
+// Purpose: Take in everything a bot has sent, keeping its last move.
+// Parameters:
+//   worker - The worker that owns the bot's session.
+//   bot - The bot.
+// Preconditions: None
+// Postconditions: bot->move is the last move received, the session is closed
+//                 if the bot has gone
+static void readMoves(Worker *worker, Connection *bot) {
+    uint8_t message[16];
+    ssize_t length;
+
+    //a stale event for a session closed earlier in the same batch
+    if (bot->fd < 0 || !bot->session->inUse) return;
+
+    for (;;) {
+        length = recv(bot->fd, message, sizeof(message), MSG_DONTWAIT);
+        if (length > 0) {
+            bot->move = message[length - 1] & (TANK_FORWARD | TANK_BACKWARD | TANK_LEFT_TURN | TANK_RIGHT_TURN | TANK_FIRE);
+            continue;
+        }
+        if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        if (length < 0 && errno == EINTR) continue;
+        closeSession(worker, bot->session);
+        return;
+    }
+}
+
+//------------------------------ stepSession ------------------------------
+// Purpose: Play one frame of a session's game, starting the next game at a
+//          game over.
+// Parameters:
+//   worker - The worker that owns the session.
+//   session - The session.
+// Preconditions: The session is in use
+// Postconditions: The game is a frame on, the bots have been sent what they
+//                 see after a movement tick
+static void stepSession(Worker *worker, Session *session) {
+    TankGame *game = &session->game;
+    uint8_t input[2];
+    int n;
+
+    if (tankMovementTick(game)) {
+        for (n = 0; n < 2; n++) {
+            input[n] = session->bots[n].fd >= 0 ? session->bots[n].move : tankAIMove(game, n);
+        }
+    } else {
+        input[0] = input[1] = TANK_NOTHING;
+    }
+
+    if (!tankStep(game, input) && !game->over) return;
+
+    if (!sendObservations(worker, session)) {
+        closeSession(worker, session);
+        return;
+    }
+
+    if (game->over) {
+        worker->games++;
+        worker->seed = worker->seed * 1664525u + 1013904223u;
+        tankInit(game, NULL, worker->seed);
+    }
+}
+
+//------------------------------ recordTick ------------------------------
+// Purpose: Add a tick's time to the worker's histograms, and print its report
+//          every REPORT_TICKS ticks.
+// Parameters:
+//   worker - The worker.
+//   elapsed - Nanoseconds the tick took.
+//   missed - Ticks of the timer that went by while the worker was busy.
+// Preconditions: None
+// Postconditions: The statistics include the tick
+static void recordTick(Worker *worker, uint64_t elapsed, uint64_t missed) {
+    uint64_t bucket = elapsed / (BUCKET_US * 1000u);
+
+    if (bucket >= HISTOGRAM_BUCKETS) bucket = HISTOGRAM_BUCKETS - 1;
+    worker->recent[bucket]++;
+    worker->total[bucket]++;
+    worker->ticks++;
+    worker->missed += missed;
+    worker->recentMissed += missed;
+    if (elapsed > worker->maxNs) worker->maxNs = elapsed;
+    if (elapsed > worker->recentMaxNs) worker->recentMaxNs = elapsed;
+
+    if (worker->ticks % REPORT_TICKS != 0) return;
+
+    printf("worker %d: %d sessions, tick p50 %.2f p90 %.2f p99 %.2f max %.2f ms, %llu missed ticks\n",
+           worker->index, worker->active,
+           percentileMs(worker->recent, 0.50), percentileMs(worker->recent, 0.90),
+           percentileMs(worker->recent, 0.99), worker->recentMaxNs / 1e6,
+           (unsigned long long)worker->recentMissed);
+    fflush(stdout);
+    memset(worker->recent, 0, sizeof(worker->recent));
+    worker->recentMaxNs = 0;
+    worker->recentMissed = 0;
+}
+
+//------------------------------ runWorker ------------------------------
+// Purpose: A worker thread: pick up new sessions, read bot moves as they come
+//          in, and step every session on each tick of a 60 Hz timer.
+// Parameters:
+//   argument - The Worker.
+// Preconditions: The worker's epoll, timer and wake descriptors are set up
+// Postconditions: Returns once stopping is set, with every session closed
+static void *runWorker(void *argument) {
+    Worker *worker = argument;
+    struct epoll_event events[EPOLL_BATCH];
+    uint64_t expirations, start;
+    int count, n, s;
+
+    while (!atomic_load(&stopping)) {
+        count = epoll_wait(worker->epoll, events, EPOLL_BATCH, 100);
+
+        for (n = 0; n < count; n++) {
+            void *tag = events[n].data.ptr;
+
+            if (tag == &timerTag) {
+                if (read(worker->timer, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+                start = nowNs();
+                for (s = 0; s < worker->capacity; s++) {
+                    if (worker->sessions[s].inUse) stepSession(worker, &worker->sessions[s]);
+                }
+                recordTick(worker, nowNs() - start, expirations - 1);
+            } else if (tag == &wakeTag) {
+                if (read(worker->wake, &expirations, sizeof(expirations)) != sizeof(expirations)) continue;
+                pthread_mutex_lock(&worker->lock);
+                while (worker->handoffTail != worker->handoffHead) {
+                    Handoff handoff = worker->handoff[worker->handoffTail % HANDOFF_SLOTS];
+
+                    worker->handoffTail++;
+                    pthread_mutex_unlock(&worker->lock);
+                    openSession(worker, &handoff);
+                    pthread_mutex_lock(&worker->lock);
+                }
+                pthread_mutex_unlock(&worker->lock);
+            } else {
+                readMoves(worker, tag);
+            }
+        }
+    }
+
+    for (n = 0; n < worker->capacity; n++) {
+        if (worker->sessions[n].inUse) closeSession(worker, &worker->sessions[n]);
+    }
+    return NULL;
+}
+
+//------------------------------ startWorker ------------------------------
+// Purpose: Give a worker its slice of the session pool and start its thread.
+// Parameters:
+//   worker - The worker.
+//   sessions - First session of its slice.
+//   capacity - Sessions in the slice.
+// Preconditions: None
+// Postconditions: The worker is running, ticking at 60 Hz
+static void startWorker(Worker *worker, Session *sessions, int capacity) {
+    struct itimerspec period = {{0, TICK_NS}, {0, TICK_NS}};
+    struct epoll_event event;
+    int n;
+
+    worker->sessions = sessions;
+    worker->capacity = capacity;
+    worker->freeList = capacity > 0 ? 0 : -1;
+    for (n = 0; n < capacity; n++) {
+        sessions[n].nextFree = n + 1 < capacity ? n + 1 : -1;
+        sessions[n].bots[0].fd = -1;
+        sessions[n].bots[1].fd = -1;
+    }
+    worker->seed = 0x9E3779B9u * (uint32_t)(worker->index + 1);
+    pthread_mutex_init(&worker->lock, NULL);
+
+    worker->epoll = epoll_create1(EPOLL_CLOEXEC);
+    worker->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    worker->wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (worker->epoll < 0 || worker->timer < 0 || worker->wake < 0) fail("cannot set up worker", "epoll");
+    if (timerfd_settime(worker->timer, 0, &period, NULL) != 0) fail("cannot set up worker", "timerfd_settime");
+
+    event.events = EPOLLIN;
+    event.data.ptr = &timerTag;
+    if (epoll_ctl(worker->epoll, EPOLL_CTL_ADD, worker->timer, &event) != 0) fail("cannot set up worker", "timer");
+    event.data.ptr = &wakeTag;
+    if (epoll_ctl(worker->epoll, EPOLL_CTL_ADD, worker->wake, &event) != 0) fail("cannot set up worker", "eventfd");
+
+    if (pthread_create(&worker->thread, NULL, runWorker, worker) != 0) fail("cannot start worker", "pthread_create");
+}
+
+//------------------------------ handOff ------------------------------
+// Purpose: Queue a new session's sockets for the next worker in turn.
+// Parameters:
+//   fds - The bots' sockets, fds[1] AI_PLAYS for a game against the C AI.
+// Preconditions: The workers are running
+// Postconditions: A worker has been woken to start the session, or the sockets
+//                 are closed if its queue is full
+static void handOff(const int fds[2]) {
+    static int next;
+    Worker *worker = &workers[next];
+    uint64_t one = 1;
+    int queued = 0;
+
+    next = (next + 1) % workerCount;
+
+    pthread_mutex_lock(&worker->lock);
+    if (worker->handoffHead - worker->handoffTail < HANDOFF_SLOTS) {
+        worker->handoff[worker->handoffHead % HANDOFF_SLOTS].fds[0] = fds[0];
+        worker->handoff[worker->handoffHead % HANDOFF_SLOTS].fds[1] = fds[1];
+        worker->handoffHead++;
+        queued = 1;
+    }
+    pthread_mutex_unlock(&worker->lock);
+
+    if (queued) {
+        if (write(worker->wake, &one, sizeof(one)) != sizeof(one)) fail("cannot wake worker", "eventfd");
+    } else {
+        close(fds[0]);
+        if (fds[1] >= 0) close(fds[1]);
+    }
+}
+
+//------------------------------ runLoadBots ------------------------------
+// Purpose: The --load bots: connect to the server and answer every
+//          observation with a random move, from one thread.
+// Parameters:
+//   argument - Number of bots, as an intptr_t.
+// Preconditions: The server is listening
+// Postconditions: Returns once stopping is set
+static void *runLoadBots(void *argument) {
+    int bots = (int)(intptr_t)argument;
+    static const uint8_t moves[] = {TANK_FORWARD, TANK_FORWARD, TANK_FORWARD, TANK_BACKWARD,
+                                    TANK_LEFT_TURN, TANK_RIGHT_TURN, TANK_FIRE, TANK_NOTHING};
+    struct sockaddr_un address;
+    struct epoll_event event, events[EPOLL_BATCH];
+    uint8_t observation[OBSERVATION_BYTES];
+    uint32_t random = 2463534242u;
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    ssize_t length;
+    int count, n, fd;
+
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+
+    for (n = 0; n < bots && !atomic_load(&stopping); n++) {
+        //a blocking connect waits for the server to catch up with its backlog
+        fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (fd < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) fail("load bot cannot connect", socketPath);
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event) != 0) fail("load bot cannot connect", "epoll");
+    }
+
+    while (!atomic_load(&stopping)) {
+        count = epoll_wait(epoll, events, EPOLL_BATCH, 100);
+        for (n = 0; n < count; n++) {
+            fd = events[n].data.fd;
+            length = recv(fd, observation, sizeof(observation), MSG_DONTWAIT);
+            if (length < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+            if (length <= 0) {
+                epoll_ctl(epoll, EPOLL_CTL_DEL, fd, NULL);
+                close(fd);
+                continue;
+            }
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            send(fd, &moves[random % sizeof(moves)], 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+        }
+    }
+    return NULL;
+}
+
+//------------------------------ raiseFileLimit ------------------------------
+// Purpose: Let the process open as many sockets as the system allows, two per
+//          session and two more per --load session.
+// Parameters: None
+// Preconditions: None
+// Postconditions: The soft descriptor limit is the hard limit
+static void raiseFileLimit(void) {
+    struct rlimit limit;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+//------------------------------ onSignal ------------------------------
+// Purpose: Stop the server on SIGINT or SIGTERM.
+// Parameters:
+//   signal - The signal.
+// Preconditions: None
+// Postconditions: stopping is set
+static void onSignal(int signal) {
+    (void)signal;
+    atomic_store(&stopping, 1);
+}
+
+//------------------------------ usage ------------------------------
+// Purpose: Print how to run the server and exit.
+// Parameters: None
+// Preconditions: None
+// Postconditions: Does not return
+static void usage(void) {
+    fprintf(stderr, "usage: matchserver [--socket path] [--workers n] [--sessions n] [--vs-ai] [--load n] [--seconds n]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int sessions = 4096;
+    int load = 0;
+    int seconds = 0;
+    int listener, epoll, count, n, b, fd;
+    int waiting = -1;                       //a bot waiting for an opponent
+    uint64_t started;
+    uint32_t histogram[HISTOGRAM_BUCKETS];
+    uint64_t ticks = 0, missed = 0, maxNs = 0, games = 0, dropped = 0, rejected = 0;
+    struct sockaddr_un address;
+    struct epoll_event event, events[EPOLL_BATCH];
+    struct sigaction action;
+    pthread_t loadThread;
+
+    workerCount = cores > 0 ? (int)cores : 1;
+    for (n = 1; n < argc; n++) {
+        if (strcmp(argv[n], "--socket") == 0 && n + 1 < argc) socketPath = argv[++n];
+        else if (strcmp(argv[n], "--workers") == 0 && n + 1 < argc) workerCount = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--sessions") == 0 && n + 1 < argc) sessions = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--load") == 0 && n + 1 < argc) load = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--seconds") == 0 && n + 1 < argc) seconds = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--vs-ai") == 0) vsAI = 1;
+        else usage();
+    }
+    if (workerCount < 1 || workerCount > MAX_WORKERS || sessions < 1 || load < 0 || seconds < 0) usage();
+    if (load > sessions) sessions = load;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSignal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    raiseFileLimit();
+
+    //the whole session pool, split evenly over the workers
+    pool = calloc((size_t)sessions, sizeof(Session));
+    if (pool == NULL) fail("cannot allocate sessions", "calloc");
+    for (n = 0; n < workerCount; n++) {
+        int first = (int)((long)sessions * n / workerCount);
+        int last = (int)((long)sessions * (n + 1) / workerCount);
+
+        workers[n].index = n;
+        startWorker(&workers[n], pool + first, last - first);
+    }
+
+    listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listener < 0) fail("cannot listen", "socket");
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, socketPath, sizeof(address.sun_path) - 1);
+    unlink(socketPath);
+    if (bind(listener, (struct sockaddr *)&address, sizeof(address)) != 0) fail("cannot listen", socketPath);
+    if (listen(listener, SOMAXCONN) != 0) fail("cannot listen", socketPath);
+
+    epoll = epoll_create1(EPOLL_CLOEXEC);
+    event.events = EPOLLIN;
+    event.data.fd = listener;
+    if (epoll < 0 || epoll_ctl(epoll, EPOLL_CTL_ADD, listener, &event) != 0) fail("cannot listen", "epoll");
+
+    printf("matchserver: %s, %d workers, %d sessions%s\n", socketPath, workerCount, sessions, vsAI ? ", bots play the C AI" : "");
+    fflush(stdout);
+
+    if (load > 0 && pthread_create(&loadThread, NULL, runLoadBots, (void *)(intptr_t)(vsAI ? load : load * 2)) != 0) {
+        fail("cannot start load bots", "pthread_create");
+    }
+
+    started = nowNs();
+    while (!atomic_load(&stopping)) {
+        if (seconds > 0 && nowNs() - started >= (uint64_t)seconds * 1000000000u) break;
+
+        count = epoll_wait(epoll, events, EPOLL_BATCH, 100);
+        if (count <= 0) continue;
+
+        while ((fd = accept4(listener, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+            int fds[2];
+
+            if (vsAI) {
+                fds[0] = fd;
+                fds[1] = AI_PLAYS;
+            } else if (waiting < 0) {
+                waiting = fd;
+                continue;
+            } else {
+                fds[0] = waiting;
+                fds[1] = fd;
+                waiting = -1;
+            }
+            handOff(fds);
+        }
+    }
+    atomic_store(&stopping, 1);
+
+    for (n = 0; n < workerCount; n++) pthread_join(workers[n].thread, NULL);
+    if (load > 0) pthread_join(loadThread, NULL);
+    if (waiting >= 0) close(waiting);
+    close(listener);
+    unlink(socketPath);
+
+    memset(histogram, 0, sizeof(histogram));
+    for (n = 0; n < workerCount; n++) {
+        for (b = 0; b < HISTOGRAM_BUCKETS; b++) histogram[b] += workers[n].total[b];
+        ticks += workers[n].ticks;
+        missed += workers[n].missed;
+        games += workers[n].games;
+        dropped += workers[n].dropped;
+        rejected += workers[n].rejected;
+        if (workers[n].maxNs > maxNs) maxNs = workers[n].maxNs;
+    }
+    printf("%llu ticks, p50 %.2f p90 %.2f p99 %.2f p99.9 %.2f max %.2f ms, %llu missed ticks\n",
+           (unsigned long long)ticks, percentileMs(histogram, 0.50), percentileMs(histogram, 0.90),
+           percentileMs(histogram, 0.99), percentileMs(histogram, 0.999), maxNs / 1e6, (unsigned long long)missed);
+    printf("%llu games played, %llu observations dropped, %llu sessions turned away\n",
+           (unsigned long long)games, (unsigned long long)dropped, (unsigned long long)rejected);
+
+    free(pool);
+    return 0;
+}
@@ -0,0 +1,118 @@
+#!/usr/bin/env python3
+"""
+    ----------------------------------------------- memcheck.py -------------------------------------------------------
+    Description                 : Cross-checks the memory report of a TankCombat built with -DMEM_DEBUG against the
+                                  ld65 map file, to show how much memory headroom is left before adding features
+    Usage                       : tools/memcheck.py TankCombat.map dump.bin [--base ADDRESS]
+    --------------------------------------------------------------------------------------------------------------------
+    Link with -m TankCombat.map, play until a game over (the report is refreshed at every one), then save a memory
+    dump from the emulator. The dump is raw bytes with the first byte at --base (default 0, a whole 64K dump).
+    Exits with 1 if any check fails.
+"""
+import re
+import struct
+import sys
+
+# memReport fields in TankCombat.c, in order, all 16 bit little endian
+REPORT_FIELDS = ["stackTop", "stackLow", "stackUsed", "heapOrigin", "heapTop", "heapEnd",
+                 "freeBetween", "displayList", "screenGap", "pmUnused"]
+SIGNED_FIELDS = {"screenGap"}
+
+
+def read_map(path):
+    """Return the segment list as {name: (start, end, size)} and the exports as {name: value}."""
+    segments = {}
+    exports = {}
+    section = None
+
+    with open(path) as map_file:
+        for line in map_file:
+            if line.startswith("Segment list"):
+                section = "segments"
+            elif line.startswith("Exports list by name"):
+                section = "exports"
+            elif line.startswith("Exports list by value") or line.startswith("Imports list"):
+                section = None
+            elif section == "segments":
+                match = re.match(r"(\w+)\s+([0-9A-F]{6})\s+([0-9A-F]{6})\s+([0-9A-F]{6})", line)
+                if match:
+                    segments[match.group(1)] = tuple(int(group, 16) for group in match.groups()[1:])
+            elif section == "exports":
+                for name, value in re.findall(r"(\S+)\s+([0-9A-F]{6})\s+[A-Z]+", line):
+                    exports[name] = int(value, 16)
+
+    return segments, exports
+
+
+def read_report(dump_path, base, address):
+    """Return memReport from the memory dump as {field: value}."""
+    with open(dump_path, "rb") as dump:
+        dump.seek(address - base)
+        data = dump.read(2 * len(REPORT_FIELDS))
+
+    if len(data) < 2 * len(REPORT_FIELDS):
+        sys.exit("memcheck: memReport is past the end of the dump")
+
+    report = {}
+    for n, field in enumerate(REPORT_FIELDS):
+        report[field] = struct.unpack_from("<h" if field in SIGNED_FIELDS else "<H", data, 2 * n)[0]
+    return report
+
+
+def main():
+    args = sys.argv[1:]
+    base = 0
+    if "--base" in args:
+        at = args.index("--base")
+        base = int(args[at + 1], 0)
+        del args[at:at + 2]
+    if len(args) != 2:
+        sys.exit(__doc__)
+
+    segments, exports = read_map(args[0])
+    if "_memReport" not in exports:
+        sys.exit("memcheck: no _memReport in the map, build with -DMEM_DEBUG")
+    report = read_report(args[1], base, exports["_memReport"])
+    failed = False
+
+    print("Segments")
+    for name, (start, end, size) in sorted(segments.items(), key=lambda item: item[1][0]):
+        print("  %-12s $%04X-$%04X %6d bytes" % (name, start, end, size))
+
+    stack_size = exports.get("__STACKSIZE__")
+    print("\nC stack")
+    print("  top          $%04X" % report["stackTop"])
+    print("  deepest      $%04X, %d bytes used" % (report["stackLow"], report["stackUsed"]))
+    if stack_size is not None:
+        print("  reserved     %d bytes (__STACKSIZE__), %d left" % (stack_size, stack_size - report["stackUsed"]))
+        if report["stackUsed"] > stack_size:
+            print("  FAIL: the stack has grown past __STACKSIZE__ into the heap's space")
+            failed = True
+
+    print("\nHeap")
+    print("  origin       $%04X" % report["heapOrigin"])
+    print("  top          $%04X, %d bytes used" % (report["heapTop"], report["heapTop"] - report["heapOrigin"]))
+    print("  end          $%04X, %d bytes free" % (report["heapEnd"], report["heapEnd"] - report["heapTop"]))
+    if "__BSS_RUN__" in exports and "__BSS_SIZE__" in exports:
+        bss_end = exports["__BSS_RUN__"] + exports["__BSS_SIZE__"]
+        if report["heapOrigin"] != bss_end:
+            print("  FAIL: the heap starts at $%04X but BSS ends at $%04X in the map" % (report["heapOrigin"], bss_end))
+            failed = True
+
+    print("\nFree RAM")
+    print("  heap to stack  %6d bytes never written" % report["freeBetween"])
+    print("  stack to DL    %6d bytes (display list at $%04X)" % (report["screenGap"], report["displayList"]))
+    print("  pmMemory       %6d bytes ANTIC does not fetch" % report["pmUnused"])
+    if report["screenGap"] < 0:
+        print("  FAIL: the C stack starts above the display list and screen memory; reserve memory for the")
+        print("        screen with -Wl -D__RESERVED_MEMORY__=<bytes>")
+        failed = True
+    if report["heapOrigin"] > report["displayList"]:
+        print("  FAIL: the program's RAM ends at $%04X, past the display list" % report["heapOrigin"])
+        failed = True
+
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
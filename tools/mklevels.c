@@ -0,0 +1,315 @@
+/*
+    ----------------------------------------------- mklevels.c --------------------------------------------------------
+    Description                 : Turns the arenas in assets/levels.txt into the level disk image for -DLEVELS
+    Compiler                    : Any C99 compiler
+    Build                       : cc -O2 -o mklevels tools/mklevels.c
+    --------------------------------------------------------------------------------------------------------------------
+    Usage:
+        mklevels assets/levels.txt levels.atr
+
+    Each level in the artwork is a LEVEL line, its wall color, the two tanks' start positions and the
+    22 rows of the bit map, 40 pixels each, X for a wall and . for open floor:
+        LEVEL Pillars
+        COLOR 26
+        TANK0 80 9 EAST          (board row, board column, heading)
+        TANK1 80 142 WEST
+        XXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXXX
+        X......................................X
+        ...
+
+    The disk is single density, 720 sectors of 128 bytes. Sector 1 is the directory ("TKLV", version,
+    number of levels) and each level takes LEVEL_SECTORS sectors from sector 2 on, laid out like the
+    Level struct in TankCombat.c. The AI's opening, how many moves it drives forward before attacking,
+    is worked out here so the game does not have to: it is how far the AI tank gets from its start
+    before it would run into a wall, at most the built in AI_OPENING.
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//must match TankCombat.c
+#define HEADINGS            16
+#define PLAYFIELD_LEFT      48
+#define PLAYFIELD_TOP       48
+#define PLAYFIELD_WIDTH     10
+#define PLAYFIELD_ROWS      22
+#define PLAYFIELD_PIXELS    (PLAYFIELD_WIDTH * 4)
+#define BOARD_TOP           55
+#define BOARD_LEFT          (PLAYFIELD_LEFT + 4)
+#define TANK_HALF           4
+#define AI_OPENING          72
+#define WALL_PIXEL          2              //bit map color of the walls, as in the built in arena
+#define SECTOR_SIZE         128
+#define LEVEL_VERSION       1
+#define LEVEL_FIRST_SECTOR  2
+#define LEVEL_SECTORS       2
+#define MAX_LEVELS          ((DISK_SECTORS - LEVEL_FIRST_SECTOR + 1) / LEVEL_SECTORS)
+#define DISK_SECTORS        720
+
+//headings in the order of the direction numbers in TankCombat.c
+static const char *headingNames[HEADINGS] = {
+    "NORTH", "NORTH_15", "NORTH_EAST", "NORTH_60",
+    "EAST", "EAST_15", "EAST_SOUTH", "EAST_60",
+    "SOUTH", "SOUTH_15", "SOUTH_WEST", "SOUTH_60",
+    "WEST", "WEST_15", "WEST_NORTH", "WEST_60"
+};
+
+//row, column step of one move in whole pixels, deltas in TankCombat.c
+static const int deltas[HEADINGS][2] = {
+    {-1, 0}, {-2, 1}, {-1, 1}, {-1, 2}, {0, 1}, {1, 2}, {1, 1}, {2, 1},
+    {1, 0}, {2, -1}, {1, -1}, {1, -2}, {0, -1}, {-1, -2}, {-1, -1}, {-2, -1}
+};
+
+//One arena
+typedef struct {
+    char name[128];
+    int color;
+    int tankRow[2];
+    int tankColumn[2];
+    int tankDirection[2];
+    unsigned char walls[PLAYFIELD_ROWS][PLAYFIELD_PIXELS];     //1 = wall
+    int aiOpening;
+} Arena;
+
+static Arena arenas[MAX_LEVELS];
+static int arenaCount;
+static const char *sourcePath;
+static int lineNumber;
+
+//------------------------------ fail ------------------------------
+// Purpose: Print an error, with the line of the artwork it was found on, and exit.
+// Parameters:
+//   message - What went wrong.
+//   detail - The level or text it went wrong with.
+// Preconditions: None
+// Postconditions: Does not return
+static void fail(const char *message, const char *detail) {
+    fprintf(stderr, "mklevels: %s:%d: %s: %s\n", sourcePath, lineNumber, message, detail);
+    exit(1);
+}
+
+//------------------------------ findHeading ------------------------------
+// Purpose: Look up a heading by name.
+// Parameters:
+//   name - The heading name, e.g. NORTH_EAST.
+// Preconditions: None
+// Postconditions: Returns the direction number, exits if there is no such heading
+static int findHeading(const char *name) {
+    int h;
+
+    for (h = 0; h < HEADINGS; h++) {
+        if (strcmp(headingNames[h], name) == 0) return h;
+    }
+    fail("unknown heading", name);
+    return -1;
+}
+
+//------------------------------ readLine ------------------------------
+// Purpose: Read the next line of the artwork that is not blank or a comment.
+// Parameters:
+//   file - The artwork.
+//   line - Buffer for the line, with the line ending removed.
+//   size - Size of the buffer.
+// Preconditions: None
+// Postconditions: Returns 0 at the end of the file
+static int readLine(FILE *file, char *line, int size) {
+    while (fgets(line, size, file) != NULL) {
+        lineNumber++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0' && line[0] != '#') return 1;
+    }
+    return 0;
+}
+
+//------------------------------ tankHitsWall ------------------------------
+// Purpose: Check whether a tank's 8x8 sprite would overlap a wall, or leave the bit map.
+// Parameters:
+//   arena - The arena.
+//   row - Board row of the middle of the tank.
+//   column - Board column of the middle of the tank.
+// Preconditions: None
+// Postconditions: Returns 1 if any pixel of the sprite is on a wall
+static int tankHitsWall(const Arena *arena, int row, int column) {
+    int r, c;
+
+    for (r = row - TANK_HALF; r < row + TANK_HALF; r++) {
+        for (c = column - TANK_HALF; c < column + TANK_HALF; c++) {
+            int line = (r + BOARD_TOP - PLAYFIELD_TOP) >> 3;
+            int pixel = (c + BOARD_LEFT - PLAYFIELD_LEFT) >> 2;
+
+            if (line < 0 || line >= PLAYFIELD_ROWS || pixel < 0 || pixel >= PLAYFIELD_PIXELS) return 1;
+            if (arena->walls[line][pixel]) return 1;
+        }
+    }
+    return 0;
+}
+
+//------------------------------ findAIOpening ------------------------------
+// Purpose: Work out how many moves the AI tank can drive forward from its start.
+// Parameters:
+//   arena - The arena, with the AI tank's start filled in.
+// Preconditions: The AI tank must start clear of the walls
+// Postconditions: arena->aiOpening is set, at most AI_OPENING
+static void findAIOpening(Arena *arena) {
+    int row = arena->tankRow[1];
+    int column = arena->tankColumn[1];
+    int direction = arena->tankDirection[1];
+    int moves;
+
+    for (moves = 0; moves < AI_OPENING; moves++) {
+        row += deltas[direction][0];
+        column += deltas[direction][1];
+        if (tankHitsWall(arena, row, column)) break;
+    }
+    arena->aiOpening = moves;
+}
+
+//------------------------------ readTank ------------------------------
+// Purpose: Read a TANK0 or TANK1 line.
+// Parameters:
+//   arena - The arena being read.
+//   line - The line.
+// Preconditions: None
+// Postconditions: The tank's start is set, exits if the line is not a tank start
+static void readTank(Arena *arena, const char *line) {
+    char heading[16];
+    int tank, row, column;
+
+    if (sscanf(line, "TANK%d %d %d %15s", &tank, &row, &column, heading) != 4 || tank < 0 || tank > 1) {
+        fail("expected TANK0 or TANK1 row column heading", line);
+    }
+    if (row < TANK_HALF || row > 255 || column < TANK_HALF || column > 255) fail("start is off the board", line);
+    arena->tankRow[tank] = row;
+    arena->tankColumn[tank] = column;
+    arena->tankDirection[tank] = findHeading(heading);
+}
+
+//------------------------------ readArtwork ------------------------------
+// Purpose: Read every level from the artwork file.
+// Parameters:
+//   path - The artwork file.
+// Preconditions: None
+// Postconditions: arenas holds the levels, exits on any mistake in the file
+static void readArtwork(const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[128];
+    int row, column, tank;
+
+    sourcePath = path;
+    if (file == NULL) fail("cannot open", path);
+
+    while (readLine(file, line, sizeof(line))) {
+        Arena *arena = &arenas[arenaCount];
+
+        if (strncmp(line, "LEVEL ", 6) != 0) fail("expected LEVEL", line);
+        if (arenaCount == MAX_LEVELS) fail("too many levels for one disk", line + 6);
+        snprintf(arena->name, sizeof(arena->name), "%s", line + 6);
+
+        if (!readLine(file, line, sizeof(line)) || sscanf(line, "COLOR %d", &arena->color) != 1) {
+            fail("expected COLOR", arena->name);
+        }
+        if (arena->color < 0 || arena->color > 255) fail("color must be 0 - 255", line);
+        for (tank = 0; tank < 2; tank++) {
+            if (!readLine(file, line, sizeof(line))) fail("level cut short", arena->name);
+            readTank(arena, line);
+        }
+
+        for (row = 0; row < PLAYFIELD_ROWS; row++) {
+            if (!readLine(file, line, sizeof(line))) fail("level cut short", arena->name);
+            if ((int)strlen(line) != PLAYFIELD_PIXELS) fail("bit map rows must be 40 pixels", line);
+            for (column = 0; column < PLAYFIELD_PIXELS; column++) {
+                if (line[column] != 'X' && line[column] != '.') fail("pixels must be X or .", line);
+                arena->walls[row][column] = line[column] == 'X';
+            }
+        }
+
+        for (tank = 0; tank < 2; tank++) {
+            if (tankHitsWall(arena, arena->tankRow[tank], arena->tankColumn[tank])) {
+                fail(tank ? "tank 1 starts on a wall" : "tank 0 starts on a wall", arena->name);
+            }
+        }
+        findAIOpening(arena);
+        arenaCount++;
+    }
+    fclose(file);
+
+    if (arenaCount == 0) fail("no levels", path);
+}
+
+//------------------------------ packLevel ------------------------------
+// Purpose: Lay out one arena the way the Level struct in TankCombat.c reads it.
+// Parameters:
+//   arena - The arena.
+//   data - LEVEL_SECTORS sectors to fill.
+// Preconditions: None
+// Postconditions: data holds the level
+static void packLevel(const Arena *arena, unsigned char *data) {
+    int row, pixel, tank;
+
+    for (tank = 0; tank < 2; tank++) {
+        data[tank] = arena->tankRow[tank];
+        data[2 + tank] = arena->tankColumn[tank];
+        data[4 + tank] = arena->tankDirection[tank];
+    }
+    data[6] = arena->color;
+    data[7] = arena->aiOpening;
+
+    //4 pixels per byte, the leftmost pixel in the top 2 bits
+    for (row = 0; row < PLAYFIELD_ROWS; row++) {
+        for (pixel = 0; pixel < PLAYFIELD_PIXELS; pixel++) {
+            if (arena->walls[row][pixel]) {
+                data[8 + row * PLAYFIELD_WIDTH + pixel / 4] |= WALL_PIXEL << (6 - (pixel & 3) * 2);
+            }
+        }
+    }
+}
+
+//------------------------------ writeDisk ------------------------------
+// Purpose: Write the level disk as an ATR image.
+// Parameters:
+//   path - The image to write.
+// Preconditions: arenas must be read
+// Postconditions: The image is written
+static void writeDisk(const char *path) {
+    static unsigned char disk[DISK_SECTORS * SECTOR_SIZE];
+    unsigned long paragraphs = sizeof(disk) / 16;
+    unsigned char header[16] = {0x96, 0x02};
+    FILE *out;
+    int n;
+
+    memcpy(disk, "TKLV", 4);
+    disk[4] = LEVEL_VERSION;
+    disk[5] = arenaCount;
+    for (n = 0; n < arenaCount; n++) {
+        packLevel(&arenas[n], disk + (LEVEL_FIRST_SECTOR - 1 + n * LEVEL_SECTORS) * SECTOR_SIZE);
+    }
+
+    header[2] = paragraphs & 0xFF;
+    header[3] = (paragraphs >> 8) & 0xFF;
+    header[4] = SECTOR_SIZE & 0xFF;
+    header[5] = SECTOR_SIZE >> 8;
+    header[6] = (paragraphs >> 16) & 0xFF;
+
+    out = fopen(path, "wb");
+    if (out == NULL) fail("cannot write", path);
+    if (fwrite(header, sizeof(header), 1, out) != 1 || fwrite(disk, sizeof(disk), 1, out) != 1 || fclose(out) != 0) {
+        fail("cannot write", path);
+    }
+}
+
+int main(int argc, char **argv) {
+    int n;
+
+    if (argc != 3) {
+        fprintf(stderr, "usage: mklevels <artwork> <disk image>\n");
+        return 2;
+    }
+
+    readArtwork(argv[1]);
+    writeDisk(argv[2]);
+    for (n = 0; n < arenaCount; n++) {
+        printf("level %d: %-20s AI opening %d moves\n", n + 1, arenas[n].name, arenas[n].aiOpening);
+    }
+    return 0;
+}
@@ -0,0 +1,429 @@
+/*
+    ----------------------------------------------- mksprites.c -------------------------------------------------------
+    Description                 : Turns the tank artwork in assets/tanks.txt into the tables in tankgfx.h
+    Compiler                    : Any C99 compiler
+    Build                       : cc -O2 -o mksprites tools/mksprites.c -lm
+    --------------------------------------------------------------------------------------------------------------------
+    Usage:
+        mksprites assets/tanks.txt tankgfx.h
+        mksprites --headings 32 assets/tanks.txt tankgfx32.h
+
+    Every heading must be drawn, or made by turning another heading a quarter turn, and every picture
+    must mark its barrel tip, so the generated tables always have all 16 headings, 8 full rows each,
+    in the order they are shown on screen. From the same pictures it works out:
+        tankPics    - one byte per row (or per pair of rows for double line player-missile graphics)
+        tankHull    - the picture with the gaps inside each row filled in, the solid outline a software
+                      collision test would use (only compiled in with -DTANK_HULLS)
+        barrelTips  - horizontal, vertical offset of the barrel tip from the sprite's top left corner
+
+    With --headings 32 it writes the header for -DHEADINGS_32 instead, every 11.25 degrees. The 16 drawn
+    headings are kept as they are for the even headings, and each odd heading is the 45 degree picture
+    11.25 degrees from it turned the rest of the way. The header also carries the tables the game turns
+    with: deltas, the step a tank or shell takes, now true unit vectors rather than the 16 heading pseudo
+    angles, and reflectDirection for -DRICOCHET.
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define HEADINGS            16             //headings drawn in the artwork
+#define MAX_HEADINGS        32
+#define SIZE                8              //tank pictures are SIZE x SIZE pixels
+#define SUBSAMPLES          4              //samples across each pixel when turning a picture by a fraction of a quarter turn
+#define FP_ONE              16             //FP_ONE in TankCombat.c, one pixel in board fixed point
+#ifndef M_PI
+#define M_PI                3.14159265358979323846
+#endif
+
+//headings in the order of the direction numbers in TankCombat.c
+static const char *headingNames[HEADINGS] = {
+    "NORTH", "NORTH_15", "NORTH_EAST", "NORTH_60",
+    "EAST", "EAST_15", "EAST_SOUTH", "EAST_60",
+    "SOUTH", "SOUTH_15", "SOUTH_WEST", "SOUTH_60",
+    "WEST", "WEST_15", "WEST_NORTH", "WEST_60"
+};
+
+//One tank picture
+typedef struct {
+    int defined;
+    unsigned char pixels[SIZE][SIZE];       //[row][column], 1 = set
+    int tipColumn;
+    int tipRow;
+} Picture;
+
+static Picture pictures[HEADINGS];          //the artwork
+static Picture headingPics[MAX_HEADINGS];   //every heading written out, the artwork or turned from it
+static int headings = HEADINGS;
+static const char *sourcePath;
+static int lineNumber;
+
+//------------------------------ fail ------------------------------
+// Purpose: Print an error, with the line of the artwork it was found on, and exit.
+// Parameters:
+//   message - What went wrong.
+//   detail - The heading or text it went wrong with.
+// Preconditions: None
+// Postconditions: Does not return
+static void fail(const char *message, const char *detail) {
+    fprintf(stderr, "mksprites: %s:%d: %s: %s\n", sourcePath, lineNumber, message, detail);
+    exit(1);
+}
+
+//------------------------------ findHeading ------------------------------
+// Purpose: Look up a heading by name.
+// Parameters:
+//   name - The heading name, e.g. NORTH_EAST.
+// Preconditions: None
+// Postconditions: Returns the direction number, exits if there is no such heading
+static int findHeading(const char *name) {
+    int h;
+
+    for (h = 0; h < HEADINGS; h++) {
+        if (strcmp(headingNames[h], name) == 0) return h;
+    }
+    fail("unknown heading", name);
+    return -1;
+}
+
+//------------------------------ readLine ------------------------------
+// Purpose: Read the next line of the artwork that is not blank or a comment.
+// Parameters:
+//   file - The artwork.
+//   line - Buffer for the line, with the line ending removed.
+//   size - Size of the buffer.
+// Preconditions: None
+// Postconditions: Returns 0 at the end of the file
+static int readLine(FILE *file, char *line, int size) {
+    while (fgets(line, size, file) != NULL) {
+        lineNumber++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0' && line[0] != '#') return 1;
+    }
+    return 0;
+}
+
+//------------------------------ rotate ------------------------------
+// Purpose: Turn a picture a quarter turn clockwise, barrel tip included.
+// Parameters:
+//   from - The picture to turn.
+//   to - The turned picture.
+// Preconditions: from must be defined
+// Postconditions: to is defined
+static void rotate(const Picture *from, Picture *to) {
+    int row, column;
+
+    for (row = 0; row < SIZE; row++) {
+        for (column = 0; column < SIZE; column++) {
+            to->pixels[row][column] = from->pixels[SIZE - 1 - column][row];
+        }
+    }
+    to->tipColumn = SIZE - 1 - from->tipRow;
+    to->tipRow = from->tipColumn;
+    to->defined = 1;
+}
+
+//------------------------------ turn ------------------------------
+// Purpose: Turn a picture clockwise by any angle about its middle. Each pixel of the turned picture
+//          is set when at least half of it lands on set pixels of the original.
+// Parameters:
+//   from - The picture to turn.
+//   to - The turned picture.
+//   degrees - How far to turn it, clockwise.
+// Preconditions: from must be defined
+// Postconditions: to is defined, with the barrel tip turned the same way and kept inside the picture
+static void turn(const Picture *from, Picture *to, double degrees) {
+    double s = sin(degrees * M_PI / 180.0);
+    double c = cos(degrees * M_PI / 180.0);
+    double half = SIZE / 2.0;
+    double x, y;
+    int row, column, i, j, covered, fromRow, fromColumn;
+
+    for (row = 0; row < SIZE; row++) {
+        for (column = 0; column < SIZE; column++) {
+            covered = 0;
+            for (i = 0; i < SUBSAMPLES; i++) {
+                for (j = 0; j < SUBSAMPLES; j++) {
+                    //turn the sample point back to where it came from in the original
+                    x = column + (j + 0.5) / SUBSAMPLES - half;
+                    y = row + (i + 0.5) / SUBSAMPLES - half;
+                    fromColumn = (int)floor(x * c + y * s + half);
+                    fromRow = (int)floor(y * c - x * s + half);
+                    if (fromRow >= 0 && fromRow < SIZE && fromColumn >= 0 && fromColumn < SIZE) {
+                        covered += from->pixels[fromRow][fromColumn];
+                    }
+                }
+            }
+            to->pixels[row][column] = covered * 2 >= SUBSAMPLES * SUBSAMPLES;
+        }
+    }
+
+    x = from->tipColumn + 0.5 - half;
+    y = from->tipRow + 0.5 - half;
+    to->tipColumn = (int)floor(x * c - y * s + half);
+    to->tipRow = (int)floor(x * s + y * c + half);
+    if (to->tipColumn < 0) to->tipColumn = 0;
+    if (to->tipColumn > SIZE - 1) to->tipColumn = SIZE - 1;
+    if (to->tipRow < 0) to->tipRow = 0;
+    if (to->tipRow > SIZE - 1) to->tipRow = SIZE - 1;
+    to->pixels[to->tipRow][to->tipColumn] = 1;
+    to->defined = 1;
+}
+
+//------------------------------ readArtwork ------------------------------
+// Purpose: Read every heading's picture from the artwork file.
+// Parameters:
+//   path - The artwork file.
+// Preconditions: None
+// Postconditions: pictures holds all 16 headings, exits on any mistake in the file
+static void readArtwork(const char *path) {
+    FILE *file = fopen(path, "r");
+    char line[128];
+    char name[64];
+    char source[64];
+    char word[16];
+    int h, row, column;
+
+    sourcePath = path;
+    if (file == NULL) fail("cannot open", path);
+
+    while (readLine(file, line, sizeof(line))) {
+        if (sscanf(line, "%63s = %63s %15s", name, source, word) == 3) {
+            int from = findHeading(source);
+
+            h = findHeading(name);
+            if (strcmp(word, "rotated") != 0) fail("expected rotated", word);
+            if (!pictures[from].defined) fail("rotated before it is drawn", source);
+            if (pictures[h].defined) fail("heading given twice", name);
+            rotate(&pictures[from], &pictures[h]);
+            continue;
+        }
+
+        h = findHeading(line);
+        if (pictures[h].defined) fail("heading given twice", line);
+        pictures[h].tipColumn = -1;
+        for (row = 0; row < SIZE; row++) {
+            if (!readLine(file, line, sizeof(line))) fail("picture cut short", headingNames[h]);
+            if ((int)strlen(line) != SIZE) fail("picture rows must be 8 pixels", line);
+            for (column = 0; column < SIZE; column++) {
+                switch (line[column]) {
+                case '.':
+                    break;
+                case '@':
+                    if (pictures[h].tipColumn >= 0) fail("more than one barrel tip", headingNames[h]);
+                    pictures[h].tipColumn = column;
+                    pictures[h].tipRow = row;
+                    pictures[h].pixels[row][column] = 1;
+                    break;
+                case 'X':
+                    pictures[h].pixels[row][column] = 1;
+                    break;
+                default:
+                    fail("pixels must be X, . or @", line);
+                }
+            }
+        }
+        if (pictures[h].tipColumn < 0) fail("no barrel tip", headingNames[h]);
+        pictures[h].defined = 1;
+    }
+    fclose(file);
+
+    for (h = 0; h < HEADINGS; h++) {
+        if (!pictures[h].defined) fail("heading missing", headingNames[h]);
+    }
+}
+
+//------------------------------ rowByte ------------------------------
+// Purpose: Pack rows of a picture into a player memory byte, leftmost pixel in bit 7.
+// Parameters:
+//   picture - The picture.
+//   row - The first row.
+//   rows - How many rows to merge into the byte (1, or 2 for double line resolution).
+//   hull - Fill in everything between the leftmost and rightmost pixel of each row.
+// Preconditions: None
+// Postconditions: Returns the byte
+static unsigned rowByte(const Picture *picture, int row, int rows, int hull) {
+    unsigned byte = 0;
+    int r, column;
+
+    for (r = row; r < row + rows; r++) {
+        int left = SIZE, right = -1;
+
+        for (column = 0; column < SIZE; column++) {
+            if (!picture->pixels[r][column]) continue;
+            if (column < left) left = column;
+            right = column;
+            if (!hull) byte |= 0x80 >> column;
+        }
+        for (column = left; hull && column <= right; column++) byte |= 0x80 >> column;
+    }
+    return byte;
+}
+
+//------------------------------ buildHeadings ------------------------------
+// Purpose: Make the pictures of every heading written out from the artwork.
+// Parameters: None
+// Preconditions: pictures must be read
+// Postconditions: headingPics holds all headings, in direction number order
+static void buildHeadings() {
+    int h, nearest;
+
+    for (h = 0; h < headings; h++) {
+        if (headings == HEADINGS) {
+            headingPics[h] = pictures[h];
+        } else if (h % 2 == 0) {
+            headingPics[h] = pictures[h / 2];
+        } else {
+            //every odd heading is 11.25 degrees from a 45 degree one, which is turned the rest of the way
+            nearest = ((h + 2) / 4) * 4 % MAX_HEADINGS;
+            turn(&pictures[nearest / 2], &headingPics[h], (h - ((h + 2) / 4) * 4) * 360.0 / MAX_HEADINGS);
+        }
+    }
+}
+
+//------------------------------ headingName ------------------------------
+// Purpose: Name a heading for the comments in the generated header.
+// Parameters:
+//   h - The direction number.
+// Preconditions: None
+// Postconditions: Returns the name of a drawn heading, or its angle from NORTH
+static const char *headingName(int h) {
+    static char name[32];
+
+    if (headings == HEADINGS) return headingNames[h];
+    if (h % 2 == 0) return headingNames[h / 2];
+    sprintf(name, "%.2f degrees", h * 360.0 / headings);
+    return name;
+}
+
+//------------------------------ writePics ------------------------------
+// Purpose: Write the tankPics or tankHull table for one player-missile resolution.
+// Parameters:
+//   out - The generated header.
+//   name - The table name.
+//   rows - Picture rows merged into each player memory byte.
+//   hull - Write the filled in outlines instead of the pictures.
+// Preconditions: buildHeadings must have run
+// Postconditions: The table is written
+static void writePics(FILE *out, const char *name, int rows, int hull) {
+    int h, row;
+
+    fprintf(out, "const unsigned char %s[%d][%d] = {\n", name, headings, SIZE / rows);
+    for (h = 0; h < headings; h++) {
+        char bytes[64];
+        int length = 0;
+
+        for (row = 0; row < SIZE; row += rows) {
+            length += sprintf(bytes + length, "%s0x%02X", row ? "," : "", rowByte(&headingPics[h], row, rows, hull));
+        }
+        fprintf(out, "        {%s}%s%*s//%s\n", bytes, h < headings - 1 ? "," : " ", 44 - length, "", headingName(h));
+    }
+    fprintf(out, "};\n");
+}
+
+//------------------------------ writeSteps ------------------------------
+// Purpose: Write deltas and reflectDirection for the 32 heading build.
+// Parameters:
+//   out - The generated header.
+// Preconditions: headings must be MAX_HEADINGS
+// Postconditions: The tables are written
+static void writeSteps(FILE *out) {
+    double angle;
+    int h, wall;
+    //a vertical wall turns the heading back across NORTH, a horizontal one across EAST, a corner turns it half round
+    const int mirror[3] = {0, MAX_HEADINGS / 2, -1};
+
+    fprintf(out, "// row, column step of one move, one board pixel along the true heading\n");
+    fprintf(out, "#if FP_ONE != %d\n#error tankgfx32.h steps are made for FP_ONE %d, run tools/mksprites again\n#endif\n", FP_ONE, FP_ONE);
+    fprintf(out, "const short deltas[%d][2] = {\n", headings);
+    for (h = 0; h < headings; h++) {
+        char step[32];
+        int length;
+
+        angle = h * 2.0 * M_PI / headings;
+        length = sprintf(step, "{%d, %d}", (int)lround(-FP_ONE * cos(angle)), (int)lround(FP_ONE * sin(angle)));
+        fprintf(out, "    %s%s%*s// %s\n", step, h < headings - 1 ? "," : " ", 28 - length, "", headingName(h));
+    }
+    fprintf(out, "};\n\n");
+
+    fprintf(out, "#ifdef RICOCHET\n//direction a shell leaves a wall in, indexed by [wall orientation][direction it came in]\n");
+    fprintf(out, "//vertical walls mirror the column step, horizontal walls mirror the row step and corners send it straight back\n");
+    fprintf(out, "const unsigned char reflectDirection[3][%d] = {\n", headings);
+    for (wall = 0; wall < 3; wall++) {
+        fprintf(out, "    {");
+        for (h = 0; h < headings; h++) {
+            int out_h = mirror[wall] < 0 ? h + headings / 2 : mirror[wall] - h;
+
+            fprintf(out, "%s%d", h ? (h % 16 ? ", " : ",\n     ") : "", (out_h + headings) % headings);
+        }
+        fprintf(out, "}%s    // %s\n", wall < 2 ? "," : " ", wall == 0 ? "WALL_VERTICAL" : wall == 1 ? "WALL_HORIZONTAL" : "WALL_CORNER");
+    }
+    fprintf(out, "};\n#endif\n");
+}
+
+//------------------------------ writeHeader ------------------------------
+// Purpose: Write tankgfx.h, or tankgfx32.h with --headings 32.
+// Parameters:
+//   path - The header to write.
+//   artworkPath - The artwork it was made from, for the header comment.
+// Preconditions: buildHeadings must have run
+// Postconditions: The header is written
+static void writeHeader(const char *path, const char *artworkPath) {
+    FILE *out = fopen(path, "w");
+    const char *base = strrchr(path, '/');
+    int h;
+
+    if (out == NULL) fail("cannot write", path);
+
+    fprintf(out, "/*\n    %s: generated by tools/mksprites from %s, do not edit.\n", base ? base + 1 : path, artworkPath);
+    fprintf(out, "    Pictures are in the order they are shown on screen, so they are copied to player memory as they are.\n");
+    if (headings != HEADINGS) {
+        fprintf(out, "    %d headings for -DHEADINGS_32: the odd headings are turned from the artwork 11.25 degrees away.\n", headings);
+    }
+    fprintf(out, "*/\n\n");
+
+    fprintf(out, "//Tank pictures, one player memory byte per row\n#ifdef PM_DOUBLE_LINE\n");
+    fprintf(out, "//Each PM memory row covers two scanlines, so pairs of picture rows are merged to keep the tanks 8 scanlines tall\n");
+    writePics(out, "tankPics", 2, 0);
+    fprintf(out, "#else\n");
+    writePics(out, "tankPics", 1, 0);
+    fprintf(out, "#endif\n\n");
+
+    fprintf(out, "#ifdef TANK_HULLS\n//Solid tank outlines, the pictures with the gaps inside each row filled in\n#ifdef PM_DOUBLE_LINE\n");
+    writePics(out, "tankHull", 2, 1);
+    fprintf(out, "#else\n");
+    writePics(out, "tankHull", 1, 1);
+    fprintf(out, "#endif\n#endif\n\n");
+
+    fprintf(out, "// horizontal, vertical offset from the tank's sprite corner to the tip of its barrel\n");
+    fprintf(out, "const unsigned char barrelTips[%d][2] = {\n", headings);
+    for (h = 0; h < headings; h++) {
+        fprintf(out, "    {%d, %d}%s             // %s\n", headingPics[h].tipColumn, headingPics[h].tipRow, h < headings - 1 ? "," : " ", headingName(h));
+    }
+    fprintf(out, "};\n");
+
+    if (headings != HEADINGS) {
+        fprintf(out, "\n");
+        writeSteps(out);
+    }
+
+    if (fclose(out) != 0) fail("cannot write", path);
+}
+
+int main(int argc, char **argv) {
+    if (argc == 5 && strcmp(argv[1], "--headings") == 0) {
+        headings = atoi(argv[2]);
+        argv += 2;
+        argc -= 2;
+    }
+    if (argc != 3 || (headings != HEADINGS && headings != MAX_HEADINGS)) {
+        fprintf(stderr, "usage: mksprites [--headings 16|32] <artwork> <header>\n");
+        return 2;
+    }
+
+    readArtwork(argv[1]);
+    buildHeadings();
+    writeHeader(argv[2], argv[1]);
+    return 0;
+}
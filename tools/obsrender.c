@@ -0,0 +1,695 @@
+/*
+    ----------------------------------------------- obsrender.c --------------------------------------------------------
+    Description                 : Renders tankcore games into the picture ANTIC and GTIA put on screen, as pixel
+                                  observations for learning agents
+    Compiler                    : Any C99 compiler on a POSIX system, SSE2 is used where the compiler offers it
+    Build                       : cc -O2 -o obsrender tools/obsrender.c tools/tankcore.c
+    --------------------------------------------------------------------------------------------------------------------
+    Usage:
+        obsrender bench [--downsample d] [--frames n]
+            Render n frames (default 200000) from a batch of games at different stages and print the frames
+            per second.
+        obsrender check [--frames n]
+            Render n random games, arenas and colors with the fast renderer and the reference renderer at
+            every downsampling, and check they agree byte for byte.
+        obsrender ppm <palette> <picture.ppm> [--seed n] [--frames n] [--downsample d]
+            Play the C AI against itself for n frames and write the screen as a PPM picture through an
+            emulator's 768 byte palette file, to hold against the emulator's own screenshot.
+
+    A frame is the bit map area of the screen, SCREEN_WIDTH color clocks by SCREEN_HEIGHT scanlines from
+    horizontal position TANK_PLAYFIELD_LEFT and scanline TANK_PLAYFIELD_TOP, one byte per color clock
+    holding the GTIA color (hue in the top 4 bits, luminance in the next 3, the bottom bit always 0).
+    It shows the game as drawn by its last tankStep:
+        - the ANTIC mode 8 bit map, 4 color clocks per pixel, in the background color or COLOR0 - COLOR2
+        - the tanks, players 0 and 1, tankPics rows on single line scanlines from their HPOS
+        - the shells, missiles 0 - 3, one color clock at their HPOS on one scanline, in their player's color
+    Colors are the shadow registers from 0x2C0: PCOLR0 - PCOLR3, then COLOR0 - COLOR4 (the last is the
+    background). The defaults are what TankCombat.c and the OS leave in them.
+
+    Priority is the default PRIOR of 0: player 0 and missile 0 over player 1 and missile 1, over missile 2,
+    over missile 3. Where a player or missile lies over a wall, GTIA shows the two colors ORed together.
+
+    With --downsample 2 or 4, each output pixel stands for a block of d x d color clocks and takes the
+    pixel in it that matters most: a shell or tank over a wall, a wall over the background, so a one
+    clock shell is never lost. Between pixels of the same kind the higher color value wins.
+
+    The fast renderer works out each bit map row once, expanding the 2 bit pixels of 16 bytes at a time
+    with SSE2 compares, copies it to its 8 scanlines and blends each player row in as an 8 byte expansion
+    of its bits, and downsamples 2x2 blocks 8 at a time. The reference renderer works every color clock out
+    on its own, from the positions, as GTIA does, and downsamples a block at a time; check keeps the two in
+    step.
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "tankcore.h"
+
+#define SCREEN_WIDTH        (TANK_PLAYFIELD_WIDTH * 16)     //color clocks
+#define SCREEN_HEIGHT       (TANK_PLAYFIELD_ROWS * 8)       //scanlines
+#define SCREEN_BYTES        (SCREEN_WIDTH * SCREEN_HEIGHT)
+#define BATCH_GAMES         1024
+#define FP_INT(v)           ((v) >> TANK_FP_SHIFT)
+
+//layers, in the order a downsampled block picks them
+#define LAYER_BACKGROUND    0
+#define LAYER_WALL          1
+#define LAYER_M3            2
+#define LAYER_M2            3
+#define LAYER_P1            4              //player 1 and missile 1
+#define LAYER_P0            5              //player 0 and missile 0
+
+//Color shadow registers, 0x2C0 - 0x2C8
+typedef struct {
+    uint8_t pcolr[4];                       //PCOLR0 - PCOLR3, players and missiles
+    uint8_t color[5];                       //COLOR0 - COLOR3 playfield, COLOR4 background
+} ScreenColors;
+
+//Everything a render needs besides the game, so renders allocate nothing
+typedef struct {
+    ScreenColors colors;
+    int downsample;                         //1, 2 or 4
+    uint8_t *target;                        //where the full resolution frame is drawn: out, or frame to downsample
+    uint8_t frame[SCREEN_BYTES];
+    uint8_t layer[SCREEN_BYTES];            //what each pixel of frame shows, only kept for downsampling
+    uint16_t keys[SCREEN_BYTES / 4];        //layer and color of each downsampled pixel
+    uint8_t pfRow[SCREEN_WIDTH];            //the bit map row being drawn
+    uint8_t pfMask[SCREEN_WIDTH];           //0xFF where it has a wall
+    uint8_t pfLayer[SCREEN_WIDTH];          //LAYER_WALL where it has a wall
+} Renderer;
+
+static const ScreenColors defaultColors = {
+    {70, 40, 70, 40},                       //TANK0_COLOR and TANK1_COLOR, for the tanks and their shells
+    {0x28, 26, 0x94, 0x46, 0x00}            //OS defaults, and COLOR1 as createBitMap sets it
+};
+
+//------------------------------ fail ------------------------------
+// Purpose: Print an error and exit.
+// Parameters:
+//   message - What went wrong.
+//   detail - The file or value it went wrong with.
+// Preconditions: None
+// Postconditions: Does not return
+static void fail(const char *message, const char *detail) {
+    fprintf(stderr, "obsrender: %s: %s\n", message, detail);
+    exit(1);
+}
+
+//------------------------------ initRenderer ------------------------------
+// Purpose: Set up a renderer.
+// Parameters:
+//   renderer - The renderer.
+//   colors - The color registers.
+//   downsample - 1, 2 or 4.
+// Preconditions: None
+// Postconditions: The renderer is ready; GTIA ignores the bottom bit of each color
+static void initRenderer(Renderer *renderer, const ScreenColors *colors, int downsample) {
+    int n;
+
+    renderer->downsample = downsample;
+    for (n = 0; n < 4; n++) renderer->colors.pcolr[n] = colors->pcolr[n] & 0xFE;
+    for (n = 0; n < 5; n++) renderer->colors.color[n] = colors->color[n] & 0xFE;
+}
+
+//------------------------------ outputBytes ------------------------------
+// Purpose: The size of a rendered frame.
+// Parameters:
+//   downsample - 1, 2 or 4.
+// Preconditions: None
+// Postconditions: Returns the bytes in a frame
+static int outputBytes(int downsample) {
+    return (SCREEN_WIDTH / downsample) * (SCREEN_HEIGHT / downsample);
+}
+
+//------------------------------ expandPlayfieldRow ------------------------------
+// Purpose: Turn one bit map row into colors and a wall mask, 4 color clocks a pixel.
+// Parameters:
+//   renderer - The renderer, whose pfRow, pfMask and pfLayer are filled in.
+//   bytes - TANK_PLAYFIELD_WIDTH bit map bytes.
+// Preconditions: None
+// Postconditions: pfRow, pfMask and pfLayer describe the row
+static void expandPlayfieldRow(Renderer *renderer, const uint8_t *bytes) {
+    const uint8_t *color = renderer->colors.color;
+    int n;
+
+#ifdef __SSE2__
+    //each byte is 4 pixels, 2 bits each with the leftmost on top: pick each pixel's bits out for its 4 clocks
+    const __m128i select = _mm_setr_epi8((char)0xC0, (char)0xC0, (char)0xC0, (char)0xC0, 0x30, 0x30, 0x30, 0x30,
+                                         0x0C, 0x0C, 0x0C, 0x0C, 0x03, 0x03, 0x03, 0x03);
+    const __m128i one = _mm_setr_epi8(0x40, 0x40, 0x40, 0x40, 0x10, 0x10, 0x10, 0x10,
+                                      0x04, 0x04, 0x04, 0x04, 0x01, 0x01, 0x01, 0x01);
+    const __m128i two = _mm_add_epi8(one, one);
+    const __m128i pf0 = _mm_set1_epi8((char)color[0]);
+    const __m128i pf1 = _mm_set1_epi8((char)color[1]);
+    const __m128i pf2 = _mm_set1_epi8((char)color[2]);
+    const __m128i background = _mm_set1_epi8((char)color[4]);
+
+    for (n = 0; n < TANK_PLAYFIELD_WIDTH; n++) {
+        __m128i pixels = _mm_and_si128(_mm_set1_epi8((char)bytes[n]), select);
+        __m128i is0 = _mm_cmpeq_epi8(pixels, one);
+        __m128i is1 = _mm_cmpeq_epi8(pixels, two);
+        __m128i is2 = _mm_cmpeq_epi8(pixels, select);
+        __m128i wall = _mm_or_si128(is0, _mm_or_si128(is1, is2));
+        __m128i colors = _mm_or_si128(_mm_or_si128(_mm_and_si128(is0, pf0), _mm_and_si128(is1, pf1)),
+                                      _mm_or_si128(_mm_and_si128(is2, pf2), _mm_andnot_si128(wall, background)));
+
+        _mm_storeu_si128((__m128i *)(renderer->pfRow + n * 16), colors);
+        _mm_storeu_si128((__m128i *)(renderer->pfMask + n * 16), wall);
+        _mm_storeu_si128((__m128i *)(renderer->pfLayer + n * 16), _mm_and_si128(wall, _mm_set1_epi8(LAYER_WALL)));
+    }
+#else
+    for (n = 0; n < TANK_PLAYFIELD_WIDTH * 4; n++) {
+        int pixel = (bytes[n >> 2] >> (6 - 2 * (n & 3))) & 3;
+
+        memset(renderer->pfRow + n * 4, pixel ? color[pixel - 1] : color[4], 4);
+        memset(renderer->pfMask + n * 4, pixel ? 0xFF : 0x00, 4);
+        memset(renderer->pfLayer + n * 4, pixel ? LAYER_WALL : LAYER_BACKGROUND, 4);
+    }
+#endif
+}
+
+
+//------------------------------ blendPlayerByte ------------------------------
+// Purpose: Draw 8 color clocks of a player into a scanline, ORing its color
+//          with any wall under it.
+// Parameters:
+//   renderer - The renderer.
+//   row - Scanline, in the frame.
+//   x - Color clock of the byte's top bit, in the frame, 0 - SCREEN_WIDTH - 8.
+//   bits - The player byte.
+//   color - The player's color.
+//   layer - Its layer.
+// Preconditions: pfRow and pfMask hold the scanline's bit map row
+// Postconditions: The player's pixels are drawn
+static void blendPlayerByte(Renderer *renderer, int row, int x, uint8_t bits, uint8_t color, uint8_t layer) {
+    uint8_t *out = renderer->target + row * SCREEN_WIDTH + x;
+    uint8_t *layers = renderer->layer + row * SCREEN_WIDTH + x;
+
+#ifdef __SSE2__
+    //bit 7 lands in the first byte: and each byte with its own bit and compare, the top 8 bytes never match
+    const __m128i select = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, 0, 0, 0, 0, 0, 0, 0, -1);
+    __m128i mask = _mm_cmpeq_epi8(_mm_and_si128(_mm_set1_epi8((char)bits), select), select);
+    __m128i wall = _mm_and_si128(_mm_loadl_epi64((const __m128i *)(renderer->pfRow + x)),
+                                 _mm_loadl_epi64((const __m128i *)(renderer->pfMask + x)));
+    __m128i drawn = _mm_or_si128(_mm_set1_epi8((char)color), wall);
+
+    _mm_storel_epi64((__m128i *)out, _mm_or_si128(_mm_and_si128(mask, drawn),
+                                                  _mm_andnot_si128(mask, _mm_loadl_epi64((const __m128i *)out))));
+    if (renderer->downsample > 1) {
+        _mm_storel_epi64((__m128i *)layers, _mm_or_si128(_mm_and_si128(mask, _mm_set1_epi8((char)layer)),
+                                                         _mm_andnot_si128(mask, _mm_loadl_epi64((const __m128i *)layers))));
+    }
+#else
+    int n;
+
+    for (n = 0; n < 8; n++) {
+        if (bits & (0x80 >> n)) {
+            out[n] = color | (renderer->pfRow[x + n] & renderer->pfMask[x + n]);
+            layers[n] = layer;
+        }
+    }
+#endif
+}
+
+//------------------------------ drawPixel ------------------------------
+// Purpose: Draw one color clock of a player or missile, clipped to the frame.
+// Parameters:
+//   renderer - The renderer.
+//   row - Scanline, in the frame.
+//   x - Color clock, in the frame.
+//   color - Its color.
+//   layer - Its layer.
+// Preconditions: pfRow and pfMask hold the scanline's bit map row
+// Postconditions: The pixel is drawn if it is in the frame
+static void drawPixel(Renderer *renderer, int row, int x, uint8_t color, uint8_t layer) {
+    if (x < 0 || x >= SCREEN_WIDTH || row < 0 || row >= SCREEN_HEIGHT) return;
+    renderer->target[row * SCREEN_WIDTH + x] = color | (renderer->pfRow[x] & renderer->pfMask[x]);
+    renderer->layer[row * SCREEN_WIDTH + x] = layer;
+}
+
+//------------------------------ downsampleReference ------------------------------
+// Purpose: Shrink the full resolution frame a block at a time, each block
+//          taking its pixel on the highest layer, the highest color on a tie.
+// Parameters:
+//   renderer - The renderer.
+//   out - outputBytes(renderer->downsample) bytes.
+// Preconditions: frame and layer hold a render
+// Postconditions: out holds the downsampled frame
+static void downsampleReference(const Renderer *renderer, uint8_t *out) {
+    int d = renderer->downsample;
+    int x, y, bx, by;
+
+    for (y = 0; y < SCREEN_HEIGHT; y += d) {
+        for (x = 0; x < SCREEN_WIDTH; x += d) {
+            unsigned best = 0;
+
+            for (by = 0; by < d; by++) {
+                for (bx = 0; bx < d; bx++) {
+                    int at = (y + by) * SCREEN_WIDTH + x + bx;
+                    unsigned key = (unsigned)renderer->layer[at] << 8 | renderer->frame[at];
+
+                    if (key > best) best = key;
+                }
+            }
+            *out++ = (uint8_t)best;
+        }
+    }
+}
+
+//------------------------------ downsampleFrame ------------------------------
+// Purpose: downsampleReference, halving the frame each way with SSE2 once for
+//          each factor of 2. Each pixel's layer and color make one 16 bit key,
+//          so a block's pixel is the biggest key in it.
+// Parameters:
+//   renderer - The renderer, its keys are used.
+//   out - outputBytes(renderer->downsample) bytes.
+// Preconditions: frame and layer hold a render
+// Postconditions: out holds the downsampled frame
+static void downsampleFrame(Renderer *renderer, uint8_t *out) {
+#ifdef __SSE2__
+    const __m128i low = _mm_set1_epi32(0xFFFF);
+    uint16_t *keys = renderer->keys;
+    int width = SCREEN_WIDTH / 2;
+    int height = SCREEN_HEIGHT / 2;
+    int x, y, n;
+
+    //frame and layer bytes to keys, 2x2 blocks at a time: 16 bytes of two rows give 8 keys
+    for (y = 0; y < height; y++) {
+        const uint8_t *frame = renderer->frame + 2 * y * SCREEN_WIDTH;
+        const uint8_t *layer = renderer->layer + 2 * y * SCREEN_WIDTH;
+
+        for (x = 0; x < SCREEN_WIDTH; x += 16) {
+            __m128i top = _mm_loadu_si128((const __m128i *)(frame + x));
+            __m128i topLayer = _mm_loadu_si128((const __m128i *)(layer + x));
+            __m128i bottom = _mm_loadu_si128((const __m128i *)(frame + SCREEN_WIDTH + x));
+            __m128i bottomLayer = _mm_loadu_si128((const __m128i *)(layer + SCREEN_WIDTH + x));
+            __m128i left = _mm_max_epi16(_mm_unpacklo_epi8(top, topLayer), _mm_unpacklo_epi8(bottom, bottomLayer));
+            __m128i right = _mm_max_epi16(_mm_unpackhi_epi8(top, topLayer), _mm_unpackhi_epi8(bottom, bottomLayer));
+
+            left = _mm_and_si128(_mm_max_epi16(left, _mm_srli_epi32(left, 16)), low);
+            right = _mm_and_si128(_mm_max_epi16(right, _mm_srli_epi32(right, 16)), low);
+            _mm_storeu_si128((__m128i *)(keys + y * width + x / 2), _mm_packs_epi32(left, right));
+        }
+    }
+
+    //halve the keys again for 4
+    if (renderer->downsample == 4) {
+        for (y = 0; y < height / 2; y++) {
+            for (x = 0; x < width; x += 16) {
+                const uint16_t *top = keys + 2 * y * width + x;
+                __m128i left = _mm_max_epi16(_mm_loadu_si128((const __m128i *)top), _mm_loadu_si128((const __m128i *)(top + width)));
+                __m128i right = _mm_max_epi16(_mm_loadu_si128((const __m128i *)(top + 8)), _mm_loadu_si128((const __m128i *)(top + width + 8)));
+
+                left = _mm_and_si128(_mm_max_epi16(left, _mm_srli_epi32(left, 16)), low);
+                right = _mm_and_si128(_mm_max_epi16(right, _mm_srli_epi32(right, 16)), low);
+                _mm_storeu_si128((__m128i *)(keys + y * (width / 2) + x / 2), _mm_packs_epi32(left, right));
+            }
+        }
+        width /= 2;
+        height /= 2;
+    }
+
+    for (n = 0; n < width * height; n++) out[n] = (uint8_t)keys[n];
+#else
+    downsampleReference(renderer, out);
+#endif
+}
+
+//------------------------------ tankCorner ------------------------------
+// Purpose: Where commitTank draws a tank: HPOSP from its column, PM memory
+//          rows from its row.
+// Parameters:
+//   game - The game.
+//   tank - The tank.
+//   row - Set to the frame scanline of its top row.
+//   x - Set to the frame color clock of its left column.
+// Preconditions: None
+// Postconditions: row and x are set
+static void tankCorner(const TankGame *game, int tank, int *row, int *x) {
+    uint8_t horizontal = (uint8_t)(FP_INT(game->drawnTankColumn[tank]) - TANK_HALF + TANK_BOARD_LEFT);
+
+    *row = FP_INT(game->drawnTankRow[tank]) - TANK_HALF + TANK_BOARD_TOP - TANK_PLAYFIELD_TOP;
+    *x = horizontal - TANK_PLAYFIELD_LEFT;
+}
+
+//------------------------------ shellPixel ------------------------------
+// Purpose: Where commitShell draws a shell.
+// Parameters:
+//   game - The game.
+//   shell - The shell.
+//   row - Set to its frame scanline.
+//   x - Set to its frame color clock.
+// Preconditions: None
+// Postconditions: Returns 1 if the shell is drawn at all
+static int shellPixel(const TankGame *game, int shell, int *row, int *x) {
+    uint8_t horizontal = (uint8_t)(FP_INT(game->drawnShellColumn[shell]) + TANK_BOARD_LEFT);
+
+    *row = FP_INT(game->drawnShellRow[shell]) + TANK_BOARD_TOP - TANK_PLAYFIELD_TOP;
+    *x = horizontal - TANK_PLAYFIELD_LEFT;
+    return game->drawnShellExists[shell];
+}
+
+//------------------------------ renderFrame ------------------------------
+// Purpose: Render a game as the screen shows it.
+// Parameters:
+//   renderer - The renderer.
+//   game - The game.
+//   out - outputBytes(renderer->downsample) bytes.
+// Preconditions: initRenderer has set the renderer up
+// Postconditions: out holds the frame
+static void renderFrame(Renderer *renderer, const TankGame *game, uint8_t *out) {
+    static const uint8_t shellLayer[TANK_SHELLS] = {LAYER_P0, LAYER_P1, LAYER_M2, LAYER_M3};
+    const uint8_t *pcolr = renderer->colors.pcolr;
+    int top[2], left[2], shellRow[TANK_SHELLS], shellX[TANK_SHELLS], shown[TANK_SHELLS];
+    int line, scan, tank, n;
+
+    //without downsampling the frame goes straight to out
+    renderer->target = renderer->downsample == 1 ? out : renderer->frame;
+    for (tank = 0; tank < 2; tank++) tankCorner(game, tank, &top[tank], &left[tank]);
+    for (n = 0; n < TANK_SHELLS; n++) shown[n] = shellPixel(game, n, &shellRow[n], &shellX[n]);
+
+    for (line = 0; line < TANK_PLAYFIELD_ROWS; line++) {
+        expandPlayfieldRow(renderer, game->bitMap + line * TANK_PLAYFIELD_WIDTH);
+        for (scan = line * 8; scan < line * 8 + 8; scan++) {
+            memcpy(renderer->target + scan * SCREEN_WIDTH, renderer->pfRow, SCREEN_WIDTH);
+            if (renderer->downsample > 1) memcpy(renderer->layer + scan * SCREEN_WIDTH, renderer->pfLayer, SCREEN_WIDTH);
+        }
+
+        //missiles 3 and 2, then player and missile 1, then player and missile 0: the highest priority goes last
+        for (n = TANK_SHELLS - 1; n >= 2; n--) {
+            if (shown[n] && shellRow[n] >> 3 == line) drawPixel(renderer, shellRow[n], shellX[n], pcolr[n], shellLayer[n]);
+        }
+        for (tank = 1; tank >= 0; tank--) {
+            const unsigned char *picture = tankPics[game->drawnTankDirection[tank]];
+            uint8_t layer = tank == 0 ? LAYER_P0 : LAYER_P1;
+
+            for (scan = line * 8; scan < line * 8 + 8; scan++) {
+                int y = scan - top[tank];
+                int bit;
+
+                if (y < 0 || y >= TANK_ROWS || picture[y] == 0) continue;
+                if (left[tank] >= 0 && left[tank] <= SCREEN_WIDTH - 8) {
+                    blendPlayerByte(renderer, scan, left[tank], picture[y], pcolr[tank], layer);
+                    continue;
+                }
+                //partly off the frame
+                for (bit = 0; bit < 8; bit++) {
+                    if (picture[y] & (0x80 >> bit)) drawPixel(renderer, scan, left[tank] + bit, pcolr[tank], layer);
+                }
+            }
+            if (shown[tank] && shellRow[tank] >> 3 == line) drawPixel(renderer, shellRow[tank], shellX[tank], pcolr[tank], layer);
+        }
+    }
+
+    if (renderer->downsample > 1) downsampleFrame(renderer, out);
+}
+
+//------------------------------ renderBatch ------------------------------
+// Purpose: Render a batch of games into consecutive frames.
+// Parameters:
+//   renderer - The renderer.
+//   games - The games.
+//   count - How many.
+//   out - count * outputBytes(renderer->downsample) bytes.
+// Preconditions: initRenderer has set the renderer up
+// Postconditions: out holds a frame for each game, in order
+static void renderBatch(Renderer *renderer, const TankGame *games, int count, uint8_t *out) {
+    int bytes = outputBytes(renderer->downsample);
+    int n;
+
+    for (n = 0; n < count; n++) renderFrame(renderer, &games[n], out + (size_t)n * bytes);
+}
+
+//------------------------------ referencePixel ------------------------------
+// Purpose: Work out one color clock of the screen the way GTIA does: look at
+//          what the bit map, each player and each missile put there, and let
+//          priority pick.
+// Parameters:
+//   colors - The color registers, bottom bits clear.
+//   game - The game.
+//   row - Scanline, in the frame.
+//   x - Color clock, in the frame.
+//   layer - Set to what the pixel shows.
+// Preconditions: None
+// Postconditions: Returns the pixel's color
+static uint8_t referencePixel(const ScreenColors *colors, const TankGame *game, int row, int x, uint8_t *layer) {
+    int horizontal = x + TANK_PLAYFIELD_LEFT;
+    int scanline = row + TANK_PLAYFIELD_TOP;
+    uint8_t byte = game->bitMap[(row / 8) * TANK_PLAYFIELD_WIDTH + x / 16];
+    int pixel = (byte >> (6 - 2 * ((x / 4) % 4))) & 3;
+    uint8_t playfield = pixel ? colors->color[pixel - 1] : colors->color[4];
+    int object = -1;                        //highest priority player or missile here, 0 - 3
+    int n;
+
+    for (n = TANK_SHELLS - 1; n >= 0; n--) {
+        //the players, then the missiles: a lower number always wins
+        if (n < 2) {
+            int hpos = (uint8_t)(FP_INT(game->drawnTankColumn[n]) - TANK_HALF + TANK_BOARD_LEFT);
+            int y = scanline - (FP_INT(game->drawnTankRow[n]) - TANK_HALF + TANK_BOARD_TOP);
+            int bit = horizontal - hpos;
+
+            if (y >= 0 && y < TANK_ROWS && bit >= 0 && bit < 8 && (tankPics[game->drawnTankDirection[n]][y] & (0x80 >> bit))) object = n;
+        }
+        if (game->drawnShellExists[n] &&
+            (uint8_t)(FP_INT(game->drawnShellColumn[n]) + TANK_BOARD_LEFT) == horizontal &&
+            FP_INT(game->drawnShellRow[n]) + TANK_BOARD_TOP == scanline) {
+            object = n;
+        }
+    }
+
+    if (object < 0) {
+        *layer = pixel ? LAYER_WALL : LAYER_BACKGROUND;
+        return playfield;
+    }
+    *layer = object == 0 ? LAYER_P0 : object == 1 ? LAYER_P1 : object == 2 ? LAYER_M2 : LAYER_M3;
+    return colors->pcolr[object] | (pixel ? playfield : 0);
+}
+
+//------------------------------ renderReference ------------------------------
+// Purpose: Render a game a color clock at a time, for check to compare with.
+// Parameters:
+//   renderer - Holds the colors, downsampling and the buffers used.
+//   game - The game.
+//   out - outputBytes(renderer->downsample) bytes.
+// Preconditions: initRenderer has set the renderer up
+// Postconditions: out holds the frame
+static void renderReference(Renderer *renderer, const TankGame *game, uint8_t *out) {
+    int row, x;
+
+    for (row = 0; row < SCREEN_HEIGHT; row++) {
+        for (x = 0; x < SCREEN_WIDTH; x++) {
+            int at = row * SCREEN_WIDTH + x;
+
+            renderer->frame[at] = referencePixel(&renderer->colors, game, row, x, &renderer->layer[at]);
+        }
+    }
+    if (renderer->downsample == 1) memcpy(out, renderer->frame, SCREEN_BYTES);
+    else downsampleReference(renderer, out);
+}
+
+//------------------------------ playGame ------------------------------
+// Purpose: Play the C AI against itself.
+// Parameters:
+//   game - The game, already set up.
+//   frames - Frames to play.
+// Preconditions: None
+// Postconditions: The game is that many frames on, or over
+static void playGame(TankGame *game, int frames) {
+    uint8_t input[2] = {TANK_NOTHING, TANK_NOTHING};
+    int n;
+
+    for (n = 0; n < frames && !game->over; n++) {
+        if (tankMovementTick(game)) {
+            input[0] = tankAIMove(game, 0);
+            input[1] = tankAIMove(game, 1);
+        }
+        tankStep(game, input);
+    }
+}
+
+//------------------------------ bench ------------------------------
+// Purpose: Time the fast renderer over a batch of games.
+// Parameters:
+//   downsample - 1, 2 or 4.
+//   frames - Frames to render.
+// Preconditions: None
+// Postconditions: The frames per second are printed
+static void bench(int downsample, int frames) {
+    static Renderer renderer;
+    TankGame *games = malloc(sizeof(TankGame) * BATCH_GAMES);
+    uint8_t *out = malloc((size_t)outputBytes(downsample) * BATCH_GAMES);
+    struct timespec start, end;
+    uint64_t checksum = 0;
+    double seconds;
+    int rendered = 0;
+    int n;
+
+    if (games == NULL || out == NULL) fail("out of memory", "bench");
+    for (n = 0; n < BATCH_GAMES; n++) {
+        tankInit(&games[n], NULL, (uint32_t)n + 1);
+        playGame(&games[n], n * 37 % 6000);
+    }
+    initRenderer(&renderer, &defaultColors, downsample);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (rendered < frames) {
+        int count = frames - rendered < BATCH_GAMES ? frames - rendered : BATCH_GAMES;
+
+        renderBatch(&renderer, games, count, out);
+        checksum += out[(size_t)(count - 1) * outputBytes(downsample)];
+        rendered += count;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("downsample %d: %d frames of %d bytes in %.3f s, %.0f frames/s (%llu)\n", downsample, frames,
+           outputBytes(downsample), seconds, frames / seconds, (unsigned long long)checksum);
+    free(games);
+    free(out);
+}
+
+//------------------------------ check ------------------------------
+// Purpose: Compare the fast renderer with the reference on random games.
+// Parameters:
+//   frames - Games to compare, each at every downsampling.
+// Preconditions: None
+// Postconditions: Prints the result, exits 1 at the first difference
+static void check(int frames) {
+    static Renderer fast, reference;
+    static uint8_t fastOut[SCREEN_BYTES], referenceOut[SCREEN_BYTES];
+    static const int downsamples[3] = {1, 2, 4};
+    uint32_t random = 0x1234567;
+    TankGame game;
+    int n, d, k;
+
+    for (n = 0; n < frames; n++) {
+        ScreenColors colors = defaultColors;
+
+        random = random * 1664525u + 1013904223u;
+        tankInit(&game, NULL, random);
+        playGame(&game, (int)(random >> 8) % 8000);
+
+        //every other game gets a random arena and colors, and tanks and shells anywhere, off the frame too
+        if (n & 1) {
+            for (k = 0; k < TANK_PLAYFIELD_BYTES; k++) {
+                random = random * 1664525u + 1013904223u;
+                game.bitMap[k] = (random >> 24) & (random >> 16);
+            }
+            for (k = 0; k < 4; k++) {
+                random = random * 1664525u + 1013904223u;
+                colors.pcolr[k] = (uint8_t)(random >> 24);
+            }
+            for (k = 0; k < 5; k++) {
+                random = random * 1664525u + 1013904223u;
+                colors.color[k] = (uint8_t)(random >> 24);
+            }
+            for (k = 0; k < 2; k++) {
+                random = random * 1664525u + 1013904223u;
+                game.drawnTankColumn[k] = (int16_t)((int)((random >> 8) % 200) - 20) * TANK_FP_ONE;
+                game.drawnTankRow[k] = (int16_t)((int)((random >> 16) % 200) - 20) * TANK_FP_ONE;
+                game.drawnTankDirection[k] = (uint8_t)(random >> 28);
+            }
+            for (k = 0; k < TANK_SHELLS; k++) {
+                random = random * 1664525u + 1013904223u;
+                game.drawnShellExists[k] = (random >> 31) & 1;
+                game.drawnShellColumn[k] = (int16_t)((int)((random >> 8) % 200) - 20) * TANK_FP_ONE;
+                game.drawnShellRow[k] = (int16_t)((int)((random >> 16) % 200) - 20) * TANK_FP_ONE;
+            }
+        }
+
+        for (d = 0; d < 3; d++) {
+            initRenderer(&fast, &colors, downsamples[d]);
+            initRenderer(&reference, &colors, downsamples[d]);
+            renderFrame(&fast, &game, fastOut);
+            renderReference(&reference, &game, referenceOut);
+            for (k = 0; k < outputBytes(downsamples[d]); k++) {
+                if (fastOut[k] != referenceOut[k]) {
+                    printf("game %d, downsample %d: pixel %d,%d is %02x, reference %02x\n", n, downsamples[d],
+                           k % (SCREEN_WIDTH / downsamples[d]), k / (SCREEN_WIDTH / downsamples[d]), fastOut[k], referenceOut[k]);
+                    exit(1);
+                }
+            }
+        }
+    }
+    printf("%d games, downsample 1, 2 and 4: the fast renderer matches the reference\n", frames);
+}
+
+//------------------------------ writePicture ------------------------------
+// Purpose: Play a game and write its screen as a PPM picture.
+// Parameters:
+//   palettePath - 256 RGB triples, as emulators save their palettes.
+//   picturePath - The picture to write.
+//   seed - The game's seed.
+//   frames - Frames to play first.
+//   downsample - 1, 2 or 4.
+// Preconditions: None
+// Postconditions: The picture is written, exits if a file cannot be read or written
+static void writePicture(const char *palettePath, const char *picturePath, uint32_t seed, int frames, int downsample) {
+    static Renderer renderer;
+    static uint8_t out[SCREEN_BYTES];
+    uint8_t palette[768];
+    TankGame game;
+    FILE *file = fopen(palettePath, "rb");
+    int width = SCREEN_WIDTH / downsample;
+    int height = SCREEN_HEIGHT / downsample;
+    int n;
+
+    if (file == NULL || fread(palette, 1, sizeof(palette), file) != sizeof(palette)) fail("cannot read palette", palettePath);
+    fclose(file);
+
+    tankInit(&game, NULL, seed);
+    playGame(&game, frames);
+    initRenderer(&renderer, &defaultColors, downsample);
+    renderFrame(&renderer, &game, out);
+
+    file = fopen(picturePath, "wb");
+    if (file == NULL) fail("cannot write", picturePath);
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+    for (n = 0; n < width * height; n++) fwrite(&palette[out[n] * 3], 1, 3, file);
+    fclose(file);
+}
+
+//------------------------------ usage ------------------------------
+// Purpose: Print how to run the tool and exit.
+// Parameters: None
+// Preconditions: None
+// Postconditions: Does not return
+static void usage(void) {
+    fprintf(stderr, "usage: obsrender bench [--downsample d] [--frames n]\n"
+                    "       obsrender check [--frames n]\n"
+                    "       obsrender ppm <palette> <picture.ppm> [--seed n] [--frames n] [--downsample d]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int downsample = 1;
+    int frames = -1;
+    uint32_t seed = 1;
+    int first = 2;
+    int n;
+
+    if (argc < 2) usage();
+    if (strcmp(argv[1], "ppm") == 0) first = 4;
+    if (argc < first) usage();
+    for (n = first; n < argc; n++) {
+        if (strcmp(argv[n], "--downsample") == 0 && n + 1 < argc) downsample = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--frames") == 0 && n + 1 < argc) frames = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--seed") == 0 && n + 1 < argc) seed = (uint32_t)strtoul(argv[++n], NULL, 0);
+        else usage();
+    }
+    if (downsample != 1 && downsample != 2 && downsample != 4) usage();
+
+    if (strcmp(argv[1], "bench") == 0) bench(downsample, frames > 0 ? frames : 200000);
+    else if (strcmp(argv[1], "check") == 0) check(frames > 0 ? frames : 2000);
+    else if (strcmp(argv[1], "ppm") == 0) writePicture(argv[2], argv[3], seed, frames >= 0 ? frames : 600, downsample);
+    else usage();
+
+    return 0;
+}
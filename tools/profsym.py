@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""
+    ----------------------------------------------- profsym.py --------------------------------------------------------
+    Description                 : Turns the program counter histogram of a TankCombat built with -DPROFILER into a
+                                  flat profile by function, and by source line with the ld65 debug file
+    Usage                       : tools/profsym.py TankCombat.map dump.bin [--dbg TankCombat.dbg] [--base ADDRESS]
+                                  [--lines N]
+    --------------------------------------------------------------------------------------------------------------------
+    Link with -m TankCombat.map (and -g -Wl --dbgfile,TankCombat.dbg for lines), play a few games, then save a
+    memory dump from the emulator. The dump is raw bytes with the first byte at --base (default 0, a whole 64K
+    dump). Functions are the exports in the map's code segments, C functions and the cc65 runtime alike. A
+    bucket that two functions or lines share is split between them by the bytes each has in it, so a line's
+    count is an estimate to within its bucket.
+"""
+import bisect
+import re
+import struct
+import sys
+from collections import defaultdict
+
+# profileReport and the histogram in TankCombat.c, all 16 bit little endian
+REPORT_FIELDS = ["samples", "outside", "loopsWithout", "loopsWith", "overheadCycles"]
+PROFILE_START = 0x2000
+PROFILE_END = 0xC000
+PROFILE_BUCKET = 16
+PROFILE_BUCKETS = (PROFILE_END - PROFILE_START) // PROFILE_BUCKET
+
+# 64 kHz clock over (PROFILE_AUDF + 1), NTSC, and the CPU cycles a frame leaves after DMA (CPU_CYCLES_PER_FRAME)
+SAMPLE_RATE = 63921 / 32
+CPU_CYCLES_PER_FRAME = 114 * 262 - 9 * 262 - 5 * 240 - 33 - (20 * 17 + 10 * 22)
+
+
+def read_map(path):
+    """Return the segment list as {name: (start, end, size)} and the exports as {name: value}."""
+    segments = {}
+    exports = {}
+    section = None
+
+    with open(path) as map_file:
+        for line in map_file:
+            if line.startswith("Segment list"):
+                section = "segments"
+            elif line.startswith("Exports list by name"):
+                section = "exports"
+            elif line.startswith("Exports list by value") or line.startswith("Imports list"):
+                section = None
+            elif section == "segments":
+                match = re.match(r"(\w+)\s+([0-9A-F]{6})\s+([0-9A-F]{6})\s+([0-9A-F]{6})", line)
+                if match:
+                    segments[match.group(1)] = tuple(int(group, 16) for group in match.groups()[1:])
+            elif section == "exports":
+                for name, value in re.findall(r"(\S+)\s+([0-9A-F]{6})\s+[A-Z]+", line):
+                    exports[name] = int(value, 16)
+
+    return segments, exports
+
+
+def read_words(dump_path, base, address, count, what):
+    """Return count 16 bit words from the memory dump at address."""
+    with open(dump_path, "rb") as dump:
+        dump.seek(address - base)
+        data = dump.read(2 * count)
+
+    if len(data) < 2 * count:
+        sys.exit("profsym: %s is past the end of the dump" % what)
+    return struct.unpack("<%dH" % count, data)
+
+
+def is_code(name):
+    return "CODE" in name or name in ("STARTUP", "ONCE", "INIT")
+
+
+def function_owners(segments, exports):
+    """Return a sorted list of (start, end, name) for every export in a code segment."""
+    code = [(start, end) for name, (start, end, size) in segments.items() if is_code(name) and size > 0]
+    symbols = sorted((value, name) for name, value in exports.items()
+                     if any(start <= value <= end for start, end in code))
+    owners = []
+    for n, (value, name) in enumerate(symbols):
+        end = next(segment_end for start, segment_end in code if start <= value <= segment_end) + 1
+        if n + 1 < len(symbols) and symbols[n + 1][0] < end:
+            end = symbols[n + 1][0]
+        if end > value:
+            owners.append((value, end, name.lstrip("_")))
+    return owners
+
+
+def parse_fields(text):
+    fields = {}
+    for item in re.findall(r'(\w+)=("[^"]*"|[^,]*)', text):
+        fields[item[0]] = item[1].strip('"')
+    return fields
+
+
+def line_owners(dbg_path):
+    """Return {address: "file:line"} for every byte of code the debug file has C lines (or failing that asm
+    lines) for."""
+    segs = {}
+    spans = {}
+    files = {}
+    lines = []
+
+    with open(dbg_path) as dbg:
+        for record in dbg:
+            kind, _, rest = record.strip().partition("\t")
+            fields = parse_fields(rest)
+            if kind == "seg":
+                segs[fields["id"]] = int(fields["start"], 0)
+            elif kind == "span":
+                spans[fields["id"]] = (fields["seg"], int(fields["start"], 0), int(fields["size"], 0))
+            elif kind == "file":
+                files[fields["id"]] = fields["name"]
+            elif kind == "line" and "span" in fields:
+                lines.append(fields)
+
+    owners = {}
+    # asm lines first, so the C lines (type 1) laid over them win
+    for fields in sorted(lines, key=lambda fields: fields.get("type") == "1"):
+        where = "%s:%s" % (files.get(fields["file"], "?"), fields["line"])
+        for span in fields["span"].split("+"):
+            seg, start, size = spans[span]
+            address = segs[seg] + start
+            for byte in range(address, address + size):
+                owners[byte] = where
+    return owners
+
+
+def spread(histogram, owner_of):
+    """Split each bucket's samples between the owners of its bytes. Returns {owner: samples}."""
+    totals = defaultdict(float)
+    for bucket, count in enumerate(histogram):
+        if count == 0:
+            continue
+        start = PROFILE_START + bucket * PROFILE_BUCKET
+        for address in range(start, start + PROFILE_BUCKET):
+            totals[owner_of(address)] += count / PROFILE_BUCKET
+    return totals
+
+
+def print_profile(title, totals, samples, limit):
+    print("\n%s" % title)
+    print("  %8s %6s %6s  %s" % ("samples", "%", "cum %", "name"))
+    cumulative = 0.0
+    for name, count in sorted(totals.items(), key=lambda item: -item[1])[:limit]:
+        cumulative += count
+        print("  %8.1f %6.2f %6.2f  %s" % (count, 100.0 * count / samples, 100.0 * cumulative / samples, name))
+
+
+def main():
+    args = sys.argv[1:]
+    base = 0
+    dbg_path = None
+    limit = 40
+    for option in ("--base", "--dbg", "--lines"):
+        if option in args:
+            at = args.index(option)
+            value = args[at + 1]
+            del args[at:at + 2]
+            if option == "--base":
+                base = int(value, 0)
+            elif option == "--dbg":
+                dbg_path = value
+            else:
+                limit = int(value)
+    if len(args) != 2:
+        sys.exit(__doc__)
+
+    segments, exports = read_map(args[0])
+    if "_profileReport" not in exports or "_profileHistogram" not in exports:
+        sys.exit("profsym: no _profileReport in the map, build with -DPROFILER")
+    report = dict(zip(REPORT_FIELDS, read_words(args[1], base, exports["_profileReport"], len(REPORT_FIELDS),
+                                                "profileReport")))
+    histogram = read_words(args[1], base, exports["_profileHistogram"], PROFILE_BUCKETS, "profileHistogram")
+    samples = report["samples"]
+    if samples == 0:
+        sys.exit("profsym: no samples yet, play a game before saving the dump")
+    if sum(histogram) + report["outside"] != samples:
+        print("profsym: warning: the histogram holds %d samples but profileReport counts %d"
+              % (sum(histogram) + report["outside"], samples))
+
+    print("Samples        %d (%.1f seconds of play at %.0f a second)" % (samples, samples / SAMPLE_RATE, SAMPLE_RATE))
+    print("Outside        %d samples (%.2f%%) outside $%04X-$%04X: OS ROM, page 6"
+          % (report["outside"], 100.0 * report["outside"] / samples, PROFILE_START, PROFILE_END - 1))
+    if report["loopsWithout"]:
+        print("Overhead       %d cycles a frame (%.1f%% of %d), idle loops %d without the profiler, %d with"
+              % (report["overheadCycles"], 100.0 * report["overheadCycles"] / CPU_CYCLES_PER_FRAME,
+                 CPU_CYCLES_PER_FRAME, report["loopsWithout"], report["loopsWith"]))
+
+    owners = function_owners(segments, exports)
+    starts = [start for start, end, name in owners]
+
+    def function_of(address):
+        n = bisect.bisect_right(starts, address) - 1
+        if n >= 0 and address < owners[n][1]:
+            return owners[n][2]
+        return "$%04X" % (address & ~0xFF)
+
+    print_profile("Functions", spread(histogram, function_of), samples, limit)
+
+    if dbg_path:
+        line_of = line_owners(dbg_path)
+        print_profile("Lines", spread(histogram, lambda address: line_of.get(address, function_of(address))),
+                      samples, limit)
+
+
+if __name__ == "__main__":
+    main()
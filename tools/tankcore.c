@@ -0,0 +1,529 @@
+/*
+    ----------------------------------------------- tankcore.c ---------------------------------------------------------
+    Description                 : The TankCombat rules for host tools, see tankcore.h
+    Compiler                    : Any C99 compiler
+    --------------------------------------------------------------------------------------------------------------------
+    Each function here follows the function of the same job in TankCombat.c (movePlayers, spinTank,
+    checkBorders, fire, traverseMissile, checkCollision, attack), in the same order within a frame as
+    playFrame. Change them together.
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#include <string.h>
+
+#include "tankcore.h"
+#include "../tankgfx.h"
+
+#define NORTH               0
+#define NORTH_15            1
+#define NORTH_EAST          2
+#define NORTH_60            3
+#define EAST                4
+#define EAST_15             5
+#define EAST_SOUTH          6
+#define EAST_60             7
+#define SOUTH               8
+#define SOUTH_15            9
+#define SOUTH_WEST          10
+#define SOUTH_60            11
+#define WEST                12
+#define WEST_15             13
+#define WEST_NORTH          14
+#define WEST_60             15
+
+#define TO_FP(n)            ((n) * TANK_FP_ONE)
+#define FP_INT(v)           ((v) >> TANK_FP_SHIFT)
+
+//board frame, from TankCombat.c
+#define BOARD_WRAP_LEFT     2
+#define BOARD_WRAP_RIGHT    (TANK_PLAYFIELD_WIDTH * 16 - 13)
+#define BOARD_WRAP_TOP      6
+#define BOARD_WRAP_BOTTOM   156
+#define TANK_START_ROW      80
+#define TANK0_START_COLUMN  9
+#define TANK1_START_COLUMN  (TANK_PLAYFIELD_WIDTH * 16 - 18)
+
+const int16_t tankDeltas[TANK_HEADINGS][2] = {
+    {TO_FP(-1), TO_FP(0)},          // NORTH
+    {TO_FP(-2), TO_FP(1)},          // NORTH_15
+    {TO_FP(-1), TO_FP(1)},          // NORTH_EAST
+    {TO_FP(-1), TO_FP(2)},          // NORTH_60
+    {TO_FP(0), TO_FP(1)},           // EAST
+    {TO_FP(1), TO_FP(2)},           // EAST_15
+    {TO_FP(1), TO_FP(1)},           // EAST_SOUTH
+    {TO_FP(2), TO_FP(1)},           // EAST_60
+    {TO_FP(1), TO_FP(0)},           // SOUTH
+    {TO_FP(2), TO_FP(-1)},          // SOUTH_15
+    {TO_FP(1), TO_FP(-1)},          // SOUTH_WEST
+    {TO_FP(1), TO_FP(-2)},          // SOUTH_60
+    {TO_FP(0), TO_FP(-1)},          // WEST
+    {TO_FP(-1), TO_FP(-2)},         // WEST_15
+    {TO_FP(-1), TO_FP(-1)},         // WEST_NORTH
+    {TO_FP(-2), TO_FP(-1)}          // WEST_60
+};
+
+//------------------------------ nextRandom ------------------------------
+// Purpose: Step the game's xorshift generator.
+// Parameters:
+//   game - The game.
+// Preconditions: game->random is not 0
+// Postconditions: Returns the next value
+static uint32_t nextRandom(TankGame *game) {
+    uint32_t x = game->random;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    game->random = x;
+    return x;
+}
+
+void tankInit(TankGame *game, const uint8_t *bitMap, uint32_t seed) {
+    int n;
+
+    memset(game, 0, sizeof(*game));
+    game->tankDirection[0] = EAST;
+    game->tankDirection[1] = WEST;
+    game->tankRow[0] = TO_FP(TANK_START_ROW);
+    game->tankColumn[0] = TO_FP(TANK0_START_COLUMN);
+    game->tankRow[1] = TO_FP(TANK_START_ROW);
+    game->tankColumn[1] = TO_FP(TANK1_START_COLUMN);
+    game->shellNext[0] = 0;
+    game->shellNext[1] = 1;
+    game->fireAvailable[0] = 1;
+    game->fireAvailable[1] = 1;
+    game->aiOpening = TANK_AI_OPENING;
+    game->random = seed != 0 ? seed : 0x2545F491;
+
+    if (bitMap != NULL) {
+        memcpy(game->bitMap, bitMap, TANK_PLAYFIELD_BYTES);
+    } else {
+        //createBitMap's border: top and bottom rows, and the outermost pixel on each side
+        for (n = 0; n < TANK_PLAYFIELD_WIDTH; n++) {
+            game->bitMap[n] = 170;
+            game->bitMap[(TANK_PLAYFIELD_ROWS - 1) * TANK_PLAYFIELD_WIDTH + n] = 170;
+        }
+        for (n = 1; n < TANK_PLAYFIELD_ROWS - 1; n++) {
+            game->bitMap[n * TANK_PLAYFIELD_WIDTH] = 128;
+            game->bitMap[n * TANK_PLAYFIELD_WIDTH + TANK_PLAYFIELD_WIDTH - 1] = 2;
+        }
+    }
+
+    //nothing has been drawn yet
+    for (n = 0; n < 2; n++) {
+        game->drawnTankRow[n] = game->tankRow[n];
+        game->drawnTankColumn[n] = game->tankColumn[n];
+        game->drawnTankDirection[n] = game->tankDirection[n];
+    }
+}
+
+int tankWallAt(const TankGame *game, int horizontal, int vertical) {
+    return tankBitMapWallAt(game->bitMap, TANK_PLAYFIELD_WIDTH, TANK_PLAYFIELD_ROWS, horizontal, vertical);
+}
+
+int tankBitMapWallAt(const uint8_t *bitMap, int width, int rows, int horizontal, int vertical) {
+    int pixel, line;
+
+    if (horizontal < TANK_PLAYFIELD_LEFT || vertical < TANK_PLAYFIELD_TOP) return 0;
+    pixel = (horizontal - TANK_PLAYFIELD_LEFT) >> 2;
+    line = (vertical - TANK_PLAYFIELD_TOP) >> 3;
+    if (pixel >= width * 4 || line >= rows) return 0;
+
+    //4 pixels per byte, the leftmost pixel in the top 2 bits
+    return ((bitMap[line * width + (pixel >> 2)] << ((pixel & 3) * 2)) & 0xC0) != 0;
+}
+
+//------------------------------ wallMask ------------------------------
+// Purpose: Which of 8 positions in a row have a wall, a player's width.
+// Parameters:
+//   bitMap, width, rows - The bit map, as for tankBitMapWallAt.
+//   left - Horizontal position of the first of them.
+//   vertical - Scanline.
+// Preconditions: None
+// Postconditions: Returns a mask with bit 7 for left, bit 0 for left + 7
+static unsigned wallMask(const uint8_t *bitMap, int width, int rows, int left, int vertical) {
+    unsigned mask = 0;
+    int x = 0;
+
+    //a playfield pixel is 4 positions wide, so 8 positions cover at most 3 of them
+    while (x < 8) {
+        int run = 4 - ((left + x - TANK_PLAYFIELD_LEFT) & 3);
+
+        if (run > 8 - x) run = 8 - x;
+        if (tankBitMapWallAt(bitMap, width, rows, left + x, vertical)) mask |= (0xFFu << (8 - run) & 0xFFu) >> x;
+        x += run;
+    }
+    return mask;
+}
+
+int tankPictureOnWall(const uint8_t *bitMap, int width, int rows, uint8_t direction, int left, int top) {
+    const unsigned char *picture = tankPics[direction];
+    unsigned mask = 0;
+    int y;
+
+    //bit map rows are 8 scanlines, so the mask only changes once inside the tank
+    for (y = 0; y < TANK_ROWS; y++) {
+        if (y == 0 || ((top + y - TANK_PLAYFIELD_TOP) & 7) == 0) mask = wallMask(bitMap, width, rows, left, top + y);
+        if (picture[y] & mask) return 1;
+    }
+    return 0;
+}
+
+int tankTakesStep(uint8_t direction, uint8_t *firstDiag) {
+    if ((direction & 1) && !*firstDiag) {
+        *firstDiag = 1;
+        return 0;
+    }
+    *firstDiag = 0;
+    return 1;
+}
+
+uint8_t tankTurn(uint8_t direction, uint8_t move) {
+    if (move & TANK_LEFT_TURN) return (direction - 1) & (TANK_HEADINGS - 1);
+    return (direction + 1) & (TANK_HEADINGS - 1);
+}
+
+uint8_t tankSpin(uint8_t hitDir, uint8_t direction, int push[2]) {
+    push[0] = 0;
+    push[1] = 0;
+    if (hitDir == NORTH || hitDir == NORTH_EAST || hitDir == EAST_60 || hitDir == NORTH_15) {
+        push[1] = TO_FP(1);
+        return (direction + NORTH_EAST) & (TANK_HEADINGS - 1);
+    }
+    if (hitDir == SOUTH || hitDir == SOUTH_15 || hitDir == SOUTH_WEST || hitDir == WEST_60) push[1] = TO_FP(-1);
+    if (hitDir == WEST || hitDir == WEST_15 || hitDir == WEST_NORTH || hitDir == SOUTH_60) push[0] = TO_FP(1);
+    if (hitDir == EAST || hitDir == EAST_15 || hitDir == EAST_SOUTH || hitDir == NORTH_60) push[0] = TO_FP(-1);
+    return (direction - NORTH_EAST) & (TANK_HEADINGS - 1);
+}
+
+void tankShellStart(uint8_t direction, int offset[2]) {
+    offset[0] = TO_FP(barrelTips[direction][1] - TANK_HALF);
+    offset[1] = TO_FP(barrelTips[direction][0] - TANK_HALF);
+}
+
+int tankMovementTick(const TankGame *game) {
+    return game->frameDelay == TANK_MOVE_TICK_FRAMES;
+}
+
+//------------------------------ moveTank ------------------------------
+// Purpose: moveForward (steps 1) and moveBackward (steps -1).
+// Parameters:
+//   game - The game.
+//   tank - The tank to move.
+//   steps - 1 or -1.
+// Preconditions: None
+// Postconditions: The tank has moved one step
+static void moveTank(TankGame *game, int tank, int steps) {
+    game->tankFirstDiag[tank] = 0;
+    game->tankRow[tank] += steps * tankDeltas[game->tankDirection[tank]][0];
+    game->tankColumn[tank] += steps * tankDeltas[game->tankDirection[tank]][1];
+}
+
+//------------------------------ fireShell ------------------------------
+// Purpose: fire and missileLocationHelper: launch one of the tank's shells from
+//          the tip of its barrel.
+// Parameters:
+//   game - The game.
+//   tank - The tank firing.
+// Preconditions: None
+// Postconditions: The shell is in flight, the tank is reloading
+static void fireShell(TankGame *game, int tank) {
+    int shell = game->shellNext[tank];
+    int direction = game->tankDirection[tank];
+    int offset[2];
+    int n;
+
+    for (n = tank; n < TANK_SHELLS; n += 2) {
+        if (!game->shellExists[n]) {
+            shell = n;
+            break;
+        }
+    }
+    game->shellNext[tank] = shell + 2 < TANK_SHELLS ? shell + 2 : tank;
+
+    tankShellStart(direction, offset);
+    game->shellDirection[shell] = direction;
+    game->shellRow[shell] = game->tankRow[tank] + offset[0];
+    game->shellColumn[shell] = game->tankColumn[tank] + offset[1];
+    game->fireAvailable[tank] = 0;
+    game->shellExists[shell] = 1;
+}
+
+//------------------------------ moveTankOnTick ------------------------------
+// Purpose: One tank's half of movePlayers, with the original's precedence:
+//          a turn is taken even while spinning.
+// Parameters:
+//   game - The game.
+//   tank - The tank.
+//   move - Its joystick bits.
+// Preconditions: Called on a movement tick
+// Postconditions: The tank has fired, moved or turned
+static void moveTankOnTick(TankGame *game, int tank, uint8_t move) {
+    uint8_t *direction = &game->tankDirection[tank];
+
+    if ((move & TANK_FIRE) && game->fireAvailable[tank] && !game->isHit[tank]) {
+        fireShell(game, tank);
+    } else if ((move & TANK_FORWARD) && !game->isHit[tank]) {
+        if (tankTakesStep(*direction, &game->tankFirstDiag[tank])) moveTank(game, tank, 1);
+    } else if ((move & TANK_BACKWARD) && !game->isHit[tank]) {
+        if (tankTakesStep(*direction, &game->tankFirstDiag[tank])) moveTank(game, tank, -1);
+    } else if ((move & TANK_LEFT_TURN) || ((move & TANK_RIGHT_TURN) && !game->isHit[tank])) {
+        *direction = tankTurn(*direction, move);
+    }
+}
+
+//------------------------------ spinTank ------------------------------
+// Purpose: spinTank and checkBorders: turn a hit tank two steps and push it
+//          away from the shell, wrapping it round if it leaves the board.
+// Parameters:
+//   game - The game.
+//   tank - The spinning tank.
+// Preconditions: The tank is hit
+// Postconditions: The tank has spun, its spin has one tick less to go
+static void spinTank(TankGame *game, int tank) {
+    int push[2];
+    int row, column;
+
+    game->tankDirection[tank] = tankSpin(game->hitDir[tank], game->tankDirection[tank], push);
+    game->tankRow[tank] += push[0];
+    game->tankColumn[tank] += push[1];
+
+    game->hitTime[tank]--;
+    if (game->hitTime[tank] == 0) game->isHit[tank] = 0;
+    game->directionChosen[tank] = 0;
+
+    row = FP_INT(game->tankRow[tank]);
+    column = FP_INT(game->tankColumn[tank]);
+    if (column <= BOARD_WRAP_LEFT) game->tankColumn[tank] = TO_FP(BOARD_WRAP_RIGHT);
+    else if (column >= BOARD_WRAP_RIGHT) game->tankColumn[tank] = TO_FP(BOARD_WRAP_LEFT);
+    if (row <= BOARD_WRAP_TOP) game->tankRow[tank] = TO_FP(BOARD_WRAP_BOTTOM);
+    else if (row >= BOARD_WRAP_BOTTOM) game->tankRow[tank] = TO_FP(BOARD_WRAP_TOP);
+}
+
+//------------------------------ drawnTankAt ------------------------------
+// Purpose: Check whether the tank as drawn last frame has a pixel at a screen
+//          position.
+// Parameters:
+//   game - The game.
+//   tank - The tank.
+//   horizontal - Horizontal position, in color clocks.
+//   vertical - Scanline.
+// Preconditions: None
+// Postconditions: Returns 1 if the tank's picture covers that position
+static int drawnTankAt(const TankGame *game, int tank, int horizontal, int vertical) {
+    int left = FP_INT(game->drawnTankColumn[tank]) - TANK_HALF + TANK_BOARD_LEFT;
+    int top = FP_INT(game->drawnTankRow[tank]) - TANK_HALF + TANK_BOARD_TOP;
+    int x = horizontal - left;
+    int y = vertical - top;
+
+    if (x < 0 || x >= 8 || y < 0 || y >= TANK_ROWS) return 0;
+    return (tankPics[game->drawnTankDirection[tank]][y] >> (7 - x)) & 1;
+}
+
+//------------------------------ drawnTankOnWall ------------------------------
+// Purpose: The player to playfield collision register for the tank as drawn
+//          last frame.
+// Parameters:
+//   game - The game.
+//   tank - The tank.
+// Preconditions: None
+// Postconditions: Returns 1 if any of its pixels lies on a wall
+static int drawnTankOnWall(const TankGame *game, int tank) {
+    return tankPictureOnWall(game->bitMap, TANK_PLAYFIELD_WIDTH, TANK_PLAYFIELD_ROWS, game->drawnTankDirection[tank],
+                             FP_INT(game->drawnTankColumn[tank]) - TANK_HALF + TANK_BOARD_LEFT,
+                             FP_INT(game->drawnTankRow[tank]) - TANK_HALF + TANK_BOARD_TOP);
+}
+
+//------------------------------ checkCollisions ------------------------------
+// Purpose: checkCollision: back tanks off walls they drove into, score hits and
+//          take shells that hit a wall out of play, from what was drawn last frame.
+// Parameters:
+//   game - The game.
+// Preconditions: None
+// Postconditions: Tanks, shells and scores are updated
+static void checkCollisions(TankGame *game) {
+    int tank, shell, step;
+
+    //tank 1 first, as checkCollision does
+    for (tank = 1; tank >= 0; tank--) {
+        if (!drawnTankOnWall(game, tank)) continue;
+        if (game->history[tank] & TANK_FORWARD) {
+            for (step = 0; step < 4; step++) moveTank(game, tank, -1);
+        }
+        //player 1 checks both, the AI only one or the other
+        if ((game->history[tank] & TANK_BACKWARD) && (tank == 0 || !(game->history[tank] & TANK_FORWARD))) {
+            for (step = 0; step < 4; step++) moveTank(game, tank, 1);
+        }
+    }
+
+    for (shell = 0; shell < TANK_SHELLS; shell++) {
+        int target = (shell & 1) ? 0 : 1;
+        int horizontal, vertical;
+
+        if (!game->shellExists[shell]) continue;
+        if (!game->drawnShellExists[shell]) continue;          //not on screen yet, the registers cannot see it
+
+        horizontal = FP_INT(game->drawnShellColumn[shell]) + TANK_BOARD_LEFT;
+        vertical = FP_INT(game->drawnShellRow[shell]) + TANK_BOARD_TOP;
+        if (drawnTankAt(game, target, horizontal, vertical)) {
+            game->hitDir[target] = game->shellDirection[shell];
+            game->score[shell & 1]++;
+            game->isHit[target] = 1;
+            game->hitTime[target] = TANK_HIT_SPIN_TICKS;
+            game->shellExists[shell] = 0;
+        } else if (tankWallAt(game, horizontal, vertical)) {
+            game->shellExists[shell] = 0;
+        }
+    }
+}
+
+int tankStep(TankGame *game, const uint8_t input[2]) {
+    static const uint8_t cooldown[2] = {TANK_P0_FIRE_COOLDOWN, TANK_P1_FIRE_COOLDOWN};
+    int tick = 0;
+    int tank, shell;
+
+    if (game->over) return 0;
+
+    if (game->frameDelay == TANK_MOVE_TICK_FRAMES) {
+        for (tank = 0; tank < 2; tank++) {
+            game->lastMove[tank] = input[tank];
+            moveTankOnTick(game, tank, input[tank]);
+        }
+        game->frameDelay = 0;
+        for (tank = 0; tank < 2; tank++) {
+            if (game->isHit[tank] && game->hitTime[tank] > 0) spinTank(game, tank);
+        }
+        tick = 1;
+    } else {
+        game->frameDelay++;
+    }
+
+    for (tank = 0; tank < 2; tank++) {
+        if (!game->fireAvailable[tank]) game->fireDelay[tank]++;
+        if (game->fireDelay[tank] >= cooldown[tank]) {
+            game->fireAvailable[tank] = 1;
+            game->fireDelay[tank] = 0;
+        }
+    }
+
+    for (shell = 0; shell < TANK_SHELLS; shell++) {
+        if (!game->shellExists[shell]) continue;
+        game->shellRow[shell] += tankDeltas[game->shellDirection[shell]][0];
+        game->shellColumn[shell] += tankDeltas[game->shellDirection[shell]][1];
+    }
+
+    checkCollisions(game);
+    game->history[0] = game->lastMove[0];
+    game->history[1] = game->lastMove[1];
+
+    for (tank = 0; tank < 2; tank++) {
+        if (game->score[tank] == TANK_WIN_SCORE) {
+            game->over = 1;
+            game->winner = tank;
+        }
+    }
+
+    //commitFrame
+    for (tank = 0; tank < 2; tank++) {
+        game->drawnTankRow[tank] = game->tankRow[tank];
+        game->drawnTankColumn[tank] = game->tankColumn[tank];
+        game->drawnTankDirection[tank] = game->tankDirection[tank];
+    }
+    for (shell = 0; shell < TANK_SHELLS; shell++) {
+        game->drawnShellRow[shell] = game->shellRow[shell];
+        game->drawnShellColumn[shell] = game->shellColumn[shell];
+        game->drawnShellExists[shell] = game->shellExists[shell];
+    }
+
+    game->frame++;
+    return tick;
+}
+
+//------------------------------ pointPosition ------------------------------
+// Purpose: Which side of the line through a tank in direction dir a point lies.
+// Parameters:
+//   game - The game.
+//   tank - The tank the line runs through.
+//   dir - Direction of the line.
+//   row, column - The point, in board pixels.
+// Preconditions: None
+// Postconditions: Returns 0 on the line, 1 anticlockwise of it, 2 clockwise
+static int pointPosition(const TankGame *game, int tank, int dir, int row, int column) {
+    int a = tankDeltas[dir][0];
+    int b = -tankDeltas[dir][1];
+    int c = tankDeltas[dir][1] * FP_INT(game->tankRow[tank]) - tankDeltas[dir][0] * FP_INT(game->tankColumn[tank]);
+    int result = a * column + b * row + c;
+
+    if (result > 0) return 1;
+    if (result < 0) return 2;
+    return 0;
+}
+
+//------------------------------ lineHitsTank ------------------------------
+// Purpose: Whether a line from a tank in direction dir crosses the other tank.
+// Parameters:
+//   game - The game.
+//   tank - The tank aiming.
+//   dir - Direction of the line.
+// Preconditions: None
+// Postconditions: Returns 1 if it goes through the middle or a corner, or
+//                 between the corners
+static int lineHitsTank(const TankGame *game, int tank, int dir) {
+    int row = FP_INT(game->tankRow[tank ^ 1]);
+    int column = FP_INT(game->tankColumn[tank ^ 1]);
+    int a = pointPosition(game, tank, dir, row - 2, column - 4);
+    int b = pointPosition(game, tank, dir, row + 2, column - 4);
+    int c = pointPosition(game, tank, dir, row - 2, column + 3);
+    int d = pointPosition(game, tank, dir, row + 2, column + 3);
+    int e = pointPosition(game, tank, dir, row, column);
+
+    if (a == 0 || b == 0 || c == 0 || d == 0 || e == 0) return 1;
+    return ((1 << a) | (1 << b) | (1 << c) | (1 << d)) == 0x03;
+}
+
+uint8_t tankAIMove(TankGame *game, int tank) {
+    int enemyRow = FP_INT(game->tankRow[tank ^ 1]);
+    int enemyColumn = FP_INT(game->tankColumn[tank ^ 1]);
+    int row = FP_INT(game->tankRow[tank]);
+    int column = FP_INT(game->tankColumn[tank]);
+    int startDir = NORTH;
+    int endDir = NORTH_60;
+    int dir;
+
+    if (game->aiMoves[tank] < game->aiOpening) {
+        game->aiMoves[tank]++;
+        return TANK_FORWARD;
+    }
+
+    //the quadrant the other tank is in, seen from this one
+    if (enemyRow < row && enemyColumn >= column) {
+        startDir = NORTH;
+        endDir = NORTH_60;
+    } else if (enemyRow >= row && enemyColumn > column) {
+        startDir = EAST;
+        endDir = EAST_60;
+    } else if (enemyRow > row && enemyColumn <= column) {
+        startDir = SOUTH;
+        endDir = SOUTH_60;
+    } else if (enemyRow <= row && enemyColumn < column) {
+        startDir = WEST;
+        endDir = WEST_60;
+    }
+
+    for (dir = startDir; dir < endDir; dir++) {
+        if (lineHitsTank(game, tank, dir)) {
+            game->tankDirection[tank] = dir;
+            game->directionChosen[tank] = 0;
+            return TANK_FIRE;
+        }
+    }
+
+    if (!game->directionChosen[tank]) {
+        game->tankDirection[tank] = startDir + nextRandom(game) % 4;
+        game->desiredDirection[tank] = game->tankDirection[tank];
+        game->directionChosen[tank] = 1;
+    } else {
+        game->tankDirection[tank] = game->desiredDirection[tank];
+        return TANK_FORWARD;
+    }
+    return TANK_NOTHING;
+}
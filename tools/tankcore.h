@@ -0,0 +1,224 @@
+/*
+    ----------------------------------------------- tankcore.h ---------------------------------------------------------
+    Description                 : The TankCombat rules for host tools: tank movement, shells, hits, scoring and the
+                                  C AI, stepped one frame at a time without the Atari hardware
+    Compiler                    : Any C99 compiler
+    --------------------------------------------------------------------------------------------------------------------
+    A TankGame is one game of the original variant (VARIANT=1) on the built in arena or a level disk
+    arena, played the way TankCombat.c plays it: a movement tick every TANK_MOVE_TICK_FRAMES frames, shells
+    moving every frame, and walls and hits found from what was drawn the frame before, as the GTIA's
+    collision registers see them. The hardware collisions are worked out from the tank pictures in
+    tankgfx.h and the bit map, pixel for pixel.
+
+    A TankGame holds no pointers and allocates nothing, so games can be kept in arrays, copied and
+    stepped on any thread. All randomness comes from the game's own seed, so a game played twice with
+    the same inputs plays out the same.
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#ifndef TANKCORE_H
+#define TANKCORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//joystick bits, as in TankCombat.c
+#define TANK_NOTHING            0x00
+#define TANK_FORWARD            0x01
+#define TANK_BACKWARD           0x02
+#define TANK_LEFT_TURN          0x04
+#define TANK_RIGHT_TURN         0x08
+#define TANK_FIRE               0x10
+
+//gameplay settings of VARIANT=1, from variants.h
+#define TANK_MOVE_TICK_FRAMES   5
+#define TANK_P0_FIRE_COOLDOWN   60
+#define TANK_P1_FIRE_COOLDOWN   100
+#define TANK_HIT_SPIN_TICKS     12
+#define TANK_AI_OPENING         72
+#define TANK_WIN_SCORE          9
+#define TANK_SHELLS             4              //shell n belongs to tank (n & 1)
+
+#define TANK_HEADINGS           16
+#define TANK_FP_SHIFT           4              //positions are board pixels in fixed point, as tankRow is
+#define TANK_FP_ONE             (1 << TANK_FP_SHIFT)
+
+//screen layout of the normal width playfield
+#define TANK_PLAYFIELD_LEFT     48             //horizontal position of the first bit map pixel
+#define TANK_PLAYFIELD_TOP      48             //scanline of the first bit map row
+#define TANK_PLAYFIELD_WIDTH    10             //bytes per bit map row, 4 pixels per byte
+#define TANK_PLAYFIELD_ROWS     22             //bit map rows, 8 scanlines each
+#define TANK_PLAYFIELD_BYTES    (TANK_PLAYFIELD_WIDTH * TANK_PLAYFIELD_ROWS)
+#define TANK_BOARD_TOP          55             //scanline of board row 0
+#define TANK_BOARD_LEFT         52             //horizontal position of board column 0
+#define TANK_HALF               4              //a tank's board position is the middle of its 8x8 sprite
+#define TANK_ROWS               8
+
+typedef struct {
+    //the game as it is now
+    int16_t tankRow[2];
+    int16_t tankColumn[2];
+    uint8_t tankDirection[2];
+    uint8_t tankFirstDiag[2];                   //diagonal moves wait every other tick
+    uint8_t isHit[2];
+    uint8_t hitDir[2];                          //direction of the shell that hit the tank
+    uint8_t hitTime[2];                         //movement ticks of spin left
+    int16_t shellRow[TANK_SHELLS];
+    int16_t shellColumn[TANK_SHELLS];
+    uint8_t shellDirection[TANK_SHELLS];
+    uint8_t shellExists[TANK_SHELLS];
+    uint8_t shellNext[2];                       //shell each tank recycles when all of its shells are in flight
+    uint8_t fireAvailable[2];
+    uint8_t fireDelay[2];
+    uint8_t frameDelay;                         //frames since the last movement tick
+    uint8_t lastMove[2];                        //each tank's move on the last movement tick
+    uint8_t history[2];                         //lastMove as of the last collision check
+    uint8_t score[2];
+    uint8_t over;                               //1 once a tank has TANK_WIN_SCORE points
+    uint8_t winner;
+
+    //what the last frame drew, which the collisions of this frame are found from
+    int16_t drawnTankRow[2];
+    int16_t drawnTankColumn[2];
+    uint8_t drawnTankDirection[2];
+    int16_t drawnShellRow[TANK_SHELLS];
+    int16_t drawnShellColumn[TANK_SHELLS];
+    uint8_t drawnShellExists[TANK_SHELLS];
+
+    //the C AI, for whichever tank tankAIMove is asked to play
+    uint8_t aiOpening;
+    uint8_t aiMoves[2];                         //opening moves driven
+    uint8_t directionChosen[2];
+    uint8_t desiredDirection[2];
+
+    uint32_t random;                            //xorshift state
+    uint32_t frame;
+    uint8_t bitMap[TANK_PLAYFIELD_BYTES];       //the arena, as createBitMap draws it
+} TankGame;
+
+//bytes of a TankGame before the arena, all that changes as it is played
+#define TANK_STATE_BYTES        offsetof(TankGame, bitMap)
+
+//fixed point board step of one move in each direction, row then column
+extern const int16_t tankDeltas[TANK_HEADINGS][2];
+//tank pictures and barrel tips, defined by tankgfx.h in tankcore.c
+extern const unsigned char tankPics[TANK_HEADINGS][TANK_ROWS];
+extern const unsigned char barrelTips[TANK_HEADINGS][2];
+
+//------------------------------ tankInit ------------------------------
+// Purpose: Set up a game as TankCombat.c does at the start of a game.
+// Parameters:
+//   game - The game to set up.
+//   bitMap - A level disk arena (TANK_PLAYFIELD_BYTES), or NULL for the built in one.
+//   seed - Seed for the game's randomness, any value.
+// Preconditions: None
+// Postconditions: Both tanks are at their start positions, scores are 0
+void tankInit(TankGame *game, const uint8_t *bitMap, uint32_t seed);
+
+//------------------------------ tankStep ------------------------------
+// Purpose: Play one frame.
+// Parameters:
+//   game - The game.
+//   input - Each tank's joystick bits, only used if the frame is a movement tick.
+// Preconditions: None
+// Postconditions: Returns 1 if the frame was a movement tick and input was used
+int tankStep(TankGame *game, const uint8_t input[2]);
+
+//------------------------------ tankAIMove ------------------------------
+// Purpose: Pick a tank's move the way the C AI in TankCombat.c picks tank 1's:
+//          drive out for the arena's opening, then sweep its quadrant for a
+//          line of fire. Like the original it turns the tank itself.
+// Parameters:
+//   game - The game.
+//   tank - The tank to play, 0 or 1.
+// Preconditions: Called once a movement tick, before tankStep
+// Postconditions: Returns the tank's joystick bits
+uint8_t tankAIMove(TankGame *game, int tank);
+
+//------------------------------ tankMovementTick ------------------------------
+// Purpose: Check whether the next tankStep is a movement tick.
+// Parameters:
+//   game - The game.
+// Preconditions: None
+// Postconditions: Returns 1 if the next frame uses its input
+int tankMovementTick(const TankGame *game);
+
+//------------------------------ tankWallAt ------------------------------
+// Purpose: Check whether the arena has a wall at a screen position.
+// Parameters:
+//   game - The game.
+//   horizontal - Horizontal position, in color clocks.
+//   vertical - Scanline.
+// Preconditions: None
+// Postconditions: Returns 1 if a bit map pixel is set there
+int tankWallAt(const TankGame *game, int horizontal, int vertical);
+
+/*
+    The rules one tank at a time, shared by TankGame and by tools that keep their own tank state, such as
+    tankswarm. Bit maps are in the screen's format, 4 pixels a byte with the leftmost in the top 2 bits,
+    laid over the screen from TANK_PLAYFIELD_LEFT and TANK_PLAYFIELD_TOP, but any size.
+*/
+
+//------------------------------ tankBitMapWallAt ------------------------------
+// Purpose: Check whether a bit map has a wall at a screen position.
+// Parameters:
+//   bitMap - The bit map.
+//   width - Bytes per bit map row.
+//   rows - Bit map rows, 8 scanlines each.
+//   horizontal - Horizontal position, in color clocks.
+//   vertical - Scanline.
+// Preconditions: None
+// Postconditions: Returns 1 if a bit map pixel is set there, 0 outside the bit map
+int tankBitMapWallAt(const uint8_t *bitMap, int width, int rows, int horizontal, int vertical);
+
+//------------------------------ tankPictureOnWall ------------------------------
+// Purpose: The player to playfield collision register: does any pixel of a
+//          tank picture lie on a wall.
+// Parameters:
+//   bitMap, width, rows - The bit map, as for tankBitMapWallAt.
+//   direction - The heading the tank is drawn with.
+//   left, top - Screen position of the picture's top left pixel.
+// Preconditions: None
+// Postconditions: Returns 1 if it does
+int tankPictureOnWall(const uint8_t *bitMap, int width, int rows, uint8_t direction, int left, int top);
+
+//------------------------------ tankTakesStep ------------------------------
+// Purpose: moveForward and moveBackward's diagonal delay: a tank on an odd
+//          heading only steps every other movement tick.
+// Parameters:
+//   direction - The tank's heading.
+//   firstDiag - The tank's flag, set when it waits and cleared when it steps.
+// Preconditions: None
+// Postconditions: Returns 1 if the tank steps by tankDeltas this tick
+int tankTakesStep(uint8_t direction, uint8_t *firstDiag);
+
+//------------------------------ tankTurn ------------------------------
+// Purpose: turnplayer: the heading one step left or right.
+// Parameters:
+//   direction - The tank's heading.
+//   move - Joystick bits, TANK_LEFT_TURN turns left, anything else right.
+// Preconditions: None
+// Postconditions: Returns the new heading
+uint8_t tankTurn(uint8_t direction, uint8_t move);
+
+//------------------------------ tankSpin ------------------------------
+// Purpose: spinTank without checkBorders: the heading a hit tank spins to and
+//          the push away from the shell, which wraps at the board's edges are
+//          left to the caller.
+// Parameters:
+//   hitDir - Direction of the shell that hit the tank.
+//   direction - The tank's heading.
+//   push - Set to the fixed point push, row then column.
+// Preconditions: None
+// Postconditions: Returns the new heading
+uint8_t tankSpin(uint8_t hitDir, uint8_t direction, int push[2]);
+
+//------------------------------ tankShellStart ------------------------------
+// Purpose: missileLocationHelper: where a shell starts, at the tip of the barrel.
+// Parameters:
+//   direction - The firing tank's heading.
+//   offset - Set to the fixed point offset from the tank's position, row then column.
+// Preconditions: None
+// Postconditions: offset is set
+void tankShellStart(uint8_t direction, int offset[2]);
+
+#endif
@@ -0,0 +1,852 @@
+/*
+    ----------------------------------------------- tankmcts.c ---------------------------------------------------------
+    Description                 : Monte Carlo tree search over the TankCombat rules, for the best move in a position
+                                  and to grade the C AI against it
+    Compiler                    : Any C11 compiler on a POSIX system (uses pthreads)
+    Build                       : cc -O2 -pthread -o tankmcts tools/tankmcts.c tools/tankcore.c -lm
+    --------------------------------------------------------------------------------------------------------------------
+    Usage:
+        tankmcts search [--threads n] [--ms n] [--tank n] [--seed n] [--frames n] [--observation file]
+            Search one position for --ms milliseconds (default 1000) and print the best move of --tank
+            (default the observation's tank, or 1, the AI's) and its value, with every move's visits and
+            value. The position is a matchserver observation saved to a file, or the C AI playing itself
+            for --frames frames from --seed.
+        tankmcts bench [--threads n] [--ms n]
+            Playouts a second on 1, 2, 4 and so on up to --threads, and the speedup over one thread.
+        tankmcts grade [--threads n] [--ms n] [--positions n] [--seed n]
+            Search positions from games of the C AI playing itself with attack() as one more move for tank
+            1, and print how often it is the best move and how much value it gives up when it is not.
+
+    Both tanks move at once on a movement tick, so the search is decoupled UCT: a node keeps, for each
+    tank, the visits and summed value of each of its moves, and each tank picks its move by UCB1 from its
+    own numbers. The pair of moves picks the child. Moves are the joystick bits the tank can send
+    (nothing, forward, back, left, right, fire), held for the TANK_MOVE_TICK_FRAMES + 1 frames to the next
+    tick. Below a new node, a playout drives both tanks with random moves held for 1 to 4 ticks until
+    HORIZON_TICKS ticks from the root. Its value is +1 for tank 0 winning the game, -1 for losing, and
+    otherwise half the points tank 0 gained over tank 1 since the root, kept between -1 and 1. Tank 1
+    scores the negative of tank 0's value.
+
+    Nodes keep the TANK_STATE_BYTES of their game, the TankGame without the arena, so reaching a node is
+    one small copy into the thread's own game that already has the arena. Nodes and their child tables
+    come from pools made at startup, claimed with an atomic add, and a new child is published with a
+    compare and swap, so the tree takes no locks. Threads share one tree: a visit counts as a loss for
+    the tanks until its playout comes back (a virtual loss), which keeps threads off the same path.
+
+    The search runs as tasks of BATCH_PLAYOUTS playouts on a work stealing thread pool. Each worker keeps
+    a deque of tasks, pushes and pops its own at the bottom and, when it runs out, steals from the top of
+    another's. A task that finishes with time left pushes itself back, so the pool keeps every core busy
+    until the time is up without a thread being handed a fixed share.
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#define _GNU_SOURCE
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tankcore.h"
+
+#define MAX_THREADS         64
+#define MOVES               6              //joystick moves a tank can make on a tick
+#define MOVE_AI             6              //grade: tank 1 plays tankAIMove, at the root only
+#define MAX_MOVES           7
+#define HORIZON_TICKS       60             //movement ticks from the root a playout runs to, 6 seconds
+#define MAX_DEPTH           HORIZON_TICKS
+#define BATCH_PLAYOUTS      64             //playouts in a task
+#define TASKS_PER_THREAD    4              //tasks each thread starts a search with
+#define DEQUE_SIZE          64             //tasks a worker can hold, a power of 2
+#define MAX_NODES           (1u << 20)
+#define VALUE_ONE           65536          //value of a won game, in the fixed point the sums are kept in
+#define EXPLORATION         1.2            //UCB1 exploration constant, for values between -1 and 1
+#define OBSERVATION_BYTES   47             //matchserver observation
+#define GRADE_EVERY_TICKS   25             //movement ticks between graded positions
+
+static const uint8_t moveBits[MAX_MOVES] = {
+    TANK_NOTHING, TANK_FORWARD, TANK_BACKWARD, TANK_LEFT_TURN, TANK_RIGHT_TURN, TANK_FIRE, TANK_NOTHING
+};
+static const char *moveNames[MAX_MOVES] = {"nothing", "forward", "back", "left", "right", "fire", "attack()"};
+
+//A position in the tree, the game at a movement tick
+typedef struct {
+    uint8_t state[TANK_STATE_BYTES];        //the TankGame up to its arena
+    uint8_t moves[2];                       //moves each tank chooses between, 0 once the game is over
+    _Atomic uint32_t children;              //first of moves[0] x moves[1] child slots, 0 until the first child
+    _Atomic uint32_t visits;
+    _Atomic uint32_t moveVisits[2][MAX_MOVES];
+    _Atomic int64_t moveValue[2][MAX_MOVES];  //summed value to that tank, VALUE_ONE a win
+} Node;
+
+//One search, shared by every thread playing it
+typedef struct {
+    TankGame root;                          //the position, and the arena every node is played on
+    Node *nodes;                            //node 0 is the root
+    _Atomic uint32_t *slots;                //child node of each pair of moves, 0 until it is made
+    _Atomic uint32_t nodeCount;
+    _Atomic uint32_t slotCount;
+    _Atomic uint64_t playouts;
+    _Atomic int tasks;                      //tasks still running or queued
+    double deadline;
+    double elapsed;                         //seconds from the start to the last task finishing
+} Search;
+
+typedef struct Pool Pool;
+
+//A thread of the pool, with its own deque of tasks and its own game to play nodes in
+typedef struct {
+    Pool *pool;
+    int index;
+    pthread_t thread;
+    pthread_mutex_t lock;                   //guards the deque, taken by the owner and by thieves
+    Search *deque[DEQUE_SIZE];
+    unsigned top;                           //thieves take from here
+    unsigned bottom;                        //the owner pushes and pops here
+    TankGame game;
+    uint32_t random;
+    uint64_t steals;
+} Worker;
+
+struct Pool {
+    int threads;
+    Worker worker[MAX_THREADS];
+    pthread_mutex_t lock;
+    pthread_cond_t wake;                    //a task was queued, or the pool is quitting
+    pthread_cond_t done;                    //a search ran out of tasks
+    _Atomic int queued;
+    int quitting;
+};
+
+static Node *nodePool;
+static _Atomic uint32_t *slotPool;
+
+//------------------------------ fail ------------------------------
+// Purpose: Print an error and exit.
+// Parameters:
+//   message - What went wrong.
+//   detail - The value it went wrong with.
+// Preconditions: None
+// Postconditions: Does not return
+static void fail(const char *message, const char *detail) {
+    fprintf(stderr, "tankmcts: %s: %s\n", message, detail);
+    exit(1);
+}
+
+static double nowSeconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+//------------------------------ nextRandom ------------------------------
+// Purpose: Step a xorshift generator.
+// Parameters:
+//   state - The generator, not 0.
+// Preconditions: None
+// Postconditions: Returns the next value
+static uint32_t nextRandom(uint32_t *state) {
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+//------------------------------ playTick ------------------------------
+// Purpose: Play a movement tick with the tanks' moves and the frames up to the next one.
+// Parameters:
+//   game - The game, at a movement tick.
+//   moves - Each tank's move, MOVE_AI for the C AI's.
+// Preconditions: None
+// Postconditions: The game is at the next movement tick, or over
+static void playTick(TankGame *game, const uint8_t moves[2]) {
+    static const uint8_t idle[2] = {TANK_NOTHING, TANK_NOTHING};
+    uint8_t input[2];
+    int tank;
+
+    for (tank = 0; tank < 2; tank++) {
+        input[tank] = moves[tank] == MOVE_AI ? tankAIMove(game, tank) : moveBits[moves[tank]];
+    }
+    tankStep(game, input);
+    while (!game->over && !tankMovementTick(game)) tankStep(game, idle);
+}
+
+//------------------------------ gameValue ------------------------------
+// Purpose: Value of a game to tank 0 at the end of a playout.
+// Parameters:
+//   search - The search, for the scores at the root.
+//   game - The game.
+// Preconditions: None
+// Postconditions: Returns between -VALUE_ONE and VALUE_ONE
+static int64_t gameValue(const Search *search, const TankGame *game) {
+    int points;
+
+    if (game->over) return game->winner == 0 ? VALUE_ONE : -VALUE_ONE;
+    points = (game->score[0] - search->root.score[0]) - (game->score[1] - search->root.score[1]);
+    if (points > 2) points = 2;
+    if (points < -2) points = -2;
+    return (int64_t)points * VALUE_ONE / 2;
+}
+
+//------------------------------ playout ------------------------------
+// Purpose: Play random moves from a new node to the horizon.
+// Parameters:
+//   search - The search.
+//   worker - The thread, whose game is at the new node.
+//   depth - Movement ticks from the root to the new node.
+// Preconditions: None
+// Postconditions: Returns the value to tank 0
+static int64_t playout(const Search *search, Worker *worker, int depth) {
+    TankGame *game = &worker->game;
+    uint8_t moves[2] = {0, 0};
+    int hold[2] = {0, 0};
+    int tank;
+
+    for (; depth < HORIZON_TICKS && !game->over; depth++) {
+        for (tank = 0; tank < 2; tank++) {
+            if (hold[tank] == 0) {
+                uint32_t r = nextRandom(&worker->random);
+
+                moves[tank] = r % MOVES;
+                hold[tank] = 1 + (r >> 8) % 4;
+            }
+            hold[tank]--;
+        }
+        playTick(game, moves);
+    }
+    return gameValue(search, game);
+}
+
+//------------------------------ initNode ------------------------------
+// Purpose: Fill in a node from the game it stands for.
+// Parameters:
+//   node - The node, all zero.
+//   game - The game.
+// Preconditions: None
+// Postconditions: The node is ready to be published
+static void initNode(Node *node, const TankGame *game) {
+    memcpy(node->state, game, TANK_STATE_BYTES);
+    node->moves[0] = game->over ? 0 : MOVES;
+    node->moves[1] = game->over ? 0 : MOVES;
+}
+
+//------------------------------ chooseMove ------------------------------
+// Purpose: Pick a tank's move at a node by UCB1 on that tank's own numbers.
+// Parameters:
+//   node - The node.
+//   tank - The tank choosing.
+//   total - The node's visits.
+// Preconditions: The node is not a game over
+// Postconditions: Returns the move; moves not tried yet come first
+static int chooseMove(Node *node, int tank, uint32_t total) {
+    double logTotal = log((double)total + 1.0);
+    double best = -1e300;
+    int bestMove = 0;
+    int move;
+
+    for (move = 0; move < node->moves[tank]; move++) {
+        uint32_t visits = atomic_load_explicit(&node->moveVisits[tank][move], memory_order_relaxed);
+        double score;
+
+        if (visits == 0) return move;
+        score = (double)atomic_load_explicit(&node->moveValue[tank][move], memory_order_relaxed) / VALUE_ONE / visits
+                + EXPLORATION * sqrt(logTotal / visits);
+        if (score > best) {
+            best = score;
+            bestMove = move;
+        }
+    }
+    return bestMove;
+}
+
+//------------------------------ childSlots ------------------------------
+// Purpose: Find a node's table of children, making it on the first visit that needs it.
+// Parameters:
+//   search - The search.
+//   node - The node.
+// Preconditions: None
+// Postconditions: Returns the first slot, or 0 if the slot pool is used up
+static uint32_t childSlots(Search *search, Node *node) {
+    uint32_t slots = atomic_load_explicit(&node->children, memory_order_acquire);
+    uint32_t wanted = (uint32_t)node->moves[0] * node->moves[1];
+    uint32_t claimed, expected = 0;
+
+    if (slots != 0) return slots;
+    claimed = atomic_fetch_add(&search->slotCount, wanted);
+    if (claimed + wanted > MAX_NODES * MOVES) return 0;
+    //a thread that loses the race leaves its claimed slots unused
+    if (!atomic_compare_exchange_strong(&node->children, &expected, claimed)) return expected;
+    return claimed;
+}
+
+//------------------------------ iterate ------------------------------
+// Purpose: One playout: walk down the tree, add a node, play on from it and back up its value.
+// Parameters:
+//   search - The search.
+//   worker - The thread.
+// Preconditions: worker->game holds the search's arena
+// Postconditions: The tree has one more visit on every node of the path
+static void iterate(Search *search, Worker *worker) {
+    uint32_t path[MAX_DEPTH + 1];
+    uint8_t chosen[MAX_DEPTH + 1][2];
+    uint32_t index = 0;
+    int depth = 0;
+    int64_t value;
+    int step;
+
+    for (;;) {
+        Node *node = &search->nodes[index];
+        uint32_t total, slots, child;
+
+        if (node->moves[0] == 0 || depth == MAX_DEPTH) {
+            memcpy(&worker->game, node->state, TANK_STATE_BYTES);
+            value = gameValue(search, &worker->game);
+            break;
+        }
+
+        //choose both moves and count them as losses until the value comes back
+        total = atomic_fetch_add(&node->visits, 1);
+        chosen[depth][0] = (uint8_t)chooseMove(node, 0, total);
+        chosen[depth][1] = (uint8_t)chooseMove(node, 1, total);
+        atomic_fetch_add(&node->moveVisits[0][chosen[depth][0]], 1);
+        atomic_fetch_add(&node->moveVisits[1][chosen[depth][1]], 1);
+        atomic_fetch_sub(&node->moveValue[0][chosen[depth][0]], VALUE_ONE);
+        atomic_fetch_sub(&node->moveValue[1][chosen[depth][1]], VALUE_ONE);
+        path[depth++] = index;
+
+        slots = childSlots(search, node);
+        child = slots != 0 ? atomic_load_explicit(&search->slots[slots + chosen[depth - 1][0] * node->moves[1]
+                                                                  + chosen[depth - 1][1]], memory_order_acquire) : 0;
+        if (child != 0) {
+            index = child;
+            continue;
+        }
+
+        //a new position: play the tick, keep it as a node if there is room, then play out from it
+        memcpy(&worker->game, node->state, TANK_STATE_BYTES);
+        playTick(&worker->game, chosen[depth - 1]);
+        if (slots != 0) {
+            uint32_t made = atomic_fetch_add(&search->nodeCount, 1);
+
+            if (made < MAX_NODES) {
+                uint32_t expected = 0;
+
+                initNode(&search->nodes[made], &worker->game);
+                //another thread may have made the same child first, this one is then left unused
+                atomic_compare_exchange_strong_explicit(&search->slots[slots + chosen[depth - 1][0] * node->moves[1]
+                                                                       + chosen[depth - 1][1]],
+                                                        &expected, made, memory_order_release, memory_order_relaxed);
+            }
+        }
+        value = playout(search, worker, depth);
+        break;
+    }
+
+    //take back the virtual losses and add the value, tank 1's being tank 0's turned round
+    for (step = 0; step < depth; step++) {
+        Node *node = &search->nodes[path[step]];
+
+        atomic_fetch_add(&node->moveValue[0][chosen[step][0]], VALUE_ONE + value);
+        atomic_fetch_add(&node->moveValue[1][chosen[step][1]], VALUE_ONE - value);
+    }
+    atomic_fetch_add_explicit(&search->playouts, 1, memory_order_relaxed);
+}
+
+//------------------------------ pushTask ------------------------------
+// Purpose: Queue a task at the bottom of a worker's deque and wake a sleeping thread to steal it.
+// Parameters:
+//   worker - The worker queuing it.
+//   search - The task, a batch of playouts of this search.
+// Preconditions: The deque is not full, which TASKS_PER_THREAD tasks a thread keeps it from being
+// Postconditions: The task is queued
+static void pushTask(Worker *worker, Search *search) {
+    Pool *pool = worker->pool;
+
+    pthread_mutex_lock(&worker->lock);
+    worker->deque[worker->bottom++ & (DEQUE_SIZE - 1)] = search;
+    pthread_mutex_unlock(&worker->lock);
+
+    atomic_fetch_add(&pool->queued, 1);
+    pthread_mutex_lock(&pool->lock);
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+//------------------------------ takeTask ------------------------------
+// Purpose: Pop a task from the bottom of a worker's own deque, or steal one from the top of another's.
+// Parameters:
+//   worker - The worker looking for work.
+// Preconditions: None
+// Postconditions: Returns the task, or NULL if every deque is empty
+static Search *takeTask(Worker *worker) {
+    Pool *pool = worker->pool;
+    Search *task = NULL;
+    int n;
+
+    pthread_mutex_lock(&worker->lock);
+    if (worker->bottom != worker->top) task = worker->deque[--worker->bottom & (DEQUE_SIZE - 1)];
+    pthread_mutex_unlock(&worker->lock);
+
+    for (n = 1; task == NULL && n < pool->threads; n++) {
+        Worker *victim = &pool->worker[(worker->index + n) % pool->threads];
+
+        pthread_mutex_lock(&victim->lock);
+        if (victim->bottom != victim->top) {
+            task = victim->deque[victim->top++ & (DEQUE_SIZE - 1)];
+            worker->steals++;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+
+    if (task != NULL) atomic_fetch_sub(&pool->queued, 1);
+    return task;
+}
+
+//------------------------------ runTask ------------------------------
+// Purpose: Play a batch of playouts, then queue the task again if the search has time left.
+// Parameters:
+//   worker - The worker running it.
+//   search - The search.
+// Preconditions: None
+// Postconditions: The search's tasks count drops when the task is not queued again
+static void runTask(Worker *worker, Search *search) {
+    Pool *pool = worker->pool;
+    int n;
+
+    memcpy(&worker->game, &search->root, sizeof(TankGame));
+    for (n = 0; n < BATCH_PLAYOUTS; n++) iterate(search, worker);
+
+    if (nowSeconds() < search->deadline) {
+        pushTask(worker, search);
+    } else if (atomic_fetch_sub(&search->tasks, 1) == 1) {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->done);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+//------------------------------ workerMain ------------------------------
+// Purpose: A pool thread: run tasks while there are any, sleep while there are none.
+// Parameters:
+//   argument - The Worker.
+// Preconditions: None
+// Postconditions: Returns when the pool quits
+static void *workerMain(void *argument) {
+    Worker *worker = argument;
+    Pool *pool = worker->pool;
+
+    for (;;) {
+        Search *task = takeTask(worker);
+
+        if (task != NULL) {
+            runTask(worker, task);
+            continue;
+        }
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load(&pool->queued) == 0 && !pool->quitting) pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->quitting) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+//------------------------------ poolCreate ------------------------------
+// Purpose: Start the pool's threads.
+// Parameters:
+//   pool - The pool.
+//   threads - Threads to start, 1 to MAX_THREADS.
+// Preconditions: None
+// Postconditions: The threads are waiting for tasks
+static void poolCreate(Pool *pool, int threads) {
+    int n;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->threads = threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    //every deque is ready before any thread can steal from it
+    for (n = 0; n < threads; n++) {
+        Worker *worker = &pool->worker[n];
+
+        worker->pool = pool;
+        worker->index = n;
+        worker->random = 0x9E3779B9u * (n + 1);
+        pthread_mutex_init(&worker->lock, NULL);
+    }
+    for (n = 0; n < threads; n++) {
+        if (pthread_create(&pool->worker[n].thread, NULL, workerMain, &pool->worker[n]) != 0) fail("cannot start thread", "pool");
+    }
+}
+
+//------------------------------ poolFree ------------------------------
+// Purpose: Stop the pool's threads.
+// Parameters:
+//   pool - The pool.
+// Preconditions: No search is running
+// Postconditions: The threads have exited
+static void poolFree(Pool *pool) {
+    int n;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quitting = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (n = 0; n < pool->threads; n++) pthread_join(pool->worker[n].thread, NULL);
+    for (n = 0; n < pool->threads; n++) pthread_mutex_destroy(&pool->worker[n].lock);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+}
+
+//------------------------------ runSearch ------------------------------
+// Purpose: Search a position on the pool until the time is up.
+// Parameters:
+//   pool - The pool.
+//   search - The search, whose root game is the position.
+//   seconds - Time to search for.
+//   gradeAI - Give tank 1 the C AI's move at the root as well.
+// Preconditions: The root game is not over
+// Postconditions: The tree is built, search->playouts counts its playouts and search->elapsed is how
+//                 long they took
+static void runSearch(Pool *pool, Search *search, double seconds, int gradeAI) {
+    static const uint8_t idle[2] = {TANK_NOTHING, TANK_NOTHING};
+    uint32_t used = atomic_load(&search->nodeCount);
+    uint32_t usedSlots = atomic_load(&search->slotCount);
+    int n;
+
+    //bring the position to a movement tick, where moves are chosen
+    while (!search->root.over && !tankMovementTick(&search->root)) tankStep(&search->root, idle);
+
+    search->nodes = nodePool;
+    search->slots = slotPool;
+    memset(nodePool, 0, (used < MAX_NODES ? used : MAX_NODES) * sizeof(Node));
+    memset((void *)slotPool, 0, sizeof(*slotPool) * (usedSlots < MAX_NODES * MOVES ? usedSlots : MAX_NODES * MOVES));
+    initNode(&search->nodes[0], &search->root);
+    if (gradeAI) search->nodes[0].moves[1] = MOVE_AI + 1;
+    atomic_store(&search->nodeCount, 1);
+    atomic_store(&search->slotCount, 1);          //slot 0 stands for no children
+    atomic_store(&search->playouts, 0);
+    atomic_store(&search->tasks, pool->threads * TASKS_PER_THREAD);
+    search->elapsed = nowSeconds();
+    search->deadline = search->elapsed + seconds;
+
+    for (n = 0; n < pool->threads * TASKS_PER_THREAD; n++) pushTask(&pool->worker[n % pool->threads], search);
+
+    pthread_mutex_lock(&pool->lock);
+    while (atomic_load(&search->tasks) > 0) pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+    search->elapsed = nowSeconds() - search->elapsed;
+}
+
+//------------------------------ bestMove ------------------------------
+// Purpose: The most visited of a tank's moves at the root.
+// Parameters:
+//   search - A finished search.
+//   tank - The tank.
+//   value - Set to the move's mean value to the tank, -1 to 1.
+// Preconditions: None
+// Postconditions: Returns the move
+static int bestMove(const Search *search, int tank, double *value) {
+    const Node *root = &search->nodes[0];
+    uint32_t most = 0;
+    int move, best = 0;
+
+    for (move = 0; move < root->moves[tank]; move++) {
+        if (root->moveVisits[tank][move] > most) {
+            most = root->moveVisits[tank][move];
+            best = move;
+        }
+    }
+    *value = most ? (double)root->moveValue[tank][best] / VALUE_ONE / most : 0.0;
+    return best;
+}
+
+//------------------------------ moveValue ------------------------------
+// Purpose: A move's mean value to a tank at the root.
+// Parameters:
+//   search - A finished search.
+//   tank - The tank.
+//   move - The move.
+// Preconditions: None
+// Postconditions: Returns -1 to 1, 0 for a move never tried
+static double moveValue(const Search *search, int tank, int move) {
+    const Node *root = &search->nodes[0];
+    uint32_t visits = root->moveVisits[tank][move];
+
+    return visits ? (double)root->moveValue[tank][move] / VALUE_ONE / visits : 0.0;
+}
+
+//------------------------------ selfPlay ------------------------------
+// Purpose: Start a game and let the C AI play both tanks for a while.
+// Parameters:
+//   game - The game.
+//   seed - Seed for the game.
+//   frames - Frames to play.
+// Preconditions: None
+// Postconditions: The game has been played for frames frames, or until it was over
+static void selfPlay(TankGame *game, uint32_t seed, int frames) {
+    uint8_t input[2] = {TANK_NOTHING, TANK_NOTHING};
+    int n;
+
+    tankInit(game, NULL, seed);
+    for (n = 0; n < frames && !game->over; n++) {
+        if (tankMovementTick(game)) {
+            input[0] = tankAIMove(game, 0);
+            input[1] = tankAIMove(game, 1);
+        }
+        tankStep(game, input);
+    }
+}
+
+//------------------------------ readObservation ------------------------------
+// Purpose: Set up a game from a matchserver observation saved to a file.
+// Parameters:
+//   game - The game.
+//   path - The file, OBSERVATION_BYTES long.
+// Preconditions: None
+// Postconditions: Returns the tank the observation was sent to. Reload times, what the C AI had
+//                 decided and which way a spinning tank was hit are not in an observation, and
+//                 start from nothing.
+static int readObservation(TankGame *game, const char *path) {
+    uint8_t data[OBSERVATION_BYTES];
+    FILE *file = fopen(path, "rb");
+    const uint8_t *p;
+    int n;
+
+    if (file == NULL) fail("cannot open", path);
+    if (fread(data, 1, sizeof(data), file) != sizeof(data)) fail("not a matchserver observation", path);
+    fclose(file);
+
+    tankInit(game, NULL, 1);
+    game->frame = data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+    game->score[0] = data[5];
+    game->score[1] = data[6];
+    game->over = data[7];
+    game->winner = data[8];
+    game->aiMoves[0] = game->aiMoves[1] = game->aiOpening;
+    for (n = 0; n < 2; n++) {
+        p = data + 9 + 7 * n;
+        game->tankRow[n] = (int16_t)(p[0] | p[1] << 8);
+        game->tankColumn[n] = (int16_t)(p[2] | p[3] << 8);
+        game->tankDirection[n] = p[4] & (TANK_HEADINGS - 1);
+        game->hitTime[n] = p[5];
+        game->isHit[n] = p[5] > 0;
+        game->fireAvailable[n] = p[6];
+        game->drawnTankRow[n] = game->tankRow[n];
+        game->drawnTankColumn[n] = game->tankColumn[n];
+        game->drawnTankDirection[n] = game->tankDirection[n];
+    }
+    for (n = 0; n < TANK_SHELLS; n++) {
+        p = data + 23 + 6 * n;
+        game->shellRow[n] = game->drawnShellRow[n] = (int16_t)(p[0] | p[1] << 8);
+        game->shellColumn[n] = game->drawnShellColumn[n] = (int16_t)(p[2] | p[3] << 8);
+        game->shellDirection[n] = p[4] & (TANK_HEADINGS - 1);
+        game->shellExists[n] = game->drawnShellExists[n] = p[5];
+    }
+    return data[4] & 1;
+}
+
+//------------------------------ search ------------------------------
+// Purpose: Search one position and print every move of the tank to move.
+// Parameters:
+//   pool - The pool.
+//   root - The position.
+//   tank - The tank whose best move is wanted.
+//   seconds - Time to search for.
+// Preconditions: The position is not a game over
+// Postconditions: The result is printed
+static void search(Pool *pool, const TankGame *root, int tank, double seconds) {
+    static Search result;
+    double value;
+    int move, best;
+
+    result.root = *root;
+    runSearch(pool, &result, seconds, 0);
+    best = bestMove(&result, tank, &value);
+
+    printf("Position    frame %u, score %u:%u, tank 0 row %d column %d direction %u, tank 1 row %d column %d direction %u\n",
+           (unsigned)result.root.frame, result.root.score[0], result.root.score[1],
+           result.root.tankRow[0] >> TANK_FP_SHIFT, result.root.tankColumn[0] >> TANK_FP_SHIFT, result.root.tankDirection[0],
+           result.root.tankRow[1] >> TANK_FP_SHIFT, result.root.tankColumn[1] >> TANK_FP_SHIFT, result.root.tankDirection[1]);
+    printf("Search      %d threads, %.0f ms, %llu playouts (%.0f a second), %u nodes of %zu bytes of state\n",
+           pool->threads, result.elapsed * 1000.0, (unsigned long long)result.playouts, result.playouts / result.elapsed,
+           (unsigned)(result.nodeCount < MAX_NODES ? result.nodeCount : MAX_NODES), (size_t)TANK_STATE_BYTES);
+    printf("Tank %d      move        visits    value\n", tank);
+    for (move = 0; move < result.nodes[0].moves[tank]; move++) {
+        printf("            %-8s %9u   %+6.3f%s\n", moveNames[move], (unsigned)result.nodes[0].moveVisits[tank][move],
+               moveValue(&result, tank, move), move == best ? "   best" : "");
+    }
+    printf("Best        %s, value %+.3f (1 is a won game, 0.5 a point ahead %d ticks on)\n", moveNames[best], value,
+           HORIZON_TICKS);
+}
+
+//------------------------------ bench ------------------------------
+// Purpose: Time searches of the same position on doubling numbers of threads.
+// Parameters:
+//   threads - Most threads.
+//   seconds - Time for each search.
+// Preconditions: None
+// Postconditions: One line printed for each number of threads
+static void bench(int threads, double seconds) {
+    static Search result;
+    Pool pool;
+    TankGame root;
+    double single = 0.0;
+    int count;
+
+    selfPlay(&root, 12345, 1200);
+    printf("%.0f ms a search, %zu bytes of state a node\n", seconds * 1000.0, (size_t)TANK_STATE_BYTES);
+    printf("threads   playouts/second   speedup   nodes   steals\n");
+    for (count = 1;; count = count * 2 < threads ? count * 2 : threads) {
+        uint64_t steals = 0;
+        double rate;
+        int n;
+
+        poolCreate(&pool, count);
+        result.root = root;
+        runSearch(&pool, &result, seconds, 0);
+        for (n = 0; n < count; n++) steals += pool.worker[n].steals;
+        poolFree(&pool);
+
+        rate = result.playouts / result.elapsed;
+        if (count == 1) single = rate;
+        printf("%7d   %15.0f   %7.2f   %5u   %6llu\n", count, rate, rate / single,
+               (unsigned)(result.nodeCount < MAX_NODES ? result.nodeCount : MAX_NODES), (unsigned long long)steals);
+        fflush(stdout);
+        if (count == threads) break;
+    }
+}
+
+//------------------------------ grade ------------------------------
+// Purpose: Grade the C AI's moves for tank 1 against the search.
+// Parameters:
+//   pool - The pool.
+//   positions - Positions to grade.
+//   seed - Seed of the first self play game.
+//   seconds - Time to search each position for.
+// Preconditions: None
+// Postconditions: The grade is printed
+static void grade(Pool *pool, int positions, uint32_t seed, double seconds) {
+    static Search result;
+    static const uint8_t idle[2] = {TANK_NOTHING, TANK_NOTHING};
+    TankGame game;
+    double loss = 0.0, worst = 0.0;
+    int graded = 0, agreed = 0, ticks = 0;
+    int bestCount[MAX_MOVES] = {0};
+    uint8_t input[2];
+    int move;
+
+    tankInit(&game, NULL, seed);
+    while (graded < positions) {
+        if (game.over) tankInit(&game, NULL, ++seed);
+        if (!tankMovementTick(&game)) {
+            tankStep(&game, idle);
+            continue;
+        }
+
+        //grade every so often once the AI has driven out of its opening
+        if (game.aiMoves[1] >= game.aiOpening && ++ticks % GRADE_EVERY_TICKS == 0) {
+            double bestValue, aiValue;
+            int best;
+
+            result.root = game;
+            runSearch(pool, &result, seconds, 1);
+            best = bestMove(&result, 1, &bestValue);
+            aiValue = moveValue(&result, 1, MOVE_AI);
+            bestCount[best]++;
+            if (best == MOVE_AI) {
+                agreed++;
+            } else {
+                loss += bestValue - aiValue;
+                if (bestValue - aiValue > worst) worst = bestValue - aiValue;
+            }
+            graded++;
+        }
+        input[0] = tankAIMove(&game, 0);
+        input[1] = tankAIMove(&game, 1);
+        tankStep(&game, input);
+    }
+
+    printf("%d positions, %.0f ms each on %d threads\n", graded, seconds * 1000.0, pool->threads);
+    printf("attack() was the best move in %d (%.1f%%)\n", agreed, 100.0 * agreed / graded);
+    printf("value given up: %.3f a position on average, %.3f at worst (1 is a won game)\n", loss / graded, worst);
+    printf("best moves:");
+    for (move = 0; move < MAX_MOVES; move++) printf(" %s %d", moveNames[move], bestCount[move]);
+    printf("\n");
+}
+
+//------------------------------ usage ------------------------------
+// Purpose: Print how to run the tool and exit.
+// Parameters: None
+// Preconditions: None
+// Postconditions: Does not return
+static void usage(void) {
+    fprintf(stderr, "usage: tankmcts search [--threads n] [--ms n] [--tank n] [--seed n] [--frames n] [--observation file]\n"
+                    "       tankmcts bench [--threads n] [--ms n]\n"
+                    "       tankmcts grade [--threads n] [--ms n] [--positions n] [--seed n]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cores > 0 ? (int)cores : 1;
+    int milliseconds = 1000;
+    int tank = -1;
+    int frames = 1200;
+    int positions = 20;
+    uint32_t seed = 12345;
+    const char *observation = NULL;
+    TankGame root;
+    Pool pool;
+    int n;
+
+    if (argc < 2) usage();
+    for (n = 2; n < argc; n++) {
+        if (strcmp(argv[n], "--threads") == 0 && n + 1 < argc) threads = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--ms") == 0 && n + 1 < argc) milliseconds = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--tank") == 0 && n + 1 < argc) tank = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--seed") == 0 && n + 1 < argc) seed = (uint32_t)strtoul(argv[++n], NULL, 0);
+        else if (strcmp(argv[n], "--frames") == 0 && n + 1 < argc) frames = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--positions") == 0 && n + 1 < argc) positions = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--observation") == 0 && n + 1 < argc) observation = argv[++n];
+        else usage();
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (milliseconds < 1 || tank > 1 || frames < 0 || positions < 1) usage();
+
+    nodePool = calloc(MAX_NODES, sizeof(Node));
+    slotPool = calloc((size_t)MAX_NODES * MOVES, sizeof(*slotPool));
+    if (nodePool == NULL || slotPool == NULL) fail("out of memory", "node pool");
+
+    if (strcmp(argv[1], "bench") == 0) {
+        bench(threads, milliseconds / 1000.0);
+    } else if (strcmp(argv[1], "search") == 0 || strcmp(argv[1], "grade") == 0) {
+        poolCreate(&pool, threads);
+        if (argv[1][0] == 'g') {
+            grade(&pool, positions, seed, milliseconds / 1000.0);
+        } else {
+            if (observation != NULL) {
+                n = readObservation(&root, observation);
+                if (tank < 0) tank = n;
+            } else {
+                selfPlay(&root, seed, frames);
+            }
+            if (root.over) fail("the game is over", observation != NULL ? observation : "try fewer --frames");
+            search(&pool, &root, tank < 0 ? 1 : tank, milliseconds / 1000.0);
+        }
+        poolFree(&pool);
+    } else {
+        usage();
+    }
+    return 0;
+}
@@ -0,0 +1,852 @@
+/*
+    ----------------------------------------------- tankswarm.c --------------------------------------------------------
+    Description                 : TankCombat's rules for thousands of tanks in one large arena, for AI experiments
+    Compiler                    : Any C11 compiler on a POSIX system (uses pthreads)
+    Build                       : cc -O2 -pthread -o tankswarm tools/tankswarm.c tools/tankcore.c
+    --------------------------------------------------------------------------------------------------------------------
+    Usage:
+        tankswarm bench [--threads n] [--frames n] [--max-tanks n]
+            Time frames for 1024 tanks, then 2048 and so on up to --max-tanks (default 65536), in an arena
+            that grows with them, and print the time per frame and per tank.
+        tankswarm check [--threads n] [--tanks n] [--frames n]
+            Play the same swarm on one thread and on n, and check every frame comes out the same.
+
+    A swarm plays the rules of tankcore.c (the original variant) for every tank at once: movement ticks
+    every TANK_MOVE_TICK_FRAMES frames, diagonal moves every other tick, backing off a wall four steps,
+    spinning when hit, and shells that move every frame and stop at a wall or the first tank they hit.
+    As on the machine, a frame finds collisions from where things were drawn the frame before, pixel for
+    pixel against the tank pictures and the arena's playfield pixels. Each tank has TANK_SHELLS / 2
+    shells and the same reload time, and every tank is driven by a simple random policy of its own.
+    There is no game over, tanks keep score for as long as the swarm runs.
+
+    Every tank and shell field is its own array, so each pass over the swarm reads only the fields it
+    uses, and the tanks are numbered in grid cell order when the swarm is made, so a range of tanks covers
+    a patch of the board. Tank against wall is a lookup in the arena's playfield pixels, which are a uniform
+    grid already, kept as a bit map in the screen's format (4 pixels a byte) and checked with tankcore's
+    tankPictureOnWall, so the swarm, the rules and the game share one copy of the movement, spin and wall
+    rules; shell against tank goes through a uniform grid of GRID_SIZE board pixel cells, rebuilt from the drawn
+    tank positions every frame with a counting sort.
+
+    A frame is played in phases, each split over the threads in contiguous ranges of tanks and their
+    shells, with a barrier between phases. A phase only writes the tanks and shells in its own range and
+    only reads what earlier phases wrote, and the few things that touch two tanks at once (a shell hitting a tank) are
+    applied by one thread in shell order, so a swarm plays out the same on any number of threads.
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tankcore.h"
+
+#define MAX_THREADS         64
+#define SHELLS_PER_TANK     (TANK_SHELLS / 2)
+#define TANK_SPACE          48             //board pixels of arena per tank, each way
+#define GRID_SHIFT          5
+#define GRID_SIZE           (1 << GRID_SHIFT)   //board pixels per shell to tank grid cell, each way
+#define WALL_BLOCKS         8              //wall blocks per 64 tanks
+#define WRAP_MARGIN         4              //a tank spun this close to the edge comes round the other side
+#define NO_HIT              0xFFFFFFFFu
+#define HIT_WALL            0xFFFFFFFEu
+
+#define FP_INT(v)           ((v) >> TANK_FP_SHIFT)
+#define TO_FP(n)            ((n) * TANK_FP_ONE)
+
+typedef struct Swarm Swarm;
+
+//A helper thread's share of the swarm
+typedef struct {
+    Swarm *swarm;
+    int index;
+} Helper;
+
+struct Swarm {
+    int threads;
+
+    //tanks
+    int tanks;
+    int32_t *row;                           //board pixels in fixed point, as in tankcore.h
+    int32_t *column;
+    uint8_t *direction;
+    uint8_t *firstDiag;
+    uint8_t *hitTime;                       //movement ticks of spin left, 0 when not hit
+    uint8_t *hitDir;
+    uint8_t *fireDelay;
+    uint8_t *lastMove;
+    uint8_t *history;
+    uint8_t *shellNext;
+    uint32_t *score;
+    uint32_t *random;                       //each tank's own policy state
+    uint8_t *policyMove;
+    uint8_t *policyTicks;
+    int32_t *drawnRow;
+    int32_t *drawnColumn;
+    uint8_t *drawnDirection;
+
+    //shells, shell s belongs to tank s / SHELLS_PER_TANK
+    int shells;
+    int32_t *shellRow;
+    int32_t *shellColumn;
+    uint8_t *shellDirection;
+    uint8_t *shellExists;
+    int32_t *drawnShellRow;
+    int32_t *drawnShellColumn;
+    uint8_t *drawnShellExists;
+
+    //the arena: a bit map in the screen's format, playfield pixels 4 board pixels wide and 8 high
+    int boardColumns;
+    int boardRows;
+    int wallColumns;                        //playfield pixels across
+    int wallWidth;                          //bytes per bit map row, 4 pixels a byte
+    int wallRows;
+    uint8_t *wall;
+
+    //shell to tank grid, the drawn tanks in each cell in tank order
+    int gridColumns;
+    int gridRows;
+    int cells;
+    uint32_t *cellStart;                    //cells + 1
+    uint32_t *cellTanks;
+    uint32_t *cellFill;                     //threads x cells: counts, then where each thread writes
+    uint32_t *tankCell;
+
+    //shells that hit something this frame, listed by each thread from its range in shell order
+    uint32_t *hitShell;
+    uint32_t *hitTarget;
+    int hitCount[MAX_THREADS];
+
+    uint8_t frameDelay;
+    uint8_t movementTick;
+    uint32_t frame;
+
+    pthread_t thread[MAX_THREADS];
+    Helper helper[MAX_THREADS];
+    pthread_barrier_t barrier;
+    int quitting;
+};
+
+//------------------------------ fail ------------------------------
+// Purpose: Print an error and exit.
+// Parameters:
+//   message - What went wrong.
+//   detail - The value it went wrong with.
+// Preconditions: None
+// Postconditions: Does not return
+static void fail(const char *message, const char *detail) {
+    fprintf(stderr, "tankswarm: %s: %s\n", message, detail);
+    exit(1);
+}
+
+//------------------------------ allocate ------------------------------
+// Purpose: Allocate a zeroed array, exiting if there is no memory.
+// Parameters:
+//   count - Elements.
+//   size - Bytes per element.
+// Preconditions: None
+// Postconditions: Returns the array
+static void *allocate(size_t count, size_t size) {
+    void *block = calloc(count > 0 ? count : 1, size);
+
+    if (block == NULL) fail("out of memory", "calloc");
+    return block;
+}
+
+//------------------------------ nextRandom ------------------------------
+// Purpose: Step an xorshift generator.
+// Parameters:
+//   state - The generator.
+// Preconditions: *state is not 0
+// Postconditions: Returns the next value
+static uint32_t nextRandom(uint32_t *state) {
+    uint32_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+//------------------------------ wallAt ------------------------------
+// Purpose: Check whether the arena has a wall at a board pixel, with the
+//          playfield lined up against the board as it is on screen.
+// Parameters:
+//   swarm - The swarm.
+//   row, column - Board pixel.
+// Preconditions: None
+// Postconditions: Returns 1 for a wall, or anywhere outside the arena
+static int wallAt(const Swarm *swarm, int row, int column) {
+    int x = (column + TANK_BOARD_LEFT - TANK_PLAYFIELD_LEFT) >> 2;
+    int y = (row + TANK_BOARD_TOP - TANK_PLAYFIELD_TOP) >> 3;
+
+    if (x < 0 || y < 0 || x >= swarm->wallColumns || y >= swarm->wallRows) return 1;
+    return tankBitMapWallAt(swarm->wall, swarm->wallWidth, swarm->wallRows, column + TANK_BOARD_LEFT, row + TANK_BOARD_TOP);
+}
+
+//------------------------------ setWall ------------------------------
+// Purpose: Put a wall in one playfield pixel of the arena.
+// Parameters:
+//   swarm - The swarm.
+//   x, y - The playfield pixel.
+// Preconditions: The pixel is inside the arena
+// Postconditions: The pixel is set, in color 2 as createBitMap's border is
+static void setWall(Swarm *swarm, int x, int y) {
+    swarm->wall[y * swarm->wallWidth + (x >> 2)] |= (uint8_t)(0x80u >> ((x & 3) * 2));
+}
+
+//------------------------------ tankOnWall ------------------------------
+// Purpose: The player to playfield collision for a tank as drawn last frame.
+// Parameters:
+//   swarm - The swarm.
+//   tank - The tank.
+// Preconditions: None
+// Postconditions: Returns 1 if any of its pixels lies on a wall
+static int tankOnWall(const Swarm *swarm, int tank) {
+    return tankPictureOnWall(swarm->wall, swarm->wallWidth, swarm->wallRows, swarm->drawnDirection[tank],
+                             FP_INT(swarm->drawnColumn[tank]) - TANK_HALF + TANK_BOARD_LEFT,
+                             FP_INT(swarm->drawnRow[tank]) - TANK_HALF + TANK_BOARD_TOP);
+}
+
+//------------------------------ tankCovers ------------------------------
+// Purpose: Check whether a tank's picture as drawn last frame covers a board pixel.
+// Parameters:
+//   swarm - The swarm.
+//   tank - The tank.
+//   row, column - Board pixel.
+// Preconditions: None
+// Postconditions: Returns 1 if it does
+static int tankCovers(const Swarm *swarm, int tank, int row, int column) {
+    int y = row - (FP_INT(swarm->drawnRow[tank]) - TANK_HALF);
+    int x = column - (FP_INT(swarm->drawnColumn[tank]) - TANK_HALF);
+
+    if (x < 0 || x >= 8 || y < 0 || y >= TANK_ROWS) return 0;
+    return (tankPics[swarm->drawnDirection[tank]][y] >> (7 - x)) & 1;
+}
+
+//------------------------------ gridCell ------------------------------
+// Purpose: The grid cell a board pixel is in, clamped to the grid.
+// Parameters:
+//   swarm - The swarm.
+//   row, column - Board pixel.
+// Preconditions: None
+// Postconditions: Returns the cell's index
+static int gridCell(const Swarm *swarm, int row, int column) {
+    int x = column >> GRID_SHIFT;
+    int y = row >> GRID_SHIFT;
+
+    if (x < 0) x = 0;
+    if (x >= swarm->gridColumns) x = swarm->gridColumns - 1;
+    if (y < 0) y = 0;
+    if (y >= swarm->gridRows) y = swarm->gridRows - 1;
+    return y * swarm->gridColumns + x;
+}
+
+//------------------------------ policyMove ------------------------------
+// Purpose: A tank's move for this movement tick: a random move held for a few
+//          ticks, driving forward more often than not.
+// Parameters:
+//   swarm - The swarm.
+//   tank - The tank.
+// Preconditions: Called once a movement tick
+// Postconditions: Returns the tank's joystick bits
+static uint8_t policyMove(Swarm *swarm, int tank) {
+    static const uint8_t moves[8] = {TANK_FORWARD, TANK_FORWARD, TANK_FORWARD, TANK_BACKWARD,
+                                     TANK_LEFT_TURN, TANK_RIGHT_TURN, TANK_FIRE, TANK_FIRE};
+
+    if (swarm->policyTicks[tank] == 0) {
+        uint32_t r = nextRandom(&swarm->random[tank]);
+
+        swarm->policyMove[tank] = moves[r & 7];
+        swarm->policyTicks[tank] = (uint8_t)(1 + ((r >> 3) & 7));
+    }
+    swarm->policyTicks[tank]--;
+    return swarm->policyMove[tank];
+}
+
+//------------------------------ moveTank ------------------------------
+// Purpose: Step a tank forward (steps 1) or backward (steps -1).
+// Parameters:
+//   swarm - The swarm.
+//   tank - The tank.
+//   steps - 1 or -1.
+// Preconditions: None
+// Postconditions: The tank has moved
+static void moveTank(Swarm *swarm, int tank, int steps) {
+    swarm->firstDiag[tank] = 0;
+    swarm->row[tank] += steps * tankDeltas[swarm->direction[tank]][0];
+    swarm->column[tank] += steps * tankDeltas[swarm->direction[tank]][1];
+}
+
+//------------------------------ fireShell ------------------------------
+// Purpose: Launch one of a tank's shells from the tip of its barrel.
+// Parameters:
+//   swarm - The swarm.
+//   tank - The tank.
+// Preconditions: The tank is reloaded
+// Postconditions: The shell is in flight
+static void fireShell(Swarm *swarm, int tank) {
+    int first = tank * SHELLS_PER_TANK;
+    int shell = first + swarm->shellNext[tank];
+    int direction = swarm->direction[tank];
+    int offset[2];
+    int n;
+
+    for (n = first; n < first + SHELLS_PER_TANK; n++) {
+        if (!swarm->shellExists[n]) {
+            shell = n;
+            break;
+        }
+    }
+    swarm->shellNext[tank] = (uint8_t)((shell - first + 1) % SHELLS_PER_TANK);
+
+    tankShellStart((uint8_t)direction, offset);
+    swarm->shellDirection[shell] = (uint8_t)direction;
+    swarm->shellRow[shell] = swarm->row[tank] + offset[0];
+    swarm->shellColumn[shell] = swarm->column[tank] + offset[1];
+    swarm->shellExists[shell] = 1;
+    swarm->fireDelay[tank] = 1;
+}
+
+//------------------------------ spinTank ------------------------------
+// Purpose: Turn a hit tank two steps and push it away from the shell, wrapping
+//          it round to the other side at the arena's edge, as checkBorders does.
+// Parameters:
+//   swarm - The swarm.
+//   tank - The tank.
+// Preconditions: The tank is hit
+// Postconditions: The tank has spun, with one tick less to go
+static void spinTank(Swarm *swarm, int tank) {
+    int push[2];
+    int row, column;
+
+    swarm->direction[tank] = tankSpin(swarm->hitDir[tank], swarm->direction[tank], push);
+    swarm->row[tank] += push[0];
+    swarm->column[tank] += push[1];
+    swarm->hitTime[tank]--;
+
+    row = FP_INT(swarm->row[tank]);
+    column = FP_INT(swarm->column[tank]);
+    if (column <= WRAP_MARGIN) swarm->column[tank] = TO_FP(swarm->boardColumns - WRAP_MARGIN - 1);
+    else if (column >= swarm->boardColumns - WRAP_MARGIN) swarm->column[tank] = TO_FP(WRAP_MARGIN + 1);
+    if (row <= WRAP_MARGIN) swarm->row[tank] = TO_FP(swarm->boardRows - WRAP_MARGIN - 1);
+    else if (row >= swarm->boardRows - WRAP_MARGIN) swarm->row[tank] = TO_FP(WRAP_MARGIN + 1);
+}
+
+//------------------------------ range ------------------------------
+// Purpose: The contiguous part of n items a thread looks after.
+// Parameters:
+//   swarm - The swarm.
+//   thread - The thread.
+//   n - Number of items.
+//   first, last - Set to the thread's items, first to last - 1.
+// Preconditions: None
+// Postconditions: The threads' ranges cover 0 to n - 1 in thread order
+static void range(const Swarm *swarm, int thread, int n, int *first, int *last) {
+    *first = (int)((int64_t)n * thread / swarm->threads);
+    *last = (int)((int64_t)n * (thread + 1) / swarm->threads);
+}
+
+//------------------------------ stepPhases ------------------------------
+// Purpose: One thread's share of a frame, phase by phase.
+// Parameters:
+//   swarm - The swarm.
+//   thread - The thread, 0 for the thread that called swarmStep.
+// Preconditions: Every thread runs this for the same frame
+// Postconditions: The frame has been played
+static void stepPhases(Swarm *swarm, int thread) {
+    int firstTank, lastTank, firstShell, lastShell;
+    uint32_t *fill = swarm->cellFill + (size_t)thread * swarm->cells;
+    int i, n;
+
+    //a thread looks after its tanks' shells, so firing stays inside its range
+    range(swarm, thread, swarm->tanks, &firstTank, &lastTank);
+    firstShell = firstTank * SHELLS_PER_TANK;
+    lastShell = lastTank * SHELLS_PER_TANK;
+
+    //moves, spins and reloads, each tank on its own
+    for (i = firstTank; i < lastTank; i++) {
+        if (swarm->movementTick) {
+            uint8_t move = policyMove(swarm, i);
+            int hit = swarm->hitTime[i] > 0;
+
+            swarm->lastMove[i] = move;
+            if ((move & TANK_FIRE) && swarm->fireDelay[i] == 0 && !hit) {
+                fireShell(swarm, i);
+            } else if ((move & (TANK_FORWARD | TANK_BACKWARD)) && !hit) {
+                if (tankTakesStep(swarm->direction[i], &swarm->firstDiag[i])) moveTank(swarm, i, (move & TANK_FORWARD) ? 1 : -1);
+            } else if ((move & TANK_LEFT_TURN) || ((move & TANK_RIGHT_TURN) && !hit)) {
+                swarm->direction[i] = tankTurn(swarm->direction[i], move);
+            }
+            if (hit) spinTank(swarm, i);
+        }
+        if (swarm->fireDelay[i] > 0 && ++swarm->fireDelay[i] > TANK_P0_FIRE_COOLDOWN) swarm->fireDelay[i] = 0;
+    }
+
+    //shells move every frame, and the drawn tanks are counted into the grid
+    for (n = firstShell; n < lastShell; n++) {
+        if (!swarm->shellExists[n]) continue;
+        swarm->shellRow[n] += tankDeltas[swarm->shellDirection[n]][0];
+        swarm->shellColumn[n] += tankDeltas[swarm->shellDirection[n]][1];
+    }
+    memset(fill, 0, sizeof(uint32_t) * swarm->cells);
+    for (i = firstTank; i < lastTank; i++) {
+        uint32_t cell = (uint32_t)gridCell(swarm, FP_INT(swarm->drawnRow[i]), FP_INT(swarm->drawnColumn[i]));
+
+        swarm->tankCell[i] = cell;
+        fill[cell]++;
+    }
+    pthread_barrier_wait(&swarm->barrier);
+
+    //where each thread's tanks go in each cell: cell by cell, thread by thread, so tanks stay in order
+    if (thread == 0) {
+        uint32_t next = 0;
+        int cell, t;
+
+        for (cell = 0; cell < swarm->cells; cell++) {
+            swarm->cellStart[cell] = next;
+            for (t = 0; t < swarm->threads; t++) {
+                uint32_t *count = &swarm->cellFill[(size_t)t * swarm->cells + cell];
+                uint32_t tanks = *count;
+
+                *count = next;
+                next += tanks;
+            }
+        }
+        swarm->cellStart[swarm->cells] = next;
+    }
+    pthread_barrier_wait(&swarm->barrier);
+
+    for (i = firstTank; i < lastTank; i++) swarm->cellTanks[fill[swarm->tankCell[i]]++] = (uint32_t)i;
+    pthread_barrier_wait(&swarm->barrier);
+
+    //collisions, from what was drawn last frame: tanks off walls, then shells against the grid
+    for (i = firstTank; i < lastTank; i++) {
+        if (!tankOnWall(swarm, i)) continue;
+        if (swarm->history[i] & TANK_FORWARD) {
+            for (n = 0; n < 4; n++) moveTank(swarm, i, -1);
+        } else if (swarm->history[i] & TANK_BACKWARD) {
+            for (n = 0; n < 4; n++) moveTank(swarm, i, 1);
+        }
+    }
+
+    swarm->hitCount[thread] = 0;
+    for (n = firstShell; n < lastShell; n++) {
+        int owner = n / SHELLS_PER_TANK;
+        uint32_t target = NO_HIT;
+        int row, column, cellRow, cellColumn;
+
+        if (!swarm->shellExists[n] || !swarm->drawnShellExists[n]) continue;
+        row = FP_INT(swarm->drawnShellRow[n]);
+        column = FP_INT(swarm->drawnShellColumn[n]);
+
+        //a tank covering the pixel has its middle within TANK_HALF of it, so look at the cells that can be in
+        for (cellRow = (row - TANK_HALF) >> GRID_SHIFT; cellRow <= (row + TANK_HALF) >> GRID_SHIFT; cellRow++) {
+            for (cellColumn = (column - TANK_HALF) >> GRID_SHIFT; cellColumn <= (column + TANK_HALF) >> GRID_SHIFT; cellColumn++) {
+                uint32_t cell, k;
+
+                if (cellRow < 0 || cellColumn < 0 || cellRow >= swarm->gridRows || cellColumn >= swarm->gridColumns) continue;
+                cell = (uint32_t)(cellRow * swarm->gridColumns + cellColumn);
+                for (k = swarm->cellStart[cell]; k < swarm->cellStart[cell + 1]; k++) {
+                    uint32_t tank = swarm->cellTanks[k];
+
+                    //the lowest numbered tank hit takes the shell, whichever cell it is in
+                    if ((int)tank != owner && tank < target && tankCovers(swarm, (int)tank, row, column)) target = tank;
+                }
+            }
+        }
+        if (target == NO_HIT && wallAt(swarm, row, column)) target = HIT_WALL;
+        if (target != NO_HIT) {
+            int slot = firstShell + swarm->hitCount[thread]++;
+
+            swarm->hitShell[slot] = (uint32_t)n;
+            swarm->hitTarget[slot] = target;
+        }
+    }
+    pthread_barrier_wait(&swarm->barrier);
+
+    //hits touch two tanks, so one thread scores them, in shell order
+    if (thread == 0) {
+        int t, k;
+
+        for (t = 0; t < swarm->threads; t++) {
+            int first, last;
+
+            range(swarm, t, swarm->tanks, &first, &last);
+            first *= SHELLS_PER_TANK;
+            for (k = 0; k < swarm->hitCount[t]; k++) {
+                uint32_t shell = swarm->hitShell[first + k];
+                uint32_t target = swarm->hitTarget[first + k];
+
+                swarm->shellExists[shell] = 0;
+                if (target == HIT_WALL) continue;
+                swarm->score[shell / SHELLS_PER_TANK]++;
+                swarm->hitDir[target] = swarm->shellDirection[shell];
+                swarm->hitTime[target] = TANK_HIT_SPIN_TICKS;
+            }
+        }
+    }
+    pthread_barrier_wait(&swarm->barrier);
+
+    //draw the frame
+    for (i = firstTank; i < lastTank; i++) {
+        swarm->history[i] = swarm->lastMove[i];
+        swarm->drawnRow[i] = swarm->row[i];
+        swarm->drawnColumn[i] = swarm->column[i];
+        swarm->drawnDirection[i] = swarm->direction[i];
+    }
+    for (n = firstShell; n < lastShell; n++) {
+        swarm->drawnShellRow[n] = swarm->shellRow[n];
+        swarm->drawnShellColumn[n] = swarm->shellColumn[n];
+        swarm->drawnShellExists[n] = swarm->shellExists[n];
+    }
+}
+
+//------------------------------ runThread ------------------------------
+// Purpose: A helper thread: play its share of every frame swarmStep starts.
+// Parameters:
+//   argument - Its Helper.
+// Preconditions: None
+// Postconditions: Returns once the swarm is freed
+static void *runThread(void *argument) {
+    Helper *helper = argument;
+    Swarm *swarm = helper->swarm;
+
+    for (;;) {
+        pthread_barrier_wait(&swarm->barrier);
+        if (swarm->quitting) return NULL;
+        stepPhases(swarm, helper->index);
+        pthread_barrier_wait(&swarm->barrier);
+    }
+}
+
+//------------------------------ compareKeys ------------------------------
+// Purpose: qsort order for sortTanks' keys.
+// Parameters:
+//   a, b - The keys.
+// Preconditions: None
+// Postconditions: Returns below, at or above 0 as a is below, at or above b
+static int compareKeys(const void *a, const void *b) {
+    uint64_t left = *(const uint64_t *)a, right = *(const uint64_t *)b;
+
+    return (left > right) - (left < right);
+}
+
+//------------------------------ sortTanks ------------------------------
+// Purpose: Number the tanks in grid cell order, so tanks next to each other on the board are next to each
+//          other in the arrays and the wall and grid lookups of a range of tanks stay in a few cache lines.
+// Parameters:
+//   swarm - The swarm, with its tanks placed.
+// Preconditions: Only the tank positions and headings are set
+// Postconditions: The positions and headings are reordered, the other fields are untouched
+static void sortTanks(Swarm *swarm) {
+    uint64_t *keys = allocate((size_t)swarm->tanks, sizeof(uint64_t));
+    int32_t *row = allocate((size_t)swarm->tanks, sizeof(int32_t));
+    int32_t *column = allocate((size_t)swarm->tanks, sizeof(int32_t));
+    uint8_t *direction = allocate((size_t)swarm->tanks, 1);
+    int i;
+
+    for (i = 0; i < swarm->tanks; i++) {
+        keys[i] = (uint64_t)gridCell(swarm, FP_INT(swarm->row[i]), FP_INT(swarm->column[i])) << 32 | (uint32_t)i;
+        row[i] = swarm->row[i];
+        column[i] = swarm->column[i];
+        direction[i] = swarm->direction[i];
+    }
+    qsort(keys, (size_t)swarm->tanks, sizeof(uint64_t), compareKeys);
+    for (i = 0; i < swarm->tanks; i++) {
+        uint32_t from = (uint32_t)keys[i];
+
+        swarm->row[i] = swarm->drawnRow[i] = row[from];
+        swarm->column[i] = swarm->drawnColumn[i] = column[from];
+        swarm->direction[i] = swarm->drawnDirection[i] = direction[from];
+    }
+    free(keys); free(row); free(column); free(direction);
+}
+
+//------------------------------ swarmCreate ------------------------------
+// Purpose: Set up a swarm: an arena with a border and scattered wall blocks
+//          sized for the tanks, and the tanks at random open places.
+// Parameters:
+//   swarm - The swarm to set up.
+//   tanks - Number of tanks.
+//   threads - Threads to play it on, 1 - MAX_THREADS.
+//   seed - Seed for the arena, the start and every tank's policy.
+// Preconditions: None
+// Postconditions: The swarm is ready for swarmStep, its threads are waiting
+static void swarmCreate(Swarm *swarm, int tanks, int threads, uint32_t seed) {
+    uint32_t random = seed != 0 ? seed : 1;
+    int side, blocks, i, x, y;
+
+    memset(swarm, 0, sizeof(*swarm));
+    swarm->threads = threads;
+    swarm->tanks = tanks;
+    swarm->shells = tanks * SHELLS_PER_TANK;
+
+    //a square arena with TANK_SPACE x TANK_SPACE board pixels for each tank
+    for (side = 1; side * side < tanks; side++) {
+    }
+    swarm->boardColumns = side * TANK_SPACE;
+    swarm->boardRows = side * TANK_SPACE;
+    swarm->wallColumns = (swarm->boardColumns + TANK_BOARD_LEFT - TANK_PLAYFIELD_LEFT) / 4 + 1;
+    swarm->wallRows = (swarm->boardRows + TANK_BOARD_TOP - TANK_PLAYFIELD_TOP) / 8 + 1;
+    swarm->wallWidth = (swarm->wallColumns + 3) / 4;
+    swarm->wall = allocate((size_t)swarm->wallWidth * swarm->wallRows, 1);
+    for (x = 0; x < swarm->wallColumns; x++) {
+        setWall(swarm, x, 0);
+        setWall(swarm, x, swarm->wallRows - 1);
+    }
+    for (y = 0; y < swarm->wallRows; y++) {
+        setWall(swarm, 0, y);
+        setWall(swarm, swarm->wallColumns - 1, y);
+    }
+    blocks = tanks * WALL_BLOCKS / 64 + 1;
+    for (i = 0; i < blocks; i++) {
+        int width = 1 + (int)(nextRandom(&random) % 6);
+        int height = 1 + (int)(nextRandom(&random) % 3);
+        int left = (int)(nextRandom(&random) % (uint32_t)swarm->wallColumns);
+        int top = (int)(nextRandom(&random) % (uint32_t)swarm->wallRows);
+
+        for (y = top; y < top + height && y < swarm->wallRows; y++) {
+            for (x = left; x < left + width && x < swarm->wallColumns; x++) setWall(swarm, x, y);
+        }
+    }
+
+    swarm->row = allocate((size_t)tanks, sizeof(int32_t));
+    swarm->column = allocate((size_t)tanks, sizeof(int32_t));
+    swarm->direction = allocate((size_t)tanks, 1);
+    swarm->firstDiag = allocate((size_t)tanks, 1);
+    swarm->hitTime = allocate((size_t)tanks, 1);
+    swarm->hitDir = allocate((size_t)tanks, 1);
+    swarm->fireDelay = allocate((size_t)tanks, 1);
+    swarm->lastMove = allocate((size_t)tanks, 1);
+    swarm->history = allocate((size_t)tanks, 1);
+    swarm->shellNext = allocate((size_t)tanks, 1);
+    swarm->score = allocate((size_t)tanks, sizeof(uint32_t));
+    swarm->random = allocate((size_t)tanks, sizeof(uint32_t));
+    swarm->policyMove = allocate((size_t)tanks, 1);
+    swarm->policyTicks = allocate((size_t)tanks, 1);
+    swarm->drawnRow = allocate((size_t)tanks, sizeof(int32_t));
+    swarm->drawnColumn = allocate((size_t)tanks, sizeof(int32_t));
+    swarm->drawnDirection = allocate((size_t)tanks, 1);
+
+    swarm->shellRow = allocate((size_t)swarm->shells, sizeof(int32_t));
+    swarm->shellColumn = allocate((size_t)swarm->shells, sizeof(int32_t));
+    swarm->shellDirection = allocate((size_t)swarm->shells, 1);
+    swarm->shellExists = allocate((size_t)swarm->shells, 1);
+    swarm->drawnShellRow = allocate((size_t)swarm->shells, sizeof(int32_t));
+    swarm->drawnShellColumn = allocate((size_t)swarm->shells, sizeof(int32_t));
+    swarm->drawnShellExists = allocate((size_t)swarm->shells, 1);
+
+    swarm->gridColumns = (swarm->boardColumns >> GRID_SHIFT) + 1;
+    swarm->gridRows = (swarm->boardRows >> GRID_SHIFT) + 1;
+    swarm->cells = swarm->gridColumns * swarm->gridRows;
+    swarm->cellStart = allocate((size_t)swarm->cells + 1, sizeof(uint32_t));
+    swarm->cellTanks = allocate((size_t)tanks, sizeof(uint32_t));
+    swarm->cellFill = allocate((size_t)swarm->cells * threads, sizeof(uint32_t));
+    swarm->tankCell = allocate((size_t)tanks, sizeof(uint32_t));
+    swarm->hitShell = allocate((size_t)swarm->shells, sizeof(uint32_t));
+    swarm->hitTarget = allocate((size_t)swarm->shells, sizeof(uint32_t));
+
+    for (i = 0; i < tanks; i++) {
+        //an open place, with room for the whole tank
+        do {
+            swarm->drawnRow[i] = TO_FP(TANK_ROWS + (int)(nextRandom(&random) % (uint32_t)(swarm->boardRows - 2 * TANK_ROWS)));
+            swarm->drawnColumn[i] = TO_FP(TANK_ROWS + (int)(nextRandom(&random) % (uint32_t)(swarm->boardColumns - 2 * TANK_ROWS)));
+            swarm->drawnDirection[i] = (uint8_t)(nextRandom(&random) & (TANK_HEADINGS - 1));
+        } while (tankOnWall(swarm, i));
+        swarm->row[i] = swarm->drawnRow[i];
+        swarm->column[i] = swarm->drawnColumn[i];
+        swarm->direction[i] = swarm->drawnDirection[i];
+        swarm->random[i] = nextRandom(&random) | 1;
+    }
+    sortTanks(swarm);
+
+    if (pthread_barrier_init(&swarm->barrier, NULL, (unsigned)threads) != 0) fail("cannot start threads", "pthread_barrier_init");
+    for (i = 1; i < threads; i++) {
+        swarm->helper[i].swarm = swarm;
+        swarm->helper[i].index = i;
+        if (pthread_create(&swarm->thread[i], NULL, runThread, &swarm->helper[i]) != 0) fail("cannot start threads", "pthread_create");
+    }
+}
+
+//------------------------------ swarmStep ------------------------------
+// Purpose: Play one frame of the swarm on all of its threads.
+// Parameters:
+//   swarm - The swarm.
+// Preconditions: swarmCreate has set it up
+// Postconditions: The swarm is a frame on
+static void swarmStep(Swarm *swarm) {
+    swarm->movementTick = swarm->frameDelay == TANK_MOVE_TICK_FRAMES;
+    swarm->frameDelay = swarm->movementTick ? 0 : swarm->frameDelay + 1;
+
+    if (swarm->threads > 1) pthread_barrier_wait(&swarm->barrier);
+    stepPhases(swarm, 0);
+    if (swarm->threads > 1) pthread_barrier_wait(&swarm->barrier);
+    swarm->frame++;
+}
+
+//------------------------------ swarmFree ------------------------------
+// Purpose: Stop a swarm's threads and free it.
+// Parameters:
+//   swarm - The swarm.
+// Preconditions: swarmCreate has set it up
+// Postconditions: Its memory is freed
+static void swarmFree(Swarm *swarm) {
+    int i;
+
+    swarm->quitting = 1;
+    if (swarm->threads > 1) pthread_barrier_wait(&swarm->barrier);
+    for (i = 1; i < swarm->threads; i++) pthread_join(swarm->thread[i], NULL);
+    pthread_barrier_destroy(&swarm->barrier);
+
+    free(swarm->wall);
+    free(swarm->row); free(swarm->column); free(swarm->direction); free(swarm->firstDiag);
+    free(swarm->hitTime); free(swarm->hitDir); free(swarm->fireDelay); free(swarm->lastMove);
+    free(swarm->history); free(swarm->shellNext); free(swarm->score); free(swarm->random);
+    free(swarm->policyMove); free(swarm->policyTicks);
+    free(swarm->drawnRow); free(swarm->drawnColumn); free(swarm->drawnDirection);
+    free(swarm->shellRow); free(swarm->shellColumn); free(swarm->shellDirection); free(swarm->shellExists);
+    free(swarm->drawnShellRow); free(swarm->drawnShellColumn); free(swarm->drawnShellExists);
+    free(swarm->cellStart); free(swarm->cellTanks); free(swarm->cellFill); free(swarm->tankCell);
+    free(swarm->hitShell); free(swarm->hitTarget);
+}
+
+//------------------------------ swarmHash ------------------------------
+// Purpose: A hash of everything a frame leaves behind, to compare runs.
+// Parameters:
+//   swarm - The swarm.
+// Preconditions: None
+// Postconditions: Returns the FNV-1a hash of the tanks, shells and scores
+static uint64_t swarmHash(const Swarm *swarm) {
+    uint64_t hash = 14695981039346656037u;
+    const void *fields[] = {swarm->row, swarm->column, swarm->direction, swarm->hitTime, swarm->score,
+                            swarm->shellRow, swarm->shellColumn, swarm->shellExists};
+    size_t sizes[] = {4u * swarm->tanks, 4u * swarm->tanks, (size_t)swarm->tanks, (size_t)swarm->tanks, 4u * swarm->tanks,
+                      4u * swarm->shells, 4u * swarm->shells, (size_t)swarm->shells};
+    size_t f, n;
+
+    for (f = 0; f < sizeof(sizes) / sizeof(sizes[0]); f++) {
+        const uint8_t *bytes = fields[f];
+
+        for (n = 0; n < sizes[f]; n++) hash = (hash ^ bytes[n]) * 1099511628211u;
+    }
+    return hash;
+}
+
+//------------------------------ nowSeconds ------------------------------
+// Purpose: Read the monotonic clock.
+// Parameters: None
+// Preconditions: None
+// Postconditions: Returns the time in seconds
+static double nowSeconds(void) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+//------------------------------ bench ------------------------------
+// Purpose: Time swarms of doubling size and print the time per frame and per tank.
+// Parameters:
+//   threads - Threads to play on.
+//   frames - Frames to time for each size.
+//   maxTanks - Largest swarm.
+// Preconditions: None
+// Postconditions: One line printed for each size
+static void bench(int threads, int frames, int maxTanks) {
+    Swarm swarm;
+    int tanks, n;
+
+    printf("%d threads, %d frames each\n", threads, frames);
+    printf("   tanks   shells in flight   ms/frame   ns/tank   hits/frame\n");
+    for (tanks = 1024; tanks <= maxTanks; tanks *= 2) {
+        uint64_t inFlight = 0, hits = 0, scoreBefore = 0, scoreAfter = 0;
+        double start, elapsed;
+
+        swarmCreate(&swarm, tanks, threads, 12345);
+        for (n = 0; n < 120; n++) swarmStep(&swarm);  //until the shells are flying
+        for (n = 0; n < tanks; n++) scoreBefore += swarm.score[n];
+
+        start = nowSeconds();
+        for (n = 0; n < frames; n++) swarmStep(&swarm);
+        elapsed = nowSeconds() - start;
+
+        for (n = 0; n < swarm.shells; n++) inFlight += swarm.shellExists[n];
+        for (n = 0; n < tanks; n++) scoreAfter += swarm.score[n];
+        hits = scoreAfter - scoreBefore;
+        printf("%8d   %16llu   %8.3f   %7.1f   %10.2f\n", tanks, (unsigned long long)inFlight,
+               elapsed * 1000.0 / frames, elapsed * 1e9 / frames / tanks, (double)hits / frames);
+        fflush(stdout);
+        swarmFree(&swarm);
+    }
+}
+
+//------------------------------ check ------------------------------
+// Purpose: Play the same swarm on one thread and on several, comparing every frame.
+// Parameters:
+//   threads - Threads for the second run.
+//   tanks - Tanks in the swarm.
+//   frames - Frames to compare.
+// Preconditions: None
+// Postconditions: Prints whether the runs matched, exits 1 if they did not
+static void check(int threads, int tanks, int frames) {
+    static Swarm single, several;
+    int n;
+
+    swarmCreate(&single, tanks, 1, 777);
+    swarmCreate(&several, tanks, threads, 777);
+    for (n = 0; n < frames; n++) {
+        swarmStep(&single);
+        swarmStep(&several);
+        if (swarmHash(&single) != swarmHash(&several)) {
+            printf("frame %d differs between 1 and %d threads\n", n, threads);
+            exit(1);
+        }
+    }
+    printf("%d tanks, %d frames: 1 and %d threads match, hash %016llx\n", tanks, frames, threads,
+           (unsigned long long)swarmHash(&single));
+    swarmFree(&single);
+    swarmFree(&several);
+}
+
+//------------------------------ usage ------------------------------
+// Purpose: Print how to run the tool and exit.
+// Parameters: None
+// Preconditions: None
+// Postconditions: Does not return
+static void usage(void) {
+    fprintf(stderr, "usage: tankswarm bench [--threads n] [--frames n] [--max-tanks n]\n"
+                    "       tankswarm check [--threads n] [--tanks n] [--frames n]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cores > 0 ? (int)cores : 1;
+    int frames = 0;
+    int tanks = 4096;
+    int maxTanks = 65536;
+    int n;
+
+    if (argc < 2) usage();
+    for (n = 2; n < argc; n++) {
+        if (strcmp(argv[n], "--threads") == 0 && n + 1 < argc) threads = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--frames") == 0 && n + 1 < argc) frames = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--tanks") == 0 && n + 1 < argc) tanks = atoi(argv[++n]);
+        else if (strcmp(argv[n], "--max-tanks") == 0 && n + 1 < argc) maxTanks = atoi(argv[++n]);
+        else usage();
+    }
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (tanks < 1 || maxTanks < 1 || frames < 0) usage();
+
+    if (strcmp(argv[1], "bench") == 0) bench(threads, frames > 0 ? frames : 600, maxTanks);
+    else if (strcmp(argv[1], "check") == 0) check(threads < 2 ? 4 : threads, tanks, frames > 0 ? frames : 1200);
+    else usage();
+
+    return 0;
+}
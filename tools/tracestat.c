@@ -0,0 +1,685 @@
+/*
+    ----------------------------------------------- tracestat.c -------------------------------------------------------
+    Description                 : Host side analyzer for the frame trace written by TankCombat built with -DFRAME_TRACE
+    Compiler                    : Any C99 compiler on a POSIX system (uses mmap)
+    Build                       : cc -O2 -o tracestat tools/tracestat.c
+    --------------------------------------------------------------------------------------------------------------------
+    Usage:
+        tracestat extract <memory dump> <trace file>
+            Find the frameTrace ring buffer in an emulator memory dump and append its records, oldest
+            first, to a trace file. Run it once per dump to build up a collection.
+        tracestat columns <column file> <trace file>...
+            Convert trace files into one column file: every record field stored as its own array so
+            queries only read the fields they need.
+        tracestat costs <column file>
+            Histogram of the scanlines each frame's logic used, with percentiles.
+        tracestat heatmap <column file> [<pgm file>]
+            Where on the 144x161 board tanks were hit, optionally written out as a grey scale image.
+        tracestat ai <column file>
+            How often the AI picked each move on a movement tick.
+        tracestat worst <memory dump>
+            Print the worst frame search results of a build with -DFRAME_SEARCH: the costliest frame
+            found, what it did, and the smallest state that still costs as much.
+
+    The record layout below must match FrameRecord in TankCombat.c, the search report layout
+    frameSearch.
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#define _POSIX_C_SOURCE 200809L        //ftruncate, mmap
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//frame trace definitions, from TankCombat.c
+#define TRACE_VERSION       2
+#define TRACE_HEADER_SIZE   11             //magic, version, recordSize, recordCount, next, frames, wrapped
+#define RECORD_SIZE         36
+#define TRACE_NO_MOVE       0xFF
+#define TRACE_NO_SHELL      0xFF
+#define TRACE_HIT           0x80
+
+//byte offsets of the FrameRecord fields
+#define R_FRAME             0
+#define R_SCANLINES         2
+#define R_TANK_ROW          4
+#define R_TANK_COLUMN       6
+#define R_TANK_DIRECTION    8
+#define R_SHELL_ROW         10
+#define R_SHELL_COLUMN      14
+#define R_SHELL_DIRECTION   18
+#define R_INPUT             22
+#define R_AI_MOVE           23
+#define R_MISSILE_PLAYFIELD 24
+#define R_MISSILE_PLAYER    28
+#define R_PLAYER_PLAYFIELD  32
+
+//board size, from the board frame in TankCombat.c
+#define BOARD_COLUMNS       144
+#define BOARD_ROWS          161
+
+#define FRAME_SCANLINES     262            //NTSC, a frame's logic using more than this missed vertical blank
+
+//worst frame search definitions, from TankCombat.c
+#define SEARCH_VERSION      1
+#define SEARCH_HEADER_SIZE  14             //magic, version, searches, budget, evaluations, the two scanline counts
+#define PATH_SIZE           12             //FramePath
+#define STATE_SIZE          28             //SearchRecord
+#define SEARCH_NO_SHELL     0xFF
+
+//byte offsets of the SearchRecord fields
+#define S_TANK_ROW          0
+#define S_TANK_COLUMN       2
+#define S_TANK_DIRECTION    4
+#define S_HIT_TIME          6
+#define S_HIT_DIRECTION     8
+#define S_SHELL_ROW         10
+#define S_SHELL_COLUMN      14
+#define S_SHELL_DIRECTION   18
+#define S_INPUT             22
+#define S_HISTORY           23
+#define S_FIRE_READY        25
+#define S_TICKS_AWAY        26
+#define S_AI_OPENING        27
+
+//column file definitions
+#define COLUMN_MAGIC        "TKCOLS1"
+#define COLUMN_ALIGN        8
+
+//One column per record field. The unsigned ints are kept 16 bits wide, every other byte of
+//the record gets a column of its own.
+typedef struct {
+    const char *name;
+    unsigned char offset;                   //byte offset in the record
+    unsigned char width;                    //1 or 2 bytes
+} Column;
+
+static const Column columns[] = {
+    {"frame", R_FRAME, 2},
+    {"scanlines", R_SCANLINES, 2},
+    {"tankRow0", R_TANK_ROW, 1},
+    {"tankRow1", R_TANK_ROW + 1, 1},
+    {"tankColumn0", R_TANK_COLUMN, 1},
+    {"tankColumn1", R_TANK_COLUMN + 1, 1},
+    {"tankDirection0", R_TANK_DIRECTION, 1},
+    {"tankDirection1", R_TANK_DIRECTION + 1, 1},
+    {"shellRow0", R_SHELL_ROW, 1},
+    {"shellRow1", R_SHELL_ROW + 1, 1},
+    {"shellRow2", R_SHELL_ROW + 2, 1},
+    {"shellRow3", R_SHELL_ROW + 3, 1},
+    {"shellColumn0", R_SHELL_COLUMN, 1},
+    {"shellColumn1", R_SHELL_COLUMN + 1, 1},
+    {"shellColumn2", R_SHELL_COLUMN + 2, 1},
+    {"shellColumn3", R_SHELL_COLUMN + 3, 1},
+    {"shellDirection0", R_SHELL_DIRECTION, 1},
+    {"shellDirection1", R_SHELL_DIRECTION + 1, 1},
+    {"shellDirection2", R_SHELL_DIRECTION + 2, 1},
+    {"shellDirection3", R_SHELL_DIRECTION + 3, 1},
+    {"input", R_INPUT, 1},
+    {"aiMove", R_AI_MOVE, 1},
+    {"missilePlayfield0", R_MISSILE_PLAYFIELD, 1},
+    {"missilePlayfield1", R_MISSILE_PLAYFIELD + 1, 1},
+    {"missilePlayfield2", R_MISSILE_PLAYFIELD + 2, 1},
+    {"missilePlayfield3", R_MISSILE_PLAYFIELD + 3, 1},
+    {"missilePlayer0", R_MISSILE_PLAYER, 1},
+    {"missilePlayer1", R_MISSILE_PLAYER + 1, 1},
+    {"missilePlayer2", R_MISSILE_PLAYER + 2, 1},
+    {"missilePlayer3", R_MISSILE_PLAYER + 3, 1},
+    {"playerPlayfield0", R_PLAYER_PLAYFIELD, 1},
+    {"playerPlayfield1", R_PLAYER_PLAYFIELD + 1, 1},
+};
+#define COLUMN_COUNT        (sizeof(columns) / sizeof(columns[0]))
+
+//Column file header, followed by the columns at their offsets
+typedef struct {
+    char magic[8];
+    uint64_t frames;
+    uint64_t offset[COLUMN_COUNT];
+} ColumnHeader;
+
+//A read only memory mapped file
+typedef struct {
+    const unsigned char *data;
+    size_t size;
+} Mapping;
+
+//AI move names, from TankCombat.c
+static const struct {
+    unsigned char move;
+    const char *name;
+} moveNames[] = {
+    {0x00, "NOTHING"},
+    {0x01, "FORWARD"},
+    {0x02, "BACKWARD"},
+    {0x04, "LEFT_TURN"},
+    {0x08, "RIGHT_TURN"},
+    {0x10, "FIRE"},
+};
+
+//FramePath counters, in order
+static const char *const pathNames[PATH_SIZE] = {
+    "movement tick", "tank steps", "spins", "shell steps", "shells fired", "hits",
+    "shells removed", "shell bounces", "AI lines", "threat lookups", "AI instructions", "tank redraws",
+};
+
+//------------------------------ fail ------------------------------
+// Purpose: Print an error and exit.
+// Parameters:
+//   message - What went wrong.
+//   detail - The file or value it went wrong with.
+// Preconditions: None
+// Postconditions: Does not return
+static void fail(const char *message, const char *detail) {
+    fprintf(stderr, "tracestat: %s: %s\n", message, detail);
+    exit(1);
+}
+
+//------------------------------ mapFile ------------------------------
+// Purpose: Memory map a whole file read only.
+// Parameters:
+//   path - The file to map.
+// Preconditions: None
+// Postconditions: Returns the mapping, exits if the file cannot be mapped
+static Mapping mapFile(const char *path) {
+    Mapping mapping = {NULL, 0};
+    struct stat info;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &info) != 0) fail("cannot open", path);
+    mapping.size = (size_t)info.st_size;
+    if (mapping.size > 0) {
+        void *data = mmap(NULL, mapping.size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED) fail("cannot map", path);
+        mapping.data = data;
+    }
+    close(fd);
+    return mapping;
+}
+
+//------------------------------ unmapFile ------------------------------
+// Purpose: Release a mapping made by mapFile.
+// Parameters:
+//   mapping - The mapping to release.
+// Preconditions: None
+// Postconditions: The mapping can no longer be used
+static void unmapFile(Mapping mapping) {
+    if (mapping.size > 0) munmap((void *)mapping.data, mapping.size);
+}
+
+//------------------------------ readWord ------------------------------
+// Purpose: Read a little endian 16 bit value, the 6502's byte order.
+// Parameters:
+//   bytes - The low byte, followed by the high byte.
+// Preconditions: None
+// Postconditions: Returns the value
+static unsigned readWord(const unsigned char *bytes) {
+    return bytes[0] | (bytes[1] << 8);
+}
+
+//------------------------------ moveName ------------------------------
+// Purpose: Name a joystick move.
+// Parameters:
+//   move - Joystick bits.
+// Preconditions: None
+// Postconditions: Returns the name, or NULL for a combination of bits
+static const char *moveName(unsigned move) {
+    unsigned n;
+
+    for (n = 0; n < sizeof(moveNames) / sizeof(moveNames[0]); n++) {
+        if (moveNames[n].move == move) return moveNames[n].name;
+    }
+    return NULL;
+}
+
+//------------------------------ extractTrace ------------------------------
+// Purpose: Find the frameTrace ring buffer in a memory dump and append the records
+//          it holds to a trace file, oldest first.
+// Parameters:
+//   dumpPath - The emulator memory dump.
+//   tracePath - The trace file to append to.
+// Preconditions: None
+// Postconditions: Returns the number of records written
+static unsigned long extractTrace(const char *dumpPath, const char *tracePath) {
+    Mapping dump = mapFile(dumpPath);
+    const unsigned char *header = NULL;
+    unsigned recordCount, next, kept, oldest, n;
+    size_t at;
+    FILE *out;
+
+    //the header is "TKTR" followed by a version and record size this tool understands
+    for (at = 0; at + TRACE_HEADER_SIZE <= dump.size; at++) {
+        const unsigned char *candidate = dump.data + at;
+
+        if (memcmp(candidate, "TKTR", 4) == 0 && candidate[4] == TRACE_VERSION && candidate[5] == RECORD_SIZE) {
+            header = candidate;
+            break;
+        }
+    }
+    if (header == NULL) fail("no frame trace in", dumpPath);
+
+    recordCount = header[6];
+    next = header[7];
+    if (at + TRACE_HEADER_SIZE + (size_t)recordCount * RECORD_SIZE > dump.size) fail("frame trace cut off in", dumpPath);
+
+    //before the buffer fills the records start at 0, afterwards the oldest is the one about to be overwritten.
+    //The frame count wraps at 65536, so the header's wrapped flag says which.
+    if (!header[10]) {
+        kept = next;
+        oldest = 0;
+    } else {
+        kept = recordCount;
+        oldest = next;
+    }
+
+    out = fopen(tracePath, "ab");
+    if (out == NULL) fail("cannot write", tracePath);
+    for (n = 0; n < kept; n++) {
+        const unsigned char *record = header + TRACE_HEADER_SIZE + ((oldest + n) % recordCount) * RECORD_SIZE;
+
+        fwrite(record, RECORD_SIZE, 1, out);
+    }
+    if (fclose(out) != 0) fail("cannot write", tracePath);
+
+    unmapFile(dump);
+    return kept;
+}
+
+//------------------------------ buildColumns ------------------------------
+// Purpose: Convert trace files into a column file. The output is sized up front
+//          and filled through a writable mapping, so collections larger than
+//          memory convert in one pass.
+// Parameters:
+//   columnPath - The column file to create.
+//   tracePaths - The trace files to convert.
+//   traceCount - The number of trace files.
+// Preconditions: None
+// Postconditions: Returns the number of frames written
+static uint64_t buildColumns(const char *columnPath, char **tracePaths, int traceCount) {
+    ColumnHeader header;
+    uint64_t frames = 0;
+    uint64_t at;
+    uint64_t written = 0;
+    unsigned char *out;
+    size_t c;
+    int fd, n;
+
+    for (n = 0; n < traceCount; n++) {
+        struct stat info;
+
+        if (stat(tracePaths[n], &info) != 0) fail("cannot open", tracePaths[n]);
+        if (info.st_size % RECORD_SIZE != 0) fail("not a whole number of records", tracePaths[n]);
+        frames += (uint64_t)info.st_size / RECORD_SIZE;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COLUMN_MAGIC, sizeof(COLUMN_MAGIC));
+    header.frames = frames;
+    at = sizeof(header);
+    for (c = 0; c < COLUMN_COUNT; c++) {
+        at = (at + COLUMN_ALIGN - 1) & ~(uint64_t)(COLUMN_ALIGN - 1);
+        header.offset[c] = at;
+        at += frames * columns[c].width;
+    }
+
+    fd = open(columnPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)at) != 0) fail("cannot write", columnPath);
+    out = mmap(NULL, at, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (out == MAP_FAILED) fail("cannot map", columnPath);
+    memcpy(out, &header, sizeof(header));
+
+    for (n = 0; n < traceCount; n++) {
+        Mapping trace = mapFile(tracePaths[n]);
+        uint64_t records = trace.size / RECORD_SIZE;
+        uint64_t r;
+
+        for (c = 0; c < COLUMN_COUNT; c++) {
+            const unsigned char *field = trace.data + columns[c].offset;
+            unsigned char *column = out + header.offset[c] + written * columns[c].width;
+
+            if (columns[c].width == 2) {
+                uint16_t *words = (uint16_t *)column;
+
+                for (r = 0; r < records; r++) words[r] = (uint16_t)readWord(field + r * RECORD_SIZE);
+            } else {
+                for (r = 0; r < records; r++) column[r] = field[r * RECORD_SIZE];
+            }
+        }
+
+        written += records;
+        unmapFile(trace);
+    }
+
+    if (munmap(out, at) != 0 || close(fd) != 0) fail("cannot write", columnPath);
+    return frames;
+}
+
+//------------------------------ findColumn ------------------------------
+// Purpose: Look up a column in a mapped column file.
+// Parameters:
+//   file - The mapped column file.
+//   name - The column name.
+// Preconditions: The file must have passed openColumns
+// Postconditions: Returns the start of the column
+static const void *findColumn(Mapping file, const char *name) {
+    const ColumnHeader *header = (const ColumnHeader *)file.data;
+    size_t c;
+
+    for (c = 0; c < COLUMN_COUNT; c++) {
+        if (strcmp(columns[c].name, name) == 0) return file.data + header->offset[c];
+    }
+    fail("no such column", name);
+    return NULL;
+}
+
+//------------------------------ openColumns ------------------------------
+// Purpose: Map a column file and check it was made by this version of the tool.
+// Parameters:
+//   path - The column file.
+//   frames - Set to the number of frames in the file.
+// Preconditions: None
+// Postconditions: Returns the mapping
+static Mapping openColumns(const char *path, uint64_t *frames) {
+    Mapping file = mapFile(path);
+    const ColumnHeader *header = (const ColumnHeader *)file.data;
+
+    if (file.size < sizeof(ColumnHeader) || memcmp(header->magic, COLUMN_MAGIC, sizeof(COLUMN_MAGIC)) != 0) {
+        fail("not a column file", path);
+    }
+    *frames = header->frames;
+    return file;
+}
+
+//------------------------------ reportCosts ------------------------------
+// Purpose: Print a histogram of the scanlines each frame used, with the mean,
+//          percentiles and the frames that missed vertical blank.
+// Parameters:
+//   path - The column file.
+// Preconditions: None
+// Postconditions: The report is printed
+static void reportCosts(const char *path) {
+    static uint64_t counts[65536];
+    uint64_t frames, f, seen, over = 0, total = 0, peak = 0;
+    Mapping file = openColumns(path, &frames);
+    const uint16_t *scanlines = findColumn(file, "scanlines");
+    const double percentiles[] = {0.50, 0.90, 0.99, 1.00};
+    unsigned long binCounts[FRAME_SCANLINES / 16 + 2] = {0};
+    const unsigned lastBin = sizeof(binCounts) / sizeof(binCounts[0]) - 1;
+    unsigned value, b, p;
+
+    if (frames == 0) fail("no frames in", path);
+
+    for (f = 0; f < frames; f++) {
+        counts[scanlines[f]]++;
+        total += scanlines[f];
+        if (scanlines[f] > FRAME_SCANLINES) over++;
+    }
+
+    printf("frames         %llu\n", (unsigned long long)frames);
+    printf("mean scanlines %.1f\n", (double)total / frames);
+    for (p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); p++) {
+        uint64_t rank = (uint64_t)(percentiles[p] * (frames - 1));
+
+        for (value = 0, seen = 0; value < 65536; value++) {
+            seen += counts[value];
+            if (seen > rank) break;
+        }
+        printf("p%-13g %u\n", percentiles[p] * 100, value);
+    }
+    printf("over budget    %llu (%.2f%%)\n\n", (unsigned long long)over, 100.0 * over / frames);
+
+    //16 scanline bins up to a whole frame, then one bin for everything that missed vertical blank
+    for (value = 0; value < 65536; value++) {
+        b = value / 16;
+        if (value > FRAME_SCANLINES || b > lastBin) b = lastBin;
+        binCounts[b] += counts[value];
+    }
+    for (b = 0; b <= lastBin; b++) {
+        if (binCounts[b] > peak) peak = binCounts[b];
+    }
+    for (b = 0; b <= lastBin; b++) {
+        int bar = peak ? (int)(50 * binCounts[b] / peak) : 0;
+
+        if (binCounts[b] == 0) continue;
+        if (b == lastBin) printf("   >%3u ", FRAME_SCANLINES);
+        else printf("%3u-%3u ", b * 16, b * 16 + 15);
+        printf("%10lu %-50.*s\n", binCounts[b], bar, "##################################################");
+    }
+
+    unmapFile(file);
+}
+
+//------------------------------ reportHeatmap ------------------------------
+// Purpose: Count where on the board tanks were hit. A frame where a missile's
+//          collision register has the opposing tank's bit set is a hit at the
+//          hit tank's position.
+// Parameters:
+//   path - The column file.
+//   imagePath - Grey scale PGM image to write the heatmap to, or NULL.
+// Preconditions: None
+// Postconditions: The busiest 8x8 board areas are printed and the image written
+static void reportHeatmap(const char *path, const char *imagePath) {
+    static uint32_t heat[BOARD_ROWS][BOARD_COLUMNS];
+    uint32_t areas[(BOARD_ROWS + 7) / 8][BOARD_COLUMNS / 8];
+    uint64_t frames, f, hits[2] = {0, 0}, outside = 0;
+    uint32_t hottest = 0;
+    Mapping file = openColumns(path, &frames);
+    const unsigned char *tankRow[2], *tankColumn[2], *missilePlayer[4];
+    char name[32];
+    unsigned n, row, column;
+
+    for (n = 0; n < 2; n++) {
+        sprintf(name, "tankRow%u", n);
+        tankRow[n] = findColumn(file, name);
+        sprintf(name, "tankColumn%u", n);
+        tankColumn[n] = findColumn(file, name);
+    }
+    for (n = 0; n < 4; n++) {
+        sprintf(name, "missilePlayer%u", n);
+        missilePlayer[n] = findColumn(file, name);
+    }
+
+    for (f = 0; f < frames; f++) {
+        for (n = 0; n < 4; n++) {
+            //shell n belongs to tank n & 1 and only hits the other one
+            unsigned target = (n & 1) ^ 1;
+
+            if (!(missilePlayer[n][f] & (1 << target))) continue;
+            hits[target]++;
+            row = tankRow[target][f];
+            column = tankColumn[target][f];
+            if (row < BOARD_ROWS && column < BOARD_COLUMNS) heat[row][column]++;
+            else outside++;
+        }
+    }
+
+    memset(areas, 0, sizeof(areas));
+    for (row = 0; row < BOARD_ROWS; row++) {
+        for (column = 0; column < BOARD_COLUMNS; column++) {
+            areas[row / 8][column / 8] += heat[row][column];
+            if (heat[row][column] > hottest) hottest = heat[row][column];
+        }
+    }
+
+    printf("frames            %llu\n", (unsigned long long)frames);
+    printf("hits on tank 0    %llu\n", (unsigned long long)hits[0]);
+    printf("hits on tank 1    %llu\n", (unsigned long long)hits[1]);
+    if (outside) printf("hits off board    %llu\n", (unsigned long long)outside);
+    printf("\nhits per 8x8 area (rows down, columns across)\n");
+    for (row = 0; row < (BOARD_ROWS + 7) / 8; row++) {
+        printf("%3u ", row * 8);
+        for (column = 0; column < BOARD_COLUMNS / 8; column++) printf("%5u", areas[row][column]);
+        printf("\n");
+    }
+
+    if (imagePath != NULL) {
+        FILE *image = fopen(imagePath, "wb");
+
+        if (image == NULL) fail("cannot write", imagePath);
+        fprintf(image, "P5\n%d %d\n255\n", BOARD_COLUMNS, BOARD_ROWS);
+        for (row = 0; row < BOARD_ROWS; row++) {
+            for (column = 0; column < BOARD_COLUMNS; column++) {
+                fputc(hottest ? (int)(255 * (uint64_t)heat[row][column] / hottest) : 0, image);
+            }
+        }
+        if (fclose(image) != 0) fail("cannot write", imagePath);
+    }
+
+    unmapFile(file);
+}
+
+//------------------------------ reportAI ------------------------------
+// Purpose: Print how often the AI picked each move on movement ticks.
+// Parameters:
+//   path - The column file.
+// Preconditions: None
+// Postconditions: The distribution is printed
+static void reportAI(const char *path) {
+    uint64_t counts[256] = {0};
+    uint64_t frames, f, ticks = 0;
+    Mapping file = openColumns(path, &frames);
+    const unsigned char *aiMove = findColumn(file, "aiMove");
+    unsigned move;
+
+    for (f = 0; f < frames; f++) counts[aiMove[f]]++;
+    for (move = 0; move < 256; move++) {
+        if (move != TRACE_NO_MOVE) ticks += counts[move];
+    }
+
+    printf("frames          %llu\n", (unsigned long long)frames);
+    printf("movement ticks  %llu\n\n", (unsigned long long)ticks);
+    for (move = 0; move < 256; move++) {
+        const char *name = moveName(move);
+
+        if (move == TRACE_NO_MOVE || counts[move] == 0) continue;
+        if (name != NULL) printf("%-12s", name);
+        else printf("0x%02X        ", move);
+        printf("%10llu %6.2f%%\n", (unsigned long long)counts[move], 100.0 * counts[move] / ticks);
+    }
+
+    unmapFile(file);
+}
+
+//------------------------------ printSearchState ------------------------------
+// Purpose: Print a SearchRecord from the worst frame search report.
+// Parameters:
+//   title - What the state is.
+//   scanlines - What its frame cost.
+//   budget - Scanlines in a frame.
+//   state - The record.
+// Preconditions: None
+// Postconditions: The state is printed
+static void printSearchState(const char *title, unsigned scanlines, unsigned budget, const unsigned char *state) {
+    const char *input = moveName(state[S_INPUT]);
+    unsigned n;
+
+    printf("%s: %u scanlines, %d to spare\n", title, scanlines, (int)budget - (int)scanlines);
+    for (n = 0; n < 2; n++) {
+        const char *history = moveName(state[S_HISTORY + n]);
+
+        printf("  tank %u      row %3u column %3u direction %2u", n, state[S_TANK_ROW + n], state[S_TANK_COLUMN + n],
+               state[S_TANK_DIRECTION + n]);
+        if (state[S_HIT_TIME + n] > 0) {
+            printf(", spinning %u more ticks, hit from %u", state[S_HIT_TIME + n], state[S_HIT_DIRECTION + n]);
+        }
+        printf(", last move %s", history != NULL ? history : "?");
+        printf(", %s\n", (state[S_FIRE_READY] >> n) & 1 ? "loaded" : "reloading");
+    }
+    for (n = 0; n < 4; n++) {
+        if (state[S_SHELL_ROW + n] == SEARCH_NO_SHELL) continue;
+        printf("  shell %u     row %3u column %3u direction %2u\n", n, state[S_SHELL_ROW + n], state[S_SHELL_COLUMN + n],
+               state[S_SHELL_DIRECTION + n]);
+    }
+    printf("  input       %s\n", input != NULL ? input : "?");
+    if (state[S_TICKS_AWAY] == 0) printf("  movement tick this frame\n");
+    else printf("  movement tick in %u frames\n", state[S_TICKS_AWAY]);
+    printf("  AI opening  %u moves left\n", state[S_AI_OPENING]);
+}
+
+//------------------------------ reportWorst ------------------------------
+// Purpose: Find the frameSearch report in a memory dump and print it.
+// Parameters:
+//   dumpPath - The emulator memory dump.
+// Preconditions: None
+// Postconditions: The report is printed
+static void reportWorst(const char *dumpPath) {
+    Mapping dump = mapFile(dumpPath);
+    const unsigned char *header = NULL;
+    const unsigned char *worstPath, *reproducerPath;
+    unsigned budget, worst, reproducer, n;
+    size_t at;
+
+    for (at = 0; at + SEARCH_HEADER_SIZE + 2 * (PATH_SIZE + STATE_SIZE) <= dump.size; at++) {
+        const unsigned char *candidate = dump.data + at;
+
+        if (memcmp(candidate, "TKWF", 4) == 0 && candidate[4] == SEARCH_VERSION) {
+            header = candidate;
+            break;
+        }
+    }
+    if (header == NULL) fail("no worst frame search in", dumpPath);
+
+    budget = readWord(header + 6);
+    worst = readWord(header + 10);
+    reproducer = readWord(header + 12);
+    worstPath = header + SEARCH_HEADER_SIZE;
+    reproducerPath = worstPath + PATH_SIZE;
+    if (header[5] == 0 || worst == 0) fail("no search has finished in", dumpPath);
+
+    printf("searches        %u\n", header[5]);
+    printf("states played   %u\n", readWord(header + 8));
+    printf("frame budget    %u scanlines\n\n", budget);
+
+    printSearchState("worst frame", worst, budget, reproducerPath + PATH_SIZE);
+    printf("\n");
+    printSearchState("reproducer", reproducer, budget, reproducerPath + PATH_SIZE + STATE_SIZE);
+
+    printf("\n%-16s %6s %10s\n", "path", "worst", "reproducer");
+    for (n = 0; n < PATH_SIZE; n++) {
+        printf("%-16s %6u %10u\n", pathNames[n], worstPath[n], reproducerPath[n]);
+    }
+
+    unmapFile(dump);
+}
+
+//------------------------------ usage ------------------------------
+// Purpose: Print the command line and exit.
+// Parameters: None
+// Preconditions: None
+// Postconditions: Does not return
+static void usage(void) {
+    fprintf(stderr,
+            "usage: tracestat extract <memory dump> <trace file>\n"
+            "       tracestat columns <column file> <trace file>...\n"
+            "       tracestat costs <column file>\n"
+            "       tracestat heatmap <column file> [<pgm file>]\n"
+            "       tracestat ai <column file>\n"
+            "       tracestat worst <memory dump>\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) usage();
+
+    if (strcmp(argv[1], "extract") == 0 && argc == 4) {
+        printf("%lu records\n", extractTrace(argv[2], argv[3]));
+    } else if (strcmp(argv[1], "columns") == 0 && argc >= 4) {
+        printf("%llu frames\n", (unsigned long long)buildColumns(argv[2], argv + 3, argc - 3));
+    } else if (strcmp(argv[1], "costs") == 0 && argc == 3) {
+        reportCosts(argv[2]);
+    } else if (strcmp(argv[1], "heatmap") == 0 && (argc == 3 || argc == 4)) {
+        reportHeatmap(argv[2], argc == 4 ? argv[3] : NULL);
+    } else if (strcmp(argv[1], "ai") == 0 && argc == 3) {
+        reportAI(argv[2]);
+    } else if (strcmp(argv[1], "worst") == 0 && argc == 3) {
+        reportWorst(argv[2]);
+    } else {
+        usage();
+    }
+
+    return 0;
+}
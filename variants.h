@@ -0,0 +1,76 @@
+/*
+    ----------------------------------------------- variants.h --------------------------------------------------------
+    Description                 : Game variants for TankCombat.c, picked at compile time
+    --------------------------------------------------------------------------------------------------------------------
+    Pick a variant with -DVARIANT=n. Every variant is its own build: the rules it does not use are not
+    compiled in at all, so no variant pays for another's rules in its frame time. Any single setting
+    can still be overridden on the command line, e.g. -DWIN_SCORE=5.
+
+        VARIANT=1   Tank                The original game (the default)
+        VARIANT=2   Tank-Pong           One shell each, bouncing off the walls
+        VARIANT=3   Invisible Tank      Tanks only show when they fire or are hit
+        VARIANT=4   Invisible Tank-Pong Invisible tanks with bouncing shells
+        VARIANT=5   Blitz               Faster moves and reloads, first to 5 wins
+    --------------------------------------------------------------------------------------------------------------------
+*/
+#ifndef VARIANTS_H
+#define VARIANTS_H
+
+#ifndef VARIANT
+#define VARIANT 1
+#endif
+
+#if VARIANT == 1
+//Tank: everything at the defaults below
+#elif VARIANT == 2
+#define RICOCHET
+#define MISSILES_PER_TANK   1
+#elif VARIANT == 3
+#define INVISIBLE_TANKS
+#elif VARIANT == 4
+#define INVISIBLE_TANKS
+#define RICOCHET
+#define MISSILES_PER_TANK   1
+#elif VARIANT == 5
+#define MOVE_TICK_FRAMES    3
+#define P0_FIRE_COOLDOWN    40
+#define P1_FIRE_COOLDOWN    70
+#define WIN_SCORE           5
+#else
+#error Unknown VARIANT, see variants.h
+#endif
+
+//Settings a variant leaves out get the original game's value
+#ifndef MOVE_TICK_FRAMES
+#define MOVE_TICK_FRAMES    5              //frames between movement ticks, tanks move and turn once a tick
+#endif
+#ifndef P0_FIRE_COOLDOWN
+#define P0_FIRE_COOLDOWN    60             //frames before player 1 can fire again
+#endif
+#ifndef P1_FIRE_COOLDOWN
+#define P1_FIRE_COOLDOWN    100            //frames before the AI can fire again
+#endif
+#ifndef HIT_SPIN_TICKS
+#define HIT_SPIN_TICKS      12             //movement ticks a hit tank spins for
+#endif
+#ifndef AI_OPENING
+#define AI_OPENING          72             //moves the AI drives forward at the start before it starts attacking
+#endif
+#ifndef WIN_SCORE
+#define WIN_SCORE           9              //points to win, at most 9 (one digit on the score line)
+#endif
+#ifndef MISSILES_PER_TANK
+#define MISSILES_PER_TANK   2              //shells each tank can have in flight, 1 or 2
+#endif
+#if defined(INVISIBLE_TANKS) && !defined(REVEAL_FRAMES)
+#define REVEAL_FRAMES       30             //frames an invisible tank shows for after firing
+#endif
+
+#if WIN_SCORE < 1 || WIN_SCORE > 9
+#error WIN_SCORE must be 1 - 9
+#endif
+#if MISSILES_PER_TANK < 1 || MISSILES_PER_TANK > 2
+#error MISSILES_PER_TANK must be 1 or 2, there are 4 hardware missiles
+#endif
+
+#endif